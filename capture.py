@@ -0,0 +1,131 @@
+#!/usr/bin/env python3
+
+import os
+import sys
+import time
+import select
+
+import telemetry
+from telemetry import FrameType, EventKind
+from capture_file import Writer
+
+READ_SIZE = 1 << 20
+
+
+class Capture:
+    def __init__(self, port, output, csv=None, log=None, events=None):
+        self.fd = telemetry.open_port(port)
+        self.decoder = telemetry.Decoder()
+        self.output = Writer(output)
+        self.csv = open(csv, 'w') if csv else None
+        if self.csv:
+            self.csv.write('host_ns,seq,device_us,aligned,channel,voltage_uv,current_ua,power_uw,period_us\n')
+        self.log = open(log, 'wb') if log else None
+        self.bytes = 0
+        self.samples = 0
+        self.lines = 0
+        self.periods = {}  # channel: sampling period from the last RATE frame
+        self.events = open(events, 'w') if events else None
+        if self.events:
+            self.events.write('host_ns,device_us,delay_us,channel,kind,before_ua,after_ua,duration_ms,energy_j\n')
+
+    def close(self):
+        os.close(self.fd)
+        self.output.close()
+        if self.csv:
+            self.csv.close()
+        if self.log:
+            self.log.close()
+        if self.events:
+            self.events.close()
+
+    def read(self, timeout):
+        """Drains everything the port has, returns False once the other side is gone"""
+        ready, _, _ = select.select([self.fd], [], [], timeout)
+        if not ready:
+            return True
+        try:
+            data = os.read(self.fd, READ_SIZE)
+        except BlockingIOError:
+            return True
+        except OSError:
+            return False
+        if not data:
+            return False
+        self.bytes += len(data)
+        now = time.monotonic_ns()
+        rows = []
+        for item in self.decoder.feed(data):
+            if item[0] == 'text':
+                self.lines += 1
+                if self.log:
+                    self.log.write(item[1])
+                continue
+            _, frame_type, seq, payload = item
+            if frame_type == FrameType.SAMPLES:
+                self.output.add_samples(payload)
+            else:
+                self.output.add_frame(now, frame_type, seq, payload)
+            if frame_type == FrameType.RATE:
+                channel, _, _, _, period_us = telemetry.RATE.unpack(payload)
+                self.periods[channel] = period_us
+            elif frame_type == FrameType.EVENT and self.events:
+                channel, kind, _, device_us, delay_us, before, after, duration_ms, energy = \
+                    telemetry.EVENT.unpack(payload)
+                self.events.write('%d,%d,%d,%d,%s,%d,%d,%d,%.6f\n' % (
+                    now, device_us, delay_us, channel, EventKind(kind).name.lower(), before, after, duration_ms,
+                    energy))
+            elif frame_type in (FrameType.SAMPLES, FrameType.ALIGNED):
+                aligned = frame_type == FrameType.ALIGNED
+                header = telemetry.ALIGNED_HEADER if aligned else telemetry.SAMPLES_HEADER
+                device_us = header.unpack_from(payload)[0 if aligned else 3]
+                for channel, sample in telemetry.samples(payload, header):
+                    self.samples += 1
+                    if self.csv:
+                        rows.append('%d,%d,%d,%d,%d,%d,%d,%d,%d\n' % (now, seq, device_us, aligned, channel, *sample,
+                                                                     self.periods.get(channel, 0)))
+        if rows:
+            self.csv.write(''.join(rows))
+        return True
+
+
+def main():
+    import argparse
+
+    parser = argparse.ArgumentParser()
+    parser.add_argument('port')
+    parser.add_argument('output', help='capture file, see capture_file.py')
+    parser.add_argument('--csv', help='also write samples as CSV')
+    parser.add_argument('--log', help='write interleaved text log lines here')
+    parser.add_argument('--events', help='write load events as CSV')
+    parser.add_argument('--duration', type=float, default=0, help='stop after this many seconds')
+    args = parser.parse_args()
+
+    capture = Capture(args.port, args.output, args.csv, args.log, args.events)
+    started = last = time.monotonic()
+    last_bytes = last_frames = 0
+    try:
+        while capture.read(0.2):
+            now = time.monotonic()
+            if args.duration and now - started >= args.duration:
+                break
+            if now - last >= 1.0:
+                decoder = capture.decoder
+                sys.stderr.write('\r%7.2f MB/s %8.0f frames/s  frames:%d samples:%d lines:%d lost:%d crc:%d ' % (
+                    (capture.bytes - last_bytes) / (now - last) / 1e6,
+                    (decoder.frames - last_frames) / (now - last),
+                    decoder.frames, capture.samples, capture.lines, decoder.lost, decoder.crc_errors))
+                last, last_bytes, last_frames = now, capture.bytes, decoder.frames
+    except KeyboardInterrupt:
+        pass
+    finally:
+        decoder = capture.decoder
+        capture.close()
+        elapsed = time.monotonic() - started
+        sys.stderr.write('\n%d bytes in %.1fs, %d frames, %d samples, %d lines, %d lost, %d crc errors\n' % (
+            capture.bytes, elapsed, decoder.frames, capture.samples, capture.lines, decoder.lost,
+            decoder.crc_errors))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,449 @@
+#!/usr/bin/env python3
+
+# Chunk-indexed capture file, written by capture.py:
+#   HEADER | chunk... | sample index | summaries | frame index | FOOTER
+# Every chunk is a CHUNK_HEADER followed by its zlib-compressed payload.
+#
+# Sample chunks hold up to `chunk_rows` readings from SAMPLES frames, column by column:
+#   time deltas:i64[rows] | channel:u8[rows] | voltage_uv:i32[rows] | current_ua:i32[rows] | power_uw:u32[rows]
+# Times are device microseconds extended to 64 bits. The sample index has one SAMPLE_ENTRY per sample chunk
+# in time order, each pointing at one SUMMARY per channel in the chunk. Queries over long ranges are answered
+# from the summaries, only the chunks at the edges of a range are decompressed.
+#
+# Frame chunks keep every other frame as host_ns:u64 | type:u8 | seq:u8 | length:u16 | payload records.
+#
+# A file without a footer (the capture was killed) is still readable: the index is rebuilt from the chunks.
+#
+# Chunks are sorted inside but not against each other: a bus whose frames arrive late puts older readings into
+# a later chunk. Reader therefore seeks on the running maximum of the chunks' last times and stops on the
+# minimum of the first times still ahead, both derived from the index when the file is opened.
+#
+# Reader is the mmap-backed reader the capture format was designed around, the index keeps its queries off the
+# sample data. host/capture_file.hh has the same reader and writer in C++ for captures too long for Python.
+
+import sys
+import mmap
+import bisect
+import zlib
+import array
+import struct
+import itertools
+
+import telemetry
+
+MAGIC = b'TMCAP\x02\x00\x00'
+END = b'TMCAPEND'
+HEADER = struct.Struct('<8sI4x')
+CHUNK_HEADER = struct.Struct('<4sB3xIIIQQ')  # tag, kind, rows or records, raw size, stored size, first, last
+SAMPLE_ENTRY = struct.Struct('<QQQIIH2x')  # offset, first_us, last_us, rows, first summary, summaries
+SUMMARY = struct.Struct('<BxxxIiiiiIIqqqd')  # channel, count, min/max v i p, sums v i p, energy_j
+FRAME_ENTRY = struct.Struct('<QQQI4x')  # offset, first_ns, last_ns, records
+FOOTER = struct.Struct('<QIIQIQI4x8s')  # index, chunks, crc, summaries, count, frames, frame chunks, END
+RECORD = struct.Struct('<QBBH')
+
+SAMPLE_TAG = b'TMCK'
+FRAME_TAG = b'TMFR'
+CHUNK_ROWS = 4096
+FRAME_CHUNK_BYTES = 256 * 1024
+MAX_GAP_US = 10000000  # longest sampling period, a longer gap is not integrated into energy
+
+
+class Summary:
+    """Count, range, mean and energy of one channel over a stretch of readings"""
+
+    __slots__ = ('channel', 'count', 'voltage', 'current', 'power', 'sums', 'energy_j')
+
+    def __init__(self, channel):
+        self.channel = channel
+        self.count = 0
+        self.voltage = self.current = self.power = None  # (min, max)
+        self.sums = [0, 0, 0]
+        self.energy_j = 0.0
+
+    def add(self, voltage, current, power, dt_us):
+        if self.count == 0:
+            self.voltage, self.current, self.power = (voltage, voltage), (current, current), (power, power)
+        else:
+            self.voltage = (min(self.voltage[0], voltage), max(self.voltage[1], voltage))
+            self.current = (min(self.current[0], current), max(self.current[1], current))
+            self.power = (min(self.power[0], power), max(self.power[1], power))
+        self.count += 1
+        self.sums[0] += voltage
+        self.sums[1] += current
+        self.sums[2] += power
+        if 0 < dt_us <= MAX_GAP_US:
+            self.energy_j += power * dt_us * 1e-12
+
+    def merge(self, other):
+        if other.count == 0:
+            return self
+        if self.count == 0:
+            self.voltage, self.current, self.power = other.voltage, other.current, other.power
+        else:
+            self.voltage = (min(self.voltage[0], other.voltage[0]), max(self.voltage[1], other.voltage[1]))
+            self.current = (min(self.current[0], other.current[0]), max(self.current[1], other.current[1]))
+            self.power = (min(self.power[0], other.power[0]), max(self.power[1], other.power[1]))
+        self.count += other.count
+        self.sums = [a + b for a, b in zip(self.sums, other.sums)]
+        self.energy_j += other.energy_j
+        return self
+
+    def mean(self):
+        """Mean (voltage_uv, current_ua, power_uw)"""
+        return tuple(s / self.count for s in self.sums) if self.count else (0, 0, 0)
+
+    def pack(self):
+        return SUMMARY.pack(self.channel, self.count, *self.voltage, *self.current, *self.power, *self.sums,
+                            self.energy_j)
+
+    @classmethod
+    def unpack_from(cls, buffer, offset):
+        channel, count, vlo, vhi, ilo, ihi, plo, phi, vs, cs, ps, energy = SUMMARY.unpack_from(buffer, offset)
+        summary = cls(channel)
+        summary.count = count
+        summary.voltage, summary.current, summary.power = (vlo, vhi), (ilo, ihi), (plo, phi)
+        summary.sums = [vs, cs, ps]
+        summary.energy_j = energy
+        return summary
+
+    def __repr__(self):
+        if self.count == 0:
+            return 'Summary(ch%d empty)' % self.channel
+        v, i, p = self.mean()
+        return 'Summary(ch%d n=%d V %.3f..%.3f mean %.3f, A %.4f..%.4f mean %.4f, W max %.3f, %.3fJ)' % (
+            self.channel, self.count, self.voltage[0] / 1e6, self.voltage[1] / 1e6, v / 1e6,
+            self.current[0] / 1e6, self.current[1] / 1e6, i / 1e6, self.power[1] / 1e6, self.energy_j)
+
+
+class DeviceClock:
+    """Extends the 32-bit device microsecond clock to 64 bits"""
+
+    def __init__(self):
+        self.last = None
+        self.high = 0
+
+    def extend(self, time_us):
+        if self.last is not None and time_us < self.last and self.last - time_us > 1 << 31:
+            self.high += 1 << 32
+        self.last = time_us
+        return self.high + time_us
+
+
+class Writer:
+    def __init__(self, path, chunk_rows=CHUNK_ROWS):
+        self.file = open(path, 'wb')
+        self.file.write(HEADER.pack(MAGIC, chunk_rows))
+        self.chunk_rows = chunk_rows
+        self.clock = DeviceClock()
+        self.rows = []
+        self.last_us = {}  # channel: time of its previous reading, for energy
+        self.frames = bytearray()
+        self.frame_records = 0
+        self.frame_range = None
+        self.sample_index = bytearray()
+        self.summaries = bytearray()
+        self.summary_count = 0
+        self.frame_index = bytearray()
+
+    def close(self):
+        self.flush()
+        index = self.file.tell()
+        self.file.write(self.sample_index)
+        summaries = self.file.tell()
+        self.file.write(self.summaries)
+        frames = self.file.tell()
+        self.file.write(self.frame_index)
+        self.file.write(FOOTER.pack(index, len(self.sample_index) // SAMPLE_ENTRY.size,
+                                    zlib.crc32(self.sample_index), summaries, self.summary_count, frames,
+                                    len(self.frame_index) // FRAME_ENTRY.size, END))
+        self.file.close()
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *args):
+        self.close()
+
+    def add_samples(self, payload):
+        """Takes the payload of a SAMPLES frame"""
+        time_us = self.clock.extend(telemetry.SAMPLES_HEADER.unpack_from(payload)[3])
+        for channel, (voltage, current, power) in telemetry.samples(payload):
+            self.add_row(time_us, channel, voltage, current, power)
+
+    def add_row(self, time_us, channel, voltage, current, power):
+        self.rows.append((time_us, channel, voltage, current, power))
+        if len(self.rows) >= self.chunk_rows:
+            self.flush_samples()
+
+    def add_frame(self, host_ns, frame_type, seq, payload):
+        self.frames += RECORD.pack(host_ns, frame_type, seq, len(payload))
+        self.frames += payload
+        self.frame_records += 1
+        self.frame_range = (self.frame_range[0] if self.frame_range else host_ns, host_ns)
+        if len(self.frames) >= FRAME_CHUNK_BYTES:
+            self.flush_frames()
+
+    def flush(self):
+        self.flush_samples()
+        self.flush_frames()
+        self.file.flush()
+
+    def flush_samples(self):
+        if not self.rows:
+            return
+        rows = self.rows
+        self.rows = []
+        # readings of one frame share a time, frames of different buses may arrive slightly out of order
+        rows.sort(key=lambda row: row[0])
+        times = [row[0] for row in rows]
+        summaries = {}
+        for time_us, channel, voltage, current, power in rows:
+            summary = summaries.get(channel)
+            if summary is None:
+                summary = summaries[channel] = Summary(channel)
+            previous = self.last_us.get(channel)
+            summary.add(voltage, current, power, time_us - previous if previous is not None else 0)
+            self.last_us[channel] = time_us
+        deltas = array.array('q', [times[0]] + [b - a for a, b in zip(times, times[1:])])
+        raw = b''.join((
+            deltas.tobytes(),
+            bytes(row[1] for row in rows),
+            array.array('i', [row[2] for row in rows]).tobytes(),
+            array.array('i', [row[3] for row in rows]).tobytes(),
+            array.array('I', [row[4] for row in rows]).tobytes(),
+        ))
+        offset = self.write_chunk(SAMPLE_TAG, 0, len(rows), raw, times[0], times[-1])
+        self.sample_index += SAMPLE_ENTRY.pack(offset, times[0], times[-1], len(rows), self.summary_count,
+                                               len(summaries))
+        for channel in sorted(summaries):
+            self.summaries += summaries[channel].pack()
+            self.summary_count += 1
+
+    def flush_frames(self):
+        if not self.frames:
+            return
+        offset = self.write_chunk(FRAME_TAG, 1, self.frame_records, bytes(self.frames), *self.frame_range)
+        self.frame_index += FRAME_ENTRY.pack(offset, *self.frame_range, self.frame_records)
+        self.frames = bytearray()
+        self.frame_records = 0
+        self.frame_range = None
+
+    def write_chunk(self, tag, kind, count, raw, first, last):
+        stored = zlib.compress(raw, 6)
+        offset = self.file.tell()
+        self.file.write(CHUNK_HEADER.pack(tag, kind, count, len(raw), len(stored), first, last))
+        self.file.write(stored)
+        return offset
+
+
+class Reader:
+    """Reads a capture file through mmap. Seeking by time is a binary search over the running maximum of the
+    chunks' last times."""
+
+    def __init__(self, path):
+        self.file = open(path, 'rb')
+        self.map = mmap.mmap(self.file.fileno(), 0, access=mmap.ACCESS_READ)
+        magic, self.chunk_rows = HEADER.unpack_from(self.map)
+        if magic != MAGIC:
+            raise ValueError('%s is not a capture file' % path)
+        self.recovered = False
+        if len(self.map) >= HEADER.size + FOOTER.size and self.map[-len(END):] == END:
+            (index, self.chunks, crc, summaries, _, frames, frame_chunks,
+             _) = FOOTER.unpack_from(self.map, len(self.map) - FOOTER.size)
+            self.index = memoryview(self.map)[index:index + self.chunks * SAMPLE_ENTRY.size]
+            self.summary_data = memoryview(self.map)[summaries:frames]
+            self.frame_index = memoryview(self.map)[frames:frames + frame_chunks * FRAME_ENTRY.size]
+            if zlib.crc32(self.index) != crc:
+                raise ValueError('%s: sample index is corrupt' % path)
+        else:
+            self.rebuild()
+        self.bound()
+
+    def bound(self):
+        """reach[k]: latest reading in chunks 0..k, floor[k]: earliest reading in chunks k.. (one past the end
+        is unbounded), so that seek and range scans stay correct when chunks overlap in time"""
+        self.reach = array.array('q', itertools.accumulate(
+            (entry[2] for entry in SAMPLE_ENTRY.iter_unpack(self.index)), max))
+        firsts = [entry[1] for entry in SAMPLE_ENTRY.iter_unpack(self.index)]
+        self.floor = array.array('q', reversed(list(itertools.accumulate(reversed(firsts), min))))
+        self.floor.append(2 ** 63 - 1)
+
+    def close(self):
+        self.index = self.summary_data = self.frame_index = None
+        self.map.close()
+        self.file.close()
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *args):
+        self.close()
+
+    def rebuild(self):
+        """Indexes a file that has no footer by walking its chunks, a truncated last chunk is dropped"""
+        index, summaries, frame_index = bytearray(), bytearray(), bytearray()
+        count = 0
+        last_us = {}
+        pos = HEADER.size
+        while pos + CHUNK_HEADER.size <= len(self.map):
+            tag, kind, rows, raw_size, stored_size, first, last = CHUNK_HEADER.unpack_from(self.map, pos)
+            if tag not in (SAMPLE_TAG, FRAME_TAG) or pos + CHUNK_HEADER.size + stored_size > len(self.map):
+                break
+            if tag == FRAME_TAG:
+                frame_index += FRAME_ENTRY.pack(pos, first, last, rows)
+            else:
+                chunk = {}
+                for time_us, channel, voltage, current, power in self.decode(pos):
+                    summary = chunk.setdefault(channel, Summary(channel))
+                    previous = last_us.get(channel)
+                    summary.add(voltage, current, power, time_us - previous if previous is not None else 0)
+                    last_us[channel] = time_us
+                index += SAMPLE_ENTRY.pack(pos, first, last, rows, count, len(chunk))
+                for channel in sorted(chunk):
+                    summaries += chunk[channel].pack()
+                    count += 1
+            pos += CHUNK_HEADER.size + stored_size
+        self.recovered = True
+        self.chunks = len(index) // SAMPLE_ENTRY.size
+        self.index, self.summary_data, self.frame_index = memoryview(index), memoryview(summaries), memoryview(
+            frame_index)
+
+    def entry(self, chunk):
+        """(offset, first_us, last_us, rows, first summary, summaries) of a sample chunk"""
+        return SAMPLE_ENTRY.unpack_from(self.index, chunk * SAMPLE_ENTRY.size)
+
+    def time_range(self):
+        if self.chunks == 0:
+            return 0, 0
+        return self.floor[0], self.reach[-1]
+
+    def seek(self, time_us):
+        """Index of the first chunk that ends at or after `time_us`, `chunks` if none does. No chunk before it
+        holds a reading at or after `time_us`."""
+        return bisect.bisect_left(self.reach, time_us)
+
+    def beyond(self, chunk, time_us):
+        """True when neither `chunk` nor any after it holds a reading before `time_us`"""
+        return self.floor[chunk] >= time_us
+
+    def chunk_summaries(self, chunk):
+        _, _, _, _, first, count = self.entry(chunk)
+        return [Summary.unpack_from(self.summary_data, (first + i) * SUMMARY.size) for i in range(count)]
+
+    def chunk_summary(self, chunk, channel):
+        for summary in self.chunk_summaries(chunk):
+            if summary.channel == channel:
+                return summary
+        return Summary(channel)
+
+    def decode(self, offset):
+        _, _, rows, raw_size, stored_size, _, _ = CHUNK_HEADER.unpack_from(self.map, offset)
+        start = offset + CHUNK_HEADER.size
+        raw = zlib.decompress(self.map[start:start + stored_size])
+        times = array.array('q')
+        times.frombytes(raw[:8 * rows])
+        channels = raw[8 * rows:9 * rows]
+        columns = []
+        for code, at in (('i', 9 * rows), ('i', 13 * rows), ('I', 17 * rows)):
+            column = array.array(code)
+            column.frombytes(raw[at:at + 4 * rows])
+            columns.append(column)
+        return zip(itertools.accumulate(times), channels, *columns)
+
+    def samples(self, start_us, end_us, channel=None):
+        """Yields (time_us, channel, voltage_uv, current_ua, power_uw) read within [start_us, end_us)"""
+        for chunk in range(self.seek(start_us), self.chunks):
+            if self.beyond(chunk, end_us):
+                return
+            offset, first, last, _, _, _ = self.entry(chunk)
+            if first >= end_us or last < start_us:
+                continue
+            for row in self.decode(offset):
+                if start_us <= row[0] < end_us and (channel is None or row[1] == channel):
+                    yield row
+
+    def summary(self, start_us, end_us, channel):
+        """Summary of `channel` within [start_us, end_us). Chunks inside the range come from the index, only
+        the ones straddling its edges are decompressed. The first reading in the range adds no energy."""
+        total = Summary(channel)
+        chunk = self.seek(start_us)
+        previous = None
+        while chunk < self.chunks and not self.beyond(chunk, end_us):
+            offset, first, last, rows, _, _ = self.entry(chunk)
+            if first >= end_us or last < start_us:
+                pass
+            elif first >= start_us and last < end_us:
+                total.merge(self.chunk_summary(chunk, channel))
+                previous = None
+            else:
+                part = Summary(channel)
+                for time_us, ch, voltage, current, power in self.decode(offset):
+                    if ch == channel and start_us <= time_us < end_us:
+                        part.add(voltage, current, power, time_us - previous if previous is not None else 0)
+                        previous = time_us
+                total.merge(part)
+            chunk += 1
+        return total
+
+    def envelope(self, start_us, end_us, buckets, channel):
+        """Summaries of `channel` over `buckets` equal spans of [start_us, end_us) from the index alone. Each
+        chunk counts towards the span its middle falls in, so spans shorter than a chunk come out empty."""
+        result = [Summary(channel) for _ in range(buckets)]
+        span = max(end_us - start_us, 1) / buckets
+        for chunk in range(self.seek(start_us), self.chunks):
+            if self.beyond(chunk, end_us):
+                break
+            _, first, last, _, _, _ = self.entry(chunk)
+            middle = (first + last) // 2
+            if start_us <= middle < end_us:
+                result[min(int((middle - start_us) / span), buckets - 1)].merge(self.chunk_summary(chunk, channel))
+        return result
+
+    def frames(self):
+        """Yields (host_ns, type, seq, payload) of every frame that is not a SAMPLES frame"""
+        for i in range(len(self.frame_index) // FRAME_ENTRY.size):
+            offset, _, _, records = FRAME_ENTRY.unpack_from(self.frame_index, i * FRAME_ENTRY.size)
+            _, _, _, _, stored_size, _, _ = CHUNK_HEADER.unpack_from(self.map, offset)
+            start = offset + CHUNK_HEADER.size
+            raw = zlib.decompress(self.map[start:start + stored_size])
+            pos = 0
+            for _ in range(records):
+                host_ns, frame_type, seq, length = RECORD.unpack_from(raw, pos)
+                pos += RECORD.size
+                yield host_ns, frame_type, seq, raw[pos:pos + length]
+                pos += length
+
+
+def main():
+    import argparse
+
+    parser = argparse.ArgumentParser()
+    parser.add_argument('capture')
+    parser.add_argument('command', choices=['info', 'summary', 'envelope', 'csv'])
+    parser.add_argument('--channel', type=int, default=0)
+    parser.add_argument('--start', type=float, help='seconds from the first reading')
+    parser.add_argument('--end', type=float, help='seconds from the first reading')
+    parser.add_argument('--buckets', type=int, default=20)
+    args = parser.parse_args()
+
+    with Reader(args.capture) as reader:
+        first, last = reader.time_range()
+        start = first + int(args.start * 1e6) if args.start is not None else first
+        end = first + int(args.end * 1e6) if args.end is not None else last + 1
+        if args.command == 'info':
+            print('%d sample chunks of up to %d readings, %.1fs%s' % (
+                reader.chunks, reader.chunk_rows, (last - first) / 1e6,
+                ', index rebuilt (no footer)' if reader.recovered else ''))
+        elif args.command == 'summary':
+            print(reader.summary(start, end, args.channel))
+        elif args.command == 'envelope':
+            for i, summary in enumerate(reader.envelope(start, end, args.buckets, args.channel)):
+                print('%10.3fs %r' % ((start - first + i * (end - start) / args.buckets) / 1e6, summary))
+        else:
+            sys.stdout.write('device_us,channel,voltage_uv,current_ua,power_uw\n')
+            for row in reader.samples(start, end, args.channel):
+                sys.stdout.write('%d,%d,%d,%d,%d\n' % row)
+
+
+if __name__ == '__main__':
+    main()
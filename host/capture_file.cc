@@ -0,0 +1,538 @@
+#include "capture_file.hh"
+
+#include <algorithm>
+#include <bit>
+#include <climits>
+#include <cstring>
+#include <fcntl.h>
+#include <numeric>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include "telemetry.hh"
+
+namespace capture_file {
+    void Summary::Add(const int32_t voltage, const int32_t current, const uint32_t power, const int64_t dtUs) {
+        if (count == 0) {
+            voltageMin = voltageMax = voltage;
+            currentMin = currentMax = current;
+            powerMin = powerMax = power;
+        } else {
+            voltageMin = std::min(voltageMin, voltage);
+            voltageMax = std::max(voltageMax, voltage);
+            currentMin = std::min(currentMin, current);
+            currentMax = std::max(currentMax, current);
+            powerMin = std::min(powerMin, power);
+            powerMax = std::max(powerMax, power);
+        }
+        count++;
+        voltageSum += voltage;
+        currentSum += current;
+        powerSum += power;
+        if (dtUs > 0 && dtUs <= MaxGapUs) {
+            energy += static_cast<double>(power) * static_cast<double>(dtUs) * 1e-12;
+        }
+    }
+
+    void Summary::Merge(const Summary& other) {
+        if (other.count == 0) {
+            return;
+        }
+        if (count == 0) {
+            voltageMin = other.voltageMin;
+            voltageMax = other.voltageMax;
+            currentMin = other.currentMin;
+            currentMax = other.currentMax;
+            powerMin = other.powerMin;
+            powerMax = other.powerMax;
+        } else {
+            voltageMin = std::min(voltageMin, other.voltageMin);
+            voltageMax = std::max(voltageMax, other.voltageMax);
+            currentMin = std::min(currentMin, other.currentMin);
+            currentMax = std::max(currentMax, other.currentMax);
+            powerMin = std::min(powerMin, other.powerMin);
+            powerMax = std::max(powerMax, other.powerMax);
+        }
+        count += other.count;
+        voltageSum += other.voltageSum;
+        currentSum += other.currentSum;
+        powerSum += other.powerSum;
+        energy += other.energy;
+    }
+
+    int64_t DeviceClock::Extend(const uint32_t timeUs) {
+        if (last >= 0 && timeUs < last && last - timeUs > int64_t{1} << 31) {
+            high += int64_t{1} << 32;
+        }
+        last = timeUs;
+        return high + timeUs;
+    }
+
+    Writer::Writer(const char* path, const uint32_t chunkRows, const int level) :
+        file{fopen(path, "wb")},
+        chunkRows{chunkRows},
+        level{level} {
+        lastUs.fill(-1);
+        if (file == nullptr) {
+            return;
+        }
+        setvbuf(file, nullptr, _IOFBF, 1 << 20);
+        Header header{};
+        memcpy(header.magic, Magic, sizeof(Magic));
+        header.chunkRows = chunkRows;
+        fwrite(&header, sizeof(header), 1, file);
+        rows.reserve(chunkRows);
+    }
+
+    Writer::~Writer() {
+        Close();
+    }
+
+    void Writer::Close() {
+        if (file == nullptr) {
+            return;
+        }
+        Flush();
+        Footer footer{};
+        footer.index = ftello(file);
+        footer.chunks = static_cast<uint32_t>(sampleIndex.size());
+        footer.crc = static_cast<uint32_t>(crc32(0, reinterpret_cast<const Bytef*>(sampleIndex.data()),
+            static_cast<uInt>(sampleIndex.size() * sizeof(SampleEntry))));
+        fwrite(sampleIndex.data(), sizeof(SampleEntry), sampleIndex.size(), file);
+        footer.summaries = ftello(file);
+        footer.summaryCount = static_cast<uint32_t>(summaries.size());
+        fwrite(summaries.data(), sizeof(Summary), summaries.size(), file);
+        footer.frames = ftello(file);
+        footer.frameChunks = static_cast<uint32_t>(frameIndex.size());
+        fwrite(frameIndex.data(), sizeof(FrameEntry), frameIndex.size(), file);
+        memcpy(footer.end, End, sizeof(End));
+        fwrite(&footer, sizeof(footer), 1, file);
+        fclose(file);
+        file = nullptr;
+    }
+
+    void Writer::AddSamples(const uint8_t* payload, const size_t length) {
+        SamplesHeader header{};
+        if (length < sizeof(header)) {
+            return;
+        }
+        memcpy(&header, payload, sizeof(header));
+        if (length < sizeof(header) + std::popcount(header.channels) * 3 * sizeof(int32_t)) {
+            return;
+        }
+        const int64_t timeUs = clock.Extend(header.timeUs);
+        const uint8_t* values = payload + sizeof(header);
+        for (uint8_t channel = 0; channel < Channels; channel++) {
+            if ((header.channels & 1 << channel) == 0) {
+                continue;
+            }
+            Row row{timeUs, channel, 0, 0, 0};
+            memcpy(&row.voltage, values, sizeof(row.voltage));
+            memcpy(&row.current, values + 4, sizeof(row.current));
+            memcpy(&row.power, values + 8, sizeof(row.power));
+            values += 12;
+            AddRow(row);
+        }
+    }
+
+    void Writer::AddRow(const Row& row) {
+        rows.push_back(row);
+        if (rows.size() >= chunkRows) {
+            FlushSamples();
+        }
+    }
+
+    void Writer::AddFrame(const uint64_t hostNs, const uint8_t type, const uint8_t seq, const uint8_t* payload,
+                          const size_t length) {
+        const FrameRecord record{hostNs, type, seq, static_cast<uint16_t>(length)};
+        const auto* bytes = reinterpret_cast<const uint8_t*>(&record);
+        frames.insert(frames.end(), bytes, bytes + sizeof(record));
+        frames.insert(frames.end(), payload, payload + length);
+        frameFirst = frameRecords == 0 ? hostNs : frameFirst;
+        frameLast = hostNs;
+        frameRecords++;
+        if (frames.size() >= FrameChunkBytes) {
+            FlushFrames();
+        }
+    }
+
+    void Writer::Flush() {
+        if (file == nullptr) {
+            return;
+        }
+        FlushSamples();
+        FlushFrames();
+        fflush(file);
+    }
+
+    void Writer::FlushSamples() {
+        if (rows.empty() || file == nullptr) {
+            return;
+        }
+        // readings of one frame share a time, frames of different buses may arrive slightly out of order
+        std::stable_sort(rows.begin(), rows.end(), [](const Row& a, const Row& b) { return a.timeUs < b.timeUs; });
+        const size_t count = rows.size();
+        Summary chunk[Channels]{};
+        for (uint8_t channel = 0; channel < Channels; channel++) {
+            chunk[channel].channel = channel;
+        }
+        raw.resize(count * 21);
+        auto* deltas = raw.data();
+        auto* channels = deltas + 8 * count;
+        auto* voltages = deltas + 9 * count;
+        auto* currents = deltas + 13 * count;
+        auto* powers = deltas + 17 * count;
+        int64_t previousUs = 0;
+        for (size_t i = 0; i < count; i++) {
+            const Row& row = rows[i];
+            int64_t& last = lastUs[row.channel];
+            chunk[row.channel].Add(row.voltage, row.current, row.power, last >= 0 ? row.timeUs - last : 0);
+            last = row.timeUs;
+            const int64_t delta = row.timeUs - previousUs;
+            previousUs = row.timeUs;
+            memcpy(deltas + 8 * i, &delta, sizeof(delta));
+            channels[i] = row.channel;
+            memcpy(voltages + 4 * i, &row.voltage, sizeof(row.voltage));
+            memcpy(currents + 4 * i, &row.current, sizeof(row.current));
+            memcpy(powers + 4 * i, &row.power, sizeof(row.power));
+        }
+        const int64_t first = rows.front().timeUs;
+        const int64_t last = rows.back().timeUs;
+        const uint64_t offset = WriteChunk(SampleTag, 0, static_cast<uint32_t>(count), first, last);
+        SampleEntry entry{offset, first, last, static_cast<uint32_t>(count), static_cast<uint32_t>(summaries.size()),
+            0, 0};
+        for (const Summary& summary : chunk) {
+            if (summary.count > 0) {
+                summaries.push_back(summary);
+                entry.summaries++;
+            }
+        }
+        sampleIndex.push_back(entry);
+        rows.clear();
+    }
+
+    void Writer::FlushFrames() {
+        if (frames.empty() || file == nullptr) {
+            return;
+        }
+        raw.swap(frames);
+        const uint64_t offset = WriteChunk(FrameTag, 1, frameRecords, frameFirst, frameLast);
+        frameIndex.push_back({offset, frameFirst, frameLast, frameRecords, 0});
+        raw.swap(frames);
+        frames.clear();
+        frameRecords = 0;
+    }
+
+    uint64_t Writer::WriteChunk(const char* tag, const uint8_t kind, const uint32_t count, const uint64_t first,
+                                const uint64_t last) {
+        uLongf size = compressBound(static_cast<uLong>(raw.size()));
+        stored.resize(size);
+        compress2(stored.data(), &size, raw.data(), static_cast<uLong>(raw.size()), level);
+        ChunkHeader header{};
+        memcpy(header.tag, tag, sizeof(header.tag));
+        header.kind = kind;
+        header.count = count;
+        header.rawSize = static_cast<uint32_t>(raw.size());
+        header.storedSize = static_cast<uint32_t>(size);
+        header.first = first;
+        header.last = last;
+        const uint64_t offset = ftello(file);
+        fwrite(&header, sizeof(header), 1, file);
+        fwrite(stored.data(), 1, size, file);
+        return offset;
+    }
+}
+
+namespace capture_file {
+    Reader::Reader(const char* path) {
+        fd = open(path, O_RDONLY);
+        struct stat status{};
+        if (fd < 0 || fstat(fd, &status) != 0) {
+            error = "cannot open";
+            return;
+        }
+        size = static_cast<size_t>(status.st_size);
+        if (size < sizeof(Header)) {
+            error = "not a capture file";
+            return;
+        }
+        void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped == MAP_FAILED) {
+            error = "cannot map";
+            return;
+        }
+        map = static_cast<const uint8_t*>(mapped);
+        Header header{};
+        memcpy(&header, map, sizeof(header));
+        if (memcmp(header.magic, Magic, sizeof(Magic)) != 0) {
+            error = "not a capture file";
+            return;
+        }
+        chunkRows = header.chunkRows;
+        if (size < sizeof(Header) + sizeof(Footer) || memcmp(map + size - sizeof(End), End, sizeof(End)) != 0) {
+            Rebuild();
+            Bound();
+            return;
+        }
+        Footer footer{};
+        memcpy(&footer, map + size - sizeof(footer), sizeof(footer));
+        const uint64_t tables = size - sizeof(footer);
+        if (footer.index > tables || footer.chunks > (tables - footer.index) / sizeof(SampleEntry) ||
+            footer.summaries > tables || footer.summaryCount > (tables - footer.summaries) / sizeof(Summary) ||
+            footer.frames > tables || footer.frameChunks > (tables - footer.frames) / sizeof(FrameEntry)) {
+            error = "footer is corrupt";
+            return;
+        }
+        index = reinterpret_cast<const SampleEntry*>(map + footer.index);
+        chunks = footer.chunks;
+        summaryData = reinterpret_cast<const Summary*>(map + footer.summaries);
+        summaryCount = footer.summaryCount;
+        frameIndex = reinterpret_cast<const FrameEntry*>(map + footer.frames);
+        frameChunks = footer.frameChunks;
+        if (crc32(0, map + footer.index, static_cast<uInt>(chunks * sizeof(SampleEntry))) != footer.crc) {
+            error = "sample index is corrupt";
+            return;
+        }
+        for (size_t chunk = 0; chunk < chunks; chunk++) {
+            if (static_cast<size_t>(index[chunk].firstSummary) + index[chunk].summaries > summaryCount) {
+                error = "sample index is corrupt";
+                return;
+            }
+        }
+        Bound();
+    }
+
+    Reader::~Reader() {
+        if (map != nullptr) {
+            munmap(const_cast<uint8_t*>(map), size);
+        }
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+
+    void Reader::Bound() {
+        reach.resize(chunks);
+        floor.resize(chunks + 1);
+        int64_t latest = INT64_MIN;
+        for (size_t chunk = 0; chunk < chunks; chunk++) {
+            latest = std::max(latest, index[chunk].lastUs);
+            reach[chunk] = latest;
+        }
+        floor[chunks] = INT64_MAX;
+        for (size_t chunk = chunks; chunk-- > 0;) {
+            floor[chunk] = std::min(floor[chunk + 1], index[chunk].firstUs);
+        }
+    }
+
+    // Indexes a file that has no footer by walking its chunks, a truncated last chunk is dropped
+    void Reader::Rebuild() {
+        std::array<int64_t, 256> lastUs;
+        lastUs.fill(-1);
+        uint64_t pos = sizeof(Header);
+        while (pos + sizeof(ChunkHeader) <= size) {
+            ChunkHeader header{};
+            memcpy(&header, map + pos, sizeof(header));
+            const bool samples = memcmp(header.tag, SampleTag, sizeof(header.tag)) == 0;
+            if ((!samples && memcmp(header.tag, FrameTag, sizeof(header.tag)) != 0) ||
+                header.storedSize > size - pos - sizeof(header)) {
+                break;
+            }
+            if (!samples) {
+                rebuiltFrames.push_back({pos, header.first, header.last, header.count, 0});
+            } else {
+                if (!Decode(pos)) {
+                    break;
+                }
+                Summary chunk[256]{};
+                for (const Row& row : decoded) {
+                    Summary& summary = chunk[row.channel];
+                    summary.channel = row.channel;
+                    summary.Add(row.voltage, row.current, row.power,
+                        lastUs[row.channel] >= 0 ? row.timeUs - lastUs[row.channel] : 0);
+                    lastUs[row.channel] = row.timeUs;
+                }
+                SampleEntry entry{pos, static_cast<int64_t>(header.first), static_cast<int64_t>(header.last),
+                    header.count, static_cast<uint32_t>(rebuiltSummaries.size()), 0, 0};
+                for (const Summary& summary : chunk) {
+                    if (summary.count > 0) {
+                        rebuiltSummaries.push_back(summary);
+                        entry.summaries++;
+                    }
+                }
+                rebuiltIndex.push_back(entry);
+            }
+            pos += sizeof(header) + header.storedSize;
+        }
+        recovered = true;
+        decodedChunks = 0;
+        index = rebuiltIndex.data();
+        chunks = rebuiltIndex.size();
+        summaryData = rebuiltSummaries.data();
+        summaryCount = rebuiltSummaries.size();
+        frameIndex = rebuiltFrames.data();
+        frameChunks = rebuiltFrames.size();
+    }
+
+    std::pair<int64_t, int64_t> Reader::TimeRange() const {
+        if (chunks == 0) {
+            return {0, 0};
+        }
+        return {floor[0], reach.back()};
+    }
+
+    size_t Reader::Seek(const int64_t timeUs) const {
+        return static_cast<size_t>(std::lower_bound(reach.begin(), reach.end(), timeUs) - reach.begin());
+    }
+
+    Summary Reader::ChunkSummary(const size_t chunk, const uint8_t channel) const {
+        const SampleEntry& entry = index[chunk];
+        for (uint32_t i = 0; i < entry.summaries; i++) {
+            const Summary& summary = summaryData[entry.firstSummary + i];
+            if (summary.channel == channel) {
+                return summary;
+            }
+        }
+        Summary empty{};
+        empty.channel = channel;
+        return empty;
+    }
+
+    bool Reader::Inflate(const uint64_t offset, const char* tag, std::vector<uint8_t>& out) const {
+        ChunkHeader header{};
+        if (offset > size || size - offset < sizeof(header)) {
+            return false;
+        }
+        memcpy(&header, map + offset, sizeof(header));
+        if (memcmp(header.tag, tag, sizeof(header.tag)) != 0 || header.storedSize > size - offset - sizeof(header)) {
+            return false;
+        }
+        out.resize(header.rawSize);
+        uLongf length = header.rawSize;
+        return uncompress(out.data(), &length, map + offset + sizeof(header), header.storedSize) == Z_OK &&
+            length == header.rawSize;
+    }
+
+    bool Reader::Decode(const uint64_t offset) {
+        decoded.clear();
+        decodedChunks++;
+        if (!Inflate(offset, SampleTag, inflated)) {
+            return false;
+        }
+        ChunkHeader header{};
+        memcpy(&header, map + offset, sizeof(header));
+        const size_t count = header.count;
+        if (inflated.size() != count * 21) {
+            return false;
+        }
+        const uint8_t* deltas = inflated.data();
+        const uint8_t* channels = deltas + 8 * count;
+        const uint8_t* voltages = deltas + 9 * count;
+        const uint8_t* currents = deltas + 13 * count;
+        const uint8_t* powers = deltas + 17 * count;
+        decoded.resize(count);
+        int64_t timeUs = 0;
+        for (size_t i = 0; i < count; i++) {
+            Row& row = decoded[i];
+            int64_t delta;
+            memcpy(&delta, deltas + 8 * i, sizeof(delta));
+            timeUs += delta;
+            row.timeUs = timeUs;
+            row.channel = channels[i];
+            memcpy(&row.voltage, voltages + 4 * i, sizeof(row.voltage));
+            memcpy(&row.current, currents + 4 * i, sizeof(row.current));
+            memcpy(&row.power, powers + 4 * i, sizeof(row.power));
+        }
+        return true;
+    }
+
+    void Reader::Samples(const int64_t startUs, const int64_t endUs, const int channel, const RowHandler handler,
+                         void* arg) {
+        for (size_t chunk = Seek(startUs); chunk < chunks && !Beyond(chunk, endUs); chunk++) {
+            const SampleEntry& entry = index[chunk];
+            if (entry.firstUs >= endUs || entry.lastUs < startUs || !Decode(entry.offset)) {
+                continue;
+            }
+            for (const Row& row : decoded) {
+                if (row.timeUs >= startUs && row.timeUs < endUs && (channel < 0 || row.channel == channel)) {
+                    handler(arg, row);
+                }
+            }
+        }
+    }
+
+    Summary Reader::Summarize(const int64_t startUs, const int64_t endUs, const uint8_t channel) {
+        Summary total{};
+        total.channel = channel;
+        int64_t previous = -1;
+        bool hasPrevious = false;
+        for (size_t chunk = Seek(startUs); chunk < chunks && !Beyond(chunk, endUs); chunk++) {
+            const SampleEntry& entry = index[chunk];
+            if (entry.firstUs >= endUs || entry.lastUs < startUs) {
+                continue;
+            }
+            if (entry.firstUs >= startUs && entry.lastUs < endUs) {
+                total.Merge(ChunkSummary(chunk, channel));
+                hasPrevious = false;
+                continue;
+            }
+            if (!Decode(entry.offset)) {
+                continue;
+            }
+            Summary part{};
+            part.channel = channel;
+            for (const Row& row : decoded) {
+                if (row.channel == channel && row.timeUs >= startUs && row.timeUs < endUs) {
+                    part.Add(row.voltage, row.current, row.power, hasPrevious ? row.timeUs - previous : 0);
+                    previous = row.timeUs;
+                    hasPrevious = true;
+                }
+            }
+            total.Merge(part);
+        }
+        return total;
+    }
+
+    std::vector<Summary> Reader::Envelope(const int64_t startUs, const int64_t endUs, const size_t buckets,
+                                          const uint8_t channel) const {
+        Summary empty{};
+        empty.channel = channel;
+        std::vector<Summary> result(buckets, empty);
+        const double span = static_cast<double>(std::max<int64_t>(endUs - startUs, 1)) / static_cast<double>(buckets);
+        for (size_t chunk = Seek(startUs); chunk < chunks && !Beyond(chunk, endUs); chunk++) {
+            const SampleEntry& entry = index[chunk];
+            const int64_t middle = std::midpoint(entry.firstUs, entry.lastUs);
+            if (middle >= startUs && middle < endUs) {
+                const auto bucket = static_cast<size_t>(static_cast<double>(middle - startUs) / span);
+                result[std::min(bucket, buckets - 1)].Merge(ChunkSummary(chunk, channel));
+            }
+        }
+        return result;
+    }
+
+    bool Reader::Frames(const FrameHandler handler, void* arg) const {
+        std::vector<uint8_t> raw;
+        for (size_t chunk = 0; chunk < frameChunks; chunk++) {
+            if (!Inflate(frameIndex[chunk].offset, FrameTag, raw)) {
+                return false;
+            }
+            size_t pos = 0;
+            for (uint32_t i = 0; i < frameIndex[chunk].records; i++) {
+                FrameRecord record{};
+                if (raw.size() - pos < sizeof(record)) {
+                    return false;
+                }
+                memcpy(&record, raw.data() + pos, sizeof(record));
+                pos += sizeof(record);
+                if (raw.size() - pos < record.length) {
+                    return false;
+                }
+                handler(arg, record.hostNs, record.type, record.seq, raw.data() + pos, record.length);
+                pos += record.length;
+            }
+        }
+        return true;
+    }
+}
@@ -0,0 +1,247 @@
+#ifndef CAPTURE_FILE_HH
+#define CAPTURE_FILE_HH
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <utility>
+#include <vector>
+
+// The chunk-indexed capture file of capture_file.py, byte for byte:
+//   Header | chunk... | sample index | summaries | frame index | Footer
+// Every chunk is a ChunkHeader and its zlib-compressed payload. Sample chunks hold up to `chunkRows` readings
+// sorted by time, column by column: time deltas:i64 | channel:u8 | voltage_uv:i32 | current_ua:i32 | power_uw:u32.
+// Frame chunks keep every other frame as FrameRecord and payload. See capture_file.py for the rest.
+namespace capture_file {
+    constexpr char Magic[8] = {'T', 'M', 'C', 'A', 'P', 2, 0, 0};
+    constexpr char End[8] = {'T', 'M', 'C', 'A', 'P', 'E', 'N', 'D'};
+    constexpr char SampleTag[4] = {'T', 'M', 'C', 'K'};
+    constexpr char FrameTag[4] = {'T', 'M', 'F', 'R'};
+    constexpr uint32_t ChunkRows = 4096;
+    constexpr size_t FrameChunkBytes = 256 * 1024;
+    constexpr uint8_t Channels = 16; // a kSamples frame has a bit per channel
+    constexpr int64_t MaxGapUs = 10000000; // longest sampling period, a longer gap is not integrated into energy
+
+    struct __attribute__((packed)) Header {
+        char magic[8];
+        uint32_t chunkRows;
+        uint32_t reserved;
+    };
+
+    struct __attribute__((packed)) ChunkHeader {
+        char tag[4];
+        uint8_t kind; // 0 samples, 1 frames
+        uint8_t reserved[3];
+        uint32_t count; // rows or records
+        uint32_t rawSize;
+        uint32_t storedSize;
+        uint64_t first; // device us of samples, host ns of frames
+        uint64_t last;
+    };
+
+    struct __attribute__((packed)) SampleEntry {
+        uint64_t offset;
+        int64_t firstUs;
+        int64_t lastUs;
+        uint32_t rows;
+        uint32_t firstSummary;
+        uint16_t summaries;
+        uint16_t reserved;
+    };
+
+    struct __attribute__((packed)) FrameEntry {
+        uint64_t offset;
+        uint64_t firstNs;
+        uint64_t lastNs;
+        uint32_t records;
+        uint32_t reserved;
+    };
+
+    struct __attribute__((packed)) Footer {
+        uint64_t index;
+        uint32_t chunks;
+        uint32_t crc; // zlib crc32 of the sample index
+        uint64_t summaries;
+        uint32_t summaryCount;
+        uint64_t frames;
+        uint32_t frameChunks;
+        uint32_t reserved;
+        char end[8];
+    };
+
+    struct __attribute__((packed)) FrameRecord {
+        uint64_t hostNs;
+        uint8_t type;
+        uint8_t seq;
+        uint16_t length;
+    };
+
+    // Count, range, sums and energy of one channel over a stretch of readings, as stored in the file
+    struct __attribute__((packed)) Summary {
+        uint8_t channel;
+        uint8_t reserved[3];
+        uint32_t count;
+        int32_t voltageMin;
+        int32_t voltageMax;
+        int32_t currentMin;
+        int32_t currentMax;
+        uint32_t powerMin;
+        uint32_t powerMax;
+        int64_t voltageSum;
+        int64_t currentSum;
+        int64_t powerSum;
+        double energy; // J
+
+        // `dtUs` since the channel's previous reading, 0 for none
+        void Add(int32_t voltage, int32_t current, uint32_t power, int64_t dtUs);
+
+        void Merge(const Summary& other);
+    };
+
+    static_assert(sizeof(Header) == 16 && sizeof(ChunkHeader) == 36 && sizeof(SampleEntry) == 36);
+    static_assert(sizeof(FrameEntry) == 32 && sizeof(Footer) == 52 && sizeof(FrameRecord) == 12);
+    static_assert(sizeof(Summary) == 64);
+
+    struct Row {
+        int64_t timeUs;
+        uint8_t channel;
+        int32_t voltage;
+        int32_t current;
+        uint32_t power;
+    };
+
+    // Extends the 32-bit device microsecond clock to 64 bits
+    struct DeviceClock {
+        int64_t last{-1};
+        int64_t high{0};
+
+        int64_t Extend(uint32_t timeUs);
+    };
+
+    struct Writer {
+        FILE* file;
+        uint32_t chunkRows;
+        int level; // zlib, 6 as capture_file.py
+        DeviceClock clock{};
+        std::vector<Row> rows{};
+        std::array<int64_t, Channels> lastUs; // time of each channel's previous reading, -1 for none, for energy
+        std::vector<uint8_t> frames{};
+        uint32_t frameRecords{0};
+        uint64_t frameFirst{0};
+        uint64_t frameLast{0};
+        std::vector<SampleEntry> sampleIndex{};
+        std::vector<Summary> summaries{};
+        std::vector<FrameEntry> frameIndex{};
+        std::vector<uint8_t> raw{};
+        std::vector<uint8_t> stored{};
+
+        // `file` is null when `path` could not be created
+        explicit Writer(const char* path, uint32_t chunkRows = ChunkRows, int level = 6);
+
+        Writer(const Writer&) = delete;
+
+        ~Writer();
+
+        // Writes what is buffered, the indexes and the footer
+        void Close();
+
+        // Takes the payload of a kSamples frame
+        void AddSamples(const uint8_t* payload, size_t length);
+
+        // `row.channel` below Channels
+        void AddRow(const Row& row);
+
+        void AddFrame(uint64_t hostNs, uint8_t type, uint8_t seq, const uint8_t* payload, size_t length);
+
+        void Flush();
+
+    private:
+        void FlushSamples();
+
+        void FlushFrames();
+
+        uint64_t WriteChunk(const char* tag, uint8_t kind, uint32_t count, uint64_t first, uint64_t last);
+    };
+
+    // capture_file.py's Reader over mmap, for captures too long to go through Python. Seeking by time is a binary
+    // search over the running maximum of the chunks' last times, summaries over long ranges come from the index
+    // and only the chunks at the edges of a range are decompressed.
+    struct Reader {
+        using RowHandler = void (*)(void* arg, const Row& row);
+        using FrameHandler = void (*)(void* arg, uint64_t hostNs, uint8_t type, uint8_t seq, const uint8_t* payload,
+                                      size_t length);
+
+        const char* error{nullptr}; // why the file could not be read, null when it can
+        int fd{-1};
+        const uint8_t* map{nullptr};
+        size_t size{0};
+        uint32_t chunkRows{0};
+        bool recovered{false}; // the footer was missing and the index was rebuilt from the chunks
+        const SampleEntry* index{nullptr};
+        size_t chunks{0};
+        const Summary* summaryData{nullptr};
+        size_t summaryCount{0};
+        const FrameEntry* frameIndex{nullptr};
+        size_t frameChunks{0};
+        // reach[k]: latest reading in chunks 0..k, floor[k]: earliest reading in chunks k.., one past the end is
+        // unbounded, so that seeks and range scans stay correct when chunks overlap in time
+        std::vector<int64_t> reach{};
+        std::vector<int64_t> floor{};
+        uint64_t decodedChunks{0};
+        std::vector<Row> decoded{};
+
+        explicit Reader(const char* path);
+
+        Reader(const Reader&) = delete;
+
+        ~Reader();
+
+        [[nodiscard]] bool Ok() const { return error == nullptr; }
+
+        [[nodiscard]] const SampleEntry& Entry(const size_t chunk) const { return index[chunk]; }
+
+        // First and last reading time, 0 and 0 for no readings
+        [[nodiscard]] std::pair<int64_t, int64_t> TimeRange() const;
+
+        // Index of the first chunk that ends at or after `timeUs`, `chunks` if none does. No chunk before it holds
+        // a reading at or after `timeUs`.
+        [[nodiscard]] size_t Seek(int64_t timeUs) const;
+
+        // True when neither `chunk` nor any after it holds a reading before `timeUs`
+        [[nodiscard]] bool Beyond(const size_t chunk, const int64_t timeUs) const { return floor[chunk] >= timeUs; }
+
+        [[nodiscard]] Summary ChunkSummary(size_t chunk, uint8_t channel) const;
+
+        // Decompresses the sample chunk at `offset` into `decoded`, false when it is corrupt
+        bool Decode(uint64_t offset);
+
+        // Hands on the readings within [startUs, endUs), of `channel` or of all channels for -1, in file order
+        void Samples(int64_t startUs, int64_t endUs, int channel, RowHandler handler, void* arg);
+
+        // Summary of `channel` within [startUs, endUs). The first reading in the range adds no energy.
+        Summary Summarize(int64_t startUs, int64_t endUs, uint8_t channel);
+
+        // Summaries of `channel` over `buckets` equal spans of [startUs, endUs) from the index alone. Each chunk
+        // counts towards the span its middle falls in, so spans shorter than a chunk come out empty.
+        [[nodiscard]] std::vector<Summary> Envelope(int64_t startUs, int64_t endUs, size_t buckets,
+                                                    uint8_t channel) const;
+
+        // Hands on every frame that is not a kSamples frame, false when a frame chunk is corrupt
+        bool Frames(FrameHandler handler, void* arg) const;
+
+    private:
+        std::vector<SampleEntry> rebuiltIndex{};
+        std::vector<Summary> rebuiltSummaries{};
+        std::vector<FrameEntry> rebuiltFrames{};
+        std::vector<uint8_t> inflated{};
+
+        bool Inflate(uint64_t offset, const char* tag, std::vector<uint8_t>& out) const;
+
+        void Rebuild();
+
+        void Bound();
+    };
+}
+
+#endif //CAPTURE_FILE_HH
@@ -0,0 +1,82 @@
+#include "link_decoder.hh"
+
+#include <algorithm>
+#include <cstring>
+
+LinkDecoder::LinkDecoder(const FrameHandler onFrame, const TextHandler onText, void* arg) :
+    parser{[](void* arg, const FrameType type, const uint8_t seq, const uint8_t* payload, const size_t length) {
+        auto& decoder = *static_cast<LinkDecoder*>(arg);
+        if (decoder.lastSeq >= 0) {
+            decoder.lost += static_cast<uint8_t>(seq - decoder.lastSeq - 1);
+        }
+        decoder.lastSeq = seq;
+        if (decoder.onFrame != nullptr) {
+            decoder.onFrame(decoder.arg, type, seq, payload, length);
+        }
+    }, this},
+    onFrame{onFrame},
+    onText{onText},
+    arg{arg} {
+}
+
+// Text between frames is scanned for the next sync byte in one go, a frame is fed to the parser up to where it
+// ends, so the parser never takes a byte of the text after it
+void LinkDecoder::Feed(const uint8_t* data, const size_t size) {
+    using State = FrameParser::State;
+    size_t pos = 0;
+    while (pos < size) {
+        switch (parser.state) {
+            case State::kSync0: {
+                const auto* sync = static_cast<const uint8_t*>(memchr(data + pos, Telemetry::Sync0, size - pos));
+                const size_t end = sync != nullptr ? static_cast<size_t>(sync - data) : size;
+                Text(data + pos, end - pos);
+                pos = end;
+                if (pos < size) {
+                    parser.Feed(data + pos++, 1);
+                }
+                break;
+            }
+            case State::kSync1: {
+                const uint8_t byte = data[pos++];
+                parser.Feed(&byte, 1);
+                if (parser.state != State::kHeader) {
+                    constexpr uint8_t sync = Telemetry::Sync0;
+                    Text(&sync, 1);
+                    if (parser.state == State::kSync0) {
+                        Text(&byte, 1);
+                    }
+                }
+                break;
+            }
+            default: {
+                const size_t rest = parser.state == State::kHeader ? sizeof(FrameHeader) - parser.pos :
+                    parser.state == State::kPayload ? parser.length - parser.pos : sizeof(parser.crc) - parser.pos;
+                const size_t take = std::min(rest, size - pos);
+                parser.Feed(data + pos, take);
+                pos += take;
+                break;
+            }
+        }
+    }
+}
+
+void LinkDecoder::Flush() {
+    if (!line.empty() && onText != nullptr) {
+        onText(arg, line.data(), line.size());
+    }
+    line.clear();
+}
+
+void LinkDecoder::Text(const uint8_t* data, size_t size) {
+    while (size > 0) {
+        const auto* newline = static_cast<const uint8_t*>(memchr(data, '\n', size));
+        const size_t end = newline != nullptr ? static_cast<size_t>(newline - data) + 1 : size;
+        line.append(reinterpret_cast<const char*>(data), end);
+        data += end;
+        size -= end;
+        if (newline != nullptr || line.size() >= MaxLine) {
+            lines += newline != nullptr;
+            Flush();
+        }
+    }
+}
@@ -0,0 +1,44 @@
+#ifndef LINK_DECODER_HH
+#define LINK_DECODER_HH
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "command.hh"
+
+// Splits what the serial link delivers into frames, checked by the firmware's FrameParser, and the console lines
+// around them. A sync byte is only known to be text once the byte after it is not the second one.
+struct LinkDecoder {
+    static constexpr size_t MaxLine = 4096; // a longer line is handed on in pieces, as is the rest at Flush()
+
+    using FrameHandler = void (*)(void* arg, FrameType type, uint8_t seq, const uint8_t* payload, size_t length);
+    using TextHandler = void (*)(void* arg, const char* line, size_t length); // with its newline
+
+    FrameParser parser;
+    FrameHandler onFrame;
+    TextHandler onText;
+    void* arg;
+    std::string line{};
+    int lastSeq{-1};
+
+    uint64_t lost{0}; // frames missing from the sequence, dropped on the device or failing the CRC here
+    uint64_t lines{0};
+
+    LinkDecoder(FrameHandler onFrame, TextHandler onText, void* arg);
+
+    LinkDecoder(const LinkDecoder&) = delete;
+
+    void Feed(const uint8_t* data, size_t size);
+
+    // Hands on a line still waiting for its newline
+    void Flush();
+
+    [[nodiscard]] uint32_t Frames() const { return parser.frames; }
+    [[nodiscard]] uint32_t CrcErrors() const { return parser.crcErrors + parser.oversized; }
+
+private:
+    void Text(const uint8_t* data, size_t size);
+};
+
+#endif //LINK_DECODER_HH
@@ -0,0 +1,147 @@
+#include "meter_client.hh"
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+namespace {
+    int64_t NowUs() {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+}
+
+MeterClient::MeterClient(const int fd, const FrameHandler onFrame, const TextHandler onText, void* arg) :
+    fd{fd},
+    link{[](void* arg, const FrameType type, const uint8_t seq, const uint8_t* payload, const size_t length) {
+        static_cast<MeterClient*>(arg)->OnFrame(type, seq, payload, length);
+    }, [](void* arg, const char* line, const size_t length) {
+        const auto& client = *static_cast<MeterClient*>(arg);
+        if (client.onText != nullptr) {
+            client.onText(client.arg, line, length);
+        }
+    }, this},
+    onFrame{onFrame},
+    onText{onText},
+    arg{arg} {
+}
+
+MeterClient::~MeterClient() {
+    if (fd >= 0) {
+        close(fd);
+    }
+}
+
+int MeterClient::Open(const char* path) {
+    const int fd = open(path, O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (fd < 0 || !isatty(fd)) {
+        return fd;
+    }
+    termios attrs{};
+    if (tcgetattr(fd, &attrs) == 0) {
+        cfmakeraw(&attrs);
+        attrs.c_cflag |= CREAD | CLOCAL;
+        attrs.c_cc[VMIN] = 0;
+        attrs.c_cc[VTIME] = 0;
+        tcsetattr(fd, TCSANOW, &attrs);
+    }
+    return fd;
+}
+
+size_t MeterClient::Poll(const int timeoutMs) {
+    pollfd ready{fd, POLLIN, 0};
+    if (poll(&ready, 1, timeoutMs) <= 0) {
+        return 0;
+    }
+    uint8_t chunk[65536];
+    const ssize_t read = ::read(fd, chunk, sizeof(chunk));
+    if (read <= 0) {
+        return 0;
+    }
+    link.Feed(chunk, static_cast<size_t>(read));
+    return static_cast<size_t>(read);
+}
+
+MeterClient::Reply MeterClient::Request(const Opcode opcode, const uint8_t channel, const uint32_t value,
+                                        const int timeoutMs) {
+    const CommandPacket command{nextId++, static_cast<uint8_t>(opcode), channel, value};
+    if (nextId == 0) {
+        nextId = 1;
+    }
+    uint8_t frame[Telemetry::MaxFrame];
+    const size_t size = Encode(FrameType::kCommand, seq++, &command, sizeof(command), frame);
+    const int64_t started = NowUs();
+    const int64_t deadline = started + static_cast<int64_t>(timeoutMs) * 1000;
+    pendingId = command.id;
+    pendingAnswered = false;
+    for (size_t written = 0; written < size;) {
+        const ssize_t n = write(fd, frame + written, size - written);
+        if (n > 0) {
+            written += static_cast<size_t>(n);
+        } else if (n < 0 && errno != EAGAIN && errno != EINTR) {
+            pendingId = 0;
+            return {false, {}, 0};
+        } else {
+            pollfd writable{fd, POLLOUT, 0};
+            poll(&writable, 1, 10);
+        }
+    }
+    while (!pendingAnswered) {
+        const int64_t remaining = deadline - NowUs();
+        if (remaining <= 0) {
+            pendingId = 0;
+            return {false, {}, static_cast<uint32_t>(NowUs() - started)};
+        }
+        Poll(static_cast<int>((remaining + 999) / 1000));
+    }
+    pendingId = 0;
+    const auto roundTripUs = static_cast<uint32_t>(NowUs() - started);
+    deviceLatency.Add(pending.latencyUs);
+    roundTrip.Add(roundTripUs);
+    return {true, pending, roundTripUs};
+}
+
+bool MeterClient::QueryStats(StatsPacket& out) {
+    statsReceived = false;
+    if (!Request(Opcode::kQueryStats).Ok() || !statsReceived) {
+        return false;
+    }
+    out = stats;
+    return true;
+}
+
+size_t MeterClient::Encode(const FrameType type, const uint8_t seq, const void* payload, const size_t length,
+                           uint8_t* out) {
+    const FrameHeader header{{Telemetry::Sync0, Telemetry::Sync1}, static_cast<uint8_t>(type), seq,
+        static_cast<uint16_t>(length)};
+    memcpy(out, &header, sizeof(header));
+    memcpy(out + sizeof(header), payload, length);
+    const uint16_t crc = Telemetry::Crc16(out + 2, sizeof(header) - 2 + length);
+    memcpy(out + sizeof(header) + length, &crc, sizeof(crc));
+    return sizeof(header) + length + sizeof(crc);
+}
+
+void MeterClient::OnFrame(const FrameType type, const uint8_t frameSeq, const uint8_t* payload,
+                          const size_t length) {
+    if (type == FrameType::kResponse && length == sizeof(ResponsePacket)) {
+        ResponsePacket response{};
+        memcpy(&response, payload, sizeof(response));
+        if (pendingId != 0 && response.id == pendingId) {
+            pending = response;
+            pendingAnswered = true;
+        }
+        return;
+    }
+    if (type == FrameType::kStats && length == sizeof(StatsPacket)) {
+        memcpy(&stats, payload, sizeof(stats));
+        statsReceived = true;
+        return;
+    }
+    if (onFrame != nullptr) {
+        onFrame(arg, type, frameSeq, payload, length);
+    }
+}
@@ -0,0 +1,89 @@
+#ifndef METER_CLIENT_HH
+#define METER_CLIENT_HH
+
+#include <cstddef>
+#include <cstdint>
+
+#include "command.hh"
+#include "link_decoder.hh"
+
+// Remote control of a tinyMeter over its serial link, the C++ counterpart of meter_client.py. Frames are built
+// with the firmware's own Telemetry::Crc16 and parsed by its FrameParser. Requests are matched to their responses
+// by id, telemetry frames and log lines received in the meantime go to the handlers instead of being dropped.
+struct MeterClient {
+    using FrameHandler = LinkDecoder::FrameHandler;
+    using TextHandler = LinkDecoder::TextHandler;
+
+    // What came back for one request, `answered` is false after a timeout
+    struct Reply {
+        bool answered;
+        ResponsePacket response;
+        uint32_t roundTripUs;
+
+        [[nodiscard]] bool Ok() const { return answered && response.status == static_cast<uint8_t>(Status::kOk); }
+    };
+
+    int fd;
+    LinkDecoder link;
+    FrameHandler onFrame;
+    TextHandler onText;
+    void* arg;
+    uint16_t nextId{1};
+    uint8_t seq{0};
+
+    // the last kStats frame and whether one arrived since QueryStats asked
+    StatsPacket stats{};
+    bool statsReceived{false};
+    LatencyStats deviceLatency{}; // as the device measured it, for every answered request
+    LatencyStats roundTrip{};
+
+    // Reply of the request in flight
+    uint16_t pendingId{0};
+    bool pendingAnswered{false};
+    ResponsePacket pending{};
+
+    // Takes over `fd`, an open serial device or pty
+    explicit MeterClient(int fd, FrameHandler onFrame = nullptr, TextHandler onText = nullptr, void* arg = nullptr);
+
+    MeterClient(const MeterClient&) = delete;
+
+    ~MeterClient();
+
+    // Opens a serial device raw and non-blocking, -1 on failure
+    static int Open(const char* path);
+
+    // Reads whatever arrived within `timeoutMs` and hands it on, returns the number of bytes read
+    size_t Poll(int timeoutMs);
+
+    // Sends one command and waits for its response
+    Reply Request(Opcode opcode, uint8_t channel = 0, uint32_t value = 0, int timeoutMs = 2000);
+
+    Reply Ping() { return Request(Opcode::kPing); }
+    Reply Enable(const uint8_t channel) { return Request(Opcode::kEnable, channel); }
+    Reply Disable(const uint8_t channel) { return Request(Opcode::kDisable, channel); }
+    Reply SetSamplePeriod(const uint32_t us) { return Request(Opcode::kSetSamplePeriod, 0, us); }
+    Reply SetInaConfig(const uint8_t channel, const uint16_t config) {
+        return Request(Opcode::kSetInaConfig, channel, config);
+    }
+    Reply Stream(const bool on) { return Request(on ? Opcode::kStreamStart : Opcode::kStreamStop); }
+    Reply CaptureRipple(const uint8_t channel) { return Request(Opcode::kCaptureRipple, channel, 0, 5000); }
+    Reply SetAlignPeriod(const uint32_t us) { return Request(Opcode::kSetAlignPeriod, 0, us); }
+    Reply SetMirrorBudget(const uint32_t bytesPerSecond) {
+        return Request(Opcode::kSetMirrorBudget, 0, bytesPerSecond);
+    }
+    Reply SetReadMode(const uint8_t channel, const bool derived) {
+        return Request(Opcode::kSetReadMode, channel, derived ? 1 : 0);
+    }
+    Reply SetFastPeriod(const uint32_t us) { return Request(Opcode::kSetFastPeriod, 0, us); }
+
+    // The kStats frame sent ahead of the response, false if either did not arrive
+    bool QueryStats(StatsPacket& out);
+
+    // Frame bytes in the firmware's format, `out` holds at least Telemetry::MaxFrame
+    static size_t Encode(FrameType type, uint8_t seq, const void* payload, size_t length, uint8_t* out);
+
+private:
+    void OnFrame(FrameType type, uint8_t frameSeq, const uint8_t* payload, size_t length);
+};
+
+#endif //METER_CLIENT_HH
@@ -0,0 +1,307 @@
+// Records a meter's serial link into a capture file, as capture.py does and with the same outputs, at the rate a
+// USB serial link delivers. Usage:
+//   tmcapture PORT OUTPUT [--csv PATH] [--log PATH] [--events PATH] [--duration S] [--idle S]
+// --idle stops once nothing arrived for that long after the first byte. A status line goes to stderr every
+// second, and a summary when the capture ends on a signal, the end of the link, --duration or --idle.
+
+#include <bit>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <poll.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "capture_file.hh"
+#include "link_decoder.hh"
+#include "meter_client.hh"
+
+namespace {
+    volatile std::sig_atomic_t stopped = 0;
+
+    // capture.py writes the lower-case names of its EventKind, LoadEvent::Kind in the same order
+    constexpr const char* EventNames[] = {"none", "plug_in", "idle", "rise", "fall", "inrush"};
+
+    int64_t NowNs() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    struct Capture {
+        static constexpr size_t ReadSize = 1 << 20;
+
+        capture_file::Writer output;
+        FILE* csv{nullptr};
+        FILE* log{nullptr};
+        FILE* events{nullptr};
+        LinkDecoder decoder{OnFrame, OnText, this};
+        int64_t now{0}; // host ns of the read being decoded
+        uint64_t bytes{0};
+        uint64_t samples{0};
+        uint32_t periods[capture_file::Channels]{}; // sampling period of each channel from its last kRate
+        std::vector<char> rows{};
+
+        explicit Capture(const char* output) : output{output} {
+            rows.reserve(ReadSize);
+        }
+
+        ~Capture() {
+            decoder.Flush();
+            WriteRows();
+            output.Close();
+            for (FILE* file : {csv, log, events}) {
+                if (file != nullptr) {
+                    fclose(file);
+                }
+            }
+        }
+
+        static void OnText(void* arg, const char* line, const size_t length) {
+            const auto& capture = *static_cast<Capture*>(arg);
+            if (capture.log != nullptr) {
+                fwrite(line, 1, length, capture.log);
+            }
+        }
+
+        static void OnFrame(void* arg, const FrameType type, const uint8_t seq, const uint8_t* payload,
+                            const size_t length) {
+            auto& capture = *static_cast<Capture*>(arg);
+            if (type == FrameType::kSamples) {
+                capture.output.AddSamples(payload, length);
+            } else {
+                capture.output.AddFrame(capture.now, static_cast<uint8_t>(type), seq, payload, length);
+            }
+            if (type == FrameType::kRate && length == sizeof(RatePacket)) {
+                RatePacket rate{};
+                memcpy(&rate, payload, sizeof(rate));
+                if (rate.channel < capture_file::Channels) {
+                    capture.periods[rate.channel] = rate.periodUs;
+                }
+            } else if (type == FrameType::kEvent && length == sizeof(EventPacket) && capture.events != nullptr) {
+                EventPacket event{};
+                memcpy(&event, payload, sizeof(event));
+                fprintf(capture.events, "%lld,%lu,%lu,%u,%s,%ld,%ld,%lu,%.6f\n", static_cast<long long>(capture.now),
+                    static_cast<unsigned long>(event.timeUs), static_cast<unsigned long>(event.delayUs),
+                    event.channel, event.kind < std::size(EventNames) ? EventNames[event.kind] : "none",
+                    static_cast<long>(event.beforeUa), static_cast<long>(event.afterUa),
+                    static_cast<unsigned long>(event.durationMs), static_cast<double>(event.energy));
+            } else if (type == FrameType::kSamples && length >= sizeof(SamplesHeader)) {
+                SamplesHeader header{};
+                memcpy(&header, payload, sizeof(header));
+                capture.Rows(seq, header.timeUs, false, header.channels, payload + sizeof(header),
+                    length - sizeof(header));
+            } else if (type == FrameType::kAligned && length >= sizeof(AlignedHeader)) {
+                AlignedHeader header{};
+                memcpy(&header, payload, sizeof(header));
+                capture.Rows(seq, header.timeUs, true, header.channels, payload + sizeof(header),
+                    length - sizeof(header));
+            }
+        }
+
+        static constexpr size_t Field = 21; // the longest integer and its separator
+
+        template<typename T>
+        static char* Put(char* pos, const T value, const char separator) {
+            pos = std::to_chars(pos, pos + Field - 1, value).ptr;
+            *pos = separator;
+            return pos + 1;
+        }
+
+        // A CSV row per reading, formatted without going through printf: at a full link this is most of the work
+        void Rows(const uint8_t seq, const uint32_t deviceUs, const bool aligned, const uint16_t channels,
+                  const uint8_t* values, const size_t length) {
+            constexpr size_t Reading = 3 * sizeof(int32_t);
+            if (length < static_cast<size_t>(std::popcount(channels)) * Reading) {
+                return;
+            }
+            for (uint8_t channel = 0; channel < capture_file::Channels; channel++) {
+                if ((channels & 1 << channel) == 0) {
+                    continue;
+                }
+                samples++;
+                if (csv == nullptr) {
+                    values += Reading;
+                    continue;
+                }
+                int32_t voltage, current;
+                uint32_t power;
+                memcpy(&voltage, values, sizeof(voltage));
+                memcpy(&current, values + 4, sizeof(current));
+                memcpy(&power, values + 8, sizeof(power));
+                values += Reading;
+                char row[9 * Field];
+                char* pos = Put(row, now, ',');
+                pos = Put(pos, seq, ',');
+                pos = Put(pos, deviceUs, ',');
+                pos = Put(pos, aligned ? 1 : 0, ',');
+                pos = Put(pos, channel, ',');
+                pos = Put(pos, voltage, ',');
+                pos = Put(pos, current, ',');
+                pos = Put(pos, power, ',');
+                pos = Put(pos, periods[channel], '\n');
+                rows.insert(rows.end(), row, pos);
+            }
+        }
+
+        void WriteRows() {
+            if (csv != nullptr && !rows.empty()) {
+                fwrite(rows.data(), 1, rows.size(), csv);
+            }
+            rows.clear();
+        }
+
+        // Decodes everything the port has, false once the other side is gone
+        bool Read(const int fd, uint8_t* buffer, const int timeoutMs) {
+            pollfd ready{fd, POLLIN, 0};
+            if (poll(&ready, 1, timeoutMs) <= 0) {
+                return true;
+            }
+            const ssize_t n = read(fd, buffer, ReadSize);
+            if (n < 0) {
+                return errno == EAGAIN || errno == EINTR;
+            }
+            if (n == 0) {
+                return false;
+            }
+            bytes += static_cast<uint64_t>(n);
+            now = NowNs();
+            decoder.Feed(buffer, static_cast<size_t>(n));
+            WriteRows();
+            return true;
+        }
+    };
+
+    FILE* OpenOutput(const char* path, const char* mode, const char* header) {
+        if (path == nullptr) {
+            return nullptr;
+        }
+        FILE* file = fopen(path, mode);
+        if (file == nullptr) {
+            fprintf(stderr, "tmcapture: cannot create %s: %s\n", path, strerror(errno));
+            exit(1);
+        }
+        setvbuf(file, nullptr, _IOFBF, 1 << 20);
+        if (header != nullptr) {
+            fputs(header, file);
+        }
+        return file;
+    }
+
+    int Usage() {
+        fprintf(stderr, "usage: tmcapture PORT OUTPUT [--csv PATH] [--log PATH] [--events PATH] [--duration S] "
+            "[--idle S]\n");
+        return 2;
+    }
+}
+
+int main(const int argc, char** argv) {
+    const char* positional[2]{};
+    size_t positionals = 0;
+    const char* csvPath = nullptr;
+    const char* logPath = nullptr;
+    const char* eventsPath = nullptr;
+    double duration = 0;
+    double idle = 0;
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg.starts_with("--") && i + 1 >= argc) {
+            return Usage();
+        }
+        if (arg == "--csv") {
+            csvPath = argv[++i];
+        } else if (arg == "--log") {
+            logPath = argv[++i];
+        } else if (arg == "--events") {
+            eventsPath = argv[++i];
+        } else if (arg == "--duration") {
+            duration = atof(argv[++i]);
+        } else if (arg == "--idle") {
+            idle = atof(argv[++i]);
+        } else if (arg.starts_with("--") || positionals == 2) {
+            return Usage();
+        } else {
+            positional[positionals++] = argv[i];
+        }
+    }
+    if (positionals != 2) {
+        return Usage();
+    }
+
+    const int fd = MeterClient::Open(positional[0]);
+    if (fd < 0) {
+        fprintf(stderr, "tmcapture: cannot open %s: %s\n", positional[0], strerror(errno));
+        return 1;
+    }
+    uint64_t frames = 0, samples = 0, lines = 0, lost = 0, crcErrors = 0, bytes = 0;
+    double elapsed = 0;
+    {
+        Capture capture{positional[1]};
+        if (capture.output.file == nullptr) {
+            fprintf(stderr, "tmcapture: cannot create %s: %s\n", positional[1], strerror(errno));
+            close(fd);
+            return 1;
+        }
+        capture.csv = OpenOutput(csvPath, "w",
+            "host_ns,seq,device_us,aligned,channel,voltage_uv,current_ua,power_uw,period_us\n");
+        capture.log = OpenOutput(logPath, "wb", nullptr);
+        capture.events = OpenOutput(eventsPath, "w",
+            "host_ns,device_us,delay_us,channel,kind,before_ua,after_ua,duration_ms,energy_j\n");
+        signal(SIGINT, [](int) { stopped = 1; });
+        signal(SIGTERM, [](int) { stopped = 1; });
+
+        std::vector<uint8_t> buffer(Capture::ReadSize);
+        const int64_t started = NowNs();
+        int64_t first = 0, received = 0, last = started;
+        uint64_t lastBytes = 0, lastFrames = 0;
+        while (!stopped && capture.Read(fd, buffer.data(), 200)) {
+            const int64_t now = NowNs();
+            if (capture.bytes > 0 && first == 0) {
+                first = capture.now;
+            }
+            if (capture.now > received) {
+                received = capture.now;
+            }
+            if (duration > 0 && static_cast<double>(now - started) >= duration * 1e9) {
+                break;
+            }
+            if (idle > 0 && first != 0 && static_cast<double>(now - received) >= idle * 1e9) {
+                break;
+            }
+            if (now - last >= 1000000000) {
+                const double seconds = static_cast<double>(now - last) * 1e-9;
+                fprintf(stderr, "\r%7.2f MB/s %8.0f frames/s  frames:%lu samples:%llu lines:%llu lost:%llu crc:%lu ",
+                    static_cast<double>(capture.bytes - lastBytes) / seconds / 1e6,
+                    static_cast<double>(capture.decoder.Frames() - lastFrames) / seconds,
+                    static_cast<unsigned long>(capture.decoder.Frames()),
+                    static_cast<unsigned long long>(capture.samples),
+                    static_cast<unsigned long long>(capture.decoder.lines),
+                    static_cast<unsigned long long>(capture.decoder.lost),
+                    static_cast<unsigned long>(capture.decoder.CrcErrors()));
+                last = now;
+                lastBytes = capture.bytes;
+                lastFrames = capture.decoder.Frames();
+            }
+        }
+        // from the first byte to the last, so the rate is the link's and not the time spent waiting for it
+        elapsed = first != 0 ? static_cast<double>(received - first) * 1e-9 : 0;
+        capture.decoder.Flush();
+        frames = capture.decoder.Frames();
+        samples = capture.samples;
+        lines = capture.decoder.lines;
+        lost = capture.decoder.lost;
+        crcErrors = capture.decoder.CrcErrors();
+        bytes = capture.bytes;
+    }
+    close(fd);
+    fprintf(stderr, "\n%llu bytes in %.3fs (%.1f MB/s), %llu frames, %llu samples, %llu lines, %llu lost, "
+        "%llu crc errors\n", static_cast<unsigned long long>(bytes), elapsed,
+        elapsed > 0 ? static_cast<double>(bytes) / elapsed / 1e6 : 0.0, static_cast<unsigned long long>(frames),
+        static_cast<unsigned long long>(samples), static_cast<unsigned long long>(lines),
+        static_cast<unsigned long long>(lost), static_cast<unsigned long long>(crcErrors));
+    return 0;
+}
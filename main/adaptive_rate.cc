@@ -0,0 +1,111 @@
+#include "adaptive_rate.hh"
+
+#include <cmath>
+
+bool RateController::Configure(const uint32_t basePeriodUs, const uint32_t fastPeriodUs) {
+    this->basePeriodUs = basePeriodUs;
+    this->fastPeriodUs = fastPeriodUs != 0 && fastPeriodUs < basePeriodUs ? fastPeriodUs : 0;
+    const uint32_t lowest = this->fastPeriodUs != 0 ? this->fastPeriodUs : basePeriodUs;
+    uint32_t period = periodUs;
+    if (period == 0 || period > basePeriodUs) { period = basePeriodUs; }
+    if (period < lowest) { period = lowest; }
+    if (period == periodUs) {
+        return false;
+    }
+    periodUs = period;
+    reason = Reason::kConfig;
+    return true;
+}
+
+bool RateController::Update(const float current, const bool enabled, const int64_t nowUs) {
+    const bool enabling = enabled && !this->enabled;
+    this->enabled = enabled;
+    if (!primed) {
+        primed = true;
+        mean = current;
+        quietSinceUs = nowUs;
+        return enabling && Trigger(Reason::kEnable, nowUs);
+    }
+    const float delta = current - mean;
+    const float sigma = std::sqrt(slowVariance);
+    const bool step = std::fabs(delta) > Deadband + StepSigmas * sigma;
+    mean += MeanAlpha * delta;
+    fastVariance += FastAlpha * (delta * delta - fastVariance);
+    // a step is not noise, keep it out of the reference so the next one is still caught
+    if (!step) {
+        slowVariance += SlowAlpha * (delta * delta - slowVariance);
+    }
+    const bool noisy = fastVariance > VarianceRatio * slowVariance + Deadband * Deadband;
+
+    if (enabling) {
+        return Trigger(Reason::kEnable, nowUs);
+    }
+    if (step) {
+        // follow the new level right away instead of flagging every reading until the average catches up
+        mean = current;
+        return Trigger(Reason::kStep, nowUs);
+    }
+    if (noisy) {
+        return Trigger(Reason::kVariance, nowUs);
+    }
+    if (periodUs >= basePeriodUs || nowUs - quietSinceUs < HoldUs) {
+        return false;
+    }
+    quietSinceUs = nowUs;
+    periodUs = periodUs * 2 < basePeriodUs ? periodUs * 2 : basePeriodUs;
+    reason = Reason::kDecay;
+    return true;
+}
+
+bool RateController::Trigger(const Reason why, const int64_t nowUs) {
+    quietSinceUs = nowUs;
+    if (fastPeriodUs == 0 || periodUs == fastPeriodUs) {
+        return false;
+    }
+    periodUs = fastPeriodUs;
+    reason = why;
+    return true;
+}
+
+void RateBudget::Allocate(const uint32_t* requestedUs, const float* costUs, const size_t count,
+                          uint32_t* grantedUs) {
+    if (Utilisation(requestedUs, costUs, count) <= Capacity) {
+        for (size_t i = 0; i < count; i++) {
+            grantedUs[i] = requestedUs[i];
+        }
+        return;
+    }
+    // water filling: settle the channels below the equal share of what is left until none is
+    bool settled[MaxChannels]{};
+    size_t open = count;
+    float left = Capacity;
+    bool changed = true;
+    while (changed && open > 0) {
+        changed = false;
+        const float share = left / static_cast<float>(open);
+        for (size_t i = 0; i < count; i++) {
+            const float load = costUs[i] / static_cast<float>(requestedUs[i]);
+            if (!settled[i] && load <= share) {
+                settled[i] = true;
+                grantedUs[i] = requestedUs[i];
+                left -= load;
+                open--;
+                changed = true;
+            }
+        }
+    }
+    const float share = open > 0 ? left / static_cast<float>(open) : 0.0f;
+    for (size_t i = 0; i < count; i++) {
+        if (!settled[i]) {
+            grantedUs[i] = static_cast<uint32_t>(std::ceil(costUs[i] / share));
+        }
+    }
+}
+
+float RateBudget::Utilisation(const uint32_t* periodsUs, const float* costUs, const size_t count) {
+    float total = 0;
+    for (size_t i = 0; i < count; i++) {
+        total += costUs[i] / static_cast<float>(periodsUs[i]);
+    }
+    return total;
+}
@@ -0,0 +1,63 @@
+#ifndef ADAPTIVE_RATE_HH
+#define ADAPTIVE_RATE_HH
+
+#include <cstddef>
+#include <cstdint>
+
+// Sampling period of one channel. A quiet channel is read every `basePeriodUs`; a step in current, a rise in
+// its short-term variance or the channel being enabled switches to `fastPeriodUs` for at least `HoldUs`, after
+// which the period doubles every `HoldUs` of quiet until it is back at the base.
+struct RateController {
+    enum class Reason : uint8_t {
+        kDecay = 0,
+        kStep = 1,
+        kVariance = 2,
+        kEnable = 3,
+        kBudget = 4, // the bus could not carry the requested rate
+        kConfig = 5, // base or fast period changed by command
+    };
+
+    static constexpr int64_t HoldUs = 250000;
+    static constexpr float Deadband = 0.005f; // A, steps below this never count as activity
+    static constexpr float StepSigmas = 4.0f;
+    static constexpr float VarianceRatio = 4.0f;
+    static constexpr float MeanAlpha = 0.1f;
+    static constexpr float FastAlpha = 0.25f; // short-term variance
+    static constexpr float SlowAlpha = 0.02f; // variance the short-term one is compared against
+
+    uint32_t basePeriodUs{0};
+    uint32_t fastPeriodUs{0}; // 0 keeps the channel at the base period
+    uint32_t periodUs{0};
+    Reason reason{Reason::kConfig};
+    float mean{0};
+    float fastVariance{0};
+    float slowVariance{0};
+    int64_t quietSinceUs{0};
+    bool primed{false};
+    bool enabled{false};
+
+    // Returns true when the period changed, `reason` tells why
+    bool Configure(uint32_t basePeriodUs, uint32_t fastPeriodUs);
+
+    // Feeds one reading taken at `nowUs`, returns true when the period changed
+    bool Update(float current, bool enabled, int64_t nowUs);
+
+private:
+    bool Trigger(Reason why, int64_t nowUs);
+};
+
+// Shares the time of one I2C bus between its channels. Each channel costs `costUs` of bus time per reading;
+// while the requested rates fit within `Capacity` every channel gets its request, otherwise the channels asking
+// for less than an equal share keep their rate and the others split what is left equally.
+struct RateBudget {
+    static constexpr float Capacity = 0.7f; // of the bus time, the rest absorbs commands and ripple captures
+    static constexpr size_t MaxChannels = 16;
+
+    // Writes the period each channel may use, never shorter than requested
+    static void Allocate(const uint32_t* requestedUs, const float* costUs, size_t count, uint32_t* grantedUs);
+
+    // Fraction of the bus time the periods use
+    [[nodiscard]] static float Utilisation(const uint32_t* periodsUs, const float* costUs, size_t count);
+};
+
+#endif //ADAPTIVE_RATE_HH
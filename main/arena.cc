@@ -0,0 +1,107 @@
+#include "arena.hh"
+
+#include <atomic>
+#include <esp_heap_caps.h>
+#include <esp_log.h>
+#include <esp_rom_sys.h>
+#include <esp_system.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+// internal-fast on the board in channel.hh (one bus, three channels), in bytes:
+//   meter canvases 3 x 22500, plot column extents 3 x 3600     78300
+//   ripple spectrum and analyzer, 1024 points                  20492
+//   sample fan-out, 27 blocks of 792 and the queues, per bus   21432
+//   sampler schedule and scratch frame, per bus                 4120
+//   deferred log ring, 64 records of 96                         6144
+//   display mirror payload                                      1024
+//   streamer and command rings, 16 x 46 + 8 x 16, per bus        864
+// 132376 in all, the rest is headroom. A second bus adds 26416 and whatever does not fit comes from the heap.
+Arena Arenas::arenas[3]{
+    {"internal-dma", MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT, 4 * 1024},
+    {"internal-fast", MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT, 144 * 1024},
+    {"psram-bulk", MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT, 512 * 1024},
+};
+
+bool Arena::Reserve() {
+    if (base != nullptr) {
+        return true;
+    }
+    base = static_cast<uint8_t*>(heap_caps_malloc(capacity, caps));
+    if (base == nullptr) {
+        ESP_LOGE("Arena", "Failed to reserve %u bytes for %s", capacity, name);
+        capacity = 0;
+        return false;
+    }
+    return true;
+}
+
+void* Arena::Allocate(const size_t size, const size_t align) {
+    size_t current = used.load(std::memory_order_relaxed);
+    while (base != nullptr) {
+        const size_t offset = (current + align - 1) & ~(align - 1);
+        if (offset + size > capacity) {
+            break;
+        }
+        if (used.compare_exchange_weak(current, offset + size, std::memory_order_relaxed)) {
+            return base + offset;
+        }
+    }
+    fallbacks.fetch_add(1, std::memory_order_relaxed);
+    fallbackBytes.fetch_add(size, std::memory_order_relaxed);
+    ESP_LOGW("Arena", "%s exhausted, %u bytes from the heap", name, size);
+    return heap_caps_aligned_alloc(align, size, caps);
+}
+
+void Arenas::Init() {
+    for (auto& arena : arenas) {
+        arena.Reserve();
+    }
+}
+
+void Arenas::Report() {
+    for (const auto& arena : arenas) {
+        ESP_LOGI("Arena", "%-13s used %6u/%6u bytes, %u fallbacks (%u bytes), heap free %u", arena.name,
+            arena.used.load(), arena.capacity, arena.fallbacks.load(), arena.fallbackBytes.load(),
+            heap_caps_get_free_size(arena.caps));
+    }
+}
+
+namespace {
+    TaskHandle_t watched[HeapGuard::MaxTasks]{};
+    std::atomic<size_t> watchedCount{0};
+    std::atomic<bool> armed{false};
+}
+
+void HeapGuard::Watch() {
+    if (const size_t index = watchedCount.fetch_add(1); index < MaxTasks) {
+        watched[index] = xTaskGetCurrentTaskHandle();
+    }
+}
+
+void HeapGuard::Arm() {
+    armed = true;
+    ESP_LOGI("HeapGuard", "Armed for %u tasks", watchedCount.load());
+}
+
+bool HeapGuard::IsViolation() {
+    if (!armed.load(std::memory_order_relaxed)) {
+        return false;
+    }
+    const TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    for (size_t i = 0; i < watchedCount.load(std::memory_order_relaxed) && i < MaxTasks; i++) {
+        if (watched[i] == task) {
+            return true;
+        }
+    }
+    return false;
+}
+
+#if CONFIG_TINYMETER_HEAP_GUARD
+extern "C" void esp_heap_trace_alloc_hook(void*, size_t size, uint32_t) {
+    if (HeapGuard::IsViolation()) {
+        esp_rom_printf("HeapGuard: %u byte allocation after init on %s\n", size, pcTaskGetName(nullptr));
+        esp_system_abort("heap allocation after init");
+    }
+}
+#endif
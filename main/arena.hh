@@ -0,0 +1,63 @@
+#ifndef ARENA_HH
+#define ARENA_HH
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+// Named memory regions reserved once at startup. Subsystems carve their buffers out of them with a bump
+// allocator, nothing is ever returned: buffers live as long as the firmware does.
+enum class Region : uint8_t {
+    kInternalDma = 0, // internal RAM a peripheral driver can DMA from
+    kInternalFast = 1, // internal RAM for buffers touched every frame or sample
+    kPsramBulk = 2, // external RAM for large, rarely touched history
+};
+
+struct Arena {
+    const char* name;
+    uint32_t caps;
+    size_t capacity;
+    uint8_t* base{};
+    std::atomic<size_t> used{0}; // init stages on both cores allocate at the same time
+    std::atomic<size_t> fallbacks{0};
+    std::atomic<size_t> fallbackBytes{0};
+
+    bool Reserve();
+
+    // Any task. Falls back to the heap with the region's caps (and counts it) when the arena is exhausted
+    void* Allocate(size_t size, size_t align = alignof(std::max_align_t));
+
+    template<typename T>
+    T* NewArray(const size_t count) {
+        auto* memory = static_cast<T*>(Allocate(sizeof(T) * count, alignof(T)));
+        for (size_t i = 0; memory != nullptr && i < count; i++) {
+            new (memory + i) T{};
+        }
+        return memory;
+    }
+};
+
+struct Arenas {
+    static Arena arenas[3];
+
+    static void Init();
+
+    static Arena& Get(Region region) { return arenas[static_cast<size_t>(region)]; }
+
+    static void Report();
+};
+
+// Any heap allocation from a watched task after Arm() is a bug on the hot paths. With
+// CONFIG_TINYMETER_HEAP_GUARD it aborts with the offending task's name, otherwise nothing is hooked.
+struct HeapGuard {
+    static constexpr size_t MaxTasks = 8;
+
+    static void Watch();
+
+    static void Arm();
+
+    static bool IsViolation();
+};
+
+#endif //ARENA_HH
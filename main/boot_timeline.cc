@@ -0,0 +1,31 @@
+#include "boot_timeline.hh"
+
+#include <algorithm>
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+BootTimeline::Mark BootTimeline::marks[MaxMarks]{};
+std::atomic<size_t> BootTimeline::count{0};
+
+int64_t BootTimeline::Record(const char *name) {
+    const int64_t now = esp_timer_get_time();
+    if (const size_t index = count.fetch_add(1); index < MaxMarks) {
+        marks[index] = {name, now, static_cast<int>(xPortGetCoreID())};
+    }
+    return now;
+}
+
+void BootTimeline::Report() {
+    const size_t size = std::min(count.load(), MaxMarks);
+    Mark sorted[MaxMarks];
+    std::copy(marks, marks + size, sorted);
+    std::sort(sorted, sorted + size, [](const Mark& a, const Mark& b) { return a.time < b.time; });
+    int64_t previous = 0;
+    for (size_t i = 0; i < size; i++) {
+        ESP_LOGI("Boot", "%8.2fms (+%7.2fms) core%d %s", static_cast<double>(sorted[i].time) / 1000.,
+            static_cast<double>(sorted[i].time - previous) / 1000., sorted[i].core, sorted[i].name);
+        previous = sorted[i].time;
+    }
+}
@@ -0,0 +1,27 @@
+#ifndef BOOT_TIMELINE_HH
+#define BOOT_TIMELINE_HH
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Timestamps of startup milestones, safe to mark from tasks on both cores
+struct BootTimeline {
+    static constexpr size_t MaxMarks = 48;
+
+    struct Mark {
+        const char* name;
+        int64_t time;
+        int core;
+    };
+
+    static Mark marks[MaxMarks];
+    static std::atomic<size_t> count;
+
+    // Records `name` at the current esp_timer time (microseconds since boot)
+    static int64_t Record(const char* name);
+
+    static void Report();
+};
+
+#endif //BOOT_TIMELINE_HH
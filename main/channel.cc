@@ -0,0 +1,23 @@
+#include "channel.hh"
+
+#include <esp_log.h>
+
+ChannelRegistry::ChannelRegistry(const BusConfig *busConfigs, const size_t busCount,
+                                 const ChannelConfig *channelConfigs, const size_t channelCount):
+    busConfigs{busConfigs},
+    channelConfigs{channelConfigs},
+    busCount{busCount},
+    channelCount{channelCount} {
+}
+
+void ChannelRegistry::InitBus(const size_t bus) {
+    const BusConfig& config = busConfigs[bus];
+    buses[bus].emplace(config.port, config.sda, config.scl);
+    for (size_t i = 0; i < channelCount; i++) {
+        const ChannelConfig& channel = channelConfigs[i];
+        if (channel.bus == bus) {
+            channels[i].emplace(*buses[bus], channel.address, channel.enableGpio, channel.name, channel.shunt);
+        }
+    }
+    ESP_LOGI("Channels", "Bus %u ready", bus);
+}
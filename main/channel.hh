@@ -0,0 +1,73 @@
+#ifndef CHANNEL_HH
+#define CHANNEL_HH
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+#include "hal_i2c.hh"
+#include "meter_bus.hh"
+
+struct BusConfig {
+    int port;
+    int sda;
+    int scl;
+};
+
+struct ChannelConfig {
+    const char* name;
+    uint8_t bus; // index into the bus table
+    uint16_t address;
+    int enableGpio;
+    float shunt; // mOhm
+};
+
+// Board description: every INA219 channel, the I2C bus it sits on and the GPIO driving its load switch.
+// Channels on different buses are sampled in parallel, one sampling task per bus.
+namespace board {
+    constexpr BusConfig Buses[] = {
+        {I2C_NUM_1, 34, 35},
+    };
+
+    constexpr ChannelConfig Channels[] = {
+        {"DC Jack", 0, 0x41, 37, 100.0f},
+        {"USB-2", 0, 0x44, 36, 100.0f},
+        {"USB-1", 0, 0x40, 33, 100.0f},
+    };
+
+    constexpr size_t BusCount = sizeof(Buses) / sizeof(Buses[0]);
+    constexpr size_t ChannelCount = sizeof(Channels) / sizeof(Channels[0]);
+}
+
+struct ChannelRegistry {
+    static constexpr size_t MaxBuses = 2; // I2C controllers on the ESP32-S3
+    static constexpr size_t MaxChannels = 16;
+
+    static_assert(board::BusCount <= MaxBuses);
+    static_assert(board::ChannelCount <= MaxChannels);
+
+    const BusConfig* busConfigs;
+    const ChannelConfig* channelConfigs;
+    size_t busCount;
+    size_t channelCount;
+    std::optional<hal::I2CBus> buses[MaxBuses]{};
+    std::optional<MeterBus> channels[MaxChannels]{};
+
+    ChannelRegistry(const BusConfig* busConfigs, size_t busCount,
+                    const ChannelConfig* channelConfigs, size_t channelCount);
+
+    ChannelRegistry() : ChannelRegistry(board::Buses, board::BusCount, board::Channels, board::ChannelCount) { }
+
+    // Brings up one bus and all channels on it, buses can be initialized from different tasks
+    void InitBus(size_t bus);
+
+    [[nodiscard]] size_t Size() const { return channelCount; }
+
+    [[nodiscard]] MeterBus& operator[](const size_t channel) { return *channels[channel]; }
+
+    [[nodiscard]] const MeterBus& operator[](const size_t channel) const { return *channels[channel]; }
+
+    [[nodiscard]] uint8_t BusOf(const size_t channel) const { return channelConfigs[channel].bus; }
+};
+
+#endif //CHANNEL_HH
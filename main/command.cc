@@ -0,0 +1,77 @@
+#include "command.hh"
+
+#include <cstring>
+
+void FrameParser::Feed(const uint8_t *data, size_t size) {
+    while (size-- > 0) {
+        const uint8_t byte = *data++;
+        switch (state) {
+            case State::kSync0:
+                if (byte == Telemetry::Sync0) {
+                    header[0] = byte;
+                    state = State::kSync1;
+                }
+                break;
+            case State::kSync1:
+                if (byte == Telemetry::Sync1) {
+                    header[1] = byte;
+                    pos = 2;
+                    state = State::kHeader;
+                } else if (byte != Telemetry::Sync0) {
+                    state = State::kSync0;
+                }
+                break;
+            case State::kHeader:
+                header[pos++] = byte;
+                if (pos == sizeof(FrameHeader)) {
+                    FrameHeader frame{};
+                    memcpy(&frame, header, sizeof(frame));
+                    length = frame.length;
+                    pos = 0;
+                    if (length > sizeof(payload)) {
+                        oversized++;
+                        state = State::kSync0;
+                    } else {
+                        state = length > 0 ? State::kPayload : State::kCrc;
+                    }
+                }
+                break;
+            case State::kPayload:
+                payload[pos++] = byte;
+                if (pos == length) {
+                    pos = 0;
+                    state = State::kCrc;
+                }
+                break;
+            case State::kCrc:
+                crc[pos++] = byte;
+                if (pos == sizeof(crc)) {
+                    uint16_t expected = Telemetry::Crc16(header + 2, sizeof(FrameHeader) - 2);
+                    expected = Telemetry::Crc16(payload, length, expected);
+                    if (static_cast<uint16_t>(crc[0] | crc[1] << 8) == expected) {
+                        frames++;
+                        const FrameHeader* frame = reinterpret_cast<const FrameHeader*>(header);
+                        handler(arg, static_cast<FrameType>(frame->type), frame->seq, payload, length);
+                    } else {
+                        crcErrors++;
+                    }
+                    state = State::kSync0;
+                }
+                break;
+        }
+    }
+}
+
+void LatencyStats::Add(const uint32_t latencyUs) {
+    count++;
+    total += latencyUs;
+    if (latencyUs < min) { min = latencyUs; }
+    if (latencyUs > max) { max = latencyUs; }
+}
+
+void LatencyStats::Merge(const LatencyStats& other) {
+    count += other.count;
+    total += other.total;
+    if (other.min < min) { min = other.min; }
+    if (other.max > max) { max = other.max; }
+}
@@ -0,0 +1,117 @@
+#ifndef COMMAND_HH
+#define COMMAND_HH
+
+#include <cstddef>
+#include <cstdint>
+
+#include "telemetry.hh"
+
+// Remote control requests arrive as kCommand frames and are answered with a kResponse frame carrying the
+// same id once the command took effect, together with the time that took.
+enum class Opcode : uint8_t {
+    kPing = 0x00,
+    kEnable = 0x01, // channel
+    kDisable = 0x02, // channel
+    kSetSamplePeriod = 0x03, // value: microseconds between readings of a quiet channel, see kSetFastPeriod
+    kSetInaConfig = 0x04, // channel, value: INA219 configuration register
+    kStreamStart = 0x05,
+    kStreamStop = 0x06,
+    kCaptureRipple = 0x07, // channel
+    kQueryStats = 0x08, // answered with an additional kStats frame
+    kSetAlignPeriod = 0x09, // value: microseconds between kAligned frames, 0 stops them
+    kSetMirrorBudget = 0x0A, // value: bytes per second for kMirror frames, 0 stops them
+    kSetReadMode = 0x0B, // channel, value: 0 reads all registers, 1 derives current and power on the device
+    // value: microseconds between readings of an active channel, 0 keeps all at the base. A base period more
+    // than Resampler::MaxPeriodRatio times the fast one is refused, set the periods in the order that avoids it.
+    kSetFastPeriod = 0x0C,
+};
+
+enum class Status : uint8_t {
+    kOk = 0x00,
+    kBadChannel = 0x01,
+    kBadValue = 0x02,
+    kUnknownOpcode = 0x03,
+    kBusy = 0x04,
+};
+
+struct __attribute__((packed)) CommandPacket {
+    uint16_t id;
+    uint8_t opcode;
+    uint8_t channel;
+    uint32_t value;
+};
+
+struct __attribute__((packed)) ResponsePacket {
+    uint16_t id;
+    uint8_t opcode;
+    uint8_t status;
+    uint32_t latencyUs; // from the last byte of the command frame to the effect being applied
+    uint32_t value;
+};
+
+struct __attribute__((packed)) StatsPacket {
+    uint32_t uptimeMs;
+    uint32_t sentFrames;
+    uint32_t droppedFrames;
+    uint32_t crcErrors;
+    uint32_t commands;
+    uint32_t latencyMinUs;
+    uint32_t latencyMaxUs;
+    uint32_t latencyAvgUs;
+    uint32_t samplePeriodUs;
+    uint8_t streaming;
+    uint8_t channels;
+    uint16_t enabled; // bit per channel
+};
+
+// A command together with the time its frame was complete
+struct Command {
+    CommandPacket packet;
+    int64_t receivedUs;
+};
+
+// Incremental frame parser: accepts whatever chunk the link returned, never waits for more
+struct FrameParser {
+    enum class State : uint8_t {
+        kSync0,
+        kSync1,
+        kHeader,
+        kPayload,
+        kCrc,
+    };
+
+    using Handler = void (*)(void* arg, FrameType type, uint8_t seq, const uint8_t* payload, size_t length);
+
+    Handler handler;
+    void* arg;
+    State state{State::kSync0};
+    uint8_t header[sizeof(FrameHeader)]{};
+    uint8_t payload[Telemetry::MaxPayload]{};
+    uint8_t crc[2]{};
+    size_t pos{0};
+    uint16_t length{0};
+
+    uint32_t frames{0};
+    uint32_t crcErrors{0};
+    uint32_t oversized{0};
+
+    FrameParser(Handler handler, void* arg) : handler{handler}, arg{arg} { }
+
+    void Feed(const uint8_t* data, size_t size);
+};
+
+// Running min/max/mean of command-to-effect latency
+struct LatencyStats {
+    uint32_t count{0};
+    uint32_t min{UINT32_MAX};
+    uint32_t max{0};
+    uint64_t total{0};
+
+    void Add(uint32_t latencyUs);
+
+    void Merge(const LatencyStats& other);
+
+    [[nodiscard]] uint32_t Average() const { return count > 0 ? static_cast<uint32_t>(total / count) : 0; }
+};
+
+#endif //COMMAND_HH
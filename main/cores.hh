@@ -0,0 +1,32 @@
+#ifndef CORES_HH
+#define CORES_HH
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+// Task placement. With CONFIG_TINYMETER_CORE_PARTITION acquisition owns core 1 at a priority above everything
+// else, rendering, streaming and the command link share core 0. Otherwise FreeRTOS is free to move tasks.
+namespace cores {
+#if CONFIG_TINYMETER_CORE_PARTITION
+    constexpr bool Partitioned = true;
+    constexpr BaseType_t Sampler = 1;
+    constexpr BaseType_t Io = 0;
+    constexpr UBaseType_t SamplerPriority = configMAX_PRIORITIES - 2;
+#else
+    constexpr bool Partitioned = false;
+    constexpr BaseType_t Sampler = tskNO_AFFINITY;
+    constexpr BaseType_t Io = tskNO_AFFINITY;
+    constexpr UBaseType_t SamplerPriority = 1;
+#endif
+    constexpr UBaseType_t IoPriority = 5;
+
+    constexpr const char* Name() { return Partitioned ? "partitioned" : "shared"; }
+}
+
+// Timer callbacks would otherwise preempt the sampler on its own core
+#if CONFIG_TINYMETER_CORE_PARTITION && defined(CONFIG_ESP_TIMER_TASK_AFFINITY) && \
+    !(CONFIG_ESP_TIMER_TASK_AFFINITY_CPU0 && CONFIG_FREERTOS_TIMER_TASK_AFFINITY_CPU0)
+#error "CONFIG_TINYMETER_CORE_PARTITION needs the esp_timer and FreeRTOS timer tasks pinned to CPU0"
+#endif
+
+#endif //CORES_HH
@@ -0,0 +1,169 @@
+#include "deferred_log.hh"
+
+#include <cstdio>
+#include <cstring>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+MpscRing<LogRecord>* DeferredLog::ring{};
+DeferredLog::Sink DeferredLog::sink{[](const char* line, const size_t length) {
+    fwrite(line, 1, length, stdout);
+}};
+
+namespace {
+    // Sites that have suppressed records at least once, pushed by the call sites and walked by the drain task
+    std::atomic<LogSite*> suppressedSites{};
+
+    constexpr int64_t ReportPeriodUs = 1000000;
+
+    // Appends one conversion, `spec` is the whole specification from '%' up to the conversion character
+    size_t Convert(char* out, const size_t size, const char* spec, const LogArg* arg) {
+        if (arg == nullptr) {
+            return snprintf(out, size, "<?>");
+        }
+        const size_t length = strlen(spec);
+        const char conversion = spec[length - 1];
+        const bool longLong = strstr(spec, "ll") != nullptr || strchr(spec, 'j') != nullptr;
+        const bool isLong = !longLong && strchr(spec, 'l') != nullptr;
+        const bool isSize = strchr(spec, 'z') != nullptr || strchr(spec, 't') != nullptr;
+        switch (conversion) {
+            case 'd':
+            case 'i':
+                if (longLong) { return snprintf(out, size, spec, static_cast<long long>(arg->integer)); }
+                if (isLong) { return snprintf(out, size, spec, static_cast<long>(arg->integer)); }
+                if (isSize) { return snprintf(out, size, spec, static_cast<ptrdiff_t>(arg->integer)); }
+                return snprintf(out, size, spec, static_cast<int>(arg->integer));
+            case 'u':
+            case 'x':
+            case 'X':
+            case 'o':
+                if (longLong) { return snprintf(out, size, spec, static_cast<unsigned long long>(arg->integer)); }
+                if (isLong) { return snprintf(out, size, spec, static_cast<unsigned long>(arg->integer)); }
+                if (isSize) { return snprintf(out, size, spec, static_cast<size_t>(arg->integer)); }
+                return snprintf(out, size, spec, static_cast<unsigned>(arg->integer));
+            case 'c':
+                return snprintf(out, size, spec, static_cast<int>(arg->integer));
+            case 's':
+                return snprintf(out, size, spec,
+                    arg->pointer != nullptr ? static_cast<const char*>(arg->pointer) : "(null)");
+            case 'p':
+                return snprintf(out, size, spec, arg->pointer);
+            default:
+                return snprintf(out, size, spec, arg->real);
+        }
+    }
+
+    // Keeps `pos` within a buffer of `size` after a snprintf that may have been truncated
+    size_t Advance(const size_t pos, const size_t written, const size_t size) {
+        return pos + written < size ? pos + written : size - 1;
+    }
+}
+
+void DeferredLog::Init(const Region region) {
+    static MpscRing<LogRecord> records{Capacity, region};
+    ring = &records;
+}
+
+void DeferredLog::Start(const int core, const unsigned priority) {
+    xTaskCreatePinnedToCore([](void*) {
+        int64_t reported = Now();
+        while (true) {
+            const int64_t now = Now();
+            const bool report = now - reported >= ReportPeriodUs;
+            if (report) {
+                reported = now;
+            }
+            Flush(report);
+            vTaskDelay(pdMS_TO_TICKS(20));
+        }
+    }, "Log", 4096, nullptr, priority, nullptr, core);
+}
+
+void DeferredLog::Flush(const bool report) {
+    char line[MaxLine];
+    LogRecord record{};
+    while (ring != nullptr && ring->Pop(record)) {
+        const size_t length = Format(record, line, sizeof(line));
+        sink(line, length);
+    }
+    if (!report) {
+        return;
+    }
+    const auto ms = static_cast<unsigned long>(Now() / 1000);
+    for (LogSite* site = suppressedSites.load(std::memory_order_acquire); site != nullptr; site = site->next) {
+        if (const uint32_t count = site->suppressed.exchange(0); count > 0) {
+            const size_t length = Advance(0, snprintf(line, sizeof(line), "W (%lu) %s: %lu more like \"%s\"\n",
+                ms, site->tag, static_cast<unsigned long>(count), site->format), sizeof(line));
+            sink(line, length);
+        }
+    }
+    if (const uint32_t dropped = ring != nullptr ? ring->dropped.exchange(0) : 0; dropped > 0) {
+        const size_t length = Advance(0, snprintf(line, sizeof(line), "W (%lu) DeferredLog: %lu records dropped\n",
+            ms, static_cast<unsigned long>(dropped)), sizeof(line));
+        sink(line, length);
+    }
+}
+
+size_t DeferredLog::Format(const LogRecord& record, char* line, const size_t size) {
+    const LogSite& site = *record.site;
+    // leave room for the newline
+    const size_t end = size - 1;
+    size_t pos = Advance(0, snprintf(line, end, "%c (%lu) %s: ", site.level,
+        static_cast<unsigned long>(record.timeUs / 1000), site.tag), end);
+    size_t arg = 0;
+    char spec[16];
+    for (const char* c = site.format; *c != '\0' && pos + 1 < end; c++) {
+        if (*c != '%') {
+            line[pos++] = *c;
+            continue;
+        }
+        if (c[1] == '%') {
+            line[pos++] = '%';
+            c++;
+            continue;
+        }
+        size_t length = 0;
+        spec[length++] = *c++;
+        while (*c != '\0' && strchr("diouxXcspfFeEgGaA", *c) == nullptr && length + 2 < sizeof(spec)) {
+            spec[length++] = *c++;
+        }
+        if (*c == '\0') {
+            break;
+        }
+        spec[length++] = *c;
+        spec[length] = '\0';
+        const LogArg* value = arg < record.count ? &record.args[arg] : nullptr;
+        arg++;
+        pos = Advance(pos, Convert(line + pos, end - pos, spec, value), end);
+    }
+    line[pos++] = '\n';
+    line[pos] = '\0';
+    return pos;
+}
+
+int64_t DeferredLog::Now() {
+    return esp_timer_get_time();
+}
+
+bool DeferredLog::Allow(LogSite& site, const int64_t now) {
+    const auto second = static_cast<uint32_t>(now / 1000000);
+    if (site.second.load(std::memory_order_relaxed) != second) {
+        // racing tasks may both reset the window, which only lets a few more records through
+        site.second.store(second, std::memory_order_relaxed);
+        site.inSecond.store(0, std::memory_order_relaxed);
+    }
+    if (site.inSecond.fetch_add(1, std::memory_order_relaxed) < RatePerSecond) {
+        return true;
+    }
+    site.suppressed.fetch_add(1, std::memory_order_relaxed);
+    // a plain load first: a flooding site is listed after its first suppressed record
+    if (!site.listed.load(std::memory_order_relaxed) && !site.listed.exchange(true, std::memory_order_relaxed)) {
+        LogSite* head = suppressedSites.load(std::memory_order_relaxed);
+        do {
+            site.next = head;
+        } while (!suppressedSites.compare_exchange_weak(head, &site, std::memory_order_release,
+                                                        std::memory_order_relaxed));
+    }
+    return false;
+}
@@ -0,0 +1,121 @@
+#ifndef DEFERRED_LOG_HH
+#define DEFERRED_LOG_HH
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#include "mpsc_ring.hh"
+
+// Logging for the sampling, UI and streaming paths. A call site only copies its arguments into a record, the
+// text is formatted and written by a low-priority task. Every site may log `RatePerSecond` records a second,
+// the rest are counted and reported as one line, and so are records lost to a full ring.
+//
+// String arguments are stored as pointers: they must outlive the record, so only pass literals and names.
+#define DLOGE(tag, format, ...) DLOG_AT('E', tag, format, ##__VA_ARGS__)
+#define DLOGW(tag, format, ...) DLOG_AT('W', tag, format, ##__VA_ARGS__)
+#define DLOGI(tag, format, ...) DLOG_AT('I', tag, format, ##__VA_ARGS__)
+
+#define DLOG_AT(level, tag, format, ...) do { \
+        static LogSite logSite{tag, format, level}; \
+        if (false) { DeferredLog::CheckFormat(format, ##__VA_ARGS__); } \
+        DeferredLog::Write(logSite, ##__VA_ARGS__); \
+    } while (false)
+
+struct LogSite {
+    const char* tag;
+    const char* format;
+    char level;
+    std::atomic<uint32_t> second{0};
+    std::atomic<uint32_t> inSecond{0};
+    std::atomic<uint32_t> suppressed{0};
+    std::atomic<bool> listed{false};
+    LogSite* next{};
+
+    constexpr LogSite(const char* tag, const char* format, const char level) :
+        tag{tag},
+        format{format},
+        level{level} { }
+
+    LogSite(const LogSite&) = delete;
+};
+
+union LogArg {
+    int64_t integer;
+    double real;
+    const void* pointer;
+};
+
+struct LogRecord {
+    static constexpr size_t MaxArgs = 8;
+
+    const LogSite* site;
+    int64_t timeUs;
+    uint8_t count;
+    LogArg args[MaxArgs];
+};
+
+struct DeferredLog {
+    static constexpr size_t Capacity = 64;
+    static constexpr uint32_t RatePerSecond = 5;
+    static constexpr size_t MaxLine = 256;
+
+    // Receives every formatted line including its newline, writes to stdout unless replaced
+    using Sink = void (*)(const char* line, size_t length);
+
+    static MpscRing<LogRecord>* ring;
+    static Sink sink;
+
+    static void Init(Region region = Region::kInternalFast);
+
+    // Starts the task that drains the ring
+    static void Start(int core, unsigned priority);
+
+    template<typename... Args>
+    static void Write(LogSite& site, Args... args) {
+        static_assert(sizeof...(Args) <= LogRecord::MaxArgs, "Too many log arguments");
+        const int64_t now = Now();
+        if (!Allow(site, now)) {
+            return;
+        }
+        if (ring == nullptr) {
+            return;
+        }
+        ring->Push([&](LogRecord& record) {
+            record.site = &site;
+            record.timeUs = now;
+            record.count = sizeof...(Args);
+            size_t i = 0;
+            ((record.args[i++] = Arg(args)), ...);
+        });
+    }
+
+    // Formats and writes every queued record, then the suppressed and dropped counts if `report` is set
+    static void Flush(bool report);
+
+    // Formats `record` into `line` as ESP_LOG does, returns the length without the terminator
+    static size_t Format(const LogRecord& record, char* line, size_t size);
+
+    [[gnu::format(printf, 1, 2)]] static void CheckFormat(const char*, ...) { }
+
+private:
+    static int64_t Now();
+
+    static bool Allow(LogSite& site, int64_t now);
+
+    template<typename T>
+    static LogArg Arg(const T value) {
+        LogArg arg{};
+        if constexpr (std::is_floating_point_v<T>) {
+            arg.real = value;
+        } else if constexpr (std::is_pointer_v<T>) {
+            arg.pointer = value;
+        } else {
+            arg.integer = static_cast<int64_t>(value);
+        }
+        return arg;
+    }
+};
+
+#endif //DEFERRED_LOG_HH
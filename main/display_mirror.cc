@@ -0,0 +1,151 @@
+#include "display_mirror.hh"
+
+#include <cstring>
+#include <esp_timer.h>
+
+#include "deferred_log.hh"
+
+DisplayMirror::DisplayMirror(Telemetry& telemetry, const uint16_t width, const uint16_t height, const Region region) :
+    telemetry{telemetry},
+    width{width},
+    height{height},
+    current{Arenas::Get(region).NewArray<uint16_t>(static_cast<size_t>(width) * height)},
+    shadow{Arenas::Get(region).NewArray<uint16_t>(static_cast<size_t>(width) * height)},
+    payload{static_cast<uint8_t*>(Arenas::Get(Region::kInternalFast).Allocate(Telemetry::MaxPayload))} {
+}
+
+void DisplayMirror::Capture(const lv_area_t& flushed, const lv_color_t* pixels) {
+    if (budget == 0) {
+        return;
+    }
+    const lv_coord_t x1 = flushed.x1 < 0 ? 0 : flushed.x1;
+    const lv_coord_t y1 = flushed.y1 < 0 ? 0 : flushed.y1;
+    const lv_coord_t x2 = flushed.x2 >= width ? static_cast<lv_coord_t>(width - 1) : flushed.x2;
+    const lv_coord_t y2 = flushed.y2 >= height ? static_cast<lv_coord_t>(height - 1) : flushed.y2;
+    if (x1 > x2 || y1 > y2) {
+        return;
+    }
+    const size_t stride = flushed.x2 - flushed.x1 + 1;
+    for (lv_coord_t y = y1; y <= y2; y++) {
+        const lv_color_t* source = pixels + (y - flushed.y1) * stride + (x1 - flushed.x1);
+        memcpy(current + y * width + x1, source, (x2 - x1 + 1) * sizeof(uint16_t));
+    }
+    if (!dirty) {
+        area = {x1, y1, x2, y2};
+        dirty = true;
+    } else {
+        if (x1 < area.x1) { area.x1 = x1; }
+        if (y1 < area.y1) { area.y1 = y1; }
+        if (x2 > area.x2) { area.x2 = x2; }
+        if (y2 > area.y2) { area.y2 = y2; }
+    }
+}
+
+size_t DisplayMirror::EncodeRow(const uint16_t* row, const uint16_t* previous, const size_t count, uint8_t* out,
+                                const size_t size) {
+    size_t len = 0;
+    size_t i = 0;
+    while (i < count) {
+        const size_t limit = count - i < MaxCount ? count - i : MaxCount;
+        size_t n = 1;
+        if (row[i] == previous[i]) {
+            while (n < limit && row[i + n] == previous[i + n]) { n++; }
+            if (len + 1 > size) { return 0; }
+            out[len++] = static_cast<uint8_t>(OpSkip | (n - 1));
+        } else {
+            while (n < limit && row[i + n] == row[i]) { n++; }
+            if (n >= 2) {
+                if (len + 3 > size) { return 0; }
+                out[len++] = static_cast<uint8_t>(OpRun | (n - 1));
+                memcpy(out + len, &row[i], sizeof(uint16_t));
+                len += sizeof(uint16_t);
+            } else {
+                // literal until an unchanged pixel or a run of the same colour starts
+                while (n < limit && row[i + n] != previous[i + n] &&
+                       (i + n + 1 >= count || row[i + n] != row[i + n + 1])) {
+                    n++;
+                }
+                if (len + 1 + n * sizeof(uint16_t) > size) { return 0; }
+                out[len++] = static_cast<uint8_t>(OpLiteral | (n - 1));
+                memcpy(out + len, &row[i], n * sizeof(uint16_t));
+                len += n * sizeof(uint16_t);
+            }
+        }
+        i += n;
+    }
+    return len;
+}
+
+void DisplayMirror::Pump() {
+    const int64_t now = esp_timer_get_time();
+    if (const uint32_t requested = requestedBudget; requested != budget) {
+        if (budget == 0) {
+            // the host starts from black, LVGL redraws everything into `current`
+            memset(shadow, 0, static_cast<size_t>(width) * height * sizeof(uint16_t));
+            lv_obj_invalidate(lv_scr_act());
+            credit = 0;
+            frames = 0;
+            sentBytes = rawBytes = 0;
+            encodeUs = 0;
+            reportUs = now;
+        }
+        budget = requested;
+        // a running stream keeps its dirty rows, the host is still missing them
+        if (budget == 0) {
+            dirty = false;
+        }
+        lastUs = now;
+    }
+    if (budget == 0) {
+        return;
+    }
+    // a burst of 200ms, but always enough for one full frame
+    const int64_t burst = budget / 5 > Telemetry::MaxPayload ? budget / 5 : Telemetry::MaxPayload;
+    credit += static_cast<int64_t>(budget) * (now - lastUs) / 1000000;
+    if (credit > burst) { credit = burst; }
+    lastUs = now;
+
+    while (dirty) {
+        const int64_t begin = esp_timer_get_time();
+        const size_t segment = area.x2 - area.x1 + 1;
+        MirrorHeader header{width, height, static_cast<uint16_t>(area.x1), static_cast<uint16_t>(area.y1),
+                            static_cast<uint16_t>(segment), 0};
+        size_t len = sizeof(header);
+        for (lv_coord_t y = area.y1; y <= area.y2; y++) {
+            const size_t offset = y * width + area.x1;
+            const size_t encoded = EncodeRow(current + offset, shadow + offset, segment, payload + len,
+                                             Telemetry::MaxPayload - len);
+            if (encoded == 0) { break; }
+            len += encoded;
+            header.rows++;
+        }
+        memcpy(payload, &header, sizeof(header));
+        encodeUs += esp_timer_get_time() - begin;
+        if (header.rows == 0 || credit < static_cast<int64_t>(len)) {
+            break;
+        }
+        if (!telemetry.Send(FrameType::kMirror, payload, len)) {
+            break; // link is busy, the rows stay dirty
+        }
+        credit -= static_cast<int64_t>(len);
+        frames++;
+        sentBytes += len;
+        rawBytes += header.rows * segment * sizeof(uint16_t);
+        for (uint16_t row = 0; row < header.rows; row++) {
+            const size_t offset = (area.y1 + row) * width + area.x1;
+            memcpy(shadow + offset, current + offset, segment * sizeof(uint16_t));
+        }
+        area.y1 = static_cast<lv_coord_t>(area.y1 + header.rows);
+        dirty = area.y1 <= area.y2;
+    }
+
+    if (now - reportUs > 10000000) {
+        reportUs = now;
+        if (frames > 0) {
+            DLOGI("Mirror", "%lu frames, %llu bytes, ratio %.1f, encode %lldus per frame",
+                static_cast<unsigned long>(frames), static_cast<unsigned long long>(sentBytes),
+                static_cast<float>(rawBytes) / static_cast<float>(sentBytes),
+                static_cast<long long>(encodeUs / frames));
+        }
+    }
+}
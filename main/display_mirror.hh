@@ -0,0 +1,72 @@
+#ifndef DISPLAY_MIRROR_HH
+#define DISPLAY_MIRROR_HH
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <lvgl.h>
+
+#include "arena.hh"
+#include "telemetry.hh"
+
+// kMirror payload: this header, then `rows` rows of `width` RGB565 pixels starting at (x, y), each row
+// fully covered by tokens. A token is one byte, op in the top two bits and count - 1 in the low six:
+//   00 skip:    `count` pixels are unchanged since the previous frame
+//   01 run:     one pixel (u16) repeated `count` times
+//   10 literal: `count` pixels (u16 each) follow
+struct __attribute__((packed)) MirrorHeader {
+    uint16_t screenWidth;
+    uint16_t screenHeight;
+    uint16_t x;
+    uint16_t y;
+    uint16_t width;
+    uint16_t rows;
+};
+
+// Streams what LVGL flushes to the panel so a host viewer can rebuild the screen. Flushed areas are copied
+// into `current` and merged into one dirty rectangle; Pump() sends that rectangle a few rows at a time,
+// delta-coded against `shadow` (what the host has), without exceeding the byte budget per second.
+// Capture() and Pump() both run on the LVGL task.
+struct DisplayMirror {
+    static constexpr uint8_t OpSkip = 0x00;
+    static constexpr uint8_t OpRun = 0x40;
+    static constexpr uint8_t OpLiteral = 0x80;
+    static constexpr size_t MaxCount = 64;
+
+    Telemetry& telemetry;
+    uint16_t width;
+    uint16_t height;
+    uint16_t* current;
+    uint16_t* shadow;
+    uint8_t* payload;
+
+    std::atomic<uint32_t> requestedBudget{0};
+    uint32_t budget{0}; // bytes per second, 0 while off
+    int64_t credit{0};
+    int64_t lastUs{0};
+    bool dirty{false};
+    lv_area_t area{};
+
+    uint32_t frames{0};
+    uint64_t sentBytes{0};
+    uint64_t rawBytes{0};
+    int64_t encodeUs{0};
+    int64_t reportUs{0};
+
+    DisplayMirror(Telemetry& telemetry, uint16_t width, uint16_t height, Region region = Region::kPsramBulk);
+
+    DisplayMirror(const DisplayMirror&) = delete;
+
+    // Any task: 0 stops the stream, a budget given while stopped restarts it from a full frame and a new budget
+    // for a running stream only changes its rate
+    void SetBudget(const uint32_t bytesPerSecond) { requestedBudget = bytesPerSecond; }
+
+    void Capture(const lv_area_t& flushed, const lv_color_t* pixels);
+
+    void Pump();
+
+    // Delta-codes one row against the host's copy, returns 0 when it does not fit into `size`
+    static size_t EncodeRow(const uint16_t* row, const uint16_t* previous, size_t count, uint8_t* out, size_t size);
+};
+
+#endif //DISPLAY_MIRROR_HH
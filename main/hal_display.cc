@@ -11,8 +11,17 @@
 #include <driver/spi_common.h>
 #include <driver/spi_master.h>
 
+#include "boot_timeline.hh"
+#include "cores.hh"
+#include "deferred_log.hh"
 #include "hal_pin.hh"
 
+void hal::Display::StartLvgl() {
+  lvgl_port_cfg_t lvgl_cfg = ESP_LVGL_PORT_INIT_CONFIG();
+  lvgl_cfg.task_affinity = cores::Io;
+  ESP_ERROR_CHECK(lvgl_port_init(&lvgl_cfg));
+}
+
 hal::Display::Display() {
   spi_bus_config_t buscfg{};
   buscfg.sclk_io_num = 4;
@@ -23,6 +32,7 @@ hal::Display::Display() {
   buscfg.max_transfer_sz = 280 * 240;
   buscfg.flags = 0;
   ESP_ERROR_CHECK(spi_bus_initialize(SPI2_HOST, &buscfg, SPI_DMA_DISABLED)); // Enable the DMA feature
+  BootTimeline::Record("display spi");
 
   esp_lcd_panel_io_handle_t io_handle{};
   esp_lcd_panel_io_spi_config_t io_config{};
@@ -49,15 +59,14 @@ hal::Display::Display() {
   ESP_ERROR_CHECK(esp_lcd_panel_invert_color(panel_handle, true));
   ESP_ERROR_CHECK(esp_lcd_panel_disp_on_off(panel_handle, true));
   ESP_ERROR_CHECK(esp_lcd_panel_set_gap(panel_handle, 0, 20));
-  lvgl_port_cfg_t lvgl_cfg = ESP_LVGL_PORT_INIT_CONFIG();
-  lvgl_port_init(&lvgl_cfg);
+  BootTimeline::Record("display panel");
   lvgl_port_display_cfg_t disp_cfg{};
   disp_cfg.io_handle = io_handle,
   disp_cfg.panel_handle = panel_handle,
-  disp_cfg.buffer_size = 280 * 240,
+  disp_cfg.buffer_size = Width * Height,
   disp_cfg.double_buffer = true,
-  disp_cfg.hres = 240,
-  disp_cfg.vres = 280,
+  disp_cfg.hres = Width,
+  disp_cfg.vres = Height,
   disp_cfg.monochrome = false,
   disp_cfg.rotation = {
     .swap_xy = false,
@@ -66,10 +75,34 @@ hal::Display::Display() {
   };
   display = lvgl_port_add_disp(&disp_cfg);
   screen = lv_disp_get_scr_act(display);
+  BootTimeline::Record("display lvgl");
 }
 
 void hal::Display::Backlight(bool on) {
     blk.SetState(on);
-    printf("I hal:Display: Backlight set to %d\n", on);
+    DLOGI("hal:Display", "Backlight set to %d", on);
     backlight = on;
 }
+
+namespace {
+  // esp_lvgl_port owns the driver's flush callback, the hook runs in front of it
+  void (*portFlush)(lv_disp_drv_t*, const lv_area_t*, lv_color_t*){};
+  hal::Display::FlushHook flushHook{};
+  void* flushHookArg{};
+}
+
+void hal::Display::SetFlushHook(FlushHook hook, void* arg) {
+  lvgl_port_lock(0);
+  if (portFlush == nullptr) {
+    portFlush = display->driver->flush_cb;
+    display->driver->flush_cb = [](lv_disp_drv_t* driver, const lv_area_t* area, lv_color_t* pixels) {
+      if (flushHook != nullptr) {
+        flushHook(flushHookArg, area, pixels);
+      }
+      portFlush(driver, area, pixels);
+    };
+  }
+  flushHook = hook;
+  flushHookArg = arg;
+  lvgl_port_unlock();
+}
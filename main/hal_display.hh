@@ -8,6 +8,12 @@
 
 namespace hal {
   struct Display {
+    static constexpr lv_coord_t Width = 240;
+    static constexpr lv_coord_t Height = 280;
+
+    // Sees every area LVGL sends to the panel, called on the LVGL task before the transfer starts
+    using FlushHook = void (*)(void* arg, const lv_area_t* area, const lv_color_t* pixels);
+
     Pin blk{1, PinMode::kOutput};
     esp_lcd_panel_handle_t panel_handle{};
     lv_obj_t* screen{};
@@ -15,9 +21,14 @@ namespace hal {
 
     bool backlight{false};
 
+    // Starts the LVGL task and its lock, before the first Display is built under that lock
+    static void StartLvgl();
+
     Display();
 
     void Backlight(bool on);
+
+    void SetFlushHook(FlushHook hook, void* arg);
   };
 }
 
@@ -2,14 +2,14 @@
 
 /// I2C BUS
 
-hal::I2CBus::I2CBus(int sda, int scl) {
+hal::I2CBus::I2CBus(int port, int sda, int scl) {
     i2c_master_bus_config_t bus_config{};
     bus_config.clk_source = I2C_CLK_SRC_DEFAULT;
-    bus_config.i2c_port = I2C_NUM_1;
+    bus_config.i2c_port = static_cast<i2c_port_num_t>(port);
     bus_config.sda_io_num = static_cast<gpio_num_t>(sda);
     bus_config.scl_io_num = static_cast<gpio_num_t>(scl);
     ESP_ERROR_CHECK(i2c_new_master_bus(&bus_config, &bus));
-    ESP_LOGI("I2CBus", "Initialized I2C bus SDA:%d SCL:%d\n", sda, scl);
+    ESP_LOGI("I2CBus", "Initialized I2C bus %d SDA:%d SCL:%d\n", port, sda, scl);
 }
 
 hal::I2CBus::~I2CBus() {
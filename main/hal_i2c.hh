@@ -21,7 +21,7 @@ namespace hal {
     struct I2CBus {
         i2c_master_bus_handle_t bus{};
 
-        I2CBus(int sda, int scl);
+        I2CBus(int port, int sda, int scl);
 
         ~I2CBus();
 
@@ -27,30 +27,56 @@ float hal::Ina219::ReadShuntVoltage() const {
 }
 
 float hal::Ina219::ReadBusVoltage() const {
-    uint16_t value = ReadRegister(REG_BUS_VOLTS);
-    return static_cast<float>(static_cast<uint16_t>((value >> static_cast<uint16_t>(3)) * 4)) * 0.001f;
+    return BusVoltage({0, ReadRegister(REG_BUS_VOLTS)});
 }
 
 float hal::Ina219::ReadPower() const {
-    int16_t value = ReadRegister(REG_POWER);
-    return static_cast<float>(value) * (currentLsb * POWER_SCALE);
+    return Power(ReadRegister(REG_POWER));
 }
 
 float hal::Ina219::ReadCurrent() const {
-    int16_t value = ReadRegister(REG_CURRENT);
-    return static_cast<float>(value) * currentLsb;
+    return Current(static_cast<int16_t>(ReadRegister(REG_CURRENT)));
 }
 
-void hal::Ina219::Reset() const {
-    Configure(0x399F);
+hal::Ina219::Raw hal::Ina219::ReadRaw() const {
+    const auto shunt = static_cast<int16_t>(ReadRegister(REG_SHUNT_VOLTS));
+    return {shunt, ReadRegister(REG_BUS_VOLTS)};
 }
 
-void hal::Ina219::ShutDown() const {
-    Configure(0x399F & ~0x7); // 3 LSB bits are MODE, 000 for shutdown
+float hal::Ina219::BusVoltage(const Raw& raw) const {
+    return static_cast<float>(static_cast<uint16_t>((raw.bus >> static_cast<uint16_t>(3)) * 4)) * 0.001f;
 }
 
-void hal::Ina219::Configure(uint16_t config) const {
-    WriteRegister(REG_CONFIG, config);
+float hal::Ina219::Current(const int16_t current) const {
+    return static_cast<float>(current) * currentLsb;
+}
+
+float hal::Ina219::Power(const uint16_t power) const {
+    return static_cast<float>(power) * (currentLsb * POWER_SCALE);
+}
+
+// 32mV across the shunt with the calibration of a 100mOhm shunt and 5A range
+static_assert(hal::Ina219::DeriveCurrent(3200, 2684) == 2096);
+static_assert(hal::Ina219::DeriveCurrent(-3200, 2684) == -2096);
+static_assert(hal::Ina219::DeriveCurrent(3200, 2685) == 2096); // bit 0 is ignored
+// 2096 current LSB at 12V on the bus
+static_assert(hal::Ina219::DerivePower(2096, 3000 << 3 | 0x2) == 1257);
+static_assert(hal::Ina219::DerivePower(-2096, 3000 << 3 | 0x2) == 1257); // reverse current, same power
+// full scale current at 32V still fits the register
+static_assert(hal::Ina219::DerivePower(INT16_MIN, 0xFFFA) == 53680);
+static_assert(hal::Ina219::DeriveCurrent(32000, 0xFFFE) == INT16_MAX);
+
+void hal::Ina219::Reset() {
+    Configure(CONFIG_DEFAULT);
+}
+
+void hal::Ina219::ShutDown() {
+    Configure(CONFIG_DEFAULT & ~0x7); // 3 LSB bits are MODE, 000 for shutdown
+}
+
+void hal::Ina219::Configure(uint16_t value) {
+    config = value;
+    WriteRegister(REG_CONFIG, value);
 }
 
 void hal::Ina219::Calibrate() const {
@@ -1,6 +1,8 @@
 #ifndef HAL_INA_219_H
 #define HAL_INA_219_H
 
+#include <cstdint>
+
 #include "hal_i2c.hh"
 
 namespace hal {
@@ -9,6 +11,9 @@ namespace hal {
     static constexpr float POWER_SCALE = 20;
     static constexpr float MAX_CURRENT = 5.0; // Max current we're expecting on shunt
 
+    static constexpr uint16_t CONFIG_DEFAULT = 0x399F; // 32V, /8 gain, 12-bit bus and shunt, continuous
+    static constexpr uint16_t CONFIG_FAST_SHUNT = 0x3985; // 9-bit (84us) shunt only, continuous
+
     static constexpr uint8_t REG_CONFIG = 0x00;
     static constexpr uint8_t REG_SHUNT_VOLTS = 0x01;
     static constexpr uint8_t REG_BUS_VOLTS = 0x02;
@@ -16,9 +21,29 @@ namespace hal {
     static constexpr uint8_t REG_CURRENT = 0x04;
     static constexpr uint8_t REG_CALIBRATION = 0x05;
 
+    // Shunt and bus voltage registers as read, enough to derive current and power
+    struct Raw {
+        int16_t shunt; // 10uV LSB
+        uint16_t bus; // 4mV LSB in bits 15..3, CNVR and OVF flags in bits 1..0
+    };
+
+    // Current register as the chip computes it: shunt * calibration / 4096, bit 0 of the calibration unused.
+    // Calibrations too large for the shunt range saturate instead of wrapping around.
+    static constexpr int16_t DeriveCurrent(const int16_t shunt, const uint16_t calibration) {
+        const int32_t current = static_cast<int32_t>(shunt) * (calibration & 0xFFFE) / 4096;
+        return static_cast<int16_t>(current > INT16_MAX ? INT16_MAX : current < INT16_MIN ? INT16_MIN : current);
+    }
+
+    // Power register as the chip computes it: |current| * bus voltage / 5000, unsigned as power flows either way
+    static constexpr uint16_t DerivePower(const int16_t current, const uint16_t bus) {
+        const int32_t magnitude = current < 0 ? -static_cast<int32_t>(current) : current;
+        return static_cast<uint16_t>(magnitude * (bus >> 3) / 5000);
+    }
+
     I2CDevice device;
     float currentLsb{0};
     uint16_t calibration{0};
+    uint16_t config{CONFIG_DEFAULT};
 
     Ina219(const I2CBus& bus, float shunt, uint16_t address);
 
@@ -34,11 +59,20 @@ namespace hal {
 
     [[nodiscard]] float ReadCurrent() const;
 
-    void Reset() const;
+    // Two transactions instead of three, current and power are derived from these
+    [[nodiscard]] Raw ReadRaw() const;
+
+    [[nodiscard]] float BusVoltage(const Raw& raw) const;
+
+    [[nodiscard]] float Current(int16_t current) const;
+
+    [[nodiscard]] float Power(uint16_t power) const;
+
+    void Reset();
 
-    void ShutDown() const;
+    void ShutDown();
 
-    void Configure(uint16_t config) const;
+    void Configure(uint16_t value);
 
     void Calibrate() const;
   };
@@ -0,0 +1,26 @@
+#include "hal_serial.hh"
+
+#include <driver/usb_serial_jtag.h>
+#include <esp_log.h>
+
+hal::Serial::Serial(size_t txBufferSize, size_t rxBufferSize) {
+  usb_serial_jtag_driver_config_t config = USB_SERIAL_JTAG_DRIVER_CONFIG_DEFAULT();
+  config.tx_buffer_size = txBufferSize;
+  config.rx_buffer_size = rxBufferSize;
+  ESP_ERROR_CHECK(usb_serial_jtag_driver_install(&config));
+  ESP_LOGI("Serial", "Initialized USB serial tx:%u rx:%u", txBufferSize, rxBufferSize);
+}
+
+hal::Serial::~Serial() {
+  usb_serial_jtag_driver_uninstall();
+}
+
+size_t hal::Serial::Write(const uint8_t *data, size_t size, TickType_t timeout) const {
+  const int written = usb_serial_jtag_write_bytes(data, size, timeout);
+  return written < 0 ? 0 : static_cast<size_t>(written);
+}
+
+size_t hal::Serial::Read(uint8_t *data, size_t size, TickType_t timeout) const {
+  const int read = usb_serial_jtag_read_bytes(data, size, timeout);
+  return read < 0 ? 0 : static_cast<size_t>(read);
+}
@@ -0,0 +1,22 @@
+#ifndef HAL_SERIAL_HH
+#define HAL_SERIAL_HH
+
+#include <cstddef>
+#include <cstdint>
+#include <freertos/FreeRTOS.h>
+
+namespace hal {
+  // USB Serial/JTAG link used for binary telemetry. Console logs share the same port as a secondary
+  // console, so the host sees frames interleaved with text lines.
+  struct Serial {
+    Serial(size_t txBufferSize, size_t rxBufferSize);
+
+    ~Serial();
+
+    [[nodiscard]] size_t Write(const uint8_t* data, size_t size, TickType_t timeout) const;
+
+    [[nodiscard]] size_t Read(uint8_t* data, size_t size, TickType_t timeout) const;
+  };
+}
+
+#endif // HAL_SERIAL_HH
@@ -0,0 +1,61 @@
+#include "init_graph.hh"
+
+#include <esp_log.h>
+#include <freertos/task.h>
+
+#include "boot_timeline.hh"
+
+InitGraph::InitGraph(): events{xEventGroupCreate()} {
+}
+
+uint32_t InitGraph::Add(const char *name, StageFn fn, void *arg, uint32_t deps, int core, uint32_t stack) {
+    if (count >= MaxStages) {
+        ESP_LOGE("InitGraph", "Too many stages, dropping %s", name);
+        return 0;
+    }
+    stages[count] = {name, fn, arg, deps, core, stack, this, 0, 0};
+    return 1u << count++;
+}
+
+void InitGraph::Run() {
+    for (size_t i = 0; i < count; i++) {
+        xTaskCreatePinnedToCore([](void* arg) {
+            auto& stage = *static_cast<Stage*>(arg);
+            if (stage.deps != 0) {
+                xEventGroupWaitBits(stage.graph->events, stage.deps, pdFALSE, pdTRUE, portMAX_DELAY);
+            }
+            stage.start = BootTimeline::Record(stage.name);
+            stage.fn(stage.arg);
+            stage.end = BootTimeline::Record(stage.name);
+            xEventGroupSetBits(stage.graph->events, 1u << (&stage - stage.graph->stages));
+            vTaskDelete(nullptr);
+        }, stages[i].name, stages[i].stack, &stages[i], 5, nullptr, stages[i].core);
+    }
+}
+
+void InitGraph::Wait(const uint32_t bits) const {
+    xEventGroupWaitBits(events, bits, pdFALSE, pdTRUE, portMAX_DELAY);
+}
+
+void InitGraph::MarkFirstFrame() const {
+    if ((xEventGroupGetBits(events) & FirstFrame) == 0) {
+        BootTimeline::Record("first frame");
+        xEventGroupSetBits(events, FirstFrame);
+    }
+}
+
+void InitGraph::Report() const {
+    for (size_t i = 0; i < count; i++) {
+        const Stage& stage = stages[i];
+        // scheduling delay between the last dependency finishing and the stage starting
+        int64_t ready = 0;
+        for (size_t dep = 0; dep < count; dep++) {
+            if (stage.deps & (1u << dep) && stages[dep].end > ready) { ready = stages[dep].end; }
+        }
+        ESP_LOGI("InitGraph", "%-10s %8.2fms..%8.2fms took %7.2fms waited %6.2fms", stage.name,
+            static_cast<double>(stage.start) / 1000., static_cast<double>(stage.end) / 1000.,
+            static_cast<double>(stage.end - stage.start) / 1000.,
+            ready > 0 ? static_cast<double>(stage.start - ready) / 1000. : 0.);
+    }
+    BootTimeline::Report();
+}
@@ -0,0 +1,49 @@
+#ifndef INIT_GRAPH_HH
+#define INIT_GRAPH_HH
+
+#include <cstddef>
+#include <cstdint>
+#include <freertos/FreeRTOS.h>
+#include <freertos/event_groups.h>
+
+// Startup stages with dependencies. Every stage runs in its own short-lived task, pinned to a core if
+// requested, as soon as all stages it depends on have finished, so independent stages overlap.
+struct InitGraph {
+    using StageFn = void (*)(void* arg);
+
+    static constexpr size_t MaxStages = 16;
+    // Not a stage: set by the UI once the first frame is on screen, stages depending on it are deferred
+    static constexpr uint32_t FirstFrame = 1u << MaxStages;
+
+    struct Stage {
+        const char* name;
+        StageFn fn;
+        void* arg;
+        uint32_t deps;
+        int core;
+        uint32_t stack;
+        InitGraph* graph;
+        int64_t start;
+        int64_t end;
+    };
+
+    Stage stages[MaxStages]{};
+    size_t count{0};
+    EventGroupHandle_t events;
+
+    InitGraph();
+
+    // Returns the bit of the new stage, to be used in `deps` of later stages and in Wait()
+    uint32_t Add(const char* name, StageFn fn, void* arg, uint32_t deps = 0, int core = tskNO_AFFINITY,
+                 uint32_t stack = 4096);
+
+    void Run();
+
+    void Wait(uint32_t bits) const;
+
+    void MarkFirstFrame() const;
+
+    void Report() const;
+};
+
+#endif //INIT_GRAPH_HH
@@ -0,0 +1,22 @@
+#include "jitter.hh"
+
+#include <cmath>
+
+void JitterStats::Add(const int32_t latenessUs) {
+    count++;
+    total += latenessUs;
+    totalSquares += static_cast<uint64_t>(static_cast<int64_t>(latenessUs) * latenessUs);
+    if (latenessUs < min) { min = latenessUs; }
+    if (latenessUs > max) { max = latenessUs; }
+}
+
+float JitterStats::Mean() const {
+    return count > 0 ? static_cast<float>(total) / static_cast<float>(count) : 0.0f;
+}
+
+float JitterStats::StdDev() const {
+    if (count < 2) { return 0.0f; }
+    const float mean = Mean();
+    const float variance = static_cast<float>(totalSquares) / static_cast<float>(count) - mean * mean;
+    return variance > 0.0f ? std::sqrt(variance) : 0.0f;
+}
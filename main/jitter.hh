@@ -0,0 +1,23 @@
+#ifndef JITTER_HH
+#define JITTER_HH
+
+#include <cstdint>
+
+// Lateness of periodic wake-ups against their deadline, in microseconds
+struct JitterStats {
+    uint32_t count{0};
+    int32_t min{INT32_MAX};
+    int32_t max{INT32_MIN};
+    int64_t total{0};
+    uint64_t totalSquares{0};
+
+    void Add(int32_t latenessUs);
+
+    void Reset() { *this = JitterStats{}; }
+
+    [[nodiscard]] float Mean() const;
+
+    [[nodiscard]] float StdDev() const;
+};
+
+#endif //JITTER_HH
@@ -0,0 +1,94 @@
+#include "kernels.hh"
+
+#if __has_include(<dsps_mulc.h>) && __has_include(<dsps_addc.h>)
+#include <dsps_addc.h>
+#include <dsps_mulc.h>
+#define KERNELS_USE_DSP 1
+#endif
+
+// Built with -ffp-contract=off (see CMakeLists.txt): a fused multiply-add would round once and no longer
+// match the reference. ESP-DSP multiplies and adds in separate passes, each rounded, as the reference does;
+// the host tests run this path against the library's portable versions (test/host/stubs/esp-dsp).
+
+void kernels::Scale(const int16_t* in, float* out, const size_t count, const float scale, const float offset) {
+#if KERNELS_USE_DSP
+    for (size_t i = 0; i < count; i++) {
+        out[i] = static_cast<float>(in[i]);
+    }
+    dsps_mulc_f32(out, out, static_cast<int>(count), scale, 1, 1);
+    dsps_addc_f32(out, out, static_cast<int>(count), offset, 1, 1);
+#else
+    size_t i = 0;
+    for (; i + Lanes <= count; i += Lanes) {
+        for (size_t j = 0; j < Lanes; j++) {
+            out[i + j] = static_cast<float>(in[i + j]) * scale + offset;
+        }
+    }
+    for (; i < count; i++) {
+        out[i] = static_cast<float>(in[i]) * scale + offset;
+    }
+#endif
+}
+
+kernels::Summary kernels::MinMaxSum(const float* in, const size_t count) {
+    if (count == 0) {
+        return {0.0f, 0.0f, 0.0f};
+    }
+    float lo[Lanes];
+    float hi[Lanes];
+    float sum[Lanes]{};
+    for (size_t j = 0; j < Lanes; j++) {
+        lo[j] = hi[j] = in[0];
+    }
+    size_t i = 0;
+    for (; i + Lanes <= count; i += Lanes) {
+        for (size_t j = 0; j < Lanes; j++) {
+            const float value = in[i + j];
+            lo[j] = value < lo[j] ? value : lo[j];
+            hi[j] = value > hi[j] ? value : hi[j];
+            sum[j] += value;
+        }
+    }
+    for (size_t j = 0; i + j < count; j++) {
+        const float value = in[i + j];
+        lo[j] = value < lo[j] ? value : lo[j];
+        hi[j] = value > hi[j] ? value : hi[j];
+        sum[j] += value;
+    }
+    for (size_t width = Lanes / 2; width > 0; width /= 2) {
+        for (size_t j = 0; j < width; j++) {
+            lo[j] = lo[j + width] < lo[j] ? lo[j + width] : lo[j];
+            hi[j] = hi[j + width] > hi[j] ? hi[j + width] : hi[j];
+            sum[j] += sum[j + width];
+        }
+    }
+    return {lo[0], hi[0], sum[0]};
+}
+
+void kernels::reference::Scale(const int16_t* in, float* out, const size_t count, const float scale,
+                               const float offset) {
+    for (size_t i = 0; i < count; i++) {
+        out[i] = static_cast<float>(in[i]) * scale + offset;
+    }
+}
+
+kernels::Summary kernels::reference::MinMaxSum(const float* in, const size_t count) {
+    if (count == 0) {
+        return {0.0f, 0.0f, 0.0f};
+    }
+    Summary summary{in[0], in[0], 0.0f};
+    float partial[Lanes]{};
+    for (size_t i = 0; i < count; i++) {
+        summary.min = in[i] < summary.min ? in[i] : summary.min;
+        summary.max = in[i] > summary.max ? in[i] : summary.max;
+        partial[i % Lanes] += in[i];
+    }
+    // (((p0 + p4) + (p2 + p6)) + ((p1 + p5) + (p3 + p7)))
+    for (size_t width = Lanes / 2; width > 0; width /= 2) {
+        for (size_t j = 0; j < width; j++) {
+            partial[j] += partial[j + width];
+        }
+    }
+    summary.sum = partial[0];
+    return summary;
+}
@@ -0,0 +1,91 @@
+#ifndef KERNELS_HH
+#define KERNELS_HH
+
+#include <cstddef>
+#include <cstdint>
+
+// Block kernels for sample arrays. The main versions work on `Lanes` elements side by side so that the compiler
+// can vectorize them; where ESP-DSP is available Scale goes through its float routines instead. `reference`
+// holds the loops that define the results: every kernel matches its reference bit for bit.
+namespace kernels {
+    constexpr size_t Lanes = 8;
+
+    template<typename T>
+    struct Range {
+        T min;
+        T max;
+    };
+
+    struct Summary {
+        float min;
+        float max;
+        float sum;
+    };
+
+    // out[i] = in[i] * scale + offset, rounded after the multiplication and again after the addition
+    void Scale(const int16_t* in, float* out, size_t count, float scale, float offset = 0.0f);
+
+    // The sum is accumulated into `Lanes` interleaved partial sums which are then added pairwise
+    [[nodiscard]] Summary MinMaxSum(const float* in, size_t count);
+
+    // Range of every `factor` consecutive elements `stride` apart, the last block may be shorter.
+    // Writes (count + factor - 1) / factor ranges.
+    template<typename T>
+    void DecimateMinMax(const T* in, const size_t stride, const size_t count, const size_t factor, Range<T>* out) {
+        const size_t blocks = count / factor;
+        size_t block = 0;
+        // `Lanes` output blocks at a time, lane j reduces block + j
+        for (; block + Lanes <= blocks; block += Lanes) {
+            T lo[Lanes];
+            T hi[Lanes];
+            for (size_t j = 0; j < Lanes; j++) {
+                lo[j] = hi[j] = in[(block + j) * factor * stride];
+            }
+            for (size_t k = 1; k < factor; k++) {
+                for (size_t j = 0; j < Lanes; j++) {
+                    const T value = in[((block + j) * factor + k) * stride];
+                    lo[j] = value < lo[j] ? value : lo[j];
+                    hi[j] = value > hi[j] ? value : hi[j];
+                }
+            }
+            for (size_t j = 0; j < Lanes; j++) {
+                out[block + j] = {lo[j], hi[j]};
+            }
+        }
+        for (; block * factor < count; block++) {
+            const size_t end = (block + 1) * factor < count ? (block + 1) * factor : count;
+            Range<T> range{in[block * factor * stride], in[block * factor * stride]};
+            for (size_t i = block * factor + 1; i < end; i++) {
+                const T value = in[i * stride];
+                range.min = value < range.min ? value : range.min;
+                range.max = value > range.max ? value : range.max;
+            }
+            out[block] = range;
+        }
+    }
+
+    namespace reference {
+        void Scale(const int16_t* in, float* out, size_t count, float scale, float offset = 0.0f);
+
+        // Not one running sum: a float sum depends on the order of its additions, and this one adds in the order
+        // of the `Lanes` interleaved partial sums, so that it defines the result of the lane-wise kernel
+        [[nodiscard]] Summary MinMaxSum(const float* in, size_t count);
+
+        template<typename T>
+        void DecimateMinMax(const T* in, const size_t stride, const size_t count, const size_t factor,
+                            Range<T>* out) {
+            for (size_t i = 0; i < count; i++) {
+                const T value = in[i * stride];
+                Range<T>& range = out[i / factor];
+                if (i % factor == 0) {
+                    range = {value, value};
+                } else {
+                    range.min = value < range.min ? value : range.min;
+                    range.max = value > range.max ? value : range.max;
+                }
+            }
+        }
+    }
+}
+
+#endif //KERNELS_HH
@@ -0,0 +1,84 @@
+#include "load_events.hh"
+
+void LoadEventDetector::Accumulate(Side& side, const float deviation, const int64_t timeUs, const float current,
+                                   const double energy) {
+    const float sum = side.sum + deviation;
+    if (sum <= 0) {
+        side.Reset();
+        return;
+    }
+    if (side.count == 0) {
+        side.startUs = timeUs;
+    }
+    side.sum = sum;
+    side.count++;
+    side.total += current;
+    side.energy += energy;
+}
+
+bool LoadEventDetector::Push(const int64_t timeUs, const float current, const float power, LoadEvent& event) {
+    if (!primed) {
+        primed = true;
+        reference = current;
+        segmentStartUs = timeUs;
+        segmentCount = 1;
+        segmentTotal = current;
+        lastUs = timeUs;
+        return false;
+    }
+    const int64_t gapUs = timeUs - lastUs;
+    const double energy = gapUs > 0 && gapUs <= MaxGapUs ? power * static_cast<double>(gapUs) * 1e-6 : 0.0;
+    lastUs = timeUs;
+    segmentCount++;
+    segmentTotal += current;
+    segmentEnergy += energy;
+    Accumulate(up, current - reference - Drift, timeUs, current, energy);
+    Accumulate(down, reference - current - Drift, timeUs, current, energy);
+    reference += TrackAlpha * (current - reference);
+
+    const Side* side = up.sum > Threshold ? &up : down.sum > Threshold ? &down : nullptr;
+    if (side == nullptr) {
+        return false;
+    }
+    const uint32_t endedCount = segmentCount - side->count;
+    event.timeUs = side->startUs;
+    event.detectedUs = timeUs;
+    event.before = endedCount > 0 ? static_cast<float>((segmentTotal - side->total) / endedCount) : reference;
+    event.after = static_cast<float>(side->total / side->count);
+    event.energy = static_cast<float>(segmentEnergy - side->energy);
+    event.durationUs = side->startUs - segmentStartUs;
+    if (event.before < Idle && event.after >= Idle) {
+        event.kind = LoadEvent::Kind::kPlugIn;
+    } else if (event.before >= Idle && event.after < Idle) {
+        event.kind = LoadEvent::Kind::kIdle;
+    } else if (event.after > event.before) {
+        event.kind = LoadEvent::Kind::kRise;
+    } else if (event.durationUs < InrushUs &&
+               (lastKind == LoadEvent::Kind::kRise || lastKind == LoadEvent::Kind::kPlugIn)) {
+        event.kind = LoadEvent::Kind::kInrush;
+    } else {
+        event.kind = LoadEvent::Kind::kFall;
+    }
+    lastKind = event.kind;
+
+    // the readings since the change point start the new segment
+    reference = event.after;
+    segmentStartUs = side->startUs;
+    segmentCount = side->count;
+    segmentTotal = side->total;
+    segmentEnergy = side->energy;
+    up.Reset();
+    down.Reset();
+    return true;
+}
+
+const char* LoadEventDetector::Name(const LoadEvent::Kind kind) {
+    switch (kind) {
+        case LoadEvent::Kind::kPlugIn: return "plug";
+        case LoadEvent::Kind::kIdle: return "idle";
+        case LoadEvent::Kind::kRise: return "rise";
+        case LoadEvent::Kind::kFall: return "fall";
+        case LoadEvent::Kind::kInrush: return "inrush";
+        default: return "none";
+    }
+}
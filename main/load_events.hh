@@ -0,0 +1,71 @@
+#ifndef LOAD_EVENTS_HH
+#define LOAD_EVENTS_HH
+
+#include <cstdint>
+
+// A change of a channel's current level, together with the segment of steady load it ended
+struct LoadEvent {
+    enum class Kind : uint8_t {
+        kNone = 0,
+        kPlugIn = 1, // from idle to drawing current
+        kIdle = 2, // from drawing current to idle
+        kRise = 3,
+        kFall = 4,
+        kInrush = 5, // fall right after a rise, the ended segment was the inrush peak
+    };
+
+    Kind kind{Kind::kNone};
+    int64_t timeUs{0}; // estimated change point
+    int64_t detectedUs{0}; // reading that confirmed it
+    float before{0}; // A, mean of the ended segment
+    float after{0}; // A, mean of the new segment up to detection
+    float energy{0}; // J drawn during the ended segment
+    int64_t durationUs{0}; // of the ended segment
+};
+
+// Two-sided CUSUM on a channel's current, O(1) per reading and a fixed few dozen bytes per channel. The
+// reference follows slow drift (a charge taper) so only changes faster than that accumulate; once the sum in
+// either direction passes `Threshold` the change point is put where that sum last left zero, and the readings
+// since then form the start of the next segment.
+struct LoadEventDetector {
+    static constexpr float MinShift = 0.02f; // A, smallest step that is reliably detected
+    static constexpr float Drift = MinShift / 2; // A, allowance per reading before deviations accumulate
+    static constexpr float Threshold = 4 * MinShift; // A, accumulated deviation that confirms a change
+    static constexpr float Idle = 0.005f; // A, below this the port counts as idle
+    static constexpr float TrackAlpha = 1.0f / 32; // reference tracking, per reading
+    static constexpr int64_t InrushUs = 100000;
+    static constexpr int64_t MaxGapUs = 10000000; // longest sampling period, longer gaps are not integrated
+
+    // Deviations in one direction since the CUSUM last left zero
+    struct Side {
+        float sum{0}; // CUSUM statistic
+        int64_t startUs{0};
+        uint32_t count{0};
+        double total{0}; // of the readings, for the new level
+        double energy{0};
+
+        void Reset() { *this = Side{}; }
+    };
+
+    float reference{0};
+    Side up{};
+    Side down{};
+    int64_t segmentStartUs{0};
+    uint32_t segmentCount{0};
+    // double: a segment may last hours at kHz rates, float sums would lose the per-reading increments
+    double segmentTotal{0};
+    double segmentEnergy{0};
+    int64_t lastUs{0};
+    LoadEvent::Kind lastKind{LoadEvent::Kind::kNone};
+    bool primed{false};
+
+    // Feeds one reading, returns true and fills `event` when it confirms a change
+    bool Push(int64_t timeUs, float current, float power, LoadEvent& event);
+
+    [[nodiscard]] static const char* Name(LoadEvent::Kind kind);
+
+private:
+    static void Accumulate(Side& side, float deviation, int64_t timeUs, float current, double energy);
+};
+
+#endif //LOAD_EVENTS_HH
@@ -1,17 +1,53 @@
+#include <algorithm>
 #include <array>
+#include <atomic>
 #include <cstdio>
 #include <cmath>
+#include <optional>
 #include <utility>
 #include <sys/unistd.h>
 
+#include <esp_lvgl_port.h>
+#include <esp_timer.h>
+
+#include "adaptive_rate.hh"
+#include "arena.hh"
+#include "boot_timeline.hh"
+#include "channel.hh"
+#include "command.hh"
+#include "cores.hh"
+#include "deferred_log.hh"
+#include "display_mirror.hh"
 #include "hal_display.hh"
 #include "hal_ina_219.hh"
 #include "hal_pin.hh"
-#include "sliding_buffer.hh"
+#include "plot.hh"
+#include "resampler.hh"
 #include "point.hh"
 #include "meter_bus.hh"
 #include "worker_task.hh"
 #include "hal_button.hh"
+#include "init_graph.hh"
+#include "jitter.hh"
+#include "load_events.hh"
+#include "number_format.hh"
+#include "sample_fanout.hh"
+#include "seqlock.hh"
+#include "spectrum.hh"
+#include "spsc_ring.hh"
+#include "telemetry.hh"
+
+// One kSamples frame from a sampling task to its consumers, `count` packets follow the header
+struct SampleFrame {
+    SamplesHeader header;
+    Packet packets[ChannelRegistry::MaxChannels];
+    uint8_t count;
+    uint8_t rateCount;
+    ReadTimes times[ChannelRegistry::MaxChannels]; // not sent, feeds the resampler
+    RatePacket rates[ChannelRegistry::MaxChannels]; // sent ahead of the samples as kRate frames
+
+    [[nodiscard]] size_t Size() const { return sizeof(header) + count * sizeof(Packet); }
+};
 
 struct DisplayUi {
     struct Theme {
@@ -24,6 +60,8 @@ struct DisplayUi {
         lv_style_t voltageStyle{};
         lv_style_t currentStyle{};
         lv_style_t powerStyle{};
+        lv_style_t rippleStyle{};
+        lv_style_t eventStyle{};
 
         Theme() {
             lv_style_init(&displayStyle);
@@ -52,18 +90,27 @@ struct DisplayUi {
             lv_style_init(&powerStyle);
             lv_style_set_text_font(&powerStyle, FontSmall);
             lv_style_set_text_align(&powerStyle, LV_TEXT_ALIGN_RIGHT);
+
+            lv_style_init(&rippleStyle);
+            lv_style_set_text_font(&rippleStyle, FontSmall);
+            lv_style_set_text_color(&rippleStyle, lv_color_make(255, 128, 0));
+
+            lv_style_init(&eventStyle);
+            lv_style_set_text_font(&eventStyle, FontSmall);
+            lv_style_set_text_color(&eventStyle, lv_color_make(0, 200, 80));
         }
     };
 
+    // Widgets of one of the on-screen slots, the channel shown in it changes with the page
     struct MeterUi {
         constexpr static lv_coord_t CanvasWidth = 225;
         constexpr static lv_coord_t CanvasHeight = 50;
         static constexpr lv_coord_t MeterHeight = 80;
+        static constexpr size_t SamplesPerColumn = 4;
 
         lv_obj_t *parent;
         Theme& theme;
         int index;
-        SlidingBuffer buffer{CanvasWidth};
 
         lv_obj_t *layout{};
         lv_obj_t *voltage_label{};
@@ -71,7 +118,9 @@ struct DisplayUi {
         lv_obj_t *power_label{};
         lv_obj_t* canvas{};
         lv_obj_t* on_led{};
-
+        lv_obj_t* ripple_label{};
+        lv_obj_t* name_label{};
+        lv_obj_t* event_label{};
 
         MeterUi(lv_obj_t* parent, Theme& theme, const int index) : parent{parent}, theme{theme}, index{index}{
             layout = CreateLayout();
@@ -80,6 +129,9 @@ struct DisplayUi {
             power_label = CreatePowerLabel();
             canvas = CreateCanvas();
             on_led = CreateLed();
+            ripple_label = CreateRippleLabel();
+            name_label = CreateNameLabel();
+            event_label = CreateEventLabel();
         }
 
         [[nodiscard]] lv_obj_t *CreateLayout() const {
@@ -103,7 +155,7 @@ struct DisplayUi {
         }
 
         [[nodiscard]] lv_obj_t *CreateCanvas() const {
-            auto *buf = lv_mem_alloc(2 * CanvasWidth * CanvasHeight);
+            auto *buf = Arenas::Get(Region::kInternalFast).Allocate(sizeof(lv_color_t) * CanvasWidth * CanvasHeight);
             lv_obj_t *canvas = lv_canvas_create(layout);
             lv_canvas_set_buffer(canvas, buf, CanvasWidth, CanvasHeight, LV_IMG_CF_TRUE_COLOR);
             lv_canvas_fill_bg(canvas, lv_color_hex3(0x3a3a3a), LV_OPA_COVER);
@@ -111,6 +163,30 @@ struct DisplayUi {
             return canvas;
         }
 
+        [[nodiscard]] lv_obj_t *CreateRippleLabel() const {
+            lv_obj_t *label = lv_label_create(layout);
+            lv_obj_align(label, LV_ALIGN_BOTTOM_RIGHT, -8, -6);
+            lv_obj_add_style(label, &theme.rippleStyle, 0);
+            lv_obj_add_flag(label, LV_OBJ_FLAG_HIDDEN);
+            return label;
+        }
+
+        [[nodiscard]] lv_obj_t *CreateNameLabel() const {
+            lv_obj_t *label = lv_label_create(layout);
+            lv_obj_align(label, LV_ALIGN_BOTTOM_LEFT, 8, -6);
+            lv_obj_add_style(label, &theme.rippleStyle, 0);
+            lv_obj_add_flag(label, LV_OBJ_FLAG_HIDDEN);
+            return label;
+        }
+
+        [[nodiscard]] lv_obj_t *CreateEventLabel() const {
+            lv_obj_t *label = lv_label_create(layout);
+            lv_obj_align(label, LV_ALIGN_BOTTOM_MID, 0, -6);
+            lv_obj_add_style(label, &theme.eventStyle, 0);
+            lv_obj_add_flag(label, LV_OBJ_FLAG_HIDDEN);
+            return label;
+        }
+
         [[nodiscard]] lv_obj_t *CreateVoltageLabel() const {
             lv_obj_t *label = lv_label_create(layout);
             lv_obj_set_width(label, 100);
@@ -139,92 +215,225 @@ struct DisplayUi {
         }
     };
 
+    // Per channel state, kept for every channel so plots continue while they are on another page
+    struct ChannelView {
+        Plot plot{MeterUi::CanvasWidth, MeterUi::SamplesPerColumn};
+        Packet packet{}; // last reading received
+        number_format::UnitFormatter voltage_format{"V", 4, 6, number_format::Prefix::kUnit};
+        number_format::UnitFormatter current_format{"A", 4, 7};
+        number_format::UnitFormatter power_format{"W", 4, 7};
+    };
+
+    static constexpr int Slots = 3;
+
     hal::Display display{};
     Theme theme{};
-    MeterUi dc_ui{display.screen, theme, 0};
-    MeterUi usb2_ui{display.screen, theme, 1};
-    MeterUi usb1_ui{display.screen, theme, 2};
+    MeterUi slots[Slots]{
+        {display.screen, theme, 0},
+        {display.screen, theme, 1},
+        {display.screen, theme, 2},
+    };
+    int channels;
+    std::optional<ChannelView> views[ChannelRegistry::MaxChannels]{};
 
     int selected{0};
 
-    DisplayUi() {
+    explicit DisplayUi(const int channels) : channels{channels} {
+        for (int i = 0; i < channels; i++) {
+            views[i].emplace();
+        }
         lv_obj_add_style(display.screen, &theme.displayStyle, LV_PART_MAIN);
         display.Backlight(true);
     }
 
-    MeterUi* GetUi(const int index) {
-        switch (index) {
-            case 0: return &dc_ui;
-            case 1: return &usb2_ui;
-            case 2: return &usb1_ui;
-            default: return nullptr;
+    [[nodiscard]] int Page() const { return selected / Slots; }
+
+    // Slot showing `channel`, nullptr while the channel is on another page
+    MeterUi* GetUi(const int channel) {
+        if (channel < 0 || channel >= channels || channel / Slots != Page()) {
+            return nullptr;
+        }
+        return &slots[channel % Slots];
+    }
+
+    // Hides the slots past the last channel on the last page
+    void BeginFrame() {
+        for (int slot = 0; slot < Slots; slot++) {
+            lv_obj_t* layout = slots[slot].layout;
+            const bool used = Page() * Slots + slot < channels;
+            if (used && lv_obj_has_flag(layout, LV_OBJ_FLAG_HIDDEN)) {
+                lv_obj_clear_flag(layout, LV_OBJ_FLAG_HIDDEN);
+            } else if (!used && !lv_obj_has_flag(layout, LV_OBJ_FLAG_HIDDEN)) {
+                lv_obj_add_flag(layout, LV_OBJ_FLAG_HIDDEN);
+            }
         }
     }
 
-    void UpdateMeter(int index, const MeterBus& meter) {
+    // Takes the readings of a frame from the display's subscription
+    void Receive(const SampleFrame& frame) {
+        for (int channel = 0, packet = 0; channel < channels; channel++) {
+            if (frame.header.channels & 1 << channel) {
+                views[channel]->packet = frame.packets[packet++];
+            }
+        }
+    }
+
+    // How long the last load event of a channel stays on screen
+    static constexpr int64_t EventShownUs = 10000000;
+
+    void UpdateMeter(int channel, const MeterBus& meter, const RippleReport& ripple, const LoadEvent& event) {
+        ChannelView& view = *views[channel];
+        const Packet& packet = view.packet;
+        if (meter.enabled) {
+            view.plot.Push({static_cast<float>(packet.voltage) / 1e6f, static_cast<float>(packet.current) / 1e6f,
+                static_cast<float>(packet.power) / 1e6f});
+        }
+
         char buffer[48]{};
-        if (MeterUi* ui_ptr = GetUi(index); ui_ptr != nullptr) {
+        if (MeterUi* ui_ptr = GetUi(channel); ui_ptr != nullptr) {
             MeterUi& ui = *ui_ptr;
 
-            snprintf(buffer, sizeof(buffer), "%.2fV", meter.voltage);
+            view.voltage_format.Format(buffer, sizeof(buffer), packet.voltage);
             lv_label_set_text(ui.voltage_label, buffer);
-            if (meter.current > 1.5) {
-                snprintf(buffer, sizeof(buffer), "%.3fA", meter.current);
+            view.current_format.Format(buffer, sizeof(buffer), packet.current);
+            lv_label_set_text(ui.current_label, buffer);
+            view.power_format.Format(buffer, sizeof(buffer), packet.power);
+            lv_label_set_text(ui.power_label, buffer);
+            if (ripple.sampleRate > 0) {
+                size_t len = number_format::FormatSignificant(buffer, sizeof(buffer),
+                    static_cast<int64_t>(ripple.peakToPeak * 1e6f), number_format::Prefix::kMilli, 3, "App");
+                if (ripple.peakCount > 0) {
+                    buffer[len++] = ' ';
+                    number_format::FormatFixed(buffer + len, sizeof(buffer) - len,
+                        static_cast<int64_t>(ripple.peaks[0].frequency * 1e6f), number_format::Prefix::kUnit, 0, "Hz");
+                }
+                lv_label_set_text(ui.ripple_label, buffer);
+                lv_obj_clear_flag(ui.ripple_label, LV_OBJ_FLAG_HIDDEN);
             } else {
-                snprintf(buffer, sizeof(buffer), "%dmA", static_cast<int>(meter.current * 1000));
+                lv_obj_add_flag(ui.ripple_label, LV_OBJ_FLAG_HIDDEN);
             }
-            lv_label_set_text(ui.current_label, buffer);
-            if (meter.power > 1) {
-                snprintf(buffer, sizeof(buffer), "%.2fW", meter.power);
+            if (event.kind != LoadEvent::Kind::kNone && esp_timer_get_time() - event.detectedUs < EventShownUs) {
+                const int len = snprintf(buffer, sizeof(buffer), "%s ", LoadEventDetector::Name(event.kind));
+                const auto prefix = event.after >= 1.0f ? number_format::Prefix::kUnit : number_format::Prefix::kMilli;
+                number_format::FormatSignificant(buffer + len, sizeof(buffer) - len,
+                    static_cast<int64_t>(event.after * 1e6f), prefix, 3, "A");
+                lv_label_set_text(ui.event_label, buffer);
+                lv_obj_clear_flag(ui.event_label, LV_OBJ_FLAG_HIDDEN);
             } else {
-                snprintf(buffer, sizeof(buffer), "%dmW", static_cast<int>(meter.power * 1000));
+                lv_obj_add_flag(ui.event_label, LV_OBJ_FLAG_HIDDEN);
+            }
+            if (channels > Slots) {
+                snprintf(buffer, sizeof(buffer), "%d:%s", channel + 1, meter.name);
+                lv_label_set_text(ui.name_label, buffer);
+                lv_obj_clear_flag(ui.name_label, LV_OBJ_FLAG_HIDDEN);
             }
-            lv_label_set_text(ui.power_label, buffer);
             if (meter.enabled) {
                 lv_led_on(ui.on_led);
             } else {
                 lv_led_off(ui.on_led);
             }
 
-            if (selected == index && !lv_obj_has_state(ui.layout, LV_STATE_USER_1)) {
+            if (selected == channel && !lv_obj_has_state(ui.layout, LV_STATE_USER_1)) {
                 lv_obj_add_state(ui.layout, LV_STATE_USER_1);
-            } else if (selected != index && lv_obj_has_state(ui.layout, LV_STATE_USER_1)) {
+            } else if (selected != channel && lv_obj_has_state(ui.layout, LV_STATE_USER_1)) {
                 lv_obj_clear_state(ui.layout, LV_STATE_USER_1);
             }
 
-            if (meter.enabled) {
-                ui.buffer.Push(meter.GetPoint());
+            lv_canvas_fill_bg(ui.canvas, lv_color_hex3(0x000000), LV_OPA_COVER);
+            if (view.plot.traces & Plot::kVoltage) {
+                DrawTrace(ui, view.plot, Plot::kVoltage, lv_color_make(255, 255, 0));
+            }
+            if (view.plot.traces & Plot::kCurrent) {
+                DrawTrace(ui, view.plot, Plot::kCurrent, lv_color_make(0, 255, 255));
             }
+            if (view.plot.traces & Plot::kPower) {
+                DrawTrace(ui, view.plot, Plot::kPower, lv_color_make(255, 0, 255));
+            }
+        }
+    }
 
-            lv_canvas_fill_bg(ui.canvas, lv_color_hex3(0x000000), LV_OPA_COVER);
-            for (auto i = ui.buffer.start; i < ui.buffer.start + ui.buffer.window; i++) {
-                const auto& point = ui.buffer.values[i];
-                auto y = MeterUi::CanvasHeight - 1 - point.VoltageY(MeterUi::CanvasHeight);
-                if (y <= 0 || y >= MeterUi::CanvasHeight) {
-                    ESP_LOGE("DisplayUi", "Bad voltage Y:%d V:%u", y, point.voltage);
-                    continue;
-                }
-                lv_canvas_set_px(ui.canvas, i - ui.buffer.start, y, lv_color_make(255, 255, 0));
-                y = MeterUi::CanvasHeight - 1 - point.CurrentY(MeterUi::CanvasHeight);
-                if (y <= 0 || y >= MeterUi::CanvasHeight) {
-                    ESP_LOGE("DisplayUi", "Bad current Y:%d I:%d", y, point.current);
-                    continue;
-                }
-                lv_canvas_set_px(ui.canvas, i - ui.buffer.start, MeterUi::CanvasHeight - 1 - point.CurrentY(MeterUi::CanvasHeight),
-                    lv_color_make(0, 255, 255));
+    static void DrawTrace(const MeterUi& ui, Plot& plot, const Plot::Trace trace, const lv_color_t color) {
+        const auto scale = plot.GetScale(trace);
+        const size_t columns = plot.ColumnExtents(trace);
+        for (size_t column = 0; column < columns; column++) {
+            const Plot::Extent& extent = plot.extents[column];
+            const int top = Plot::MapY(extent.hi, scale, MeterUi::CanvasHeight);
+            const int bottom = Plot::MapY(extent.lo, scale, MeterUi::CanvasHeight);
+            if (top < 0 || bottom < 0) {
+                DLOGE("DisplayUi", "Bad trace %d Y:%d..%d value:%d..%d", trace, top, bottom,
+                         static_cast<int>(extent.lo), static_cast<int>(extent.hi));
+                continue;
+            }
+            for (int y = top; y <= bottom; y++) {
+                lv_canvas_set_px(ui.canvas, static_cast<lv_coord_t>(column), static_cast<lv_coord_t>(y), color);
             }
         }
     }
 };
 
+// Parts are brought up by the init graph in app_main, independent ones in parallel
 struct Meter {
-    hal::I2CBus i2cBus{34, 35};
-    std::array<MeterBus, 3> buses{
-        MeterBus{i2cBus, 0x41, 37, "DC Jack"},
-        MeterBus{i2cBus, 0x44, 36, "USB-2"},
-        MeterBus{i2cBus, 0x40, 33, "USB-1"},
+    static constexpr size_t RippleSamples = 1024;
+    static constexpr uint32_t MinSamplePeriodUs = 1000;
+    static constexpr uint32_t MaxSamplePeriodUs = 10000000;
+    static constexpr uint32_t MaxMirrorBudget = 1000000;
+
+    // Consumers of every bus's sample frames, in the order of `Consumers`
+    enum Consumer : uint8_t {
+        kStream = 0,
+        kDisplay = 1,
+    };
+    static constexpr Subscription Consumers[]{
+        {"stream", FanoutPolicy::kLossless, 16}, // every frame feeds the resampler
+        {"display", FanoutPolicy::kDropOldest, 8}, // only the last reading of each channel is shown
     };
-    DisplayUi display{};
+
+    std::optional<ChannelRegistry> channels{};
+    std::optional<Fanout<SampleFrame>> samples[ChannelRegistry::MaxBuses]{};
+    std::optional<hal::Serial> serial{};
+    std::optional<Telemetry> telemetry{};
+    RippleAnalyzer rippleAnalyzer{RippleSamples};
+    SemaphoreHandle_t rippleLock{xSemaphoreCreateMutex()}; // the analyzer buffers are shared by all buses
+    // last of each channel, written by the sampling task of its bus and read by the display
+    std::array<Seqlock<RippleReport>, ChannelRegistry::MaxChannels> ripple{};
+    std::array<Seqlock<LoadEvent>, ChannelRegistry::MaxChannels> events{};
+    std::atomic<int> rippleRequest{-1};
+    std::atomic<bool> streaming{true};
+    std::atomic<uint32_t> samplePeriodUs{50000}; // quiet channels
+    std::atomic<uint32_t> fastPeriodUs{5000}; // active channels, 0 reads every channel at samplePeriodUs
+    std::atomic<uint32_t> alignPeriodUs{0};
+    std::optional<DisplayUi> display{};
+    std::optional<DisplayMirror> mirror{}; // engaged under the LVGL lock
+
+    // Runs on the sampling task of the channel's bus, which owns that bus. Returns the kRipple report, which
+    // the caller hands to the streamer.
+    RipplePacket CaptureRipple(const int index) {
+        MeterBus& channel = (*channels)[index];
+        xSemaphoreTake(rippleLock, portMAX_DELAY);
+        const float sampleRate = channel.CaptureCurrent(rippleAnalyzer.raw, rippleAnalyzer.samples, RippleSamples);
+        const RippleReport report = rippleAnalyzer.Analyze(sampleRate);
+        xSemaphoreGive(rippleLock);
+        ripple[index].Write(report);
+
+        RipplePacket packet{
+            .channel = static_cast<uint8_t>(index),
+            .peakCount = static_cast<uint8_t>(report.peakCount),
+            .size = static_cast<uint16_t>(RippleSamples),
+            .sampleRate = report.sampleRate,
+            .mean = report.mean,
+            .peakToPeak = report.peakToPeak,
+            .noiseFloor = report.noiseFloor,
+        };
+        for (size_t i = 0; i < report.peakCount; i++) {
+            packet.frequency[i] = report.peaks[i].frequency;
+            packet.amplitude[i] = report.peaks[i].amplitude;
+        }
+        DLOGI("Ripple", "%s: %.0fHz sampling, %.2fmA pp, floor %.3fmA, peak %.1fHz %.3fmA",
+            channel.name, report.sampleRate, report.peakToPeak * 1000, report.noiseFloor * 1000,
+            report.peakCount > 0 ? report.peaks[0].frequency : 0.0f,
+            report.peakCount > 0 ? report.peaks[0].amplitude * 1000 : 0.0f);
+        return packet;
+    }
 };
 
 
@@ -236,16 +445,14 @@ struct Keypad {
     hal::Button center{9, queue};
     hal::Button down{8, queue};
     hal::Button left{7, queue};
+    WorkerTask<Keypad> worker{[](Keypad& keypad) {
+        hal::Keypress keyPress{};
+        if (keypad.queue.Receive(keyPress)) {
+            keypad.HandleKeypress(keyPress);
+        }
+    }, *this, "Keypad", cores::Io};
 
     explicit Keypad(Meter& meter) : meter{meter} {
-        WorkerTask<Keypad>([](Keypad& keypad) {
-            while (true) {
-                hal::Keypress keyPress{};
-                if (keypad.queue.Receive(keyPress)) {
-                    keypad.HandleKeypress(keyPress);
-                }
-            }
-        }, *this);
     }
 
     hal::Button* GetButton(int gpio) {
@@ -286,70 +493,698 @@ struct Keypad {
     }
 
     void OnPress(hal::Button* button) {
+        DisplayUi& display = *meter.display;
         if (button == &up) {
-            if (meter.display.selected == 0) {
-                meter.display.selected = 2;
+            if (display.selected == 0) {
+                display.selected = display.channels - 1;
             } else {
-                meter.display.selected--;
+                display.selected--;
             }
         } else if (button == &down) {
-            if (meter.display.selected == 2) {
-                meter.display.selected = 0;
+            if (display.selected == display.channels - 1) {
+                display.selected = 0;
             } else {
-                meter.display.selected++;
+                display.selected++;
+            }
+        } else if (button == &right) {
+            auto& plot = display.views[display.selected]->plot;
+            plot.mode = plot.mode == Plot::Mode::kFixed ? Plot::Mode::kAutoscale : Plot::Mode::kFixed;
+        } else if (button == &left) {
+            auto& plot = display.views[display.selected]->plot;
+            switch (plot.traces) {
+                case Plot::kVoltage | Plot::kCurrent: plot.traces = Plot::kPower; break;
+                case Plot::kPower: plot.traces = Plot::kVoltage | Plot::kCurrent | Plot::kPower; break;
+                default: plot.traces = Plot::kVoltage | Plot::kCurrent; break;
             }
         } else if (button == &center) {
-            if (meter.buses[meter.display.selected].enabled) {
-                meter.buses[meter.display.selected].Disable();
+            MeterBus& channel = (*meter.channels)[display.selected];
+            if (channel.enabled) {
+                channel.Disable();
             } else {
-                meter.buses[meter.display.selected].Enable();
+                channel.Enable();
             }
         }
     }
 
-    void OnLongPress(hal::Button*) {
-
+    void OnLongPress(hal::Button* button) {
+        if (button == &center) {
+            meter.rippleRequest = meter.display->selected;
+        }
     }
 
     void OnLongRelease(hal::Button*) {
     }
 };
 
-extern "C" void app_main(void) {
-    Meter meter{};
-    Keypad keypad{meter};
-
-    lv_timer_create([](lv_timer_t* timer) {
-        Meter& meter = *static_cast<Meter*>(timer->user_data);
-        for (auto i = 0; i < meter.buses.size(); i++) {
-            meter.display.UpdateMeter(i, meter.buses[i]);
-        }
-    }, 20, &meter);
-
-    auto statsTimer = xTimerCreate("Stats", pdMS_TO_TICKS(5000), true, nullptr, [](TimerHandle_t) {
-        auto freeHeap = esp_get_free_heap_size();
-        ESP_LOGI("Stats", "heap free:%.2fkB", static_cast<float>(freeHeap) / 1024.);
-    });
-    xTimerStart(statsTimer, 0);
-
-    uint64_t sent = 0;
-    uint64_t ts = 0;
-    float thr = 0;
-    while (true) {
-        Packet bulk[3]{};
-        for (uint8_t i = 0; i < meter.buses.size(); i++) {
-            meter.buses[i].Update();
-            bulk[i] = meter.buses[i].GetPacket();
-        }
-        sent += sizeof(bulk);
+// Receives command frames on the serial link. Commands are executed by the sampling task of the bus the
+// channel is on, which is woken up right away, so a command takes effect within one bus transaction.
+// Commands without a channel go to the first bus. Their responses leave through the streamer.
+struct Remote {
+    static constexpr size_t ReadChunk = 256;
+    static constexpr size_t RingCommands = 8;
+
+    Meter& meter;
+    std::optional<SpscRing<Command>> commands[ChannelRegistry::MaxBuses]{}; // from this task to each sampler
+    std::atomic<TaskHandle_t> samplers[ChannelRegistry::MaxBuses]{};
+    FrameParser parser{[](void* arg, FrameType type, uint8_t, const uint8_t* payload, size_t length) {
+        static_cast<Remote*>(arg)->OnFrame(type, payload, length);
+    }, this};
+    std::optional<WorkerTask<Remote>> worker{};
+
+    explicit Remote(Meter& meter) : meter{meter} {
+        for (size_t bus = 0; bus < meter.channels->busCount; bus++) {
+            commands[bus].emplace(RingCommands);
+        }
+        // started last, frames may arrive right away
+        worker.emplace([](Remote& remote) {
+            uint8_t chunk[ReadChunk];
+            const size_t read = remote.meter.serial->Read(chunk, sizeof(chunk), pdMS_TO_TICKS(10));
+            remote.parser.Feed(chunk, read);
+        }, *this, "Remote", cores::Io);
+    }
+
+    void OnFrame(const FrameType type, const uint8_t* payload, const size_t length) {
+        if (type != FrameType::kCommand || length != sizeof(CommandPacket)) {
+            return;
+        }
+        Command command{{}, esp_timer_get_time()};
+        memcpy(&command.packet, payload, sizeof(command.packet));
+        const ChannelRegistry& channels = *meter.channels;
+        const size_t bus = command.packet.channel < channels.Size() ? channels.BusOf(command.packet.channel) : 0;
+        if (!commands[bus]->Push(command)) {
+            // on the I/O core like the streamer, the sampler never sees this one
+            const ResponsePacket response{command.packet.id, command.packet.opcode,
+                static_cast<uint8_t>(Status::kBusy), 0, 0};
+            meter.telemetry->Send(FrameType::kResponse, &response, sizeof(response));
+            return;
+        }
+        if (TaskHandle_t task = samplers[bus].load(); task != nullptr) {
+            xTaskNotifyGive(task);
+        }
+    }
+};
+
+// Sends the frames of all sampling tasks from the I/O core, so the link never holds up a bus read: sample frames
+// come through the fan-out, everything else a sampling task sends (events, command responses, stats and ripple
+// reports) through a ring of its own. Also puts all channels onto a common timebase for the kAligned stream.
+struct Streamer {
+    static constexpr size_t RingPosted = 16; // a full command ring's responses and as many events
+
+    // One frame posted by a sampling task, the payload copied in
+    struct Posted {
+        static constexpr size_t MaxPayload = std::max({sizeof(EventPacket), sizeof(ResponsePacket),
+            sizeof(StatsPacket), sizeof(RipplePacket)});
+
+        FrameType type;
+        uint8_t length;
+        uint8_t payload[MaxPayload];
+    };
+
+    struct AlignedFrame {
+        AlignedHeader header;
+        Packet packets[ChannelRegistry::MaxChannels];
+    };
+
+    Meter& meter;
+    const FrameParser* parser; // for the stats, read on this task
+    std::optional<SpscRing<Posted>> posted[ChannelRegistry::MaxBuses]{};
+    Resampler resampler;
+    AlignedFrame aligned{};
+    size_t alignedSize;
+    JitterStats skew{};
+    uint64_t sent{0};
+    uint64_t ts{0};
+    float thr{0};
+    std::optional<WorkerTask<Streamer>> worker{};
+
+    Streamer(Meter& meter, const FrameParser& parser) :
+        meter{meter},
+        parser{&parser},
+        resampler{static_cast<uint16_t>((1 << meter.channels->Size()) - 1)},
+        alignedSize{sizeof(AlignedHeader) + meter.channels->Size() * sizeof(Packet)} {
+        aligned.header.channels = resampler.channels;
+        for (size_t bus = 0; bus < meter.channels->busCount; bus++) {
+            posted[bus].emplace(RingPosted);
+        }
+        worker.emplace([](Streamer& streamer) {
+            streamer.Drain();
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(10));
+        }, *this, "Streamer", cores::Io);
+    }
+
+    // Called on a sampling task after it published a frame
+    void Wake() {
+        if (TaskHandle_t task = worker->handle; task != nullptr) {
+            xTaskNotifyGive(task);
+        }
+    }
+
+    // Called on the sampling task of `bus`, which wakes the streamer once its cycle is done
+    template<typename P>
+    bool Post(const size_t bus, const FrameType type, const P& payload) {
+        static_assert(sizeof(P) <= Posted::MaxPayload);
+        Posted frame{type, sizeof(P), {}};
+        memcpy(frame.payload, &payload, sizeof(P));
+        return posted[bus]->Push(frame);
+    }
+
+    void Drain() {
+        if (const uint32_t period = meter.alignPeriodUs; period != resampler.periodUs) {
+            resampler.SetPeriod(period);
+            aligned.header.periodUs = period;
+        }
+        Posted frame{};
+        for (size_t bus = 0; bus < meter.channels->busCount; bus++) {
+            while (posted[bus]->Pop(frame)) {
+                Send(frame);
+            }
+        }
+        // one frame per bus in turn keeps the resampler input roughly in time order
+        bool more = true;
+        while (more) {
+            more = false;
+            for (size_t bus = 0; bus < meter.channels->busCount; bus++) {
+                auto& subscriber = (*meter.samples[bus])[Meter::kStream];
+                if (const SampleFrame* frame = subscriber.Pop(); frame != nullptr) {
+                    Forward(*frame);
+                    subscriber.Release(frame);
+                    more = true;
+                }
+            }
+        }
         constexpr int kSeconds = 10;
         constexpr float kAlpha = 0.3f;
         if (ts == 0 || xTaskGetTickCount() - ts > 1000 * kSeconds) {
             ts = xTaskGetTickCount();
             thr = (1.0f - kAlpha) * thr + kAlpha * static_cast<float>(sent);
-            ESP_LOGI("Meter", "Sent %llu bytes/s throughput %.1f bytes/s", sent / kSeconds, thr / kSeconds);
+            DLOGI("Meter", "Sent %llu bytes/s throughput %.1f bytes/s", sent / kSeconds, thr / kSeconds);
+            if (skew.count > 0) {
+                DLOGI("Meter", "Channel skew within a cycle min:%ldus mean:%.1fus max:%ldus", skew.min,
+                    skew.Mean(), skew.max);
+            }
+            skew.Reset();
             sent = 0;
+            for (size_t bus = 0; bus < meter.channels->busCount; bus++) {
+                if (const uint32_t dropped = posted[bus]->dropped.exchange(0); dropped > 0) {
+                    DLOGW("Meter", "Bus %u %lu posted frames dropped", bus, dropped);
+                }
+            }
         }
-        usleep(50000);
     }
+
+    void Send(Posted& frame) {
+        if (frame.type == FrameType::kEvent && !meter.streaming) {
+            return;
+        }
+        // the link counters belong to this task, the sampler fills in the rest
+        if (frame.type == FrameType::kStats) {
+            auto& stats = *reinterpret_cast<StatsPacket*>(frame.payload);
+            stats.sentFrames = meter.telemetry->sentFrames;
+            stats.droppedFrames = meter.telemetry->droppedFrames;
+            stats.crcErrors = parser->crcErrors;
+        }
+        if (meter.telemetry->Send(frame.type, frame.payload, frame.length)) {
+            sent += frame.length;
+        }
+    }
+
+    void Forward(const SampleFrame& frame) {
+        for (size_t i = 0; i < frame.rateCount; i++) {
+            if (meter.streaming && meter.telemetry->Send(FrameType::kRate, &frame.rates[i], sizeof(RatePacket))) {
+                sent += sizeof(RatePacket);
+            }
+        }
+        if (frame.count == 0) {
+            return;
+        }
+        skew.Add(static_cast<int32_t>(frame.header.skewUs));
+        if (meter.streaming && meter.telemetry->Send(FrameType::kSamples, &frame, frame.Size())) {
+            sent += frame.Size();
+        }
+        for (size_t channel = 0, packet = 0; channel < ChannelRegistry::MaxChannels; channel++) {
+            if (frame.header.channels & 1 << channel) {
+                resampler.Push(channel, frame.packets[packet], frame.times[packet]);
+                packet++;
+            }
+        }
+        int64_t timeUs = 0;
+        while (resampler.Next(timeUs, aligned.packets)) {
+            aligned.header.timeUs = static_cast<uint32_t>(timeUs);
+            if (meter.streaming && meter.telemetry->Send(FrameType::kAligned, &aligned, alignedSize)) {
+                sent += alignedSize;
+            }
+        }
+    }
+};
+
+struct App {
+    Meter meter{};
+    std::optional<Keypad> keypad{};
+    std::optional<Remote> remote{};
+    std::optional<Streamer> streamer{};
+    InitGraph init{};
+    LatencyStats latency[ChannelRegistry::MaxBuses]{};
+    bool uiWatched{false};
+
+    // Called on the sampling task of `bus`
+    void ExecuteCommands(const size_t bus) {
+        if (!remote) { return; }
+        Command command{};
+        bool executed = false;
+        while (remote->commands[bus]->Pop(command)) {
+            Execute(bus, command);
+            executed = true;
+        }
+        if (executed) {
+            streamer->Wake();
+        }
+    }
+
+    // Called on the sampling task of `bus`, whatever it sends goes through the streamer
+    void Execute(const size_t bus, const Command& command) {
+        const CommandPacket& packet = command.packet;
+        ChannelRegistry& channels = *meter.channels;
+        const bool validChannel = packet.channel < channels.Size();
+        ResponsePacket response{packet.id, packet.opcode, static_cast<uint8_t>(Status::kOk), 0, packet.value};
+        auto status = Status::kOk;
+        switch (static_cast<Opcode>(packet.opcode)) {
+            case Opcode::kPing:
+                break;
+            case Opcode::kEnable:
+            case Opcode::kDisable:
+                if (!validChannel) {
+                    status = Status::kBadChannel;
+                } else if (static_cast<Opcode>(packet.opcode) == Opcode::kEnable) {
+                    channels[packet.channel].Enable();
+                } else {
+                    channels[packet.channel].Disable();
+                }
+                break;
+            case Opcode::kSetSamplePeriod:
+                if (packet.value < Meter::MinSamplePeriodUs || packet.value > Meter::MaxSamplePeriodUs ||
+                    !Resampler::PeriodsFit(packet.value, meter.fastPeriodUs)) {
+                    status = Status::kBadValue;
+                } else {
+                    meter.samplePeriodUs = packet.value;
+                }
+                break;
+            case Opcode::kSetInaConfig:
+                if (!validChannel) {
+                    status = Status::kBadChannel;
+                } else if (packet.value > 0xFFFF) {
+                    status = Status::kBadValue;
+                } else {
+                    channels[packet.channel].ina.Configure(static_cast<uint16_t>(packet.value));
+                }
+                break;
+            case Opcode::kStreamStart:
+                meter.streaming = true;
+                break;
+            case Opcode::kStreamStop:
+                meter.streaming = false;
+                break;
+            case Opcode::kCaptureRipple:
+                if (!validChannel) {
+                    status = Status::kBadChannel;
+                } else {
+                    streamer->Post(bus, FrameType::kRipple, meter.CaptureRipple(packet.channel));
+                }
+                break;
+            case Opcode::kSetAlignPeriod:
+                if (packet.value != 0 &&
+                    (packet.value < Meter::MinSamplePeriodUs || packet.value > Meter::MaxSamplePeriodUs)) {
+                    status = Status::kBadValue;
+                } else {
+                    meter.alignPeriodUs = packet.value;
+                }
+                break;
+            case Opcode::kSetMirrorBudget:
+                if (!meter.mirror) {
+                    status = Status::kBusy;
+                } else if (packet.value > Meter::MaxMirrorBudget) {
+                    status = Status::kBadValue;
+                } else {
+                    meter.mirror->SetBudget(packet.value);
+                }
+                break;
+            case Opcode::kSetReadMode:
+                if (!validChannel) {
+                    status = Status::kBadChannel;
+                } else if (packet.value > static_cast<uint32_t>(MeterBus::ReadMode::kDerived)) {
+                    status = Status::kBadValue;
+                } else {
+                    channels[packet.channel].mode = static_cast<MeterBus::ReadMode>(packet.value);
+                }
+                break;
+            case Opcode::kSetFastPeriod:
+                if (packet.value != 0 &&
+                    (packet.value < Meter::MinSamplePeriodUs || packet.value > Meter::MaxSamplePeriodUs ||
+                     !Resampler::PeriodsFit(meter.samplePeriodUs, packet.value))) {
+                    status = Status::kBadValue;
+                } else {
+                    meter.fastPeriodUs = packet.value;
+                }
+                break;
+            case Opcode::kQueryStats:
+                PostStats(bus);
+                break;
+            default:
+                status = Status::kUnknownOpcode;
+                break;
+        }
+        const auto latencyUs = static_cast<uint32_t>(esp_timer_get_time() - command.receivedUs);
+        latency[bus].Add(latencyUs);
+        response.status = static_cast<uint8_t>(status);
+        response.latencyUs = latencyUs;
+        streamer->Post(bus, FrameType::kResponse, response);
+    }
+
+    // The link counters are left to the streamer, which owns them
+    void PostStats(const size_t bus) {
+        const ChannelRegistry& channels = *meter.channels;
+        LatencyStats total{};
+        for (size_t bus = 0; bus < channels.busCount; bus++) {
+            total.Merge(latency[bus]);
+        }
+        StatsPacket stats{
+            .uptimeMs = static_cast<uint32_t>(esp_timer_get_time() / 1000),
+            .sentFrames = 0,
+            .droppedFrames = 0,
+            .crcErrors = 0,
+            .commands = total.count,
+            .latencyMinUs = total.count > 0 ? total.min : 0,
+            .latencyMaxUs = total.max,
+            .latencyAvgUs = total.Average(),
+            .samplePeriodUs = meter.samplePeriodUs,
+            .streaming = meter.streaming,
+            .channels = static_cast<uint8_t>(channels.Size()),
+        };
+        for (size_t i = 0; i < channels.Size(); i++) {
+            stats.enabled |= channels[i].enabled ? 1 << i : 0;
+        }
+        streamer->Post(bus, FrameType::kStats, stats);
+    }
+
+    // Schedule of the channels on one bus, `count` of them, and the frame read into when every block is taken.
+    // About 4.1KB for a full bus: taken from the arena when the sampling task starts rather than from its stack.
+    struct SamplerState {
+        static constexpr size_t MaxChannels = ChannelRegistry::MaxChannels;
+        static_assert(RateBudget::MaxChannels >= MaxChannels);
+
+        size_t members[MaxChannels];
+        size_t count;
+        RateController rates[MaxChannels];
+        LoadEventDetector detectors[MaxChannels];
+        float costUs[MaxChannels];
+        uint32_t requested[MaxChannels];
+        uint32_t granted[MaxChannels];
+        int64_t due[MaxChannels];
+        SampleFrame scratch; // never published
+    };
+
+    // Sampling loop of one I2C bus, every bus has its own task so the buses are read in parallel. Each channel
+    // is read on its own schedule: faster while its readings change, within what the bus can carry.
+    // Nothing here waits on the display or the link: whatever the task sends leaves through the streamer.
+    [[noreturn]] void Sample(const uint8_t bus) {
+        ChannelRegistry& channels = *meter.channels;
+        HeapGuard::Watch();
+        remote->samplers[bus] = xTaskGetCurrentTaskHandle();
+
+        constexpr float CostAlpha = 0.05f;
+        SamplerState& state = *Arenas::Get(Region::kInternalFast).NewArray<SamplerState>(1);
+        auto& [members, count, rates, detectors, costUs, requested, granted, due, scratch] = state;
+        for (size_t i = 0; i < channels.Size(); i++) {
+            if (channels.BusOf(i) == bus) {
+                members[count++] = i;
+            }
+        }
+        uint32_t basePeriodUs = 0;
+        uint32_t fastPeriodUs = 0;
+
+        Fanout<SampleFrame>& fanout = *meter.samples[bus];
+
+        JitterStats jitter{};
+        TickType_t ts = xTaskGetTickCount();
+        int64_t cycleStart = esp_timer_get_time();
+        for (size_t k = 0; k < count; k++) {
+            due[k] = cycleStart;
+            costUs[k] = 500.0f; // until measured, about three register reads at 400kHz
+        }
+        while (true) {
+            const int64_t now = esp_timer_get_time();
+            jitter.Add(static_cast<int32_t>(now - cycleStart));
+            bool replan = false;
+            if (meter.samplePeriodUs != basePeriodUs || meter.fastPeriodUs != fastPeriodUs) {
+                basePeriodUs = meter.samplePeriodUs;
+                fastPeriodUs = meter.fastPeriodUs;
+                for (size_t k = 0; k < count; k++) {
+                    rates[k].Configure(basePeriodUs, fastPeriodUs);
+                }
+                replan = true;
+            }
+
+            // filled in place and handed to every consumer without a copy
+            SampleFrame* block = fanout.Next();
+            SampleFrame& frame = block != nullptr ? *block : scratch;
+            frame.header.bus = bus;
+            frame.header.channels = 0;
+            frame.count = 0;
+            frame.rateCount = 0;
+            for (size_t k = 0; k < count; k++) {
+                if (due[k] > now) {
+                    continue;
+                }
+                MeterBus& channel = channels[members[k]];
+                const int64_t begin = esp_timer_get_time();
+                channel.Update();
+                costUs[k] += CostAlpha * (static_cast<float>(esp_timer_get_time() - begin) - costUs[k]);
+                frame.header.channels |= 1 << members[k];
+                frame.packets[frame.count] = channel.GetPacket();
+                frame.times[frame.count] = channel.readTimes;
+                frame.count++;
+                replan |= rates[k].Update(channel.current, channel.enabled, channel.readTimes.current);
+                LoadEvent event{};
+                if (detectors[k].Push(channel.readTimes.current, channel.current, channel.power, event)) {
+                    Announce(bus, members[k], event);
+                }
+                // after a stall the channel is read once, not once for every period it missed
+                due[k] += granted[k];
+                if (due[k] <= now) {
+                    due[k] = now + granted[k];
+                }
+            }
+            if (replan) {
+                Reschedule(state, now, frame);
+            }
+            if (frame.count > 0) {
+                const int64_t first = frame.times[0].current;
+                frame.header.timeUs = static_cast<uint32_t>(first);
+                frame.header.skewUs = static_cast<uint32_t>(frame.times[frame.count - 1].current - first);
+            }
+            if (block != nullptr && (frame.count > 0 || frame.rateCount > 0)) {
+                fanout.Publish();
+                streamer->Wake();
+            }
+            // only the task owning the channel's bus may take the request
+            if (int request = meter.rippleRequest; request >= 0 && channels.BusOf(request) == bus &&
+                meter.rippleRequest.compare_exchange_strong(request, -1)) {
+                streamer->Post(bus, FrameType::kRipple, meter.CaptureRipple(request));
+                streamer->Wake();
+            }
+            if (xTaskGetTickCount() - ts > pdMS_TO_TICKS(10000)) {
+                ts = xTaskGetTickCount();
+                DLOGI("Meter", "Bus %u %s on core %d, wake-up lateness min:%ldus mean:%.1fus sd:%.1fus max:%ldus",
+                    bus, cores::Name(), xPortGetCoreID(), jitter.min, jitter.Mean(), jitter.StdDev(), jitter.max);
+                DLOGI("Meter", "Bus %u load %.1f%%, stack headroom %u bytes", bus,
+                    RateBudget::Utilisation(granted, costUs, count) * 100.0f, uxTaskGetStackHighWaterMark(nullptr));
+                for (size_t i = 0; i < fanout.count; i++) {
+                    auto& subscriber = fanout[i];
+                    DLOGI("Meter", "Bus %u %s: %lu frames, %lu dropped, lag max:%lu", bus, subscriber.name,
+                        subscriber.delivered.load(), subscriber.dropped.load(), subscriber.maxLag.exchange(0));
+                }
+                if (fanout.pool.exhausted > 0) {
+                    DLOGW("Meter", "Bus %u no free block for %lu frames", bus, fanout.pool.exhausted);
+                }
+                jitter.Reset();
+                for (size_t i = 0; i < channels.Size(); i++) {
+                    if (channels.BusOf(i) == bus && channels[i].verified > 0) {
+                        DLOGI("Meter", "%s derived readings, %lu checks %lu mismatches", channels[i].name,
+                            channels[i].verified, channels[i].mismatches);
+                    }
+                }
+                if (latency[bus].count > 0) {
+                    DLOGI("Remote", "Bus %u %lu commands, latency min:%luus avg:%luus max:%luus", bus,
+                        latency[bus].count, latency[bus].min, latency[bus].Average(), latency[bus].max);
+                }
+            }
+
+            // sleep until the next channel is due, but wake up for commands
+            cycleStart = INT64_MAX;
+            for (size_t k = 0; k < count; k++) {
+                cycleStart = std::min(cycleStart, due[k]);
+            }
+            while (true) {
+                ExecuteCommands(bus);
+                const int64_t remaining = cycleStart - esp_timer_get_time();
+                if (remaining <= 0) {
+                    break;
+                }
+                ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(remaining / 1000) + 1);
+            }
+        }
+    }
+
+    // Called on the sampling task of `bus`
+    void Announce(const uint8_t bus, const size_t index, const LoadEvent& event) {
+        meter.events[index].Write(event);
+        streamer->Post(bus, FrameType::kEvent, EventPacket{
+            .channel = static_cast<uint8_t>(index),
+            .kind = static_cast<uint8_t>(event.kind),
+            .reserved = 0,
+            .timeUs = static_cast<uint32_t>(event.timeUs),
+            .delayUs = static_cast<uint32_t>(event.detectedUs - event.timeUs),
+            .beforeUa = static_cast<int32_t>(event.before * 1e6f),
+            .afterUa = static_cast<int32_t>(event.after * 1e6f),
+            .durationMs = static_cast<uint32_t>(event.durationUs / 1000),
+            .energy = event.energy,
+        });
+        DLOGI("Events", "%s: %s %.3fA -> %.3fA after %.1fs, %.3fJ", (*meter.channels)[index].name,
+            LoadEventDetector::Name(event.kind), event.before, event.after,
+            static_cast<double>(event.durationUs) / 1e6, event.energy);
+    }
+
+    // Grants the periods the controllers ask for within the bus budget and records every change in `frame`
+    static void Reschedule(SamplerState& state, const int64_t now, SampleFrame& frame) {
+        auto& [members, count, rates, detectors, costUs, requested, granted, due, scratch] = state;
+        uint32_t allowed[SamplerState::MaxChannels]{};
+        for (size_t k = 0; k < count; k++) {
+            requested[k] = rates[k].periodUs;
+        }
+        RateBudget::Allocate(requested, costUs, count, allowed);
+        for (size_t k = 0; k < count; k++) {
+            if (allowed[k] == granted[k]) {
+                continue;
+            }
+            // the new period counts from the last reading, a faster one need not wait for the slow one to run out
+            due[k] = std::max(due[k] - granted[k] + allowed[k], now);
+            granted[k] = allowed[k];
+            const auto reason = allowed[k] != requested[k] ? RateController::Reason::kBudget : rates[k].reason;
+            frame.rates[frame.rateCount++] = {
+                .channel = static_cast<uint8_t>(members[k]),
+                .reason = static_cast<uint8_t>(reason),
+                .reserved = 0,
+                .timeUs = static_cast<uint32_t>(now),
+                .periodUs = allowed[k],
+            };
+        }
+    }
+};
+
+extern "C" void app_main(void) {
+    BootTimeline::Record("app_main");
+    Arenas::Init();
+    DeferredLog::Init();
+    DeferredLog::Start(cores::Io, 1);
+    // static: the parts outlive this stack frame in the stage tasks
+    static App app{};
+    InitGraph& init = app.init;
+
+    const uint32_t sensors = init.Add("sensors", [](void* arg) {
+        Meter& meter = static_cast<App*>(arg)->meter;
+        auto& channels = meter.channels.emplace();
+        for (size_t bus = 0; bus < channels.busCount; bus++) {
+            channels.InitBus(bus);
+            meter.samples[bus].emplace(Meter::Consumers, std::size(Meter::Consumers));
+        }
+    }, &app, 0, cores::Sampler);
+    const uint32_t serial = init.Add("serial", [](void* arg) {
+        Meter& meter = static_cast<App*>(arg)->meter;
+        meter.serial.emplace(8192, 1024);
+        meter.telemetry.emplace(*meter.serial);
+    }, &app, 0, cores::Io);
+    // builds widgets right after starting the LVGL task, holding its lock: with the cores shared the LVGL task
+    // may run on the other core meanwhile
+    const uint32_t display = init.Add("display", [](void* arg) {
+        hal::Display::StartLvgl();
+        lvgl_port_lock(0);
+        static_cast<App*>(arg)->meter.display.emplace(static_cast<int>(board::ChannelCount));
+        lvgl_port_unlock();
+    }, &app, 0, cores::Io, 8192);
+    init.Add("ui", [](void* arg) {
+        lvgl_port_lock(0);
+        lv_timer_create([](lv_timer_t* timer) {
+            App& app = *static_cast<App*>(timer->user_data);
+            Meter& meter = app.meter;
+            if (!app.uiWatched) {
+                app.uiWatched = true;
+                HeapGuard::Watch();
+            }
+            for (size_t bus = 0; bus < meter.channels->busCount; bus++) {
+                auto& subscriber = (*meter.samples[bus])[Meter::kDisplay];
+                while (const SampleFrame* frame = subscriber.Pop()) {
+                    meter.display->Receive(*frame);
+                    subscriber.Release(frame);
+                }
+            }
+            meter.display->BeginFrame();
+            for (size_t i = 0; i < meter.channels->Size(); i++) {
+                meter.display->UpdateMeter(static_cast<int>(i), (*meter.channels)[i], meter.ripple[i].Read(),
+                    meter.events[i].Read());
+            }
+            if (meter.mirror) {
+                meter.mirror->Pump();
+            }
+            app.init.MarkFirstFrame();
+        }, 20, arg);
+        lvgl_port_unlock();
+    }, &app, sensors | display);
+
+    const uint32_t remote = init.Add("remote", [](void* arg) {
+        App& app = *static_cast<App*>(arg);
+        app.remote.emplace(app.meter);
+    }, &app, sensors | serial, cores::Io);
+    const uint32_t streamer = init.Add("streamer", [](void* arg) {
+        App& app = *static_cast<App*>(arg);
+        app.streamer.emplace(app.meter, app.remote->parser);
+    }, &app, remote, cores::Io);
+
+    // nothing below is needed to get readings on screen
+    const uint32_t keypad = init.Add("keypad", [](void* arg) {
+        App& app = *static_cast<App*>(arg);
+        app.keypad.emplace(app.meter);
+    }, &app, InitGraph::FirstFrame);
+    const uint32_t stats = init.Add("stats", [](void*) {
+        auto statsTimer = xTimerCreate("Stats", pdMS_TO_TICKS(5000), true, nullptr, [](TimerHandle_t) {
+            auto freeHeap = esp_get_free_heap_size();
+            ESP_LOGI("Stats", "heap free:%.2fkB", static_cast<float>(freeHeap) / 1024.);
+            Arenas::Report();
+        });
+        xTimerStart(statsTimer, 0);
+    }, nullptr, InitGraph::FirstFrame);
+    const uint32_t mirror = init.Add("mirror", [](void* arg) {
+        Meter& meter = static_cast<App*>(arg)->meter;
+        lvgl_port_lock(0);
+        meter.mirror.emplace(*meter.telemetry, hal::Display::Width, hal::Display::Height);
+        lvgl_port_unlock();
+        meter.display->display.SetFlushHook([](void* arg, const lv_area_t* area, const lv_color_t* pixels) {
+            static_cast<DisplayMirror*>(arg)->Capture(*area, pixels);
+        }, &*meter.mirror);
+    }, &app, serial | InitGraph::FirstFrame, cores::Io);
+    init.Add("report", [](void* arg) {
+        static_cast<App*>(arg)->init.Report();
+        Arenas::Report();
+        HeapGuard::Arm();
+    }, &app, keypad | stats | remote | streamer | mirror);
+
+    init.Run();
+    init.Wait(sensors | serial | remote | streamer);
+
+    static uint8_t busIds[ChannelRegistry::MaxBuses]{};
+    for (size_t bus = 0; bus < app.meter.channels->busCount; bus++) {
+        busIds[bus] = static_cast<uint8_t>(bus);
+        xTaskCreatePinnedToCore([](void* arg) {
+            app.Sample(*static_cast<uint8_t*>(arg));
+        }, "Sampler", 4096, &busIds[bus], cores::SamplerPriority, nullptr, cores::Sampler);
+    }
+    ESP_LOGI("Meter", "%u sampling tasks, %s cores", app.meter.channels->busCount, cores::Name());
 }
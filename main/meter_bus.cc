@@ -1,8 +1,13 @@
 #include "meter_bus.hh"
 
-MeterBus::MeterBus(const hal::I2CBus &bus, uint16_t address, int gpio, const char *name):
+#include <esp_timer.h>
+
+#include "deferred_log.hh"
+#include "kernels.hh"
+
+MeterBus::MeterBus(const hal::I2CBus &bus, uint16_t address, int gpio, const char *name, float shunt):
     name{name},
-    ina{bus, 100.0, address},
+    ina{bus, shunt, address},
     nfet{gpio, hal::PinMode::kOutput, hal::PinState::kFloat} {
     Reset();
 }
@@ -28,9 +33,65 @@ void MeterBus::Disable() {
 }
 
 void MeterBus::Update() {
+    if (mode == ReadMode::kDerived) {
+        const int64_t begin = esp_timer_get_time();
+        const hal::Ina219::Raw raw = ina.ReadRaw();
+        const int64_t end = esp_timer_get_time();
+        const int16_t currentRegister = hal::Ina219::DeriveCurrent(raw.shunt, ina.calibration);
+        voltage = ina.BusVoltage(raw);
+        current = ina.Current(currentRegister);
+        power = ina.Power(hal::Ina219::DerivePower(currentRegister, raw.bus));
+        // shunt first, bus second, power depends on both
+        readTimes.current = begin + (end - begin) / 4;
+        readTimes.voltage = end - (end - begin) / 4;
+        readTimes.power = (begin + end) / 2;
+        if (++updates % VerifyInterval == 0) {
+            Verify(raw);
+        }
+        return;
+    }
+    int64_t begin = esp_timer_get_time();
     voltage = ina.ReadBusVoltage();
+    int64_t end = esp_timer_get_time();
+    readTimes.voltage = (begin + end) / 2;
+    begin = end;
     current = ina.ReadCurrent();
+    end = esp_timer_get_time();
+    readTimes.current = (begin + end) / 2;
+    begin = end;
     power = ina.ReadPower();
+    end = esp_timer_get_time();
+    readTimes.power = (begin + end) / 2;
+}
+
+void MeterBus::Verify(const hal::Ina219::Raw& raw) {
+    const auto current = static_cast<int16_t>(ina.ReadRegister(hal::Ina219::REG_CURRENT));
+    const uint16_t power = ina.ReadRegister(hal::Ina219::REG_POWER);
+    const hal::Ina219::Raw again = ina.ReadRaw();
+    if (again.shunt != raw.shunt || (again.bus & ~0x3) != (raw.bus & ~0x3)) {
+        return;
+    }
+    verified++;
+    const int16_t derivedCurrent = hal::Ina219::DeriveCurrent(raw.shunt, ina.calibration);
+    const uint16_t derivedPower = hal::Ina219::DerivePower(derivedCurrent, raw.bus);
+    if (current != derivedCurrent || power != derivedPower) {
+        mismatches++;
+        DLOGW("MeterBus", "%s: derived current %d power %u, chip %d %u (shunt %d bus %u)", name,
+            derivedCurrent, derivedPower, current, power, raw.shunt, raw.bus);
+    }
+}
+
+float MeterBus::CaptureCurrent(int16_t *raw, float *samples, const size_t count) {
+    const uint16_t config = ina.config;
+    ina.Configure(hal::Ina219::CONFIG_FAST_SHUNT);
+    const int64_t begin = esp_timer_get_time();
+    for (size_t i = 0; i < count; i++) {
+        raw[i] = static_cast<int16_t>(ina.ReadRegister(hal::Ina219::REG_CURRENT));
+    }
+    const int64_t elapsed = esp_timer_get_time() - begin;
+    ina.Configure(config);
+    kernels::Scale(raw, samples, count, ina.currentLsb);
+    return elapsed > 0 ? static_cast<float>(count) * 1e6f / static_cast<float>(elapsed) : 0.0f;
 }
 
 Point MeterBus::GetPoint() const {
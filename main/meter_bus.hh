@@ -11,7 +11,22 @@ struct Packet {
     uint32_t power{0};
 };
 
+// When each register was read: esp_timer microseconds at the middle of its bus transaction
+struct ReadTimes {
+    int64_t voltage{0};
+    int64_t current{0};
+    int64_t power{0};
+};
+
 struct MeterBus {
+    enum class ReadMode : uint8_t {
+        kRegisters = 0, // bus voltage, current and power registers, three transactions
+        kDerived = 1, // shunt and bus voltage registers, current and power computed like the chip does
+    };
+
+    // Every this many derived updates the chip's own current and power registers are read back and compared
+    static constexpr uint32_t VerifyInterval = 256;
+
     const char* name;
     hal::Ina219 ina;
     hal::Pin nfet;
@@ -20,8 +35,13 @@ struct MeterBus {
     float current{0};
     float voltage{0};
     float power{0};
+    ReadTimes readTimes{};
+    ReadMode mode{ReadMode::kDerived};
+    uint32_t updates{0};
+    uint32_t verified{0};
+    uint32_t mismatches{0};
 
-    MeterBus(const hal::I2CBus& bus, uint16_t address, int gpio, const char* name);
+    MeterBus(const hal::I2CBus& bus, uint16_t address, int gpio, const char* name, float shunt = 100.0f);
 
     void Reset();
 
@@ -31,6 +51,12 @@ struct MeterBus {
 
     void Update();
 
+    // Derived values against the chip's registers, skipped when a conversion finished in between
+    void Verify(const hal::Ina219::Raw& raw);
+
+    // Reads the current register back to back in the fast shunt-only mode, returns the achieved sample rate
+    float CaptureCurrent(int16_t* raw, float* samples, size_t count);
+
     [[nodiscard]] Point GetPoint() const;
     [[nodiscard]] Packet GetPacket() const;
 };
@@ -0,0 +1,79 @@
+#ifndef MPSC_RING_HH
+#define MPSC_RING_HH
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "arena.hh"
+
+// Lock-free ring for any number of producers and one consumer. Producers claim a slot by advancing `head` and
+// publish it through the slot's sequence number, so a producer preempted between the two only holds back the
+// consumer, never the other producers. A full ring drops the new item instead of waiting.
+template<typename T>
+struct MpscRing {
+    struct Slot {
+        std::atomic<size_t> sequence;
+        T item;
+    };
+
+    Slot* slots;
+    size_t mask;
+    std::atomic<size_t> head{0};
+    size_t tail{0};
+    std::atomic<uint32_t> dropped{0};
+
+    // Capacity is rounded up to a power of two
+    explicit MpscRing(size_t capacity, Region region = Region::kInternalFast) :
+        slots{nullptr},
+        mask{RoundUp(capacity) - 1} {
+        slots = Arenas::Get(region).template NewArray<Slot>(mask + 1);
+        for (size_t i = 0; slots != nullptr && i <= mask; i++) {
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MpscRing(const MpscRing&) = delete;
+
+    // Producer side, `fill` writes the claimed item in place
+    template<typename F>
+    bool Push(F&& fill) {
+        size_t h = head.load(std::memory_order_relaxed);
+        while (true) {
+            Slot& slot = slots[h & mask];
+            const auto lag = static_cast<intptr_t>(slot.sequence.load(std::memory_order_acquire) - h);
+            if (lag == 0) {
+                if (head.compare_exchange_weak(h, h + 1, std::memory_order_relaxed)) {
+                    fill(slot.item);
+                    slot.sequence.store(h + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (lag < 0) {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            } else {
+                h = head.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Consumer side
+    bool Pop(T& item) {
+        Slot& slot = slots[tail & mask];
+        if (slot.sequence.load(std::memory_order_acquire) != tail + 1) {
+            return false;
+        }
+        item = slot.item;
+        slot.sequence.store(tail + mask + 1, std::memory_order_release);
+        tail++;
+        return true;
+    }
+
+    static constexpr size_t RoundUp(const size_t capacity) {
+        size_t size = 1;
+        while (size < capacity) { size <<= 1; }
+        return size;
+    }
+};
+
+#endif //MPSC_RING_HH
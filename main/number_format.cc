@@ -0,0 +1,31 @@
+#include "number_format.hh"
+
+namespace {
+    using number_format::Prefix;
+
+    constexpr bool Equals(const char* a, const char* b) {
+        while (*a != '\0' && *a == *b) { a++; b++; }
+        return *a == *b;
+    }
+
+    template<size_t N>
+    struct Rendered {
+        char text[N]{};
+    };
+
+    constexpr Rendered<16> Render(const int64_t micro, const Prefix prefix, const int digits, const char* unit,
+                                  const size_t width = 0) {
+        Rendered<16> out{};
+        number_format::FormatSignificant(out.text, sizeof(out.text), micro, prefix, digits, unit, width);
+        return out;
+    }
+
+    // The label formats used by DisplayUi, checked at build time
+    static_assert(Equals(Render(5123456, Prefix::kUnit, 4, "V").text, "5.123V"));
+    static_assert(Equals(Render(12345678, Prefix::kUnit, 4, "V").text, "12.35V"));
+    static_assert(Equals(Render(9999960, Prefix::kUnit, 4, "V").text, "10.00V"));
+    static_assert(Equals(Render(20400, Prefix::kMilli, 4, "A", 7).text, "20.40mA"));
+    static_assert(Equals(Render(-1500, Prefix::kMilli, 4, "A", 7).text, "-1.500mA"));
+    static_assert(Equals(Render(1234567, Prefix::kUnit, 4, "W", 7).text, " 1.235W"));
+    static_assert(Equals(Render(0, Prefix::kMilli, 4, "W").text, "0.000mW"));
+}
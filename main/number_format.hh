@@ -0,0 +1,159 @@
+#ifndef NUMBER_FORMAT_HH
+#define NUMBER_FORMAT_HH
+
+#include <cstddef>
+#include <cstdint>
+
+// Integer formatting for micro-unit readings (uV, uA, uW, uWh) without the printf float path.
+// Everything below is constexpr so label layouts can be checked at compile time.
+namespace number_format {
+    enum class Prefix : uint8_t {
+        kMicro = 0,
+        kMilli = 1,
+        kUnit = 2,
+    };
+
+    constexpr int64_t Pow10(int exp) {
+        int64_t value = 1;
+        while (exp-- > 0) { value *= 10; }
+        return value;
+    }
+
+    constexpr int64_t PrefixDivisor(const Prefix prefix) {
+        return Pow10(3 * static_cast<int>(prefix));
+    }
+
+    constexpr const char* PrefixSymbol(const Prefix prefix) {
+        switch (prefix) {
+            case Prefix::kMicro: return "u";
+            case Prefix::kMilli: return "m";
+            default: return "";
+        }
+    }
+
+    constexpr int CountDigits(uint64_t value) {
+        int digits = 1;
+        while (value >= 10) {
+            value /= 10;
+            digits++;
+        }
+        return digits;
+    }
+
+    // Decimals past a micro-unit have no digits behind them, so `prefix` allows 0 to 3 * prefix of them. That also
+    // bounds the text: 20 digits of magnitude, the point, 6 decimals and a sign.
+    constexpr int ClampDecimals(const Prefix prefix, const int decimals) {
+        const int maxDecimals = 3 * static_cast<int>(prefix);
+        return decimals < 0 ? 0 : decimals > maxDecimals ? maxDecimals : decimals;
+    }
+
+    // Rounds |micro| to `decimals` digits after the point of `prefix`, half away from zero, `decimals` clamped.
+    constexpr uint64_t RoundScaled(const uint64_t magnitude, const Prefix prefix, const int decimals) {
+        const auto divisor = static_cast<uint64_t>(PrefixDivisor(prefix) / Pow10(ClampDecimals(prefix, decimals)));
+        return (magnitude + divisor / 2) / divisor;
+    }
+
+    // Number of decimals that yields `digits` significant digits, never finer than 1 micro-unit.
+    constexpr int DecimalsFor(const uint64_t magnitude, const Prefix prefix, const int digits) {
+        const auto divisor = static_cast<uint64_t>(PrefixDivisor(prefix));
+        int decimals = ClampDecimals(prefix, digits - CountDigits(magnitude / divisor));
+        // 9.9996 rounds to 10.000, which needs one decimal less to stay at `digits`
+        const auto rounded = RoundScaled(magnitude, prefix, decimals);
+        if (CountDigits(rounded / static_cast<uint64_t>(Pow10(decimals))) + decimals > digits) {
+            decimals = ClampDecimals(prefix, decimals - 1);
+        }
+        return decimals;
+    }
+
+    // Writes `micro` in `prefix` + `unit` with `decimals` fixed decimals, right-aligned to `width`.
+    // `decimals` is clamped to what `prefix` resolves. Always NUL-terminates when size > 0, returns the length that
+    // was written.
+    constexpr size_t FormatFixed(char* out, const size_t size, const int64_t micro, const Prefix prefix,
+                                 int decimals, const char* unit, const size_t width = 0) {
+        if (size == 0) { return 0; }
+        decimals = ClampDecimals(prefix, decimals);
+        char text[32]{};
+        size_t len = 0;
+
+        const bool negative = micro < 0;
+        const uint64_t magnitude = negative ? 0 - static_cast<uint64_t>(micro) : static_cast<uint64_t>(micro);
+        uint64_t scaled = RoundScaled(magnitude, prefix, decimals);
+
+        // digits are produced in reverse order and flipped below
+        for (int i = 0; i < decimals; i++) {
+            text[len++] = static_cast<char>('0' + scaled % 10);
+            scaled /= 10;
+        }
+        if (decimals > 0) { text[len++] = '.'; }
+        do {
+            text[len++] = static_cast<char>('0' + scaled % 10);
+            scaled /= 10;
+        } while (scaled > 0);
+        if (negative) { text[len++] = '-'; }
+
+        size_t suffixLen = 0;
+        const char* symbol = PrefixSymbol(prefix);
+        while (symbol[suffixLen] != '\0') { suffixLen++; }
+        size_t unitLen = 0;
+        while (unit != nullptr && unit[unitLen] != '\0') { unitLen++; }
+        suffixLen += unitLen;
+
+        size_t pos = 0;
+        for (size_t pad = len + suffixLen; pad < width && pos + 1 < size; pad++) { out[pos++] = ' '; }
+        for (size_t i = len; i > 0 && pos + 1 < size; i--) { out[pos++] = text[i - 1]; }
+        for (size_t i = 0; symbol[i] != '\0' && pos + 1 < size; i++) { out[pos++] = symbol[i]; }
+        for (size_t i = 0; i < unitLen && pos + 1 < size; i++) { out[pos++] = unit[i]; }
+        out[pos] = '\0';
+        return pos;
+    }
+
+    // Formats with `digits` significant digits in a fixed prefix.
+    constexpr size_t FormatSignificant(char* out, const size_t size, const int64_t micro, const Prefix prefix,
+                                       const int digits, const char* unit, const size_t width = 0) {
+        const uint64_t magnitude = micro < 0 ? 0 - static_cast<uint64_t>(micro) : static_cast<uint64_t>(micro);
+        return FormatFixed(out, size, micro, prefix, DecimalsFor(magnitude, prefix, digits), unit, width);
+    }
+
+    // Picks the SI prefix for a reading and keeps it stable around the switch point: it moves up as soon as
+    // the value reaches 1000 of the current prefix, but only moves back down once it falls below
+    // (1000 - hysteresis) of the lower one, so a reading hovering around 1A does not flicker between mA and A.
+    struct UnitFormatter {
+        const char* unit;
+        int digits;
+        size_t width;
+        Prefix minPrefix;
+        Prefix maxPrefix;
+        int64_t hysteresis;
+        Prefix prefix;
+
+        constexpr UnitFormatter(const char* unit, const int digits, const size_t width,
+                                const Prefix minPrefix = Prefix::kMilli, const Prefix maxPrefix = Prefix::kUnit,
+                                const int64_t hysteresis = 100) :
+            unit{unit},
+            digits{digits},
+            width{width},
+            minPrefix{minPrefix},
+            maxPrefix{maxPrefix},
+            hysteresis{hysteresis},
+            prefix{minPrefix} { }
+
+        constexpr Prefix SelectPrefix(const int64_t micro) {
+            const int64_t magnitude = micro < 0 ? -micro : micro;
+            while (prefix < maxPrefix && magnitude >= 1000 * PrefixDivisor(prefix)) {
+                prefix = static_cast<Prefix>(static_cast<uint8_t>(prefix) + 1);
+            }
+            while (prefix > minPrefix) {
+                const auto lower = static_cast<Prefix>(static_cast<uint8_t>(prefix) - 1);
+                if (magnitude >= (1000 - hysteresis) * PrefixDivisor(lower)) { break; }
+                prefix = lower;
+            }
+            return prefix;
+        }
+
+        constexpr size_t Format(char* out, const size_t size, const int64_t micro) {
+            return FormatSignificant(out, size, micro, SelectPrefix(micro), digits, unit, width);
+        }
+    };
+}
+
+#endif //NUMBER_FORMAT_HH
@@ -0,0 +1,113 @@
+#include "plot.hh"
+
+#include <algorithm>
+
+static_assert(sizeof(Point) == 3 * sizeof(uint16_t), "Point fields must be packed for the strided kernels");
+
+Plot::Plot(const size_t columns, const size_t samplesPerColumn):
+    columns{columns},
+    samplesPerColumn{samplesPerColumn},
+    buffer{columns * samplesPerColumn},
+    voltage{columns * samplesPerColumn},
+    current{columns * samplesPerColumn},
+    power{columns * samplesPerColumn},
+    extents{Arenas::Get(Region::kInternalFast).NewArray<Extent>(columns)},
+    ranges{Arenas::Get(Region::kInternalFast).NewArray<kernels::Range<uint16_t>>(columns)},
+    signedRanges{Arenas::Get(Region::kInternalFast).NewArray<kernels::Range<int16_t>>(columns)} {
+}
+
+void Plot::Push(const Point &point) {
+    buffer.Push(point);
+    voltage.Push(TraceValue(point, kVoltage));
+    current.Push(TraceValue(point, kCurrent));
+    power.Push(TraceValue(point, kPower));
+    if (count < buffer.window) {
+        count++;
+    }
+}
+
+void Plot::Reset() {
+    buffer.Reset();
+    voltage.Reset();
+    current.Reset();
+    power.Reset();
+    count = 0;
+}
+
+Plot::Scale Plot::GetScale(const Trace trace) const {
+    if (mode == Mode::kFixed) {
+        switch (trace) {
+            case kVoltage: return {0, static_cast<int32_t>(Point::MaxVoltage)};
+            case kCurrent: return {0, static_cast<int32_t>(Point::MaxCurrent)};
+            default: return {0, static_cast<int32_t>(Point::MaxPower / Point::PowerStep)};
+        }
+    }
+    const RangeTracker* tracker = &power;
+    int32_t minSpan = MinPowerSpan;
+    if (trace == kVoltage) {
+        tracker = &voltage;
+        minSpan = MinVoltageSpan;
+    } else if (trace == kCurrent) {
+        tracker = &current;
+        minSpan = MinCurrentSpan;
+    }
+    Scale scale{tracker->Min(), tracker->Max()};
+    if (scale.hi - scale.lo < minSpan) {
+        const int32_t grow = minSpan - (scale.hi - scale.lo);
+        scale.lo -= grow / 2;
+        scale.hi += grow - grow / 2;
+        if (scale.lo < 0 && tracker->Min() >= 0) {
+            scale.hi -= scale.lo;
+            scale.lo = 0;
+        }
+    }
+    return scale;
+}
+
+size_t Plot::ColumnExtents(const Trace trace) {
+    // until the buffer fills up the window holds pushed samples from its left edge only
+    const size_t used = (count + samplesPerColumn - 1) / samplesPerColumn;
+    const Point* window = &buffer.values[buffer.start];
+    if (trace == kCurrent) {
+        kernels::DecimateMinMax(&window->current, Stride, count, samplesPerColumn, signedRanges);
+        for (size_t column = 0; column < used; column++) {
+            // envelope of abs(current), a column crossing zero reaches down to it
+            const int32_t lo = signedRanges[column].min;
+            const int32_t hi = signedRanges[column].max;
+            if (lo >= 0) {
+                extents[column] = {lo, hi};
+            } else if (hi <= 0) {
+                extents[column] = {-hi, -lo};
+            } else {
+                extents[column] = {0, std::max(-lo, hi)};
+            }
+        }
+        return used;
+    }
+    kernels::DecimateMinMax(trace == kVoltage ? &window->voltage : &window->power, Stride, count,
+                            samplesPerColumn, ranges);
+    for (size_t column = 0; column < used; column++) {
+        extents[column] = {ranges[column].min, ranges[column].max};
+    }
+    return used;
+}
+
+int Plot::MapY(const int32_t value, const Scale &scale, const int height) {
+    const int32_t span = scale.hi - scale.lo;
+    if (span <= 0) {
+        return height - 1;
+    }
+    const int32_t offset = value - scale.lo;
+    if (offset < 0 || offset > span) {
+        return -1;
+    }
+    return height - 1 - static_cast<int>(static_cast<int64_t>(offset) * (height - 1) / span);
+}
+
+int32_t Plot::TraceValue(const Point &point, const Trace trace) {
+    switch (trace) {
+        case kVoltage: return point.voltage;
+        case kCurrent: return abs(point.current);
+        default: return point.power;
+    }
+}
@@ -0,0 +1,79 @@
+#ifndef PLOT_HH
+#define PLOT_HH
+
+#include <cstdint>
+#include <cstdlib>
+
+#include "kernels.hh"
+#include "point.hh"
+#include "range_tracker.hh"
+#include "sliding_buffer.hh"
+
+// History of points behind a meter canvas. Keeps `samplesPerColumn` samples for every pixel column
+// so a column can be drawn as the min/max envelope of the samples it covers, and tracks the range of
+// every trace over the visible window for autoscaling.
+struct Plot {
+    enum class Mode {
+        kFixed,
+        kAutoscale,
+    };
+
+    enum Trace : uint8_t {
+        kVoltage = 1 << 0,
+        kCurrent = 1 << 1,
+        kPower = 1 << 2,
+    };
+
+    struct Scale {
+        int32_t lo;
+        int32_t hi;
+    };
+
+    struct Extent {
+        int32_t lo;
+        int32_t hi;
+    };
+
+    // Smallest span the autoscaler zooms into, so noise on a steady line is not blown up to full height
+    static constexpr int32_t MinVoltageSpan = 100; // mV
+    static constexpr int32_t MinCurrentSpan = 10; // mA
+    static constexpr int32_t MinPowerSpan = 5; // Point::PowerStep, 50mW
+
+    // Distance between the same field of consecutive points, the kernels walk one field across the window
+    static constexpr size_t Stride = sizeof(Point) / sizeof(uint16_t);
+
+    size_t columns;
+    size_t samplesPerColumn;
+    SlidingBuffer buffer;
+    RangeTracker voltage;
+    RangeTracker current;
+    RangeTracker power;
+    size_t count{0};
+    Extent* extents; // one per column, filled by ColumnExtents
+    kernels::Range<uint16_t>* ranges;
+    kernels::Range<int16_t>* signedRanges;
+
+    Mode mode{Mode::kAutoscale};
+    uint8_t traces{kVoltage | kCurrent};
+
+    Plot(size_t columns, size_t samplesPerColumn);
+
+    Plot(const Plot&) = delete;
+
+    void Push(const Point& point);
+
+    void Reset();
+
+    [[nodiscard]] Scale GetScale(Trace trace) const;
+
+    // Fills `extents` with the envelope of `trace` over the samples of every column, returns the number of
+    // columns that have samples
+    [[nodiscard]] size_t ColumnExtents(Trace trace);
+
+    // Maps a value onto canvas rows, 0 being the top row. Returns -1 if it is outside of a fixed scale.
+    [[nodiscard]] static int MapY(int32_t value, const Scale& scale, int height);
+
+    [[nodiscard]] static int32_t TraceValue(const Point& point, Trace trace);
+};
+
+#endif //PLOT_HH
@@ -3,7 +3,7 @@
 Point::Point(float voltage, float current, float power):
     voltage{static_cast<uint16_t>(voltage * 1000.0)},
     current{static_cast<int16_t>(current * 1000.0)},
-    power{static_cast<uint16_t>(power * 1000.0)} { }
+    power{static_cast<uint16_t>(power * 1000.0f / PowerStep)} { }
 
 int Point::VoltageY(const size_t height) const {
     const auto f = static_cast<float>(voltage) / MaxVoltage; // NOLINT(*-narrowing-conversions)
@@ -16,6 +16,8 @@ int Point::CurrentY(const size_t height) const {
 }
 
 int Point::PowerY(const size_t height) const {
-    const auto f = static_cast<float>(power) / (MaxCurrent * MaxVoltage);  // NOLINT(*-narrowing-conversions)
+    const auto f = static_cast<float>(power) * PowerStep / MaxPower;  // NOLINT(*-narrowing-conversions)
     return static_cast<int>(f * height);  // NOLINT(*-narrowing-conversions)
 }
+
+static_assert(Point::MaxPower / Point::PowerStep <= UINT16_MAX, "full scale power must fit the power field");
@@ -1,15 +1,19 @@
 #ifndef POINT_HH
 #define POINT_HH
 
+#include <cstdint>
 #include <cstdlib>
 
 struct Point {
     static constexpr float MaxVoltage = 26000.0f;
     static constexpr float MaxCurrent = 3000.0f;
+    static constexpr float MaxPower = MaxVoltage * MaxCurrent / 1000.0f;
+    // mW per unit of `power`, 16 bits of mW would wrap at 65W
+    static constexpr float PowerStep = 10.0f;
 
-    uint16_t voltage;
-    int16_t current;
-    uint16_t power;
+    uint16_t voltage; // mV
+    int16_t current; // mA
+    uint16_t power; // PowerStep mW
 
     Point() :
         voltage{0},
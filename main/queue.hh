@@ -20,6 +20,16 @@ struct Queue {
         }
     }
 
+    bool Push(const T& item) {
+        if (!queue) { return false; }
+        return xQueueSend(queue, &item, 0) == pdTRUE;
+    }
+
+    bool TryReceive(T& item) {
+        if (!queue) { return false; }
+        return xQueueReceive(queue, &item, 0) == pdTRUE;
+    }
+
     bool Receive(T& item) {
         if (!queue) { return false; }
         if (xQueueReceive(queue, &item, portMAX_DELAY) == pdTRUE) {
@@ -0,0 +1,26 @@
+#include "range_tracker.hh"
+
+RangeTracker::RangeTracker(const size_t window, const Region region):
+    window{window},
+    storage{Arenas::Get(region).NewArray<Entry>(2 * (window + 1))},
+    minQueue{storage, window + 1},
+    maxQueue{storage + window + 1, window + 1} {
+}
+
+void RangeTracker::Push(const int32_t value) {
+    // drop entries that slid out of the window
+    while (minQueue.size > 0 && seq - minQueue.Front().seq >= window) { minQueue.PopFront(); }
+    while (maxQueue.size > 0 && seq - maxQueue.Front().seq >= window) { maxQueue.PopFront(); }
+    // a new value makes every older, larger (smaller) candidate irrelevant for the min (max)
+    while (minQueue.size > 0 && minQueue.Back().value >= value) { minQueue.PopBack(); }
+    while (maxQueue.size > 0 && maxQueue.Back().value <= value) { maxQueue.PopBack(); }
+    minQueue.PushBack({seq, value});
+    maxQueue.PushBack({seq, value});
+    seq++;
+}
+
+void RangeTracker::Reset() {
+    minQueue.head = minQueue.size = 0;
+    maxQueue.head = maxQueue.size = 0;
+    seq = 0;
+}
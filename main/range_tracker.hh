@@ -0,0 +1,51 @@
+#ifndef RANGE_TRACKER_HH
+#define RANGE_TRACKER_HH
+
+#include <cstdint>
+#include <cstdlib>
+
+#include "arena.hh"
+
+// Minimum and maximum over the last `window` pushed values, maintained with two monotonic
+// queues so each Push is amortized O(1) and reading the range never rescans the window.
+struct RangeTracker {
+    struct Entry {
+        uint32_t seq;
+        int32_t value;
+    };
+
+    struct MonotonicQueue {
+        Entry* entries;
+        size_t capacity;
+        size_t head{0};
+        size_t size{0};
+
+        [[nodiscard]] Entry& Front() const { return entries[head]; }
+        [[nodiscard]] Entry& Back() const { return entries[(head + size - 1) % capacity]; }
+        void PopFront() { head = (head + 1) % capacity; size--; }
+        void PopBack() { size--; }
+        void PushBack(const Entry& entry) { entries[(head + size++) % capacity] = entry; }
+    };
+
+    size_t window;
+    Entry* storage;
+    MonotonicQueue minQueue;
+    MonotonicQueue maxQueue;
+    uint32_t seq{0};
+
+    explicit RangeTracker(size_t window, Region region = Region::kPsramBulk);
+
+    RangeTracker(const RangeTracker&) = delete;
+
+    void Push(int32_t value);
+
+    void Reset();
+
+    [[nodiscard]] bool Empty() const { return minQueue.size == 0; }
+
+    [[nodiscard]] int32_t Min() const { return Empty() ? 0 : minQueue.Front().value; }
+
+    [[nodiscard]] int32_t Max() const { return Empty() ? 0 : maxQueue.Front().value; }
+};
+
+#endif //RANGE_TRACKER_HH
@@ -0,0 +1,74 @@
+#include "resampler.hh"
+
+#include <initializer_list>
+
+void Resampler::Series::Push(const int64_t timeUs, const int64_t value) {
+    if (count == Depth) {
+        for (size_t i = 1; i < Depth; i++) {
+            history[i - 1] = history[i];
+        }
+        count--;
+    }
+    history[count++] = {timeUs, value};
+}
+
+int64_t Resampler::Series::At(const int64_t timeUs) const {
+    size_t i = 1;
+    while (i < count - 1 && history[i].timeUs < timeUs) {
+        i++;
+    }
+    const Reading& a = history[i - 1];
+    const Reading& b = history[i];
+    if (b.timeUs == a.timeUs) {
+        return b.value;
+    }
+    return a.value + (b.value - a.value) * (timeUs - a.timeUs) / (b.timeUs - a.timeUs);
+}
+
+void Resampler::SetPeriod(const uint32_t period) {
+    periodUs = period;
+    nextUs = 0;
+}
+
+void Resampler::Push(const size_t channel, const Packet& packet, const ReadTimes& times) {
+    voltage[channel].Push(times.voltage, packet.voltage);
+    current[channel].Push(times.current, packet.current);
+    power[channel].Push(times.power, packet.power);
+}
+
+bool Resampler::Next(int64_t& timeUs, Packet* packets) {
+    if (periodUs == 0 || channels == 0) {
+        return false;
+    }
+    int64_t oldest = INT64_MIN;
+    int64_t newest = INT64_MAX;
+    for (size_t channel = 0; channel < ChannelRegistry::MaxChannels; channel++) {
+        if ((channels & 1 << channel) == 0) { continue; }
+        for (const Series* series : {&voltage[channel], &current[channel], &power[channel]}) {
+            if (series->count < 2) {
+                return false;
+            }
+            if (series->Oldest() > oldest) { oldest = series->Oldest(); }
+            if (series->Newest() < newest) { newest = series->Newest(); }
+        }
+    }
+    // instants that fell out of the history are skipped, the grid stays on multiples of the period
+    if (nextUs < oldest) {
+        nextUs = (oldest + periodUs - 1) / periodUs * periodUs;
+    }
+    if (nextUs > newest) {
+        return false;
+    }
+    size_t index = 0;
+    for (size_t channel = 0; channel < ChannelRegistry::MaxChannels; channel++) {
+        if ((channels & 1 << channel) == 0) { continue; }
+        packets[index++] = {
+            .voltage = static_cast<int32_t>(voltage[channel].At(nextUs)),
+            .current = static_cast<int32_t>(current[channel].At(nextUs)),
+            .power = static_cast<uint32_t>(power[channel].At(nextUs)),
+        };
+    }
+    timeUs = nextUs;
+    nextUs += periodUs;
+    return true;
+}
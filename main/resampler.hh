@@ -0,0 +1,66 @@
+#ifndef RESAMPLER_HH
+#define RESAMPLER_HH
+
+#include <cstddef>
+#include <cstdint>
+
+#include "channel.hh"
+#include "meter_bus.hh"
+
+// Aligns channels that were read at different instants onto one timebase. Every register read carries its
+// own timestamp, so voltage, current and power of each channel are interpolated linearly and independently
+// to output instants on a grid of `periodUs`. An instant is produced once every channel has been read past it.
+struct Resampler {
+    // Readings kept per register. Covers channels arriving out of step, and a channel sampled at the fast
+    // adaptive rate between two readings of a quiet one at the default 10:1 ratio of the periods.
+    static constexpr size_t Depth = 12;
+
+    // Largest ratio of the base to the fast sampling period the history covers: `Depth` readings of an active
+    // channel must reach back past the older of two readings of a quiet one, with two to spare for skew
+    static constexpr uint32_t MaxPeriodRatio = Depth - 2;
+
+    // Whether channels read at `basePeriodUs` and `fastPeriodUs` (0 for none) can be aligned
+    static constexpr bool PeriodsFit(const uint32_t basePeriodUs, const uint32_t fastPeriodUs) {
+        return fastPeriodUs == 0 || fastPeriodUs >= basePeriodUs ||
+            basePeriodUs <= static_cast<uint64_t>(fastPeriodUs) * MaxPeriodRatio;
+    }
+
+    struct Reading {
+        int64_t timeUs;
+        int64_t value;
+    };
+
+    // History of one register, oldest first
+    struct Series {
+        Reading history[Depth]{};
+        size_t count{0};
+
+        void Push(int64_t timeUs, int64_t value);
+
+        [[nodiscard]] int64_t Oldest() const { return history[0].timeUs; }
+
+        [[nodiscard]] int64_t Newest() const { return history[count - 1].timeUs; }
+
+        // Linear interpolation, `timeUs` must lie within [Oldest, Newest]
+        [[nodiscard]] int64_t At(int64_t timeUs) const;
+    };
+
+    uint16_t channels; // bit per channel taking part
+    uint32_t periodUs{0}; // 0 stops the output
+    int64_t nextUs{0};
+    Series voltage[ChannelRegistry::MaxChannels]{};
+    Series current[ChannelRegistry::MaxChannels]{};
+    Series power[ChannelRegistry::MaxChannels]{};
+
+    explicit Resampler(uint16_t channels) : channels{channels} { }
+
+    void SetPeriod(uint32_t periodUs);
+
+    void Push(size_t channel, const Packet& packet, const ReadTimes& times);
+
+    // Writes one packet per channel in `channels`, lowest first. False until all channels are read past the
+    // next instant; call again until it returns false.
+    bool Next(int64_t& timeUs, Packet* packets);
+};
+
+#endif //RESAMPLER_HH
@@ -0,0 +1,256 @@
+#ifndef SAMPLE_FANOUT_HH
+#define SAMPLE_FANOUT_HH
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+#include "arena.hh"
+
+// Fixed set of blocks handed out by one producer and returned by whoever drops the last reference, on any
+// core. Free blocks form a lock-free stack; its head carries a tag that changes on every push, so a pop
+// racing with a release can not be fooled by a block that left and came back.
+template<typename T>
+struct BlockPool {
+    static constexpr uint16_t None = 0xFFFF;
+
+    struct Block {
+        T item;
+        std::atomic<uint16_t> refs;
+        uint16_t next;
+    };
+
+    Block* blocks;
+    size_t capacity;
+    std::atomic<uint32_t> free{None}; // tag << 16 | index of the first free block
+    std::atomic<uint32_t> inUse{0};
+    uint32_t exhausted{0}; // producer only
+
+    explicit BlockPool(const size_t capacity, const Region region = Region::kInternalFast) :
+        blocks{nullptr},
+        capacity{std::min<size_t>(capacity, None)} {
+        blocks = Arenas::Get(region).template NewArray<Block>(this->capacity);
+        for (size_t i = 0; blocks != nullptr && i < this->capacity; i++) {
+            blocks[i].next = i + 1 < this->capacity ? static_cast<uint16_t>(i + 1) : None;
+        }
+        free.store(blocks != nullptr && this->capacity > 0 ? 0 : None, std::memory_order_relaxed);
+    }
+
+    BlockPool(const BlockPool&) = delete;
+
+    // Producer side, the block comes back with one reference or None when all of them are out
+    uint16_t Acquire() {
+        uint32_t head = free.load(std::memory_order_acquire);
+        while (true) {
+            const auto index = static_cast<uint16_t>(head & 0xFFFF);
+            if (index == None) {
+                exhausted++;
+                return None;
+            }
+            const uint32_t next = (head & 0xFFFF0000) | blocks[index].next;
+            if (free.compare_exchange_weak(head, next, std::memory_order_acquire, std::memory_order_acquire)) {
+                blocks[index].refs.store(1, std::memory_order_relaxed);
+                inUse.fetch_add(1, std::memory_order_relaxed);
+                return index;
+            }
+        }
+    }
+
+    void Retain(const uint16_t index) {
+        blocks[index].refs.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Any task, the last reference puts the block back on the free stack
+    void Release(const uint16_t index) {
+        if (blocks[index].refs.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+            return;
+        }
+        inUse.fetch_sub(1, std::memory_order_relaxed);
+        uint32_t head = free.load(std::memory_order_relaxed);
+        while (true) {
+            blocks[index].next = static_cast<uint16_t>(head & 0xFFFF);
+            const uint32_t next = ((head & 0xFFFF0000) + 0x10000) | index;
+            if (free.compare_exchange_weak(head, next, std::memory_order_release, std::memory_order_relaxed)) {
+                return;
+            }
+        }
+    }
+
+    T& operator[](const uint16_t index) { return blocks[index].item; }
+
+    [[nodiscard]] uint16_t IndexOf(const T* item) const {
+        const auto offset = reinterpret_cast<const uint8_t*>(item) - reinterpret_cast<const uint8_t*>(blocks);
+        return static_cast<uint16_t>(static_cast<size_t>(offset) / sizeof(Block));
+    }
+};
+
+// What a subscriber gets when it falls behind. No policy ever makes the producer wait.
+enum class FanoutPolicy : uint8_t {
+    kLossless = 0, // every block while the subscriber lags by at most `depth`, which the pool reserves for it
+    kDropOldest = 1, // a full queue loses its oldest block to the new one
+    kLatest = 2, // only the newest block is kept
+};
+
+struct Subscription {
+    const char* name;
+    FanoutPolicy policy;
+    size_t depth; // blocks a subscriber may lag behind, ignored for kLatest
+};
+
+// Hands every block one producer fills to all subscribers without copying it: each gets a reference, the
+// block returns to the pool when the last one lets go. Subscribers are fixed at construction so the pool can
+// hold every block that may be in flight at once, and each is drained by one consumer task of its own.
+template<typename T>
+struct Fanout {
+    static constexpr size_t MaxSubscribers = 4;
+
+    struct Subscriber {
+        const char* name;
+        FanoutPolicy policy;
+        BlockPool<T>& pool;
+        std::atomic<uint16_t>* slots;
+        size_t mask;
+        std::atomic<size_t> head{0}; // written by the producer
+        std::atomic<size_t> tail{0}; // advanced by the consumer, and by the producer when it drops the oldest
+        std::atomic<uint32_t> delivered{0};
+        std::atomic<uint32_t> dropped{0};
+        std::atomic<uint32_t> maxLag{0};
+
+        Subscriber(const Subscription& subscription, BlockPool<T>& pool, const Region region) :
+            name{subscription.name},
+            policy{subscription.policy},
+            pool{pool},
+            slots{nullptr},
+            mask{Capacity(subscription) - 1} {
+            slots = Arenas::Get(region).template NewArray<std::atomic<uint16_t>>(mask + 1);
+            for (size_t i = 0; slots != nullptr && i <= mask; i++) {
+                slots[i].store(BlockPool<T>::None, std::memory_order_relaxed);
+            }
+        }
+
+        Subscriber(const Subscriber&) = delete;
+
+        // Producer side, takes a reference to the block when it is queued
+        void Offer(const uint16_t block) {
+            if (policy == FanoutPolicy::kLatest) {
+                pool.Retain(block);
+                if (const uint16_t old = slots[0].exchange(block, std::memory_order_acq_rel);
+                    old != BlockPool<T>::None) {
+                    pool.Release(old);
+                    dropped.fetch_add(1, std::memory_order_relaxed);
+                }
+                delivered.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            const size_t h = head.load(std::memory_order_relaxed);
+            size_t t = tail.load(std::memory_order_acquire);
+            while (h - t > mask) {
+                if (policy == FanoutPolicy::kLossless) {
+                    dropped.fetch_add(1, std::memory_order_relaxed);
+                    return;
+                }
+                // whoever moves the tail past the oldest block owns its reference
+                if (tail.compare_exchange_weak(t, t + 1, std::memory_order_acq_rel, std::memory_order_acquire)) {
+                    pool.Release(slots[t & mask].load(std::memory_order_relaxed));
+                    dropped.fetch_add(1, std::memory_order_relaxed);
+                    t++;
+                }
+            }
+            pool.Retain(block);
+            slots[h & mask].store(block, std::memory_order_relaxed);
+            head.store(h + 1, std::memory_order_release);
+            delivered.fetch_add(1, std::memory_order_relaxed);
+            const auto lag = static_cast<uint32_t>(h + 1 - t);
+            if (lag > maxLag.load(std::memory_order_relaxed)) {
+                maxLag.store(lag, std::memory_order_relaxed);
+            }
+        }
+
+        // Consumer side, the block stays valid until it is given back with Release()
+        const T* Pop() {
+            if (policy == FanoutPolicy::kLatest) {
+                const uint16_t block = slots[0].exchange(BlockPool<T>::None, std::memory_order_acq_rel);
+                return block != BlockPool<T>::None ? &pool[block] : nullptr;
+            }
+            size_t t = tail.load(std::memory_order_relaxed);
+            while (t != head.load(std::memory_order_acquire)) {
+                const uint16_t block = slots[t & mask].load(std::memory_order_relaxed);
+                if (tail.compare_exchange_weak(t, t + 1, std::memory_order_acq_rel, std::memory_order_relaxed)) {
+                    return &pool[block];
+                }
+            }
+            return nullptr;
+        }
+
+        void Release(const T* item) {
+            pool.Release(pool.IndexOf(item));
+        }
+
+        [[nodiscard]] size_t Lag() const {
+            if (policy == FanoutPolicy::kLatest) {
+                return slots[0].load(std::memory_order_relaxed) != BlockPool<T>::None ? 1 : 0;
+            }
+            return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+        }
+
+        static size_t Capacity(const Subscription& subscription) {
+            if (subscription.policy == FanoutPolicy::kLatest) {
+                return 1;
+            }
+            size_t size = 1;
+            while (size < subscription.depth) { size <<= 1; }
+            return size;
+        }
+    };
+
+    BlockPool<T> pool;
+    std::optional<Subscriber> subscribers[MaxSubscribers]{};
+    size_t count;
+    uint16_t current{BlockPool<T>::None};
+
+    Fanout(const Subscription* subscriptions, const size_t count, const Region region = Region::kInternalFast) :
+        pool{Blocks(subscriptions, count), region},
+        count{std::min(count, MaxSubscribers)} {
+        for (size_t i = 0; i < this->count; i++) {
+            subscribers[i].emplace(subscriptions[i], pool, region);
+        }
+    }
+
+    Fanout(const Fanout&) = delete;
+
+    // Producer side: the block being filled, the same one until it is published. nullptr only if a
+    // subscriber holds more than the one block it is allowed to.
+    T* Next() {
+        if (current == BlockPool<T>::None) {
+            current = pool.Acquire();
+        }
+        return current != BlockPool<T>::None ? &pool[current] : nullptr;
+    }
+
+    // Producer side, hands the block from Next() to every subscriber
+    void Publish() {
+        if (current == BlockPool<T>::None) {
+            return;
+        }
+        for (size_t i = 0; i < count; i++) {
+            subscribers[i]->Offer(current);
+        }
+        pool.Release(current);
+        current = BlockPool<T>::None;
+    }
+
+    Subscriber& operator[](const size_t index) { return *subscribers[index]; }
+
+    // One block being filled, every queue full (a kLatest slot holds one) and one more held by each consumer
+    static size_t Blocks(const Subscription* subscriptions, const size_t count) {
+        size_t blocks = 1;
+        for (size_t i = 0; i < std::min(count, MaxSubscribers); i++) {
+            blocks += Subscriber::Capacity(subscriptions[i]) + 1;
+        }
+        return blocks;
+    }
+};
+
+#endif //SAMPLE_FANOUT_HH
@@ -0,0 +1,41 @@
+#ifndef SEQLOCK_HH
+#define SEQLOCK_HH
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// Latest value of something one task writes and others read, on any core. The writer never waits: `sequence` is
+// odd while it copies, and a reader that saw it odd or changed across its own copy copies again. Readers must not
+// run above the writer's priority on its core, or they could spin on a write they preempted.
+template<typename T>
+struct Seqlock {
+    static_assert(std::is_trivially_copyable_v<T>);
+
+    std::atomic<uint32_t> sequence{0};
+    T value{};
+
+    // Writer side, one task only
+    void Write(const T& item) {
+        const uint32_t s = sequence.load(std::memory_order_relaxed);
+        sequence.store(s + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        memcpy(&value, &item, sizeof(T));
+        sequence.store(s + 2, std::memory_order_release);
+    }
+
+    [[nodiscard]] T Read() const {
+        T item;
+        while (true) {
+            const uint32_t before = sequence.load(std::memory_order_acquire);
+            memcpy(&item, &value, sizeof(T));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if ((before & 1) == 0 && sequence.load(std::memory_order_relaxed) == before) {
+                return item;
+            }
+        }
+    }
+};
+
+#endif //SEQLOCK_HH
@@ -2,11 +2,9 @@
 
 #include "point.hh"
 
-SlidingBuffer::SlidingBuffer(const size_t window): window{window}, values{new Point[window * 2]{}} {
-}
-
-SlidingBuffer::~SlidingBuffer() {
-    delete values;
+SlidingBuffer::SlidingBuffer(const size_t window, const Region region):
+    window{window},
+    values{Arenas::Get(region).NewArray<Point>(window * 2)} {
 }
 
 void SlidingBuffer::Push(const Point &value) {
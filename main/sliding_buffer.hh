@@ -3,6 +3,8 @@
 
 #include <cstdlib>
 
+#include "arena.hh"
+
 struct Point;
 
 struct SlidingBuffer {
@@ -11,9 +13,9 @@ struct SlidingBuffer {
     size_t start{0};
     size_t pos{0};
 
-    explicit SlidingBuffer(size_t window);
+    explicit SlidingBuffer(size_t window, Region region = Region::kPsramBulk);
 
-    ~SlidingBuffer();
+    SlidingBuffer(const SlidingBuffer&) = delete;
 
     void Push(const Point& value);
 
@@ -0,0 +1,164 @@
+#include "spectrum.hh"
+
+#include <algorithm>
+#include <cmath>
+
+#include "kernels.hh"
+
+#if __has_include(<dsps_fft2r.h>)
+#include <dsps_fft2r.h>
+#define SPECTRUM_USE_DSP 1
+#else
+#define SPECTRUM_USE_DSP 0
+#endif
+
+namespace {
+    constexpr float Pi = 3.14159265358979f;
+}
+
+Spectrum::Spectrum(const size_t size, const Region region):
+    size{size},
+    window{Arenas::Get(region).NewArray<float>(size)},
+    twiddles{Arenas::Get(region).NewArray<float>(size)},
+    work{Arenas::Get(region).NewArray<float>(size + 2)},
+    magnitude{Arenas::Get(region).NewArray<float>(size / 2 + 1)} {
+    for (size_t i = 0; i < size; i++) {
+        window[i] = 0.5f - 0.5f * cosf(2 * Pi * static_cast<float>(i) / static_cast<float>(size));
+        windowGain += window[i];
+    }
+    // cos/sin pairs of e^(-2*pi*i*k/size) for k < size / 2, shared by the half-size complex FFT
+    // (which uses every other entry) and the real-spectrum split
+    for (size_t k = 0; k < size / 2; k++) {
+        const float angle = -2 * Pi * static_cast<float>(k) / static_cast<float>(size);
+        twiddles[2 * k] = cosf(angle);
+        twiddles[2 * k + 1] = sinf(angle);
+    }
+#if SPECTRUM_USE_DSP
+    static bool dspInitialized = false;
+    if (!dspInitialized) {
+        dspInitialized = dsps_fft2r_init_fc32(nullptr, CONFIG_DSP_MAX_FFT_SIZE) == ESP_OK;
+    }
+#endif
+}
+
+void Spectrum::ComplexFft(float *data, const size_t n) const {
+#if SPECTRUM_USE_DSP
+    dsps_fft2r_fc32(data, static_cast<int>(n));
+    dsps_bit_rev_fc32(data, static_cast<int>(n));
+#else
+    // bit reversal permutation
+    for (size_t i = 1, j = 0; i < n; i++) {
+        size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1) { j ^= bit; }
+        j ^= bit;
+        if (i < j) {
+            std::swap(data[2 * i], data[2 * j]);
+            std::swap(data[2 * i + 1], data[2 * j + 1]);
+        }
+    }
+    // iterative radix-2 butterflies, twiddle stride relative to the full real size
+    for (size_t len = 2; len <= n; len <<= 1) {
+        const size_t stride = 2 * n / len;
+        for (size_t i = 0; i < n; i += len) {
+            for (size_t k = 0; k < len / 2; k++) {
+                const float wr = twiddles[2 * k * stride];
+                const float wi = twiddles[2 * k * stride + 1];
+                float* a = &data[2 * (i + k)];
+                float* b = &data[2 * (i + k + len / 2)];
+                const float tr = b[0] * wr - b[1] * wi;
+                const float ti = b[0] * wi + b[1] * wr;
+                b[0] = a[0] - tr;
+                b[1] = a[1] - ti;
+                a[0] += tr;
+                a[1] += ti;
+            }
+        }
+    }
+#endif
+}
+
+void Spectrum::Compute(const float *samples) {
+    const float mean = kernels::MinMaxSum(samples, size).sum / static_cast<float>(size);
+
+    // even samples go to the real, odd samples to the imaginary part of a half-size complex sequence
+    for (size_t i = 0; i < size; i++) {
+        work[i] = (samples[i] - mean) * window[i];
+    }
+    const size_t half = size / 2;
+    ComplexFft(work, half);
+
+    // split the packed transform into the spectrum of the real input
+    const float scale = 2.0f / windowGain;
+    for (size_t k = 0; k <= half; k++) {
+        const size_t a = k % half;
+        const size_t b = (half - k) % half;
+        const float zr = work[2 * a], zi = work[2 * a + 1];
+        const float cr = work[2 * b], ci = -work[2 * b + 1];
+        const float er = 0.5f * (zr + cr), ei = 0.5f * (zi + ci);
+        const float dr = 0.5f * (zr - cr), di = 0.5f * (zi - ci);
+        // odd part is (d / i) * w^k
+        const float wr = k < half ? twiddles[2 * k] : -1.0f;
+        const float wi = k < half ? twiddles[2 * k + 1] : 0.0f;
+        const float or_ = di * wr + dr * wi;
+        const float oi = di * wi - dr * wr;
+        magnitude[k] = sqrtf((er + or_) * (er + or_) + (ei + oi) * (ei + oi)) * scale;
+    }
+    magnitude[0] *= 0.5f;
+    magnitude[half] *= 0.5f;
+}
+
+RippleReport RippleReport::Analyze(Spectrum &spectrum, const float *samples, const float sampleRate,
+                                   const float threshold) {
+    RippleReport report{};
+    report.sampleRate = sampleRate;
+    const kernels::Summary summary = kernels::MinMaxSum(samples, spectrum.size);
+    report.mean = summary.sum / static_cast<float>(spectrum.size);
+    report.peakToPeak = summary.max - summary.min;
+
+    spectrum.Compute(samples);
+    const float* magnitude = spectrum.magnitude;
+    const size_t bins = spectrum.Bins();
+
+    // median of the bins is robust against the few bins that carry the periodic components
+    float* sorted = spectrum.work;
+    std::copy(magnitude + 1, magnitude + bins, sorted);
+    std::nth_element(sorted, sorted + (bins - 1) / 2, sorted + bins - 1);
+    report.noiseFloor = sorted[(bins - 1) / 2];
+
+    const float binWidth = sampleRate / static_cast<float>(spectrum.size);
+    for (size_t k = 2; k + 1 < bins; k++) {
+        const float m = magnitude[k];
+        if (m <= magnitude[k - 1] || m < magnitude[k + 1] || m < report.noiseFloor * threshold) {
+            continue;
+        }
+        const float left = magnitude[k - 1];
+        const float right = magnitude[k + 1];
+        const float denom = left - 2 * m + right;
+        const float delta = denom != 0 ? 0.5f * (left - right) / denom : 0.0f;
+        const Peak peak{
+            (static_cast<float>(k) + delta) * binWidth,
+            m - 0.25f * (left - right) * delta,
+        };
+        // keep the strongest peaks ordered by amplitude
+        size_t slot = report.peakCount;
+        while (slot > 0 && report.peaks[slot - 1].amplitude < peak.amplitude) {
+            if (slot < MaxPeaks) { report.peaks[slot] = report.peaks[slot - 1]; }
+            slot--;
+        }
+        if (slot < MaxPeaks) {
+            report.peaks[slot] = peak;
+            report.peakCount = std::min(report.peakCount + 1, MaxPeaks);
+        }
+    }
+    return report;
+}
+
+RippleAnalyzer::RippleAnalyzer(const size_t size, const Region region):
+    spectrum{size, region},
+    raw{Arenas::Get(region).NewArray<int16_t>(size)},
+    samples{Arenas::Get(region).NewArray<float>(size)} {
+}
+
+RippleReport RippleAnalyzer::Analyze(const float sampleRate) {
+    return RippleReport::Analyze(spectrum, samples, sampleRate);
+}
@@ -0,0 +1,70 @@
+#ifndef SPECTRUM_HH
+#define SPECTRUM_HH
+
+#include <cstdint>
+#include <cstdlib>
+
+#include "arena.hh"
+
+// Windowed real FFT of a block of samples. Uses the ESP-DSP radix-2 kernels (which pick the
+// ESP32-S3 vector implementation) when the component is available and a portable scalar FFT otherwise.
+struct Spectrum {
+    static constexpr size_t MaxSize = 4096;
+
+    size_t size;
+    float* window;
+    float* twiddles;
+    float* work;
+    float* magnitude;
+    float windowGain{0};
+
+    // `size` must be a power of two between 8 and MaxSize
+    explicit Spectrum(size_t size, Region region = Region::kInternalFast);
+
+    Spectrum(const Spectrum&) = delete;
+
+    // Removes the DC component, applies a Hann window and fills `magnitude` with size / 2 + 1
+    // single-sided amplitudes in the unit of the samples
+    void Compute(const float* samples);
+
+    [[nodiscard]] size_t Bins() const { return size / 2 + 1; }
+
+private:
+    void ComplexFft(float* data, size_t n) const;
+};
+
+// Ripple and noise figures of a block of samples taken at `sampleRate`
+struct RippleReport {
+    static constexpr size_t MaxPeaks = 3;
+
+    struct Peak {
+        float frequency;
+        float amplitude;
+    };
+
+    float sampleRate{0};
+    float mean{0};
+    float peakToPeak{0};
+    float noiseFloor{0};
+    size_t peakCount{0};
+    Peak peaks[MaxPeaks]{};
+
+    // Dominant frequencies are local spectral maxima at least `threshold` times above the noise floor,
+    // refined with parabolic interpolation between neighbouring bins
+    static RippleReport Analyze(Spectrum& spectrum, const float* samples, float sampleRate, float threshold = 4.0f);
+};
+
+// Sample block and spectrum for ripple captures of a single channel
+struct RippleAnalyzer {
+    Spectrum spectrum;
+    int16_t* raw; // register values as read, scaled into `samples`
+    float* samples;
+
+    explicit RippleAnalyzer(size_t size, Region region = Region::kInternalFast);
+
+    RippleAnalyzer(const RippleAnalyzer&) = delete;
+
+    [[nodiscard]] RippleReport Analyze(float sampleRate);
+};
+
+#endif //SPECTRUM_HH
@@ -0,0 +1,63 @@
+#ifndef SPSC_RING_HH
+#define SPSC_RING_HH
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "arena.hh"
+
+// Lock-free ring for one producer and one consumer, which may run on different cores. `head` is only written
+// by the producer and `tail` only by the consumer; a full ring drops the new item instead of waiting.
+template<typename T>
+struct SpscRing {
+    T* items;
+    size_t mask;
+    std::atomic<size_t> head{0};
+    std::atomic<size_t> tail{0};
+    std::atomic<uint32_t> dropped{0};
+
+    // Capacity is rounded up to a power of two
+    explicit SpscRing(size_t capacity, Region region = Region::kInternalFast) :
+        items{nullptr},
+        mask{RoundUp(capacity) - 1} {
+        items = Arenas::Get(region).template NewArray<T>(mask + 1);
+    }
+
+    SpscRing(const SpscRing&) = delete;
+
+    // Producer side
+    bool Push(const T& item) {
+        const size_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) > mask) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        items[h & mask] = item;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side
+    bool Pop(T& item) {
+        const size_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire)) {
+            return false;
+        }
+        item = items[t & mask];
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    [[nodiscard]] size_t Size() const {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    }
+
+    static constexpr size_t RoundUp(const size_t capacity) {
+        size_t size = 1;
+        while (size < capacity) { size <<= 1; }
+        return size;
+    }
+};
+
+#endif //SPSC_RING_HH
@@ -0,0 +1,33 @@
+#include "telemetry.hh"
+
+#include <cstring>
+
+Telemetry::Telemetry(hal::Serial &serial):
+    serial{serial},
+    lock{xSemaphoreCreateMutex()},
+    frame{static_cast<uint8_t*>(Arenas::Get(Region::kInternalDma).Allocate(MaxFrame, 4))} {
+}
+
+bool Telemetry::Send(const FrameType type, const void *payload, const size_t length) {
+    if (length > MaxPayload) {
+        return false;
+    }
+    xSemaphoreTake(lock, portMAX_DELAY);
+    FrameHeader header{{Sync0, Sync1}, static_cast<uint8_t>(type), seq++, static_cast<uint16_t>(length)};
+    memcpy(frame, &header, sizeof(header));
+    memcpy(frame + sizeof(header), payload, length);
+    const uint16_t crc = Crc16(frame + 2, sizeof(header) - 2 + length);
+    memcpy(frame + sizeof(header) + length, &crc, sizeof(crc));
+
+    const size_t size = sizeof(header) + length + sizeof(crc);
+    const size_t written = serial.Write(frame, size, 0);
+    sentBytes += written;
+    const bool sent = written == size;
+    if (sent) {
+        sentFrames++;
+    } else {
+        droppedFrames++;
+    }
+    xSemaphoreGive(lock);
+    return sent;
+}
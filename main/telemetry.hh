@@ -0,0 +1,135 @@
+#ifndef TELEMETRY_HH
+#define TELEMETRY_HH
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+#include "arena.hh"
+#include "hal_serial.hh"
+
+// Binary frames on the serial link:
+//   0xA5 0x5A | type:u8 | seq:u8 | length:u16 | payload[length] | crc16:u16
+// Multi-byte fields are little-endian, the CRC is CRC-16/CCITT-FALSE over type..payload.
+enum class FrameType : uint8_t {
+    kSamples = 0x01,
+    kRipple = 0x02,
+    kAligned = 0x03,
+    kMirror = 0x04,
+    kRate = 0x05,
+    kEvent = 0x06,
+    kCommand = 0x10,
+    kResponse = 0x11,
+    kStats = 0x12,
+};
+
+struct __attribute__((packed)) FrameHeader {
+    uint8_t sync[2];
+    uint8_t type;
+    uint8_t seq;
+    uint16_t length;
+};
+
+// kSamples payload: this header, then one Packet (voltage, current, power) per set bit of `channels`,
+// lowest channel first. Each I2C bus is sampled by its own task and sends its own frames.
+// Times are the low 32 bits of the esp_timer microsecond clock.
+struct __attribute__((packed)) SamplesHeader {
+    uint8_t bus;
+    uint8_t reserved;
+    uint16_t channels; // bit per channel
+    uint32_t timeUs; // current register read of the first channel
+    uint32_t skewUs; // between the current register reads of the first and the last channel
+};
+
+// kAligned payload: this header, then one Packet per set bit of `channels` interpolated to `timeUs`.
+// Instants lie on a grid of `periodUs` and are shared by all channels, whatever bus they are on.
+struct __attribute__((packed)) AlignedHeader {
+    uint32_t timeUs;
+    uint32_t periodUs;
+    uint16_t channels;
+    uint16_t reserved;
+};
+
+// kRate payload: from `timeUs` on, `channel` is read every `periodUs`. Quiet channels are read at the base
+// period and active ones faster, so kSamples frames of a bus carry whichever of its channels were due.
+struct __attribute__((packed)) RatePacket {
+    uint8_t channel;
+    uint8_t reason; // RateController::Reason
+    uint16_t reserved;
+    uint32_t timeUs;
+    uint32_t periodUs;
+};
+
+// kEvent payload: the current of `channel` changed level at `timeUs`, ending a segment of steady load
+struct __attribute__((packed)) EventPacket {
+    uint8_t channel;
+    uint8_t kind; // LoadEvent::Kind
+    uint16_t reserved;
+    uint32_t timeUs; // estimated change point
+    uint32_t delayUs; // until the change was confirmed
+    int32_t beforeUa; // mean of the ended segment
+    int32_t afterUa; // mean of the new segment so far
+    uint32_t durationMs; // of the ended segment
+    float energy; // J drawn during the ended segment
+};
+
+struct __attribute__((packed)) RipplePacket {
+    uint8_t channel;
+    uint8_t peakCount;
+    uint16_t size;
+    float sampleRate;
+    float mean;
+    float peakToPeak;
+    float noiseFloor;
+    float frequency[3];
+    float amplitude[3];
+};
+
+// CRC-16/CCITT-FALSE one byte at a time, in the header so the host tools frame and check with the same code
+namespace crc16 {
+    constexpr std::array<uint16_t, 256> MakeTable() {
+        std::array<uint16_t, 256> table{};
+        for (uint16_t i = 0; i < 256; i++) {
+            uint16_t crc = i << 8;
+            for (int bit = 0; bit < 8; bit++) {
+                crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+            }
+            table[i] = crc;
+        }
+        return table;
+    }
+
+    inline constexpr auto Table = MakeTable();
+}
+
+struct Telemetry {
+    static constexpr uint8_t Sync0 = 0xA5;
+    static constexpr uint8_t Sync1 = 0x5A;
+    static constexpr size_t MaxPayload = 1024;
+    static constexpr size_t MaxFrame = sizeof(FrameHeader) + MaxPayload + sizeof(uint16_t);
+
+    hal::Serial& serial;
+    SemaphoreHandle_t lock;
+    uint8_t seq{0};
+    uint8_t* frame;
+
+    uint64_t sentBytes{0};
+    uint32_t sentFrames{0};
+    uint32_t droppedFrames{0};
+
+    explicit Telemetry(hal::Serial& serial);
+
+    // Never blocks on the link: a frame that does not fit into the transmit buffer is dropped and counted
+    bool Send(FrameType type, const void* payload, size_t length);
+
+    [[nodiscard]] static constexpr uint16_t Crc16(const uint8_t* data, size_t size, uint16_t crc = 0xFFFF) {
+        while (size-- > 0) {
+            crc = (crc << 8) ^ crc16::Table[(crc >> 8) ^ *data++];
+        }
+        return crc;
+    }
+};
+
+#endif //TELEMETRY_HH
@@ -2,19 +2,24 @@
 #define WORKER_TASK_HH
 
 #include <freertos/FreeRTOS.h>
-#include <functional>
+#include <freertos/task.h>
 
+// Runs `work` in a loop on its own task. Must outlive the task, so keep it as a member of `param`.
 template<typename T>
 struct WorkerTask {
-    std::function<void(T&)> work;
+    void (*work)(T&);
     T* param;
+    TaskHandle_t handle{};
 
-    explicit WorkerTask(std::function<void(T&)> work, T& param) : work{std::move(work)}, param{&param} {
-        xTaskCreate([](void* arg) {
+    explicit WorkerTask(void (*work)(T&), T& param, const char* name = "Worker", BaseType_t core = tskNO_AFFINITY,
+                        UBaseType_t priority = 5) : work{work}, param{&param} {
+        xTaskCreatePinnedToCore([](void* arg) {
             auto& task = *static_cast<WorkerTask*>(arg);
             while (true) { task.work(*task.param); }
-        }, "Worker", 4096, this, 5, nullptr);
+        }, name, 4096, this, priority, &handle, core);
     }
+
+    WorkerTask(const WorkerTask&) = delete;
 };
 
 #endif //WORKER_TASK_HH
@@ -0,0 +1,157 @@
+#!/usr/bin/env python3
+
+import os
+import time
+import select
+import itertools
+
+import telemetry
+from telemetry import FrameType, Opcode, Status
+
+
+class CommandError(Exception):
+    def __init__(self, opcode, status):
+        super().__init__('%s failed: %s' % (opcode.name, status.name))
+        self.opcode = opcode
+        self.status = status
+
+
+class MeterClient:
+    """Remote control of a tinyMeter over its serial link.
+
+    Requests are sent as command frames and matched to responses by id, telemetry frames and log lines
+    received in the meantime are handed to the optional callbacks instead of being dropped."""
+
+    def __init__(self, port, on_frame=None, on_text=None):
+        self.fd = telemetry.open_port(port)
+        self.decoder = telemetry.Decoder()
+        self.ids = itertools.count(1)
+        self.seq = itertools.count()
+        self.on_frame = on_frame
+        self.on_text = on_text
+        self.stats = None
+        self.latencies = []
+
+    def close(self):
+        os.close(self.fd)
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *args):
+        self.close()
+
+    def poll(self, timeout):
+        ready, _, _ = select.select([self.fd], [], [], timeout)
+        if not ready:
+            return []
+        try:
+            data = os.read(self.fd, 65536)
+        except BlockingIOError:
+            return []
+        items = self.decoder.feed(data)
+        for item in items:
+            if item[0] == 'text':
+                if self.on_text is not None:
+                    self.on_text(item[1])
+            elif item[1] == FrameType.STATS:
+                self.stats = dict(zip(STATS_FIELDS, telemetry.STATS.unpack(item[3])))
+            elif self.on_frame is not None and item[1] != FrameType.RESPONSE:
+                self.on_frame(item[1], item[2], item[3])
+        return items
+
+    def request(self, opcode, channel=0, value=0, timeout=2.0):
+        """Sends a command and waits for its response, returns (device latency us, round trip s)"""
+        command_id = next(self.ids) & 0xffff
+        payload = telemetry.COMMAND.pack(command_id, int(opcode), channel, value)
+        started = time.monotonic()
+        os.write(self.fd, telemetry.encode(FrameType.COMMAND, next(self.seq), payload))
+        deadline = started + timeout
+        while time.monotonic() < deadline:
+            for item in self.poll(deadline - time.monotonic()):
+                if item[0] != 'frame' or item[1] != FrameType.RESPONSE:
+                    continue
+                response_id, _, status, latency, _ = telemetry.RESPONSE.unpack(item[3])
+                if response_id != command_id:
+                    continue
+                if status != Status.OK:
+                    raise CommandError(Opcode(opcode), Status(status))
+                self.latencies.append(latency)
+                return latency, time.monotonic() - started
+        raise TimeoutError('no response to %s' % Opcode(opcode).name)
+
+    def ping(self):
+        return self.request(Opcode.PING)
+
+    def enable(self, channel):
+        return self.request(Opcode.ENABLE, channel)
+
+    def disable(self, channel):
+        return self.request(Opcode.DISABLE, channel)
+
+    def set_sample_period(self, microseconds):
+        return self.request(Opcode.SET_SAMPLE_PERIOD, value=microseconds)
+
+    def set_ina_config(self, channel, config):
+        return self.request(Opcode.SET_INA_CONFIG, channel, config)
+
+    def stream(self, on):
+        return self.request(Opcode.STREAM_START if on else Opcode.STREAM_STOP)
+
+    def capture_ripple(self, channel):
+        return self.request(Opcode.CAPTURE_RIPPLE, channel, timeout=5.0)
+
+    def set_align_period(self, microseconds):
+        return self.request(Opcode.SET_ALIGN_PERIOD, value=microseconds)
+
+    def set_mirror_budget(self, bytes_per_second):
+        return self.request(Opcode.SET_MIRROR_BUDGET, value=bytes_per_second)
+
+    def set_read_mode(self, channel, derived):
+        return self.request(Opcode.SET_READ_MODE, channel, 1 if derived else 0)
+
+    def set_fast_period(self, microseconds):
+        return self.request(Opcode.SET_FAST_PERIOD, value=microseconds)
+
+    def query_stats(self):
+        self.stats = None
+        self.request(Opcode.QUERY_STATS)
+        return self.stats
+
+
+STATS_FIELDS = ('uptime_ms', 'sent_frames', 'dropped_frames', 'crc_errors', 'commands', 'latency_min_us',
+                'latency_max_us', 'latency_avg_us', 'sample_period_us', 'streaming', 'channels', 'enabled')
+
+
+if __name__ == '__main__':
+    import argparse
+
+    parser = argparse.ArgumentParser()
+    parser.add_argument('port')
+    parser.add_argument('command', choices=['ping', 'enable', 'disable', 'period', 'config', 'stream',
+                                            'ripple', 'align', 'mirror', 'mode', 'fast', 'stats'])
+    parser.add_argument('args', nargs='*', type=lambda v: int(v, 0))
+    parser.add_argument('--count', default=1, type=int, help='repeat and report latency')
+    args = parser.parse_args()
+    with MeterClient(args.port) as client:
+        calls = {
+            'ping': lambda: client.ping(),
+            'enable': lambda: client.enable(*args.args),
+            'disable': lambda: client.disable(*args.args),
+            'period': lambda: client.set_sample_period(*args.args),
+            'config': lambda: client.set_ina_config(*args.args),
+            'stream': lambda: client.stream(*args.args),
+            'ripple': lambda: client.capture_ripple(*args.args),
+            'align': lambda: client.set_align_period(*args.args),
+            'mirror': lambda: client.set_mirror_budget(*args.args),
+            'mode': lambda: client.set_read_mode(*args.args),
+            'fast': lambda: client.set_fast_period(*args.args),
+            'stats': lambda: client.query_stats(),
+        }
+        for _ in range(args.count):
+            result = calls[args.command]()
+            print(result)
+        if args.count > 1:
+            latencies = sorted(client.latencies)
+            print('device latency min:%dus p50:%dus max:%dus' % (
+                latencies[0], latencies[len(latencies) // 2], latencies[-1]))
@@ -0,0 +1,125 @@
+#!/usr/bin/env python3
+
+import os
+import sys
+import time
+import struct
+
+import telemetry
+from telemetry import FrameType
+from meter_client import MeterClient
+
+OP_SKIP = 0x00
+OP_RUN = 0x40
+OP_LITERAL = 0x80
+PIXEL = struct.Struct('<H')
+
+
+class Screen:
+    """Rebuilds the device screen from MIRROR frames, pixels are kept as RGB565"""
+
+    def __init__(self, width=0, height=0):
+        self.width = width
+        self.height = height
+        self.pixels = [0] * (width * height)
+        self.frames = 0
+        self.errors = 0
+
+    def apply(self, payload):
+        screen_width, screen_height, x, y, width, rows = telemetry.MIRROR_HEADER.unpack_from(payload)
+        if (screen_width, screen_height) != (self.width, self.height):
+            self.__init__(screen_width, screen_height)
+        if x + width > self.width or y + rows > self.height:
+            self.errors += 1
+            return False
+        pos = telemetry.MIRROR_HEADER.size
+        for row in range(rows):
+            pos = self.decode_row(payload, pos, (y + row) * self.width + x, width)
+            if pos is None:
+                self.errors += 1
+                return False
+        self.frames += 1
+        return True
+
+    def decode_row(self, payload, pos, offset, count):
+        end = offset + count
+        while offset < end:
+            if pos >= len(payload):
+                return None
+            token = payload[pos]
+            pos += 1
+            op, n = token & 0xc0, (token & 0x3f) + 1
+            if offset + n > end:
+                return None
+            if op == OP_SKIP:
+                pass
+            elif op == OP_RUN:
+                if pos + 2 > len(payload):
+                    return None
+                pixel, = PIXEL.unpack_from(payload, pos)
+                pos += 2
+                self.pixels[offset:offset + n] = [pixel] * n
+            elif op == OP_LITERAL:
+                if pos + 2 * n > len(payload):
+                    return None
+                self.pixels[offset:offset + n] = struct.unpack_from('<%dH' % n, payload, pos)
+                pos += 2 * n
+            else:
+                return None
+            offset += n
+        return pos
+
+    def rgb(self):
+        out = bytearray(self.width * self.height * 3)
+        for i, pixel in enumerate(self.pixels):
+            r, g, b = pixel >> 11, (pixel >> 5) & 0x3f, pixel & 0x1f
+            out[3 * i:3 * i + 3] = bytes(((r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2)))
+        return bytes(out)
+
+    def save_ppm(self, path):
+        with open(path + '.tmp', 'wb') as f:
+            f.write(b'P6\n%d %d\n255\n' % (self.width, self.height))
+            f.write(self.rgb())
+        os.replace(path + '.tmp', path)
+
+
+def main():
+    import argparse
+
+    parser = argparse.ArgumentParser(description='Mirror the device screen into a PPM file')
+    parser.add_argument('port')
+    parser.add_argument('output', help='PPM snapshot, rewritten every --interval seconds')
+    parser.add_argument('--budget', type=int, default=100000, help='bytes per second the device may spend')
+    parser.add_argument('--interval', type=float, default=0.5)
+    args = parser.parse_args()
+
+    screen = Screen()
+    received = [0]
+
+    def on_frame(frame_type, seq, payload):
+        if frame_type == FrameType.MIRROR:
+            received[0] += len(payload)
+            screen.apply(payload)
+
+    with MeterClient(args.port, on_frame=on_frame) as client:
+        client.set_mirror_budget(args.budget)
+        last = time.monotonic()
+        try:
+            while True:
+                client.poll(0.05)
+                now = time.monotonic()
+                if now - last >= args.interval and screen.width:
+                    screen.save_ppm(args.output)
+                    sys.stderr.write('\r%d frames %.1f kB/s errors:%d ' % (
+                        screen.frames, received[0] / (now - last) / 1000, screen.errors))
+                    received[0] = 0
+                    last = now
+        except KeyboardInterrupt:
+            pass
+        finally:
+            client.set_mirror_budget(0)
+            sys.stderr.write('\n')
+
+
+if __name__ == '__main__':
+    main()
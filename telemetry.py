@@ -0,0 +1,176 @@
+#!/usr/bin/env python3
+
+# Frame format shared with main/telemetry.hh:
+#   0xA5 0x5A | type:u8 | seq:u8 | length:u16 | payload[length] | crc16:u16  (little-endian)
+# The CRC is CRC-16/CCITT-FALSE over type..payload.
+
+import os
+import enum
+import struct
+import termios
+import binascii
+
+SYNC = b'\xa5\x5a'
+HEADER = struct.Struct('<2sBBH')
+CRC = struct.Struct('<H')
+MAX_PAYLOAD = 1024
+
+
+class FrameType(enum.IntEnum):
+    SAMPLES = 0x01
+    RIPPLE = 0x02
+    ALIGNED = 0x03
+    MIRROR = 0x04
+    RATE = 0x05
+    EVENT = 0x06
+    COMMAND = 0x10
+    RESPONSE = 0x11
+    STATS = 0x12
+
+
+class Opcode(enum.IntEnum):
+    PING = 0x00
+    ENABLE = 0x01
+    DISABLE = 0x02
+    SET_SAMPLE_PERIOD = 0x03
+    SET_INA_CONFIG = 0x04
+    STREAM_START = 0x05
+    STREAM_STOP = 0x06
+    CAPTURE_RIPPLE = 0x07
+    QUERY_STATS = 0x08
+    SET_ALIGN_PERIOD = 0x09
+    SET_MIRROR_BUDGET = 0x0A
+    SET_READ_MODE = 0x0B
+    SET_FAST_PERIOD = 0x0C
+
+
+class Status(enum.IntEnum):
+    OK = 0x00
+    BAD_CHANNEL = 0x01
+    BAD_VALUE = 0x02
+    UNKNOWN_OPCODE = 0x03
+    BUSY = 0x04
+
+
+class RateReason(enum.IntEnum):
+    DECAY = 0
+    STEP = 1
+    VARIANCE = 2
+    ENABLE = 3
+    BUDGET = 4
+    CONFIG = 5
+
+
+class EventKind(enum.IntEnum):
+    PLUG_IN = 1
+    IDLE = 2
+    RISE = 3
+    FALL = 4
+    INRUSH = 5
+
+
+SAMPLES_HEADER = struct.Struct('<BBHII')
+ALIGNED_HEADER = struct.Struct('<IIHH')
+MIRROR_HEADER = struct.Struct('<6H')
+RATE = struct.Struct('<BBHII')
+EVENT = struct.Struct('<BBHIIiiIf')
+SAMPLE = struct.Struct('<iiI')
+COMMAND = struct.Struct('<HBBI')
+RESPONSE = struct.Struct('<HBBII')
+STATS = struct.Struct('<9IBBH')
+RIPPLE = struct.Struct('<BBH4f3f3f')
+
+
+def crc16(data, crc=0xffff):
+    # binascii implements the same CCITT polynomial, non-reflected, in C
+    return binascii.crc_hqx(data, crc)
+
+
+def open_port(port):
+    """Opens a serial device (or pty) raw and non-blocking, returns the file descriptor"""
+    fd = os.open(port, os.O_RDWR | os.O_NOCTTY | os.O_NONBLOCK)
+    if os.isatty(fd):
+        attrs = termios.tcgetattr(fd)
+        attrs[0] = attrs[1] = attrs[3] = 0
+        attrs[2] = termios.CS8 | termios.CREAD | termios.CLOCAL
+        attrs[6][termios.VMIN] = 0
+        attrs[6][termios.VTIME] = 0
+        termios.tcsetattr(fd, termios.TCSANOW, attrs)
+    return fd
+
+
+def encode(frame_type, seq, payload):
+    header = HEADER.pack(SYNC, int(frame_type), seq & 0xff, len(payload))
+    return header + payload + CRC.pack(crc16(header[2:] + payload))
+
+
+def samples(payload, header=SAMPLES_HEADER):
+    """Yields (channel, (voltage_uv, current_ua, power_uw)) from a SAMPLES or, with ALIGNED_HEADER, an
+    ALIGNED payload"""
+    channels = header.unpack_from(payload)[2]
+    values = SAMPLE.iter_unpack(payload[header.size:])
+    for channel in range(16):
+        if channels & (1 << channel):
+            yield channel, next(values)
+
+
+class Decoder:
+    """Splits a byte stream into frames and the text that surrounds them.
+
+    feed() returns a list of ('frame', type, seq, payload) and ('text', line) items. Bytes that look like
+    a frame start but fail the CRC are counted and handed back as text."""
+
+    def __init__(self):
+        self.buffer = bytearray()
+        self.frames = 0
+        self.crc_errors = 0
+        self.lost = 0
+        self.last_seq = None
+
+    def feed(self, data):
+        self.buffer += data
+        items = []
+        buffer = self.buffer
+        pos = 0
+        while True:
+            start = buffer.find(SYNC, pos)
+            newline = buffer.find(b'\n', pos)
+            if newline >= 0 and (start < 0 or newline < start):
+                items.append(('text', bytes(buffer[pos:newline + 1])))
+                pos = newline + 1
+                continue
+            if start < 0:
+                # keep a trailing 0xA5, it may be the first half of the next sync
+                keep = len(buffer) - 1 if buffer.endswith(SYNC[:1]) else len(buffer)
+                if keep > pos and newline < 0 and len(buffer) - pos > 4096:
+                    items.append(('text', bytes(buffer[pos:keep])))
+                    pos = keep
+                break
+            if start > pos:
+                items.append(('text', bytes(buffer[pos:start])))
+                pos = start
+            if len(buffer) - start < HEADER.size:
+                break
+            _, frame_type, seq, length = HEADER.unpack_from(buffer, start)
+            end = start + HEADER.size + length + CRC.size
+            if length > MAX_PAYLOAD:
+                self.crc_errors += 1
+                items.append(('text', bytes(buffer[start:start + 1])))
+                pos = start + 1
+                continue
+            if len(buffer) < end:
+                break
+            (crc,) = CRC.unpack_from(buffer, end - CRC.size)
+            if crc != crc16(buffer[start + 2:end - CRC.size]):
+                self.crc_errors += 1
+                items.append(('text', bytes(buffer[start:start + 1])))
+                pos = start + 1
+                continue
+            if self.last_seq is not None:
+                self.lost += (seq - self.last_seq - 1) & 0xff
+            self.last_seq = seq
+            self.frames += 1
+            items.append(('frame', frame_type, seq, bytes(buffer[start + HEADER.size:end - CRC.size])))
+            pos = end
+        del buffer[:pos]
+        return items
@@ -0,0 +1,182 @@
+#include <algorithm>
+#include <random>
+
+#include "adaptive_rate.hh"
+#include "check.hh"
+#include "resampler.hh"
+
+namespace {
+    constexpr uint32_t BaseUs = 50000;
+    constexpr uint32_t FastUs = 5000;
+
+    using Reason = RateController::Reason;
+
+    // Feeds `current` at the controller's own period until `untilUs`, returns false if the period changed
+    bool Quiet(RateController& rate, int64_t& nowUs, const int64_t untilUs, std::mt19937& rng, const float current) {
+        std::uniform_real_distribution<float> noise{-0.001f, 0.001f};
+        bool unchanged = true;
+        while (nowUs < untilUs) {
+            nowUs += rate.periodUs;
+            unchanged &= !rate.Update(current + noise(rng), true, nowUs);
+        }
+        return unchanged;
+    }
+
+    void Controller() {
+        std::mt19937 rng{1};
+        RateController rate;
+        CHECK(rate.Configure(BaseUs, FastUs) && rate.periodUs == BaseUs && rate.reason == Reason::kConfig);
+        int64_t nowUs = 0;
+        // enabling the channel reads it fast right away
+        CHECK(rate.Update(0.1f, true, nowUs) && rate.periodUs == FastUs && rate.reason == Reason::kEnable);
+        // then the period doubles after every HoldUs of quiet until it is back at the base
+        for (const uint32_t period : {10000u, 20000u, 40000u, BaseUs}) {
+            const int64_t from = nowUs;
+            while (!rate.Update(0.1f, true, nowUs += rate.periodUs)) {
+                if (nowUs - from > 2 * RateController::HoldUs) {
+                    break;
+                }
+            }
+            CHECK(rate.periodUs == period && rate.reason == Reason::kDecay);
+            CHECK(nowUs - from >= RateController::HoldUs && nowUs - from < RateController::HoldUs + period);
+        }
+        // noise within the deadband never counts as activity
+        CHECK(Quiet(rate, nowUs, nowUs + 5000000, rng, 0.1f));
+        // a step in load does, in either direction
+        CHECK(rate.Update(0.3f, true, nowUs += rate.periodUs) && rate.periodUs == FastUs);
+        CHECK(rate.reason == Reason::kStep);
+        // the new level is followed at once, readings of it are quiet
+        CHECK(!rate.Update(0.3f, true, nowUs += rate.periodUs));
+        CHECK(Quiet(rate, nowUs, nowUs + RateController::HoldUs - 2 * FastUs, rng, 0.3f));
+        CHECK(rate.periodUs == FastUs);
+        CHECK(!Quiet(rate, nowUs, nowUs + 4 * RateController::HoldUs, rng, 0.3f) && rate.periodUs > FastUs);
+        Quiet(rate, nowUs, nowUs + 5000000, rng, 0.3f);
+        CHECK(rate.Update(0.05f, true, nowUs += rate.periodUs) && rate.reason == Reason::kStep);
+
+        // a fast period at or above the base turns the adaptive rate off
+        RateController fixed;
+        fixed.Configure(BaseUs, BaseUs);
+        CHECK(fixed.fastPeriodUs == 0);
+        CHECK(!fixed.Update(0.0f, true, 0) && !fixed.Update(1.0f, true, BaseUs) && fixed.periodUs == BaseUs);
+        // a shorter base period pulls a quiet channel down to it, a longer fast one lifts an active channel
+        RateController quiet;
+        quiet.Configure(BaseUs, FastUs);
+        CHECK(quiet.Configure(20000, FastUs) && quiet.periodUs == 20000 && quiet.reason == Reason::kConfig);
+        CHECK(!quiet.Configure(20000, 10000));
+        CHECK(rate.Configure(BaseUs, 8000) && rate.periodUs == 8000);
+    }
+
+    // 8 channels on a bus, every reading two transactions of ~250us. Whatever mix of quiet and active
+    // channels asks, the grants never exceed the capacity and never stretch a quiet channel further from an
+    // active one than the resampler can bridge.
+    void Budget() {
+        std::mt19937 rng{2};
+        constexpr size_t Count = 8;
+        uint32_t requested[Count];
+        float costUs[Count];
+        uint32_t granted[Count];
+        bool fits = true;
+        bool neverShorter = true;
+        bool quietKept = true;
+        bool bridged = true;
+        size_t stretched = 0;
+        for (int trial = 0; trial < 100000; trial++) {
+            const uint32_t fast = 1000 + rng() % 20000;
+            const uint32_t base = std::min<uint32_t>(fast * (1 + rng() % Resampler::MaxPeriodRatio), 10000000);
+            for (size_t i = 0; i < Count; i++) {
+                requested[i] = rng() % 3 == 0 ? fast : base;
+                // derived readings or all three registers, on a 400kHz or a slower bus
+                costUs[i] = static_cast<float>(150 + rng() % 300);
+            }
+            RateBudget::Allocate(requested, costUs, Count, granted);
+            const float utilisation = RateBudget::Utilisation(granted, costUs, Count);
+            const bool over = RateBudget::Utilisation(requested, costUs, Count) > RateBudget::Capacity;
+            stretched += over;
+            fits &= !over || utilisation <= RateBudget::Capacity * 1.0001f;
+            const auto [shortest, longest] = std::minmax_element(granted, granted + Count);
+            for (size_t i = 0; i < Count; i++) {
+                neverShorter &= granted[i] >= requested[i];
+                quietKept &= over || granted[i] == requested[i];
+            }
+            bridged &= Resampler::PeriodsFit(*longest, *shortest);
+        }
+        printf("%zu of 100000 requests over the bus capacity\n", stretched);
+        CHECK(stretched > 1000);
+        CHECK(fits);
+        CHECK(neverShorter);
+        CHECK(quietKept);
+        CHECK(bridged);
+    }
+
+    // Aligned instants produced while a quiet channel is read every `baseUs` and an active one every `fastUs`,
+    // out of step by a few hundred microseconds
+    size_t Aligned(const uint32_t baseUs, const uint32_t fastUs, const int64_t durationUs) {
+        Resampler resampler{0b11};
+        resampler.SetPeriod(fastUs);
+        Packet out[2];
+        size_t outputs = 0;
+        for (int64_t t = 0; t < durationUs; t += fastUs) {
+            resampler.Push(0, {static_cast<int32_t>(t), 0, 0}, {t, t, t});
+            if (t % baseUs == 0) {
+                const int64_t slow = t + 300;
+                resampler.Push(1, {static_cast<int32_t>(slow), 0, 0}, {slow, slow, slow});
+            }
+            int64_t timeUs;
+            while (resampler.Next(timeUs, out)) {
+                outputs++;
+            }
+        }
+        return outputs;
+    }
+
+    void Ratio() {
+        constexpr int64_t DurationUs = 10000000;
+        CHECK(Resampler::PeriodsFit(BaseUs, FastUs));
+        CHECK(Resampler::PeriodsFit(BaseUs, 0) && Resampler::PeriodsFit(BaseUs, BaseUs * 2));
+        CHECK(!Resampler::PeriodsFit(BaseUs, 1000));
+        CHECK(Resampler::PeriodsFit(10000000, 1000000) && !Resampler::PeriodsFit(10000000, 999999));
+        // every instant up to the last quiet reading comes out at the largest ratio accepted
+        const uint32_t fastest = BaseUs / Resampler::MaxPeriodRatio;
+        const size_t atBound = Aligned(BaseUs, fastest, DurationUs);
+        CHECK(atBound >= (DurationUs - BaseUs) / fastest);
+        // beyond it the active channel's history no longer reaches back to the quiet one's older reading and most
+        // instants between two quiet readings are skipped
+        const size_t beyond = Aligned(BaseUs, 1000, DurationUs);
+        printf("aligned instants at 1:%lu: %zu of %lld, at 1:50: %zu of %lld\n",
+            static_cast<unsigned long>(Resampler::MaxPeriodRatio), atBound,
+            static_cast<long long>(DurationUs / fastest), beyond, static_cast<long long>(DurationUs / 1000));
+        CHECK(beyond < DurationUs / 1000 / 2);
+    }
+
+    void Benchmark() {
+        std::mt19937 rng{3};
+        std::normal_distribution<float> noise{0.1f, 0.002f};
+        float readings[4096];
+        for (float& reading : readings) {
+            reading = noise(rng);
+        }
+        RateController rate;
+        rate.Configure(BaseUs, FastUs);
+        size_t changes = 0;
+        const double updateNs = check::NsPer(10000000, [&](const size_t i) {
+            changes += rate.Update(readings[i % 4096], true, static_cast<int64_t>(i) * FastUs);
+        });
+        uint32_t requested[8] = {FastUs, BaseUs, FastUs, BaseUs, BaseUs, BaseUs, FastUs, BaseUs};
+        float costUs[8] = {600, 600, 600, 600, 600, 600, 600, 600};
+        uint32_t granted[8];
+        const double allocateNs = check::NsPer(1000000, [&](const size_t i) {
+            requested[i % 8] = i % 3 == 0 ? FastUs : BaseUs;
+            RateBudget::Allocate(requested, costUs, 8, granted);
+        });
+        printf("RateController::Update %.1f ns per reading (%zu changes), RateBudget::Allocate %.1f ns for 8 "
+            "channels\n", updateNs, changes, allocateNs);
+    }
+}
+
+int main() {
+    Controller();
+    Budget();
+    Ratio();
+    Benchmark();
+    return check::Result();
+}
@@ -0,0 +1,183 @@
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include <esp_heap_caps.h>
+#include <freertos/task.h>
+
+#include "arena.hh"
+#include "check.hh"
+
+namespace {
+    struct Counted {
+        uint32_t value{7};
+        uint8_t tag{3};
+    };
+
+    void BumpAllocation() {
+        Arena arena{"test", MALLOC_CAP_8BIT, 256};
+        CHECK(arena.Reserve());
+        auto* a = static_cast<uint8_t*>(arena.Allocate(3, 1));
+        auto* b = static_cast<uint8_t*>(arena.Allocate(8, 8));
+        auto* c = static_cast<uint8_t*>(arena.Allocate(16, 16));
+        CHECK(a == arena.base);
+        CHECK(b == arena.base + 8 && c == arena.base + 16); // padded up to each alignment
+        CHECK(arena.used == 32 && arena.fallbacks == 0);
+
+        Counted* items = arena.NewArray<Counted>(4);
+        CHECK(reinterpret_cast<uintptr_t>(items) % alignof(Counted) == 0);
+        CHECK(items[0].value == 7 && items[3].tag == 3); // constructed, not just carved out
+    }
+
+    void Exhaustion() {
+        Arena arena{"small", MALLOC_CAP_8BIT, 64};
+        CHECK(arena.Reserve());
+        CHECK(arena.Allocate(60) == arena.base);
+        // what does not fit still works, from the heap, and is counted for the report
+        auto* spill = static_cast<uint8_t*>(arena.Allocate(100, 16));
+        CHECK(spill != nullptr && (spill < arena.base || spill >= arena.base + arena.capacity));
+        CHECK(reinterpret_cast<uintptr_t>(spill) % 16 == 0);
+        CHECK(arena.fallbacks == 1 && arena.fallbackBytes == 100 && arena.used == 60);
+        CHECK(arena.Allocate(4, 4) == arena.base + 60); // the tail is still handed out
+        heap_caps_free(spill);
+    }
+
+    struct Stage {
+        Arena* arena;
+        const std::atomic<bool>* go;
+        uint8_t id;
+        size_t count;
+        std::vector<std::pair<uint8_t*, size_t>> blocks{};
+        bool intact{true};
+        std::atomic<bool> done{false};
+    };
+
+    // `count` allocations of 1 to 24 bytes at alignments up to 8 by each of four tasks on both cores at once.
+    // Returns the number that came from the heap after checking no two blocks overlap.
+    size_t Concurrent(Arena& arena, const size_t count) {
+        constexpr size_t Stages = 4;
+        std::atomic<bool> go{false};
+        Stage stages[Stages];
+        for (uint8_t id = 0; id < Stages; id++) {
+            stages[id].arena = &arena;
+            stages[id].go = &go;
+            stages[id].id = id;
+            stages[id].count = count;
+            xTaskCreatePinnedToCore([](void* arg) {
+                auto& stage = *static_cast<Stage*>(arg);
+                stage.blocks.reserve(stage.count);
+                while (!*stage.go) {
+                    std::this_thread::yield();
+                }
+                for (size_t i = 0; i < stage.count; i++) {
+                    const size_t size = 1 + (i * 7 + stage.id) % 24;
+                    const size_t align = size_t{1} << (i + stage.id) % 4;
+                    auto* block = static_cast<uint8_t*>(stage.arena->Allocate(size, align));
+                    stage.intact &= block != nullptr && reinterpret_cast<uintptr_t>(block) % align == 0;
+                    memset(block, stage.id + 1, size);
+                    stage.blocks.emplace_back(block, size);
+                    if (i % 64 == 0) {
+                        std::this_thread::yield();
+                    }
+                }
+                // nobody wrote over what this stage was given
+                for (const auto& [block, size] : stage.blocks) {
+                    stage.intact &= std::all_of(block, block + size, [&](uint8_t b) { return b == stage.id + 1; });
+                }
+                stage.done = true;
+                vTaskDelete(nullptr);
+            }, "Stage", 4096, &stages[id], 5, nullptr, id % 2);
+        }
+        go = true;
+        for (const Stage& stage : stages) {
+            while (!stage.done) {
+                vTaskDelay(1);
+            }
+        }
+        std::vector<std::pair<uint8_t*, size_t>> inside;
+        size_t spilled = 0;
+        size_t spilledBytes = 0;
+        for (Stage& stage : stages) {
+            CHECK(stage.intact);
+            for (const auto& block : stage.blocks) {
+                if (block.first >= arena.base && block.first < arena.base + arena.capacity) {
+                    inside.push_back(block);
+                } else {
+                    spilled++;
+                    spilledBytes += block.second;
+                    heap_caps_free(block.first);
+                }
+            }
+        }
+        std::sort(inside.begin(), inside.end());
+        bool disjoint = true;
+        for (size_t i = 1; i < inside.size(); i++) {
+            disjoint &= inside[i - 1].first + inside[i - 1].second <= inside[i].first;
+        }
+        CHECK(disjoint);
+        CHECK(!inside.empty() && inside.back().first + inside.back().second <= arena.base + arena.used);
+        CHECK(arena.used <= arena.capacity);
+        CHECK(arena.fallbacks == spilled && arena.fallbackBytes == spilledBytes);
+        return spilled;
+    }
+
+    // Init stages on both cores carve their buffers out of one arena at the same time
+    void Stages() {
+        Arena roomy{"roomy", MALLOC_CAP_8BIT, 2 * 1024 * 1024};
+        CHECK(roomy.Reserve());
+        CHECK(Concurrent(roomy, 20000) == 0);
+        printf("80000 concurrent allocations, %zu bytes used\n", roomy.used.load());
+        // and once it runs out every spill to the heap is counted
+        Arena tight{"tight", MALLOC_CAP_8BIT, 2048};
+        CHECK(tight.Reserve());
+        CHECK(Concurrent(tight, 48) > 0);
+    }
+
+    void Regions() {
+        Arenas::Init();
+        for (const Arena& arena : Arenas::arenas) {
+            CHECK(arena.base != nullptr && arena.capacity > 0);
+        }
+        CHECK(&Arenas::Get(Region::kPsramBulk) == &Arenas::arenas[2]);
+        Arenas::Report();
+    }
+
+    void Guard() {
+        static TaskHandle_t watched{};
+        static bool before = true;
+        static bool after = false;
+        static volatile bool done = false;
+        CHECK(!HeapGuard::IsViolation());
+        xTaskCreatePinnedToCore([](void*) {
+            watched = xTaskGetCurrentTaskHandle();
+            HeapGuard::Watch();
+            before = HeapGuard::IsViolation(); // init is still running, allocating is fine
+            while (!HeapGuard::IsViolation()) {
+                vTaskDelay(1);
+            }
+            after = true;
+            done = true;
+        }, "Sampler", 4096, nullptr, 5, nullptr, 1);
+        while (watched == nullptr) {
+            vTaskDelay(1);
+        }
+        vTaskDelay(5);
+        HeapGuard::Arm();
+        while (!done) {
+            vTaskDelay(1);
+        }
+        CHECK(!before && after);
+        // unwatched tasks may still allocate after init
+        CHECK(!HeapGuard::IsViolation());
+    }
+}
+
+int main() {
+    BumpAllocation();
+    Exhaustion();
+    Stages();
+    Regions();
+    Guard();
+    return check::Result();
+}
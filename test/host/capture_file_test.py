@@ -0,0 +1,183 @@
+#!/usr/bin/env python3
+
+# capture_file.Reader against brute force over a synthetic capture.
+#
+# Bus 0 (channels 0, 1) is written every millisecond as it is read. Bus 1 (channels 4, 5) is read at the same
+# rate but its frames arrive in bursts every 5 s, so that whole chunks of its older readings land after chunks
+# of bus 0 and the chunks' last times are not in order.
+#
+# CAPTURE_FILE_TEST_ROWS sets the number of readings written, 1M by default.
+
+import os
+import sys
+import time
+import bisect
+import random
+import shutil
+import tempfile
+import unittest
+
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), '..', '..'))
+
+from capture_file import Writer, Reader, CHUNK_ROWS
+
+ROWS = int(os.environ.get('CAPTURE_FILE_TEST_ROWS', 1000000))
+PERIOD_US = 1000
+BURST_US = 5000000
+CHANNELS = (0, 1, 4, 5)
+
+
+def reading(time_us, channel):
+    """A load that drifts and steps, different per channel, reproducible from the time alone"""
+    step = (time_us // 700000 + channel) % 5
+    voltage = 5000000 + channel * 100000 + (time_us // 1000) % 3000
+    current = step * 200000 - 300000 + (time_us * 7 + channel) % 1000
+    return voltage, current, abs(voltage // 1000 * current // 1000)
+
+
+class CaptureFileTest(unittest.TestCase):
+    @classmethod
+    def setUpClass(cls):
+        cls.dir = tempfile.mkdtemp()
+        cls.path = os.path.join(cls.dir, 'capture.tmcap')
+        cls.rows = []
+        started = time.perf_counter()
+        with Writer(cls.path) as writer:
+            backlog = []
+            time_us = 0
+            while len(cls.rows) < ROWS:
+                time_us += PERIOD_US
+                for channel in CHANNELS[:2]:
+                    row = (time_us, channel) + reading(time_us, channel)
+                    writer.add_row(*row)
+                    cls.rows.append(row)
+                backlog += [(time_us, channel) + reading(time_us, channel) for channel in CHANNELS[2:]]
+                if time_us % BURST_US == 0:
+                    for row in backlog:
+                        writer.add_row(*row)
+                    cls.rows += backlog
+                    backlog = []
+        cls.rows.sort()
+        cls.times = [row[0] for row in cls.rows]
+        cls.end_us = time_us
+        print('\n%d readings, %.1f MB, written in %.1fs' % (
+            len(cls.rows), os.path.getsize(cls.path) / 1e6, time.perf_counter() - started), file=sys.stderr)
+
+    @classmethod
+    def tearDownClass(cls):
+        shutil.rmtree(cls.dir)
+
+    def setUp(self):
+        self.reader = Reader(self.path)
+        self.random = random.Random(1)
+
+    def tearDown(self):
+        self.reader.close()
+
+    def expected(self, start_us, end_us, channel=None):
+        lo, hi = bisect.bisect_left(self.times, start_us), bisect.bisect_left(self.times, end_us)
+        return [row for row in self.rows[lo:hi] if channel is None or row[1] == channel]
+
+    def ranges(self, count):
+        for _ in range(count):
+            start = self.random.randrange(-PERIOD_US, self.end_us + PERIOD_US)
+            yield start, start + self.random.choice((1, PERIOD_US, 777777, BURST_US + 1, 60000000))
+
+    def test_chunks_overlap(self):
+        # the case the running maximum is there for
+        lasts = [self.reader.entry(chunk)[2] for chunk in range(self.reader.chunks)]
+        self.assertTrue(any(b < a for a, b in zip(lasts, lasts[1:])))
+        self.assertEqual(self.reader.time_range(), (self.times[0], self.times[-1]))
+
+    def test_seek(self):
+        for time_us, _ in self.ranges(200):
+            chunk = self.reader.seek(time_us)
+            # nothing at or after the time before the chunk found, the chunk itself reaches it
+            for before in range(chunk):
+                self.assertLess(self.reader.entry(before)[2], time_us)
+            if chunk < self.reader.chunks:
+                self.assertGreaterEqual(self.reader.entry(chunk)[2], time_us)
+
+    def test_samples(self):
+        for start, end in self.ranges(40):
+            channel = self.random.choice((None,) + CHANNELS)
+            self.assertEqual(sorted(self.reader.samples(start, end, channel)), self.expected(start, end, channel))
+
+    def test_summary(self):
+        for start, end in list(self.ranges(30)) + [(0, self.end_us + 1)]:
+            for channel in CHANNELS:
+                rows = self.expected(start, end, channel)
+                summary = self.reader.summary(start, end, channel)
+                self.assertEqual(summary.count, len(rows))
+                if not rows:
+                    continue
+                columns = list(zip(*rows))[2:]
+                self.assertEqual((summary.voltage, summary.current, summary.power),
+                                 tuple((min(column), max(column)) for column in columns))
+                self.assertEqual(summary.sums, [sum(column) for column in columns])
+
+    def test_summary_decodes_edges(self):
+        # a range well inside the capture decompresses only the chunks it does not cover whole
+        start, end = self.end_us // 4 + 1234, self.end_us // 2 + 5678
+        edges = [chunk for chunk in range(self.reader.chunks) if self.straddles(chunk, start, end)]
+        inside = [chunk for chunk in range(self.reader.chunks) if self.inside(chunk, start, end)]
+        decoded = []
+        decode = self.reader.decode
+        self.reader.decode = lambda offset: decoded.append(offset) or decode(offset)
+        self.reader.summary(start, end, 4)
+        self.reader.decode = decode
+        self.assertEqual(sorted(decoded), sorted(self.reader.entry(chunk)[0] for chunk in edges))
+        self.assertGreater(len(inside), 10 * len(edges))
+
+    def straddles(self, chunk, start, end):
+        _, first, last, _, _, _ = self.reader.entry(chunk)
+        return first < end and last >= start and not self.inside(chunk, start, end)
+
+    def inside(self, chunk, start, end):
+        _, first, last, _, _, _ = self.reader.entry(chunk)
+        return first >= start and last < end
+
+    def test_envelope(self):
+        # every chunk counts towards exactly one span
+        for channel in CHANNELS:
+            buckets = self.reader.envelope(0, self.end_us + 1, 1000, channel)
+            self.assertEqual(sum(bucket.count for bucket in buckets), len(self.expected(0, self.end_us + 1, channel)))
+
+    def test_recovered(self):
+        # a capture killed in the middle of a chunk keeps every chunk before it
+        truncated = os.path.join(self.dir, 'truncated.tmcap')
+        cut = self.reader.entry(self.reader.chunks // 2)[0] + 100
+        with open(self.path, 'rb') as source, open(truncated, 'wb') as target:
+            target.write(source.read(cut))
+        with Reader(truncated) as reader:
+            self.assertTrue(reader.recovered)
+            self.assertEqual(reader.chunks, self.reader.chunks // 2)
+            kept = sorted(row for chunk in range(reader.chunks) for row in self.reader.decode(
+                self.reader.entry(chunk)[0]))
+            self.assertEqual(sorted(reader.samples(0, self.end_us + 1)), kept)
+            self.assertEqual(reader.summary(0, self.end_us + 1, 5).count, sum(row[1] == 5 for row in kept))
+
+    def test_timings(self):
+        started = time.perf_counter()
+        Reader(self.path).close()
+        open_ms = (time.perf_counter() - started) * 1e3
+        started = time.perf_counter()
+        for time_us in range(0, self.end_us, self.end_us // 1000):
+            self.reader.seek(time_us)
+        seek_us = (time.perf_counter() - started) * 1e3
+        started = time.perf_counter()
+        self.reader.summary(self.end_us // 3, self.end_us // 3 + 60000000, 0)
+        minute_ms = (time.perf_counter() - started) * 1e3
+        started = time.perf_counter()
+        self.reader.summary(0, self.end_us + 1, 0)
+        whole_ms = (time.perf_counter() - started) * 1e3
+        started = time.perf_counter()
+        self.reader.envelope(0, self.end_us + 1, 1000, 0)
+        envelope_ms = (time.perf_counter() - started) * 1e3
+        print('\n%d chunks of %d: open %.2fms, seek %.1fus, one-minute summary %.1fms, whole-capture summary '
+              '%.1fms, 1000-bucket envelope %.1fms' % (self.reader.chunks, CHUNK_ROWS, open_ms, seek_us, minute_ms,
+                                                       whole_ms, envelope_ms), file=sys.stderr)
+
+
+if __name__ == '__main__':
+    unittest.main()
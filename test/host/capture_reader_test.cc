@@ -0,0 +1,349 @@
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+#include "capture_file.hh"
+#include "check.hh"
+
+// capture_file::Reader against brute force over a synthetic capture, as capture_file_test.py checks the Python
+// one. Bus 0 (channels 0, 1) is written every millisecond as it is read. Bus 1 (channels 4, 5) is read at the
+// same rate but its frames arrive in bursts every 5 s, so whole chunks of its older readings land after chunks of
+// bus 0 and the chunks' last times are not in order. Every reading is a function of its time and channel, so the
+// expected answers are computed rather than kept, whatever the size of the file.
+//
+// CAPTURE_READER_TEST_MB sets the size of the capture file, 256 MB by default; multi-GB captures take minutes to
+// write and a few seconds to check.
+namespace {
+    using namespace capture_file;
+
+    constexpr int64_t PeriodUs = 1000;
+    constexpr int64_t BurstUs = 5000000;
+    constexpr uint8_t Channels[] = {0, 1, 4, 5};
+
+    std::string path;
+    int64_t endUs = 0; // last reading, readings are at every multiple of PeriodUs from PeriodUs up to it
+    uint64_t frames = 0;
+
+    uint64_t Mix(uint64_t x) {
+        x += 0x9E3779B97F4A7C15;
+        x = (x ^ x >> 30) * 0xBF58476D1CE4E5B9;
+        x = (x ^ x >> 27) * 0x94D049BB133111EB;
+        return x ^ x >> 31;
+    }
+
+    // A load that drifts and steps, different per channel, with noise in the low digits of the current
+    Row Reading(const int64_t timeUs, const uint8_t channel) {
+        const int64_t step = (timeUs / 700000 + channel) % 5;
+        const auto voltage = static_cast<int32_t>(5000000 + channel * 100000 + timeUs / 1000 % 3000);
+        const auto current = static_cast<int32_t>(step * 200000 - 300000 + static_cast<int64_t>(
+            Mix(static_cast<uint64_t>(timeUs) * 8 + channel) % 1000));
+        const auto power = static_cast<uint32_t>(std::abs(int64_t{voltage} / 1000 * current) / 1000);
+        return {timeUs, channel, voltage, current, power};
+    }
+
+    bool Equal(const Row& a, const Row& b) {
+        return a.timeUs == b.timeUs && a.channel == b.channel && a.voltage == b.voltage && a.current == b.current &&
+            a.power == b.power;
+    }
+
+    // Expected readings within [startUs, endUs) of `channel`, -1 for all, by time and channel
+    std::vector<Row> Expected(const int64_t startUs, const int64_t rangeEndUs, const int channel) {
+        std::vector<Row> rows;
+        const int64_t first = std::max<int64_t>((startUs + PeriodUs - 1) / PeriodUs, 1) * PeriodUs;
+        for (int64_t timeUs = first; timeUs < rangeEndUs && timeUs <= endUs; timeUs += PeriodUs) {
+            for (const uint8_t ch : Channels) {
+                if (channel < 0 || ch == channel) {
+                    rows.push_back(Reading(timeUs, ch));
+                }
+            }
+        }
+        return rows;
+    }
+
+    Summary ExpectedSummary(const int64_t startUs, const int64_t rangeEndUs, const uint8_t channel) {
+        Summary summary{};
+        summary.channel = channel;
+        const int64_t first = std::max<int64_t>((startUs + PeriodUs - 1) / PeriodUs, 1) * PeriodUs;
+        for (int64_t timeUs = first; timeUs < rangeEndUs && timeUs <= endUs; timeUs += PeriodUs) {
+            const Row row = Reading(timeUs, channel);
+            summary.Add(row.voltage, row.current, row.power, summary.count > 0 ? PeriodUs : 0);
+        }
+        return summary;
+    }
+
+    bool SameSummary(const Summary& a, const Summary& b) {
+        return a.count == b.count && (a.count == 0 || (a.voltageMin == b.voltageMin && a.voltageMax == b.voltageMax &&
+            a.currentMin == b.currentMin && a.currentMax == b.currentMax && a.powerMin == b.powerMin &&
+            a.powerMax == b.powerMax && a.voltageSum == b.voltageSum && a.currentSum == b.currentSum &&
+            a.powerSum == b.powerSum));
+    }
+
+    double Ms(const std::chrono::steady_clock::time_point started) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+    }
+
+    void Write(const uint64_t bytes) {
+        const auto started = std::chrono::steady_clock::now();
+        Writer writer{path.c_str(), ChunkRows, 1};
+        CHECK(writer.file != nullptr);
+        std::vector<Row> backlog;
+        int64_t timeUs = 0;
+        do {
+            timeUs += PeriodUs;
+            writer.AddRow(Reading(timeUs, 0));
+            writer.AddRow(Reading(timeUs, 1));
+            backlog.push_back(Reading(timeUs, 4));
+            backlog.push_back(Reading(timeUs, 5));
+            if (timeUs % BurstUs == 0) {
+                for (const Row& row : backlog) {
+                    writer.AddRow(row);
+                }
+                backlog.clear();
+                const uint64_t hostNs = static_cast<uint64_t>(timeUs) * 1000;
+                writer.AddFrame(hostNs, 0x05, static_cast<uint8_t>(frames), reinterpret_cast<const uint8_t*>(&hostNs),
+                    sizeof(hostNs));
+                frames++;
+            }
+        } while (!backlog.empty() || static_cast<uint64_t>(ftello(writer.file)) < bytes);
+        writer.Close();
+        endUs = timeUs;
+        const double ms = Ms(started);
+        struct stat status{};
+        stat(path.c_str(), &status);
+        printf("%" PRId64 " readings, %.1f MB, written in %.1fs (%.1f M readings/s)\n", endUs / PeriodUs * 4,
+            static_cast<double>(status.st_size) / 1e6, ms / 1e3, static_cast<double>(endUs / PeriodUs * 4) / ms / 1e3);
+    }
+
+    void Overlap(const Reader& reader) {
+        // the case the running maximum is there for
+        bool overlap = false;
+        for (size_t chunk = 1; chunk < reader.chunks; chunk++) {
+            overlap |= reader.Entry(chunk).lastUs < reader.Entry(chunk - 1).lastUs;
+        }
+        CHECK(overlap);
+        CHECK(reader.TimeRange() == std::make_pair(PeriodUs, endUs));
+        CHECK(!reader.recovered && reader.chunkRows == ChunkRows);
+    }
+
+    void Seek(const Reader& reader, std::mt19937_64& random) {
+        bool ok = true;
+        for (int i = 0; i < 200; i++) {
+            const int64_t timeUs = static_cast<int64_t>(random() % static_cast<uint64_t>(endUs + 2 * PeriodUs)) -
+                PeriodUs;
+            const size_t chunk = reader.Seek(timeUs);
+            // nothing at or after the time before the chunk found, the chunk itself reaches it
+            for (size_t before = 0; before < chunk; before++) {
+                ok &= reader.Entry(before).lastUs < timeUs;
+            }
+            ok &= chunk == reader.chunks || reader.Entry(chunk).lastUs >= timeUs;
+        }
+        CHECK(ok);
+    }
+
+    std::pair<int64_t, int64_t> Range(std::mt19937_64& random) {
+        constexpr int64_t Lengths[] = {1, PeriodUs, 777777, BurstUs + 1, 60000000};
+        const int64_t start = static_cast<int64_t>(random() % static_cast<uint64_t>(endUs + 2 * PeriodUs)) -
+            PeriodUs;
+        return {start, start + Lengths[random() % std::size(Lengths)]};
+    }
+
+    void Samples(Reader& reader, std::mt19937_64& random) {
+        bool ok = true;
+        for (int i = 0; i < 40; i++) {
+            const auto [start, end] = Range(random);
+            const int channel = random() % 5 == 0 ? -1 : Channels[random() % std::size(Channels)];
+            std::vector<Row> rows;
+            reader.Samples(start, end, channel, [](void* arg, const Row& row) {
+                static_cast<std::vector<Row>*>(arg)->push_back(row);
+            }, &rows);
+            std::sort(rows.begin(), rows.end(), [](const Row& a, const Row& b) {
+                return a.timeUs != b.timeUs ? a.timeUs < b.timeUs : a.channel < b.channel;
+            });
+            const std::vector<Row> expected = Expected(start, end, channel);
+            ok &= std::equal(rows.begin(), rows.end(), expected.begin(), expected.end(), Equal);
+        }
+        CHECK(ok);
+    }
+
+    void Summaries(Reader& reader, std::mt19937_64& random) {
+        bool ok = true;
+        for (int i = 0; i < 30; i++) {
+            const auto [start, end] = Range(random);
+            for (const uint8_t channel : Channels) {
+                ok &= SameSummary(reader.Summarize(start, end, channel), ExpectedSummary(start, end, channel));
+            }
+        }
+        CHECK(ok);
+        // over the whole capture every reading but a channel's first adds one period of its power
+        for (const uint8_t channel : Channels) {
+            const Summary summary = reader.Summarize(0, endUs + 1, channel);
+            const Summary expected = ExpectedSummary(0, endUs + 1, channel);
+            CHECK(SameSummary(summary, expected));
+            CHECK(std::abs(summary.energy - expected.energy) <= 1e-9 * expected.energy);
+        }
+    }
+
+    void Edges(Reader& reader) {
+        // a range well inside the capture decompresses only the chunks it does not cover whole
+        const int64_t start = endUs / 4 + 1234;
+        const int64_t end = endUs / 2 + 5678;
+        size_t edges = 0, inside = 0;
+        for (size_t chunk = 0; chunk < reader.chunks; chunk++) {
+            const SampleEntry& entry = reader.Entry(chunk);
+            const bool whole = entry.firstUs >= start && entry.lastUs < end;
+            inside += whole;
+            edges += !whole && entry.firstUs < end && entry.lastUs >= start;
+        }
+        reader.decodedChunks = 0;
+        CHECK(SameSummary(reader.Summarize(start, end, 4), ExpectedSummary(start, end, 4)));
+        CHECK(reader.decodedChunks == edges);
+        CHECK(inside > 10 * edges);
+    }
+
+    void Envelope(const Reader& reader) {
+        // every chunk counts towards exactly one span
+        for (const uint8_t channel : Channels) {
+            uint64_t count = 0;
+            for (const Summary& bucket : reader.Envelope(0, endUs + 1, 1000, channel)) {
+                count += bucket.count;
+            }
+            CHECK(count == static_cast<uint64_t>(endUs / PeriodUs));
+        }
+    }
+
+    void Frames(const Reader& reader) {
+        struct Seen {
+            uint64_t count;
+            bool ok;
+        } seen{0, true};
+        CHECK(reader.Frames([](void* arg, const uint64_t hostNs, const uint8_t type, const uint8_t seq,
+                               const uint8_t* payload, const size_t length) {
+            auto& seen = *static_cast<Seen*>(arg);
+            uint64_t value = 0;
+            seen.ok &= type == 0x05 && seq == static_cast<uint8_t>(seen.count) && length == sizeof(value);
+            memcpy(&value, payload, std::min(length, sizeof(value)));
+            seen.ok &= value == hostNs && hostNs == (seen.count + 1) * BurstUs * 1000;
+            seen.count++;
+        }, &seen));
+        CHECK(seen.ok && seen.count == frames);
+    }
+
+    void Recovered(Reader& reader) {
+        // a capture killed in the middle of a chunk keeps every chunk before it
+        const size_t kept = std::min<size_t>(reader.chunks / 2, 64);
+        const std::string truncated = path + ".truncated";
+        FILE* file = fopen(truncated.c_str(), "wb");
+        const uint64_t cut = reader.Entry(kept).offset + 100;
+        fwrite(reader.map, 1, cut, file);
+        fclose(file);
+        std::vector<Row> rows;
+        for (size_t chunk = 0; chunk < kept; chunk++) {
+            reader.Decode(reader.Entry(chunk).offset);
+            rows.insert(rows.end(), reader.decoded.begin(), reader.decoded.end());
+        }
+        {
+            Reader recovered{truncated.c_str()};
+            CHECK(recovered.Ok() && recovered.recovered && recovered.chunks == kept);
+            std::vector<Row> read;
+            recovered.Samples(0, endUs + 1, -1, [](void* arg, const Row& row) {
+                static_cast<std::vector<Row>*>(arg)->push_back(row);
+            }, &read);
+            CHECK(std::equal(read.begin(), read.end(), rows.begin(), rows.end(), Equal));
+            const auto count = static_cast<uint32_t>(std::count_if(rows.begin(), rows.end(), [](const Row& row) {
+                return row.channel == 5;
+            }));
+            CHECK(recovered.Summarize(0, endUs + 1, 5).count == count);
+            // the summaries rebuilt from the chunks are the ones the writer put into the index
+            bool same = true;
+            for (size_t chunk = 0; chunk < kept; chunk++) {
+                for (const uint8_t channel : Channels) {
+                    same &= SameSummary(recovered.ChunkSummary(chunk, channel), reader.ChunkSummary(chunk, channel));
+                }
+            }
+            CHECK(same);
+        }
+        unlink(truncated.c_str());
+    }
+
+    void Corrupt() {
+        const std::string corrupt = path + ".corrupt";
+        FILE* file = fopen(corrupt.c_str(), "wb");
+        fputs("TMCAP but not really", file);
+        fclose(file);
+        CHECK(!Reader{corrupt.c_str()}.Ok());
+        CHECK(!Reader{(path + ".missing").c_str()}.Ok());
+        unlink(corrupt.c_str());
+    }
+
+    void Benchmark(Reader& reader) {
+        auto started = std::chrono::steady_clock::now();
+        {
+            const Reader opened{path.c_str()};
+            CHECK(opened.Ok());
+        }
+        const double openMs = Ms(started);
+        size_t sink = 0;
+        const double seekNs = check::NsPer(1000000, [&](const size_t i) {
+            sink += reader.Seek(static_cast<int64_t>(Mix(i) % static_cast<uint64_t>(endUs)));
+        });
+        started = std::chrono::steady_clock::now();
+        CHECK(reader.Summarize(endUs / 3, endUs / 3 + 60000000, 0).count > 0);
+        const double minuteMs = Ms(started);
+        started = std::chrono::steady_clock::now();
+        const Summary whole = reader.Summarize(0, endUs + 1, 0);
+        const double wholeMs = Ms(started);
+        started = std::chrono::steady_clock::now();
+        CHECK(reader.Envelope(0, endUs + 1, 1000, 0).size() == 1000);
+        const double envelopeMs = Ms(started);
+        started = std::chrono::steady_clock::now();
+        uint64_t rows = 0;
+        const size_t decoded = std::min<size_t>(reader.chunks, 2000);
+        for (size_t chunk = 0; chunk < decoded; chunk++) {
+            reader.Decode(reader.Entry(chunk).offset);
+            rows += reader.decoded.size();
+        }
+        const double scanMs = Ms(started);
+        printf("%zu chunks of %lu: open %.2fms, seek %.0fns, one-minute summary %.2fms, whole-capture summary "
+            "%.2fms (%.1fh), 1000-bucket envelope %.2fms, decoding %zu chunks %.0fms (%.0f M readings/s)\n",
+            reader.chunks, static_cast<unsigned long>(ChunkRows), openMs, seekNs, minuteMs, wholeMs,
+            static_cast<double>(whole.count) * PeriodUs / 3.6e9, envelopeMs, decoded, scanMs,
+            static_cast<double>(rows) / scanMs / 1e3);
+        CHECK(sink > 0);
+    }
+}
+
+int main() {
+    const char* megabytes = getenv("CAPTURE_READER_TEST_MB");
+    const uint64_t bytes = static_cast<uint64_t>((megabytes != nullptr ? atof(megabytes) : 256) * 1e6);
+    const char* directory = getenv("TMPDIR");
+    path = std::string(directory != nullptr ? directory : "/tmp") + "/capture_reader_test." +
+        std::to_string(getpid()) + ".tmcap";
+    Write(bytes);
+    {
+        Reader reader{path.c_str()};
+        CHECK(reader.Ok());
+        if (reader.Ok()) {
+            std::mt19937_64 random{1};
+            Overlap(reader);
+            Seek(reader, random);
+            Samples(reader, random);
+            Summaries(reader, random);
+            Edges(reader);
+            Envelope(reader);
+            Frames(reader);
+            Recovered(reader);
+            Corrupt();
+            Benchmark(reader);
+        }
+    }
+    unlink(path.c_str());
+    return check::Result();
+}
@@ -0,0 +1,248 @@
+#!/usr/bin/env python3
+
+# capture.py against a pseudo-terminal standing in for the board.
+#
+# data/link.bin is a link recording written by the firmware's own Telemetry::Send, built for the host: boot and
+# warning log lines between kSamples frames of two buses, a kRate, a kEvent, a kResponse and a kStats frame.
+# One kSamples frame (seq 18) was dropped and one (seq 27) has a flipped payload bit.
+#
+# CAPTURE_TEST_MB sets the size of the synthetic stream pushed through the pty, 16 MB by default.
+#
+# Given the path of tmcapture, the C++ capture tool, it is checked against the same recording and has to keep up
+# with the synthetic stream at TMCAPTURE_MIN_MBPS, 8 MB/s by default: a USB serial link at 12 Mbit/s full speed
+# tops out at about 1.2 MB/s, a high speed USB CDC port at several MB/s.
+
+import os
+import re
+import pty
+import sys
+import tty
+import time
+import subprocess
+import tempfile
+import threading
+import unittest
+
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), '..', '..'))
+
+import telemetry
+from telemetry import FrameType
+from capture import Capture
+from capture_file import Reader
+
+RECORDING = os.path.join(os.path.dirname(__file__), 'data', 'link.bin')
+TMCAPTURE = sys.argv.pop(1) if len(sys.argv) > 1 else None
+SUMMARY = re.compile(rb'(\d+) bytes in ([\d.]+)s \(([\d.]+) MB/s\), (\d+) frames, (\d+) samples, (\d+) lines, '
+                     rb'(\d+) lost, (\d+) crc errors')
+
+
+class Board:
+    """Writes a byte stream to the master side of a pty from a thread, as fast as the reader takes it"""
+
+    def __init__(self, data):
+        self.master, self.slave = pty.openpty()
+        tty.setraw(self.master)
+        self.port = os.ttyname(self.slave)
+        self.data = data
+        self.elapsed = None
+        self.thread = threading.Thread(target=self.push, daemon=True)
+
+    def push(self):
+        started = time.monotonic()
+        view = memoryview(self.data)
+        pos = 0
+        while pos < len(view):
+            pos += os.write(self.master, view[pos:pos + 65536])
+        self.elapsed = time.monotonic() - started
+
+    def close(self):
+        self.thread.join()
+        os.close(self.slave)
+        os.close(self.master)
+
+
+def run(capture, board, frames, timeout=60.0):
+    """Reads until the decoder has seen `frames` frames and the board is done"""
+    board.thread.start()
+    deadline = time.monotonic() + timeout
+    while (capture.decoder.frames < frames or board.thread.is_alive()) and time.monotonic() < deadline:
+        capture.read(0.2)
+    # anything the last read left undecided, a text line without its newline
+    capture.read(0.05)
+
+
+def run_tool(board, *args):
+    """Runs tmcapture on the board's port until the board is done and the link has been idle for a second,
+    returns its summary as (bytes, seconds, MB/s, frames, samples, lines, lost, crc errors)"""
+    tool = subprocess.Popen([TMCAPTURE, board.port, *args, '--idle', '1'], stderr=subprocess.PIPE)
+    # the port has to be open and raw before the board writes, tmcapture is quiet until then
+    time.sleep(0.2)
+    board.thread.start()
+    _, errors = tool.communicate(timeout=300)
+    board.close()
+    summary = SUMMARY.search(errors)
+    if tool.returncode != 0 or summary is None:
+        raise AssertionError('tmcapture failed: %s' % errors.decode(errors='replace'))
+    return tuple(float(value) if '.' in value.decode() else int(value) for value in summary.groups())
+
+
+class RecordedLinkTest(unittest.TestCase):
+    def setUp(self):
+        with open(RECORDING, 'rb') as file:
+            self.recording = file.read()
+
+    def test_decoder(self):
+        decoder = telemetry.Decoder()
+        items = decoder.feed(self.recording)
+        frames = [item for item in items if item[0] == 'frame']
+        self.assertEqual(decoder.frames, 42)
+        self.assertEqual(decoder.lost, 2)
+        self.assertEqual(decoder.crc_errors, 1)
+        self.assertEqual([item[1] for item in frames].count(FrameType.SAMPLES), 38)
+        lines = [item[1] for item in items if item[0] == 'text' and item[1].endswith(b'\n')]
+        self.assertEqual(lines, [b'I (312) main: init done in 86ms\n', b'W (1005) Sampler: bus 0 over budget\n',
+                                 b'I (1021) Meter: Sent 3120 bytes/s\n'])
+
+        bus, _, channels, time_us, skew_us = telemetry.SAMPLES_HEADER.unpack_from(frames[0][3])
+        self.assertEqual((bus, channels, time_us, skew_us), (0, 0b0111, 1000000, 180))
+        self.assertEqual(list(telemetry.samples(frames[0][3])), [
+            (0, (5000000, 100000, 500000)), (1, (6000000, 200000, 1000000)), (2, (7000000, -100000, 1500000))])
+        by_type = {item[1]: item[3] for item in frames}
+        self.assertEqual(telemetry.RATE.unpack(by_type[FrameType.RATE]), (2, 1, 0, 1005000, 2000))
+        event = telemetry.EVENT.unpack(by_type[FrameType.EVENT])
+        self.assertEqual(event[:8], (2, 3, 0, 1014900, 600, -300000, -150000, 1200))
+        self.assertAlmostEqual(event[8], 0.0045, places=6)
+        self.assertEqual(telemetry.RESPONSE.unpack(by_type[FrameType.RESPONSE]), (7, 1, 0, 85, 0))
+        self.assertEqual(telemetry.STATS.unpack(by_type[FrameType.STATS])[-3:], (1, 4, 0b1111))
+
+    def test_split_reads(self):
+        # the same items whatever way the link cuts the stream, down to single bytes
+        whole = telemetry.Decoder().feed(self.recording)
+        for size in (1, 2, 3, 7, 16, 61, 512):
+            decoder = telemetry.Decoder()
+            items = []
+            for pos in range(0, len(self.recording), size):
+                items += decoder.feed(self.recording[pos:pos + size])
+            frames = [item for item in items if item[0] == 'frame']
+            self.assertEqual(frames, [item for item in whole if item[0] == 'frame'], size)
+            self.assertEqual(b''.join(item[1] for item in items if item[0] == 'text'),
+                             b''.join(item[1] for item in whole if item[0] == 'text'), size)
+            self.assertEqual((decoder.lost, decoder.crc_errors), (2, 1))
+
+    def test_capture(self):
+        with tempfile.TemporaryDirectory() as directory:
+            path = lambda name: os.path.join(directory, name)
+            board = Board(self.recording)
+            capture = Capture(board.port, path('run.tmcap'), path('run.csv'), path('run.log'), path('events.csv'))
+            run(capture, board, 42)
+            capture.close()
+            board.close()
+
+            # 20 frames of bus 0 with three channels, 18 of bus 1 with one
+            with open(path('run.csv')) as csv:
+                rows = csv.read().splitlines()[1:]
+            self.assertEqual(len(rows), 78)
+            self.assertTrue(all(row.endswith(',2000') for row in rows[-20:] if row.split(',')[4] == '2'))
+            with Reader(path('run.tmcap')) as reader:
+                self.assertEqual(len(list(reader.samples(0, 1 << 40))), 78)
+                self.assertEqual(reader.time_range(), (1000000, 1000000 + 39 * 500))
+                self.assertEqual(sorted({frame[1] for frame in reader.frames()}),
+                                 [FrameType.RATE, FrameType.EVENT, FrameType.RESPONSE, FrameType.STATS])
+            with open(path('events.csv')) as events:
+                self.assertEqual(events.read().splitlines()[1].split(',')[1:8],
+                                 ['1014900', '600', '2', 'rise', '-300000', '-150000', '1200'])
+            with open(path('run.log'), 'rb') as log:
+                self.assertEqual(log.read().count(b'\n'), 3)
+
+    @unittest.skipIf(TMCAPTURE is None, 'no tmcapture given')
+    def test_tmcapture(self):
+        with tempfile.TemporaryDirectory() as directory:
+            path = lambda name: os.path.join(directory, name)
+            board = Board(self.recording)
+            capture = Capture(board.port, path('py.tmcap'), path('py.csv'), path('py.log'), path('py_events.csv'))
+            run(capture, board, 42)
+            capture.close()
+            board.close()
+            summary = run_tool(Board(self.recording), path('run.tmcap'), '--csv', path('run.csv'), '--log',
+                               path('run.log'), '--events', path('events.csv'))
+            self.assertEqual(summary[:1] + summary[3:], (len(self.recording), 42, 78, 3, 2, 1))
+
+            # the same rows and events as capture.py but for the host times, and the same capture file
+            def columns(name):
+                with open(path(name)) as file:
+                    return [line.split(',', 1)[1] for line in file.read().splitlines()]
+            self.assertEqual(columns('run.csv'), columns('py.csv'))
+            self.assertEqual(columns('events.csv'), columns('py_events.csv'))
+            with Reader(path('run.tmcap')) as reader, Reader(path('py.tmcap')) as expected:
+                self.assertFalse(reader.recovered)
+                self.assertEqual(list(reader.samples(0, 1 << 40)), list(expected.samples(0, 1 << 40)))
+                self.assertEqual(reader.time_range(), expected.time_range())
+                for channel in range(3):
+                    self.assertEqual(repr(reader.summary(0, 1 << 40, channel)),
+                                     repr(expected.summary(0, 1 << 40, channel)))
+                self.assertEqual([frame[1:] for frame in reader.frames()],
+                                 [frame[1:] for frame in expected.frames()])
+            # the frame failing its CRC is dropped whole by the firmware's parser rather than logged as text
+            with open(path('run.log'), 'rb') as log:
+                self.assertEqual(log.read(), b'I (312) main: init done in 86ms\nW (1005) Sampler: bus 0 over '
+                                             b'budget\nI (1021) Meter: Sent 3120 bytes/s\n')
+
+
+class ThroughputTest(unittest.TestCase):
+    @classmethod
+    def setUpClass(cls):
+        megabytes = float(os.environ.get('CAPTURE_TEST_MB', 16))
+        # one bus with four channels read every 200us, and a log line every 100 frames
+        header = telemetry.SAMPLES_HEADER
+        frame_size = telemetry.HEADER.size + header.size + 4 * telemetry.SAMPLE.size + telemetry.CRC.size
+        cls.count = int(megabytes * 1e6 / frame_size)
+        parts = []
+        for i in range(cls.count):
+            payload = header.pack(0, 0, 0b1111, (i * 200) & 0xffffffff, 90) + b''.join(
+                telemetry.SAMPLE.pack(5000000 + channel, i & 0xffff, channel) for channel in range(4))
+            parts.append(telemetry.encode(FrameType.SAMPLES, i, payload))
+            if i % 100 == 0:
+                parts.append(b'I (%d) Meter: Sent 108000 bytes/s\n' % (i // 5))
+        cls.stream = b''.join(parts)
+
+    def test_synthetic_stream(self):
+        count, stream = self.count, self.stream
+        with tempfile.TemporaryDirectory() as directory:
+            board = Board(stream)
+            capture = Capture(board.port, os.path.join(directory, 'run.tmcap'))
+            started = time.monotonic()
+            run(capture, board, count, timeout=300.0)
+            elapsed = time.monotonic() - started
+            capture.close()
+            board.close()
+            decoder = capture.decoder
+            print('\n%.1f MB, %d frames through a pty at %.1f MB/s' % (len(stream) / 1e6, count,
+                                                                       len(stream) / 1e6 / elapsed))
+            self.assertEqual(capture.bytes, len(stream))
+            self.assertEqual((decoder.frames, decoder.lost, decoder.crc_errors), (count, 0, 0))
+            self.assertEqual(capture.samples, 4 * count)
+            self.assertEqual(capture.lines, (count + 99) // 100)
+
+    @unittest.skipIf(TMCAPTURE is None, 'no tmcapture given')
+    def test_tmcapture(self):
+        count, stream = self.count, self.stream
+        minimum = float(os.environ.get('TMCAPTURE_MIN_MBPS', 8))
+        with tempfile.TemporaryDirectory() as directory:
+            path = lambda name: os.path.join(directory, name)
+            summary = run_tool(Board(stream), path('run.tmcap'), '--csv', path('run.csv'))
+            size, seconds, rate, frames, samples, lines, lost, crc_errors = summary
+            print('\n%.1f MB, %d frames through a pty into tmcapture at %.1f MB/s, with CSV' % (
+                len(stream) / 1e6, count, rate))
+            self.assertEqual((size, frames, samples, lines, lost, crc_errors),
+                             (len(stream), count, 4 * count, (count + 99) // 100, 0, 0))
+            self.assertGreaterEqual(rate, minimum)
+            with Reader(path('run.tmcap')) as reader:
+                self.assertEqual(reader.time_range(), (0, (count - 1) * 200))
+                self.assertEqual(reader.summary(0, 1 << 40, 3).count, count)
+            with open(path('run.csv'), 'rb') as csv:
+                self.assertEqual(sum(chunk.count(b'\n') for chunk in iter(lambda: csv.read(1 << 20), b'')),
+                                 1 + 4 * count)
+
+
+if __name__ == '__main__':
+    unittest.main()
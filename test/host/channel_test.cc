@@ -0,0 +1,128 @@
+#include <atomic>
+#include <cmath>
+#include <esp_timer.h>
+#include <freertos/task.h>
+
+#include "channel.hh"
+#include "check.hh"
+#include "sim_board.hh"
+
+namespace {
+    // Eight channels, as one bus would carry them or split over both controllers
+    constexpr BusConfig TwoBuses[] = {
+        {I2C_NUM_0, 8, 9},
+        {I2C_NUM_1, 34, 35},
+    };
+
+    constexpr ChannelConfig OneBusChannels[] = {
+        {"ch0", 0, 0x40, 10, 100.0f}, {"ch1", 0, 0x41, 11, 100.0f}, {"ch2", 0, 0x42, 12, 100.0f},
+        {"ch3", 0, 0x43, 13, 100.0f}, {"ch4", 0, 0x44, 14, 100.0f}, {"ch5", 0, 0x45, 15, 100.0f},
+        {"ch6", 0, 0x46, 16, 100.0f}, {"ch7", 0, 0x47, 17, 100.0f},
+    };
+
+    constexpr ChannelConfig TwoBusChannels[] = {
+        {"ch0", 0, 0x40, 10, 100.0f}, {"ch1", 1, 0x40, 11, 100.0f}, {"ch2", 0, 0x41, 12, 100.0f},
+        {"ch3", 1, 0x41, 13, 50.0f}, {"ch4", 0, 0x42, 14, 100.0f}, {"ch5", 1, 0x42, 15, 100.0f},
+        {"ch6", 0, 0x43, 16, 100.0f}, {"ch7", 1, 0x43, 17, 100.0f},
+    };
+
+    // Channel n carries 5V + n * 1V and n * 100mA
+    sim::Load Steady(const void* arg, int64_t) {
+        const auto n = static_cast<float>(reinterpret_cast<uintptr_t>(arg));
+        return {5.0f + n, 0.1f * n};
+    }
+
+    void Attach(const ChannelConfig* channels, const size_t count) {
+        sim::Reset();
+        for (size_t i = 0; i < count; i++) {
+            sim::GetBus(TwoBuses[channels[i].bus].port).Attach(channels[i].address, Steady,
+                reinterpret_cast<const void*>(i), channels[i].shunt / 1000.0f);
+        }
+    }
+
+    void Registry() {
+        Attach(TwoBusChannels, 8);
+        ChannelRegistry registry{TwoBuses, 2, TwoBusChannels, 8};
+        registry.InitBus(0);
+        registry.InitBus(1);
+        CHECK(registry.Size() == 8);
+        for (size_t i = 0; i < registry.Size(); i++) {
+            MeterBus& channel = registry[i];
+            CHECK(registry.BusOf(i) == i % 2);
+            CHECK(sim::Level(TwoBusChannels[i].enableGpio) == 0);
+            channel.Enable();
+            CHECK(sim::Level(TwoBusChannels[i].enableGpio) == 1);
+            channel.Update();
+            // within a register step of the simulated load: 4mV on the bus, two current LSB of 153uA as the
+            // calibration register is truncated too
+            CHECK(std::fabs(channel.voltage - (5.0f + static_cast<float>(i))) <= 0.004f);
+            CHECK(std::fabs(channel.current - 0.1f * static_cast<float>(i)) <= 0.0003f);
+            channel.Disable();
+            CHECK(sim::Level(TwoBusChannels[i].enableGpio) == 0);
+        }
+        CHECK(sim::GetBus(0).transactions > 0 && sim::GetBus(1).transactions > 0);
+    }
+
+    struct Sampler {
+        ChannelRegistry* registry;
+        uint8_t bus;
+        int64_t until;
+        std::atomic<uint32_t> updates{0};
+        std::atomic<bool> done{false};
+    };
+
+    // What each Sampler task does, without the frames: every channel of its bus in turn
+    void Sample(void* arg) {
+        auto& sampler = *static_cast<Sampler*>(arg);
+        while (esp_timer_get_time() < sampler.until) {
+            for (size_t i = 0; i < sampler.registry->Size(); i++) {
+                if (sampler.registry->BusOf(i) == sampler.bus) {
+                    (*sampler.registry)[i].Update();
+                    sampler.updates++;
+                }
+            }
+        }
+        sampler.done = true;
+        vTaskDelete(nullptr);
+    }
+
+    // Channel updates per second over all buses, each bus sampled by its own task
+    double Throughput(const ChannelConfig* channels, const size_t busCount) {
+        Attach(channels, 8);
+        ChannelRegistry registry{TwoBuses, busCount, channels, 8};
+        for (size_t bus = 0; bus < busCount; bus++) {
+            registry.InitBus(bus);
+        }
+        constexpr int64_t DurationUs = 400000;
+        const int64_t begin = esp_timer_get_time();
+        Sampler samplers[ChannelRegistry::MaxBuses]{};
+        for (size_t bus = 0; bus < busCount; bus++) {
+            samplers[bus].registry = &registry;
+            samplers[bus].bus = static_cast<uint8_t>(bus);
+            samplers[bus].until = begin + DurationUs;
+            xTaskCreatePinnedToCore(Sample, "Sampler", 4096, &samplers[bus], 20, nullptr, 1);
+        }
+        uint32_t updates = 0;
+        for (size_t bus = 0; bus < busCount; bus++) {
+            while (!samplers[bus].done) {
+                vTaskDelay(1);
+            }
+            updates += samplers[bus].updates;
+        }
+        return updates * 1e6 / static_cast<double>(esp_timer_get_time() - begin);
+    }
+
+    void Scaling() {
+        const double one = Throughput(OneBusChannels, 1);
+        const double two = Throughput(TwoBusChannels, 2);
+        printf("8 channels on one bus: %.0f updates/s, on two buses: %.0f updates/s (x%.2f)\n", one, two, two / one);
+        // the buses are independent, only the transactions on each are serialised
+        CHECK(two > 1.7 * one);
+    }
+}
+
+int main() {
+    Registry();
+    Scaling();
+    return check::Result();
+}
@@ -0,0 +1,40 @@
+#ifndef CHECK_HH
+#define CHECK_HH
+
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+
+// Just enough of a test harness for the host tests: CHECK reports a failed expression and carries on, so one
+// run shows every failure, and Result() turns the count into the exit code ctest looks at.
+namespace check {
+    inline int failures = 0;
+
+    inline bool Report(const bool ok, const char* expression, const char* file, const int line) {
+        if (!ok) {
+            failures++;
+            printf("%s:%d: CHECK(%s) failed\n", file, line, expression);
+        }
+        return ok;
+    }
+
+    inline int Result() {
+        printf(failures == 0 ? "passed\n" : "%d checks failed\n", failures);
+        return failures == 0 ? 0 : 1;
+    }
+
+    // Nanoseconds per call of `fn(i)` for i in [0, count)
+    template<typename F>
+    double NsPer(const size_t count, F&& fn) {
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < count; i++) {
+            fn(i);
+        }
+        const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count() / static_cast<double>(count);
+    }
+}
+
+#define CHECK(expression) check::Report(static_cast<bool>(expression), #expression, __FILE__, __LINE__)
+
+#endif //CHECK_HH
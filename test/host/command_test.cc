@@ -0,0 +1,169 @@
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "check.hh"
+#include "command.hh"
+
+// The link as the host sees it: every byte Telemetry wrote, in order
+namespace {
+    std::vector<uint8_t> wire;
+}
+
+hal::Serial::Serial(size_t, size_t) { }
+
+hal::Serial::~Serial() = default;
+
+size_t hal::Serial::Write(const uint8_t* data, const size_t size, TickType_t) const {
+    wire.insert(wire.end(), data, data + size);
+    return size;
+}
+
+size_t hal::Serial::Read(uint8_t*, size_t, TickType_t) const { return 0; }
+
+namespace {
+    struct Received {
+        FrameType type;
+        uint8_t seq;
+        std::vector<uint8_t> payload;
+    };
+
+    struct Collector {
+        std::vector<Received> frames;
+
+        static void Handle(void* arg, const FrameType type, const uint8_t seq, const uint8_t* payload,
+                           const size_t length) {
+            static_cast<Collector*>(arg)->frames.push_back({type, seq, {payload, payload + length}});
+        }
+    };
+
+    void Feed(FrameParser& parser, const std::vector<uint8_t>& bytes, std::mt19937& rng) {
+        // the link hands out whatever it has, from single bytes to several frames at once
+        for (size_t pos = 0; pos < bytes.size();) {
+            const size_t chunk = std::min<size_t>(bytes.size() - pos, 1 + rng() % 97);
+            parser.Feed(bytes.data() + pos, chunk);
+            pos += chunk;
+        }
+    }
+
+    void Crc() {
+        // CRC-16/CCITT-FALSE check value
+        const auto* check = reinterpret_cast<const uint8_t*>("123456789");
+        CHECK(Telemetry::Crc16(check, 9) == 0x29B1);
+        CHECK(Telemetry::Crc16(check + 4, 5, Telemetry::Crc16(check, 4)) == 0x29B1);
+    }
+
+    void RoundTrip() {
+        hal::Serial serial{0, 0};
+        Telemetry telemetry{serial};
+        std::mt19937 rng{11};
+        std::vector<Received> sent;
+        wire.clear();
+        for (int i = 0; i < 2000; i++) {
+            // console lines share the port and land between frames; they are text, a stray first sync byte at
+            // most, never both
+            if (i % 5 == 0) {
+                const char line[] = "I (1234) app: \xA5 text between frames\n";
+                wire.insert(wire.end(), line, line + sizeof(line) - 1);
+            }
+            std::vector<uint8_t> payload(i % 50 == 0 ? Telemetry::MaxPayload : rng() % 64);
+            for (uint8_t& byte : payload) {
+                byte = static_cast<uint8_t>(rng());
+            }
+            const auto type = i % 7 == 0 ? FrameType::kCommand : FrameType::kSamples;
+            CHECK(telemetry.Send(type, payload.data(), payload.size()));
+            sent.push_back({type, static_cast<uint8_t>(i), payload});
+        }
+        CHECK(!telemetry.Send(FrameType::kSamples, wire.data(), Telemetry::MaxPayload + 1));
+
+        Collector collector;
+        FrameParser parser{Collector::Handle, &collector};
+        Feed(parser, wire, rng);
+        CHECK(collector.frames.size() == sent.size() && parser.frames == sent.size());
+        CHECK(parser.crcErrors == 0 && parser.oversized == 0);
+        size_t mismatches = 0;
+        for (size_t i = 0; i < std::min(sent.size(), collector.frames.size()); i++) {
+            const Received& a = sent[i];
+            const Received& b = collector.frames[i];
+            if (a.type != b.type || a.seq != b.seq || a.payload != b.payload) {
+                mismatches++;
+            }
+        }
+        CHECK(mismatches == 0);
+        CHECK(telemetry.sentFrames == sent.size() && telemetry.droppedFrames == 0);
+    }
+
+    void Corruption() {
+        hal::Serial serial{0, 0};
+        Telemetry telemetry{serial};
+        const CommandPacket command{7, static_cast<uint8_t>(Opcode::kEnable), 3, 0};
+        wire.clear();
+        CHECK(telemetry.Send(FrameType::kCommand, &command, sizeof(command)));
+        std::vector<uint8_t> frame = wire;
+
+        std::vector<uint8_t> stream;
+        // a flipped payload bit fails the CRC
+        stream.insert(stream.end(), frame.begin(), frame.end());
+        stream[sizeof(FrameHeader) + 1] ^= 0x10;
+        // a length past MaxPayload is given up on at the header and the parser resynchronises
+        const uint8_t oversized[] = {Telemetry::Sync0, Telemetry::Sync1, 0x10, 0, 0xFF, 0x7F};
+        stream.insert(stream.end(), oversized, oversized + sizeof(oversized));
+        // a frame cut short by a reset swallows the start of the next one, which is lost as well
+        stream.insert(stream.end(), frame.begin(), frame.begin() + 9);
+        stream.insert(stream.end(), frame.begin(), frame.end());
+        // and the one after that is fine again
+        stream.insert(stream.end(), frame.begin(), frame.end());
+
+        Collector collector;
+        FrameParser parser{Collector::Handle, &collector};
+        for (const uint8_t byte : stream) {
+            parser.Feed(&byte, 1);
+        }
+        CHECK(parser.oversized == 1);
+        CHECK(parser.crcErrors == 2);
+        CHECK(collector.frames.size() == 1);
+        if (!collector.frames.empty()) {
+            CommandPacket received{};
+            memcpy(&received, collector.frames[0].payload.data(), sizeof(received));
+            CHECK(received.id == 7 && received.opcode == command.opcode && received.channel == 3);
+        }
+    }
+
+    void Latency() {
+        LatencyStats a;
+        LatencyStats b;
+        CHECK(a.Average() == 0);
+        a.Add(10);
+        a.Add(30);
+        b.Add(5);
+        a.Merge(b);
+        CHECK(a.count == 3 && a.min == 5 && a.max == 30 && a.Average() == 15);
+    }
+
+    void Benchmark() {
+        hal::Serial serial{0, 0};
+        Telemetry telemetry{serial};
+        wire.clear();
+        // a kSamples frame of a busy bus: header and four channels
+        uint8_t payload[sizeof(SamplesHeader) + 4 * 12]{};
+        for (int i = 0; i < 10000; i++) {
+            payload[0] = static_cast<uint8_t>(i);
+            (void) telemetry.Send(FrameType::kSamples, payload, sizeof(payload));
+        }
+        Collector collector;
+        FrameParser parser{[](void*, FrameType, uint8_t, const uint8_t*, size_t) { }, &collector};
+        const double ns = check::NsPer(100, [&](size_t) { parser.Feed(wire.data(), wire.size()); });
+        CHECK(parser.frames == 100 * 10000 && parser.crcErrors == 0);
+        printf("FrameParser: %.1f MB/s\n", static_cast<double>(wire.size()) / ns * 1000.0);
+    }
+}
+
+int main() {
+    Arenas::Init();
+    Crc();
+    RoundTrip();
+    Corruption();
+    Latency();
+    Benchmark();
+    return check::Result();
+}
@@ -0,0 +1,267 @@
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include <esp_timer.h>
+#include <freertos/task.h>
+
+#include "check.hh"
+#include "deferred_log.hh"
+
+namespace {
+    std::vector<std::string> lines;
+
+    void Collect(const char* line, const size_t length) { lines.emplace_back(line, length); }
+
+    void Discard(const char*, size_t) { }
+
+    // The text after "L (ms) tag: " without the newline
+    std::string Message(const std::string& line) {
+        const size_t start = line.find(": ");
+        return line.substr(start + 2, line.size() - start - 3);
+    }
+
+    // Waits for the start of the next rate window so that a burst does not straddle two of them
+    void NextSecond() {
+        const int64_t now = esp_timer_get_time();
+        std::this_thread::sleep_for(std::chrono::microseconds(1000000 - now % 1000000 + 1000));
+    }
+
+    LogRecord Record(const LogSite& site, std::initializer_list<LogArg> args) {
+        CHECK(args.size() <= LogRecord::MaxArgs);
+        LogRecord record{&site, 1234567, static_cast<uint8_t>(args.size()), {}};
+        std::copy(args.begin(), args.end(), record.args);
+        return record;
+    }
+
+    std::string Formatted(const LogRecord& record, const size_t size = DeferredLog::MaxLine) {
+        char line[DeferredLog::MaxLine];
+        const size_t length = DeferredLog::Format(record, line, size);
+        CHECK(length < size && line[length] == '\0' && line[length - 1] == '\n');
+        return {line, length};
+    }
+
+    void Format() {
+        static LogSite numbers{"Meter", "%d %ld %lld %u %lu %llu %x %zu", 'I'};
+        CHECK(Formatted(Record(numbers, {{-7}, {-70000}, {-5000000000LL}, {4000000000LL}, {4000000000LL},
+            {5000000000LL}, {255}, {12}})) ==
+            "I (1234) Meter: -7 -70000 -5000000000 4000000000 4000000000 5000000000 ff 12\n");
+        static LogSite flags{"Meter", "%c|%5d|%-3u|%%|%04X", 'I'};
+        CHECK(Formatted(Record(flags, {{'k'}, {42}, {9}, {0xBEEF}})) == "I (1234) Meter: k|   42|9  |%|BEEF\n");
+        static LogSite reals{"Ripple", "%s: %.0fHz %.2fmA %e", 'W'};
+        LogArg name{};
+        name.pointer = "ch0";
+        LogArg hz{};
+        hz.real = 1001.6;
+        LogArg ma{};
+        ma.real = -0.125;
+        LogArg tiny{};
+        tiny.real = 1.5e-9;
+        CHECK(Formatted(Record(reals, {name, hz, ma, tiny})) == "W (1234) Ripple: ch0: 1002Hz -0.12mA 1.500000e-09\n");
+        // arguments missing from the record and a null string do not crash the drain task
+        LogArg null{};
+        null.pointer = nullptr;
+        CHECK(Formatted(Record(reals, {null})) == "W (1234) Ripple: (null): <?>Hz <?>mA <?>\n");
+        // a line longer than the buffer is cut, the newline stays
+        static LogSite longer{"Long", "%s%s%s", 'E'};
+        const std::string text(200, 'x');
+        LogArg part{};
+        part.pointer = text.c_str();
+        const std::string cut = Formatted(Record(longer, {part, part, part}));
+        CHECK(cut.size() == DeferredLog::MaxLine - 1 && cut.starts_with("E (1234) Long: xxx"));
+        CHECK(Formatted(Record(longer, {part}), 24) == "E (1234) Long: xxxxxxx\n");
+    }
+
+    // Records of several sites come out in the order they were written, arguments intact
+    void Order() {
+        lines.clear();
+        NextSecond();
+        for (int i = 0; i < 5; i++) {
+            DLOGI("A", "a %d", i);
+            DLOGW("B", "b %d %s", i * 10, "x");
+            DLOGE("C", "c %.1f", i * 0.5);
+        }
+        DeferredLog::Flush(false);
+        CHECK(lines.size() == 15);
+        bool ordered = lines.size() == 15;
+        for (int i = 0; ordered && i < 5; i++) {
+            ordered &= Message(lines[i * 3]) == "a " + std::to_string(i) && lines[i * 3][0] == 'I';
+            ordered &= Message(lines[i * 3 + 1]) == "b " + std::to_string(i * 10) + " x" && lines[i * 3 + 1][0] == 'W';
+            char c[16];
+            snprintf(c, sizeof(c), "c %.1f", i * 0.5);
+            ordered &= Message(lines[i * 3 + 2]) == c && lines[i * 3 + 2][0] == 'E';
+        }
+        CHECK(ordered);
+    }
+
+    void RateLimit() {
+        lines.clear();
+        NextSecond();
+        for (int i = 0; i < 100; i++) {
+            DLOGW("Sampler", "bus %d over budget", i);
+        }
+        DeferredLog::Flush(true);
+        // the first `RatePerSecond` records, then one line for the rest
+        CHECK(lines.size() == DeferredLog::RatePerSecond + 1);
+        CHECK(Message(lines[0]) == "bus 0 over budget" && Message(lines[4]) == "bus 4 over budget");
+        CHECK(Message(lines.back()) == "95 more like \"bus %d over budget\"");
+        // reported once, the count starts over
+        lines.clear();
+        DeferredLog::Flush(true);
+        CHECK(lines.empty());
+        // a new second lets the site through again
+        NextSecond();
+        for (int i = 0; i < 7; i++) {
+            DLOGW("Sampler", "bus %d over budget", i);
+        }
+        DeferredLog::Flush(true);
+        CHECK(lines.size() == DeferredLog::RatePerSecond + 1);
+        CHECK(Message(lines.back()) == "2 more like \"bus %d over budget\"");
+    }
+
+    // One site per instantiation, all of them within their rate
+    template<int N>
+    void Burst() {
+        for (uint32_t i = 0; i < DeferredLog::RatePerSecond; i++) {
+            DLOGI("Burst", "site %d record %lu", N, static_cast<unsigned long>(i));
+        }
+    }
+
+    template<int... N>
+    void Bursts(std::integer_sequence<int, N...>) { (Burst<N>(), ...); }
+
+    void Dropped() {
+        lines.clear();
+        NextSecond();
+        // 100 records into a ring of 64 that nobody drains meanwhile
+        Bursts(std::make_integer_sequence<int, 20>{});
+        DeferredLog::Flush(true);
+        CHECK(lines.size() == DeferredLog::Capacity + 1);
+        CHECK(Message(lines[0]) == "site 0 record 0");
+        CHECK(Message(lines[DeferredLog::Capacity - 1]) == "site 12 record 3");
+        CHECK(Message(lines.back()) == "36 records dropped");
+    }
+
+    struct Item {
+        uint32_t producer;
+        uint32_t seq;
+    };
+
+    struct Producer {
+        MpscRing<Item>* ring;
+        uint32_t id;
+        uint32_t count;
+        std::atomic<uint32_t> pushed{0};
+        std::atomic<bool> done{false};
+    };
+
+    // Producers on several tasks: what each pushed comes out in its order, what did not fit is counted
+    void Producers() {
+        MpscRing<Item> ring{256};
+        constexpr uint32_t Count = 100000;
+        Producer producers[4];
+        for (uint32_t id = 0; id < 4; id++) {
+            producers[id].ring = &ring;
+            producers[id].id = id;
+            producers[id].count = Count;
+            xTaskCreatePinnedToCore([](void* arg) {
+                auto& producer = *static_cast<Producer*>(arg);
+                for (uint32_t seq = 0; seq < producer.count; seq++) {
+                    producer.pushed += producer.ring->Push([&](Item& item) { item = {producer.id, seq}; });
+                    // let the others and the consumer in, on one CPU a producer would fill the ring alone
+                    if (seq % 16 == 0) {
+                        std::this_thread::yield();
+                    }
+                }
+                producer.done = true;
+                vTaskDelete(nullptr);
+            }, "Producer", 4096, &producers[id], 3, nullptr, 0);
+        }
+        uint32_t next[4]{};
+        uint32_t popped[4]{};
+        bool ordered = true;
+        Item item{};
+        const auto drain = [&] {
+            while (ring.Pop(item)) {
+                ordered &= item.producer < 4 && item.seq >= next[item.producer];
+                next[item.producer] = item.seq + 1;
+                popped[item.producer]++;
+            }
+        };
+        while (!(producers[0].done && producers[1].done && producers[2].done && producers[3].done)) {
+            drain();
+            std::this_thread::yield();
+        }
+        drain();
+        uint32_t total = 0;
+        bool accounted = true;
+        for (uint32_t id = 0; id < 4; id++) {
+            accounted &= popped[id] == producers[id].pushed;
+            total += popped[id];
+        }
+        printf("4 producers, %lu items: %lu through the ring, %lu dropped\n", static_cast<unsigned long>(4 * Count),
+            static_cast<unsigned long>(total), static_cast<unsigned long>(ring.dropped.load()));
+        CHECK(ordered);
+        CHECK(accounted);
+        CHECK(total + ring.dropped == 4 * Count);
+    }
+
+    // What a call site costs the sampling task: a record copied into the ring, a suppressed call, and for
+    // comparison the formatting the drain task does instead
+    void Benchmark() {
+        DeferredLog::sink = Discard;
+        constexpr size_t Sites = 12;
+        LogSite sites[Sites] = {
+            {"Meter", "Bus %u load %.1f%%", 'I'}, {"Meter", "Bus %u load %.1f%%", 'I'},
+            {"Meter", "Bus %u load %.1f%%", 'I'}, {"Meter", "Bus %u load %.1f%%", 'I'},
+            {"Meter", "Bus %u load %.1f%%", 'I'}, {"Meter", "Bus %u load %.1f%%", 'I'},
+            {"Meter", "Bus %u load %.1f%%", 'I'}, {"Meter", "Bus %u load %.1f%%", 'I'},
+            {"Meter", "Bus %u load %.1f%%", 'I'}, {"Meter", "Bus %u load %.1f%%", 'I'},
+            {"Meter", "Bus %u load %.1f%%", 'I'}, {"Meter", "Bus %u load %.1f%%", 'I'},
+        };
+        // 60 records a round fit the ring, each site starts the round with its whole rate
+        constexpr size_t Rounds = 20000;
+        double queuedNs = 0;
+        for (size_t round = 0; round < Rounds; round++) {
+            for (LogSite& site : sites) {
+                site.inSecond = 0;
+            }
+            const auto start = std::chrono::steady_clock::now();
+            for (LogSite& site : sites) {
+                for (uint32_t i = 0; i < DeferredLog::RatePerSecond; i++) {
+                    DeferredLog::Write(site, i, 42.5f);
+                }
+            }
+            queuedNs += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+            DeferredLog::Flush(false);
+        }
+        queuedNs /= Rounds * Sites * DeferredLog::RatePerSecond;
+        const double suppressedNs = check::NsPer(1000000, [&](const size_t i) {
+            DeferredLog::Write(sites[0], static_cast<uint32_t>(i), 42.5f);
+        });
+        char line[DeferredLog::MaxLine];
+        const double formattedNs = check::NsPer(200000, [&](const size_t i) {
+            snprintf(line, sizeof(line), "I (%lu) %s: Bus %u load %.1f%%\n", 1234ul, "Meter",
+                static_cast<unsigned>(i), 42.5);
+            asm volatile("" ::: "memory");
+        });
+        DeferredLog::Flush(true);
+        printf("call site: %.1f ns queued, %.1f ns suppressed, formatting in place %.1f ns\n", queuedNs,
+            suppressedNs, formattedNs);
+        CHECK(queuedNs < formattedNs);
+    }
+}
+
+int main() {
+    Arenas::Init();
+    DeferredLog::Init();
+    DeferredLog::sink = Collect;
+    Format();
+    Order();
+    RateLimit();
+    Dropped();
+    Producers();
+    Benchmark();
+    return check::Result();
+}
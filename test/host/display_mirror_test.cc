@@ -0,0 +1,351 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+#include <esp_timer.h>
+
+#include "check.hh"
+#include "display_mirror.hh"
+
+// The link as the viewer sees it: every byte Telemetry wrote, in order
+namespace {
+    std::vector<uint8_t> wire;
+    int invalidations = 0;
+}
+
+hal::Serial::Serial(size_t, size_t) { }
+
+hal::Serial::~Serial() = default;
+
+size_t hal::Serial::Write(const uint8_t* data, const size_t size, TickType_t) const {
+    wire.insert(wire.end(), data, data + size);
+    return size;
+}
+
+size_t hal::Serial::Read(uint8_t*, size_t, TickType_t) const { return 0; }
+
+lv_obj_t* lv_scr_act() { return nullptr; }
+
+void lv_obj_invalidate(const lv_obj_t*) { invalidations++; }
+
+namespace {
+    constexpr uint16_t Width = 240;
+    constexpr uint16_t Height = 280;
+
+    // What mirror.py does with kMirror payloads, returns false where it would count an error
+    struct Viewer {
+        std::vector<uint16_t> pixels = std::vector<uint16_t>(Width * Height);
+        uint32_t frames{0};
+
+        static bool DecodeRow(const uint8_t*& pos, const uint8_t* end, uint16_t* row, const size_t count) {
+            size_t x = 0;
+            while (x < count) {
+                if (pos >= end) {
+                    return false;
+                }
+                const uint8_t op = *pos & 0xC0;
+                const size_t n = (*pos++ & 0x3F) + 1;
+                if (x + n > count) {
+                    return false;
+                }
+                if (op == DisplayMirror::OpRun) {
+                    if (end - pos < 2) { return false; }
+                    uint16_t pixel;
+                    memcpy(&pixel, pos, sizeof(pixel));
+                    pos += sizeof(pixel);
+                    std::fill_n(row + x, n, pixel);
+                } else if (op == DisplayMirror::OpLiteral) {
+                    if (static_cast<size_t>(end - pos) < n * sizeof(uint16_t)) { return false; }
+                    memcpy(row + x, pos, n * sizeof(uint16_t));
+                    pos += n * sizeof(uint16_t);
+                } else if (op != DisplayMirror::OpSkip) {
+                    return false;
+                }
+                x += n;
+            }
+            return true;
+        }
+
+        bool Apply(const uint8_t* payload, const size_t length) {
+            MirrorHeader header;
+            memcpy(&header, payload, sizeof(header));
+            if (header.screenWidth != Width || header.screenHeight != Height || header.x + header.width > Width ||
+                header.y + header.rows > Height) {
+                return false;
+            }
+            const uint8_t* pos = payload + sizeof(header);
+            for (uint16_t row = 0; row < header.rows; row++) {
+                if (!DecodeRow(pos, payload + length, &pixels[(header.y + row) * Width + header.x], header.width)) {
+                    return false;
+                }
+            }
+            frames++;
+            return pos == payload + length;
+        }
+
+        // Applies every kMirror frame on the wire and empties it
+        bool Drain() {
+            bool ok = true;
+            size_t pos = 0;
+            while (pos + sizeof(FrameHeader) <= wire.size()) {
+                FrameHeader header;
+                memcpy(&header, &wire[pos], sizeof(header));
+                const uint8_t* payload = &wire[pos + sizeof(header)];
+                uint16_t crc;
+                memcpy(&crc, payload + header.length, sizeof(crc));
+                ok &= crc == Telemetry::Crc16(&wire[pos + 2], sizeof(header) - 2 + header.length);
+                if (header.type == static_cast<uint8_t>(FrameType::kMirror)) {
+                    ok &= Apply(payload, header.length);
+                }
+                pos += sizeof(header) + header.length + sizeof(crc);
+            }
+            ok &= pos == wire.size();
+            wire.clear();
+            return ok;
+        }
+    };
+
+    // A meter screen as LVGL would draw it: four panels, each with a changing reading in blocky digits and a
+    // scrolling trace. Only what changed is flushed, one area per widget.
+    struct Ui {
+        static constexpr uint16_t Panel = Height / 4;
+        static constexpr uint16_t Background = 0x18E3;
+        static constexpr uint16_t Ink = 0xFFFF;
+        static constexpr uint16_t Trace = 0x07E0;
+
+        std::vector<uint16_t> screen = std::vector<uint16_t>(Width * Height);
+        std::vector<lv_color_t> flush = std::vector<lv_color_t>(Width * Height);
+        std::mt19937 rng{7};
+        uint32_t step{0};
+
+        void Flush(DisplayMirror& mirror, const lv_area_t& area) {
+            size_t i = 0;
+            for (lv_coord_t y = area.y1; y <= area.y2; y++) {
+                for (lv_coord_t x = area.x1; x <= area.x2; x++) {
+                    flush[i++].full = screen[y * Width + x];
+                }
+            }
+            mirror.Capture(area, flush.data());
+        }
+
+        void Fill(const lv_area_t& area, const uint16_t colour) {
+            for (lv_coord_t y = area.y1; y <= area.y2; y++) {
+                std::fill_n(&screen[y * Width + area.x1], area.x2 - area.x1 + 1, colour);
+            }
+        }
+
+        void Full(DisplayMirror& mirror) {
+            Fill({0, 0, Width - 1, Height - 1}, Background);
+            for (uint16_t panel = 0; panel < 4; panel++) {
+                Fill({0, static_cast<lv_coord_t>(panel * Panel), Width - 1, static_cast<lv_coord_t>(panel * Panel)},
+                    0x4208);
+            }
+            Flush(mirror, {0, 0, Width - 1, Height - 1});
+        }
+
+        // Six digits of 8x12 pixels, each a pattern of 2x2 blocks
+        void Reading(DisplayMirror& mirror, const uint16_t panel) {
+            const lv_area_t area{8, static_cast<lv_coord_t>(panel * Panel + 6), 8 + 6 * 10 - 1,
+                                 static_cast<lv_coord_t>(panel * Panel + 6 + 11)};
+            Fill(area, Background);
+            for (int digit = 0; digit < 6; digit++) {
+                const uint32_t glyph = rng();
+                for (int block = 0; block < 24; block++) {
+                    if (glyph >> block & 1) {
+                        const auto x = static_cast<lv_coord_t>(area.x1 + digit * 10 + block % 4 * 2);
+                        const auto y = static_cast<lv_coord_t>(area.y1 + block / 4 * 2);
+                        Fill({x, y, static_cast<lv_coord_t>(x + 1), static_cast<lv_coord_t>(y + 1)}, Ink);
+                    }
+                }
+            }
+            Flush(mirror, area);
+        }
+
+        // The plot scrolls by a pixel, the whole plot area is redrawn
+        void Plot(DisplayMirror& mirror, const uint16_t panel) {
+            const lv_area_t area{0, static_cast<lv_coord_t>(panel * Panel + 24), Width - 1,
+                                 static_cast<lv_coord_t>(panel * Panel + Panel - 2)};
+            Fill(area, Background);
+            const int height = area.y2 - area.y1;
+            for (lv_coord_t x = 0; x < Width; x++) {
+                const int phase = static_cast<int>((x + step + panel * 37) % 60);
+                const int level = (phase < 30 ? phase : 60 - phase) * height / 30;
+                const auto y = static_cast<lv_coord_t>(area.y2 - level);
+                Fill({x, y, x, area.y2}, panel % 2 == 0 ? Trace : static_cast<uint16_t>(0x001F | x << 11));
+            }
+            Flush(mirror, area);
+        }
+
+        void Step(DisplayMirror& mirror) {
+            step++;
+            for (uint16_t panel = 0; panel < 4; panel++) {
+                Reading(mirror, panel);
+                if (step % 2 == 0) {
+                    Plot(mirror, panel);
+                }
+            }
+        }
+
+        void Noise(DisplayMirror& mirror) {
+            for (uint16_t& pixel : screen) {
+                pixel = static_cast<uint16_t>(rng());
+            }
+            Flush(mirror, {0, 0, Width - 1, Height - 1});
+        }
+    };
+
+    // Pumps as the LVGL timer does until the dirty rows are out
+    void Settle(DisplayMirror& mirror) {
+        for (int i = 0; i < 1000 && mirror.dirty; i++) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            mirror.Pump();
+        }
+    }
+
+    void RoundTrip() {
+        std::mt19937 rng{3};
+        uint16_t row[300];
+        uint16_t previous[300];
+        uint16_t decoded[300];
+        uint8_t out[2 * 300 + 5];
+        bool exact = true;
+        bool bounded = true;
+        bool tight = true;
+        for (int round = 0; round < 20000; round++) {
+            const size_t count = 1 + rng() % 300;
+            // noise, flat fills and unchanged stretches in every mix
+            const uint32_t change = rng() % 5;
+            const uint32_t colours = 1 + rng() % 4;
+            for (size_t i = 0; i < count; i++) {
+                previous[i] = static_cast<uint16_t>(rng() % 3);
+                row[i] = rng() % 4 < change ? static_cast<uint16_t>(rng() % colours + (round % 3 == 0 ? rng() : 0))
+                                             : previous[i];
+                decoded[i] = previous[i];
+            }
+            const size_t len = DisplayMirror::EncodeRow(row, previous, count, out, sizeof(out));
+            // two bytes a pixel and a token per MaxCount of them when nothing repeats
+            bounded &= len > 0 && len <= 2 * count + (count + DisplayMirror::MaxCount - 1) / DisplayMirror::MaxCount;
+            const uint8_t* pos = out;
+            exact &= Viewer::DecodeRow(pos, out + len, decoded, count) && pos == out + len &&
+                memcmp(row, decoded, count * sizeof(uint16_t)) == 0;
+            uint8_t small[sizeof(out)];
+            tight &= DisplayMirror::EncodeRow(row, previous, count, small, len) == len &&
+                DisplayMirror::EncodeRow(row, previous, count, small, len - 1) == 0;
+        }
+        CHECK(exact);
+        CHECK(bounded);
+        CHECK(tight);
+        // a row without changes is one skip per MaxCount pixels
+        std::fill_n(row, 300, 5);
+        CHECK(DisplayMirror::EncodeRow(row, row, 300, out, sizeof(out)) == 5);
+    }
+
+    // The synthetic meter screen through Capture, Pump and the viewer, compared pixel for pixel after each step.
+    // With `stream` set the link bytes and the final screen are written out for mirror_test.py.
+    void Stream(const char* stream, const char* screen) {
+        hal::Serial serial{0, 0};
+        Telemetry telemetry{serial};
+        DisplayMirror mirror{telemetry, Width, Height};
+        Viewer viewer;
+        Ui ui;
+        wire.clear();
+        std::vector<uint8_t> recorded;
+        mirror.SetBudget(10000000);
+        mirror.Pump();
+        CHECK(invalidations == 1);
+        ui.Full(mirror);
+        bool same = true;
+        bool decoded = true;
+        constexpr int Steps = 300;
+        for (int step = 0; step < Steps; step++) {
+            if (step > 0) {
+                ui.Step(mirror);
+            }
+            Settle(mirror);
+            recorded.insert(recorded.end(), wire.begin(), wire.end());
+            decoded &= viewer.Drain();
+            same &= viewer.pixels == ui.screen;
+        }
+        CHECK(decoded);
+        CHECK(same);
+        CHECK(!mirror.dirty && viewer.frames == mirror.frames);
+        const double ratio = static_cast<double>(mirror.rawBytes) / static_cast<double>(mirror.sentBytes);
+        printf("%d screen updates in %lu frames: %llu bytes for %llu raw, ratio %.1f, encode %.1fus per frame\n",
+            Steps, static_cast<unsigned long>(mirror.frames), static_cast<unsigned long long>(mirror.sentBytes),
+            static_cast<unsigned long long>(mirror.rawBytes), ratio,
+            static_cast<double>(mirror.encodeUs) / mirror.frames);
+        // most of every redrawn area is what the host already has
+        CHECK(ratio > 4);
+        if (stream != nullptr) {
+            FILE* file = fopen(stream, "wb");
+            fwrite(recorded.data(), 1, recorded.size(), file);
+            fclose(file);
+            file = fopen(screen, "wb");
+            fwrite(ui.screen.data(), sizeof(uint16_t), ui.screen.size(), file);
+            fclose(file);
+        }
+    }
+
+    // Bytes sent while the whole screen changes every 10ms for `durationUs`
+    uint64_t Saturate(DisplayMirror& mirror, Ui& ui, const int64_t durationUs) {
+        const uint64_t before = mirror.sentBytes;
+        const int64_t end = esp_timer_get_time() + durationUs;
+        while (esp_timer_get_time() < end) {
+            ui.Noise(mirror);
+            mirror.Pump();
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        wire.clear();
+        return mirror.sentBytes - before;
+    }
+
+    void Budget() {
+        hal::Serial serial{0, 0};
+        Telemetry telemetry{serial};
+        DisplayMirror mirror{telemetry, Width, Height};
+        Ui ui;
+        invalidations = 0;
+        constexpr uint32_t Rate = 20000;
+        constexpr int64_t DurationUs = 500000;
+        mirror.SetBudget(Rate);
+        mirror.Pump();
+        const uint64_t slow = Saturate(mirror, ui, DurationUs);
+        // the credit never exceeds one burst of 200ms, or one payload
+        const uint64_t burst = std::max<uint64_t>(Rate / 5, Telemetry::MaxPayload);
+        printf("%u bytes/s for %lldms: sent %llu bytes\n", Rate, static_cast<long long>(DurationUs / 1000),
+            static_cast<unsigned long long>(slow));
+        CHECK(slow <= Rate * DurationUs / 1000000 + burst);
+        CHECK(slow >= Rate * DurationUs / 1000000 / 2);
+
+        // a new budget for the running stream changes the rate only: no redraw and the rows still owed stay dirty
+        CHECK(mirror.dirty);
+        const lv_area_t owed = mirror.area;
+        mirror.SetBudget(2 * Rate);
+        mirror.Pump();
+        CHECK(invalidations == 1);
+        CHECK(mirror.budget == 2 * Rate && mirror.dirty && mirror.area.y1 >= owed.y1 && mirror.area.y2 == owed.y2);
+        const uint64_t fast = Saturate(mirror, ui, DurationUs);
+        CHECK(fast > slow * 3 / 2);
+
+        // stopping drops what is owed, captures are ignored until the stream restarts from black with a full redraw
+        mirror.SetBudget(0);
+        mirror.Pump();
+        CHECK(!mirror.dirty);
+        ui.Noise(mirror);
+        CHECK(!mirror.dirty);
+        mirror.SetBudget(Rate);
+        mirror.Pump();
+        CHECK(invalidations == 2 && mirror.sentBytes == 0);
+        CHECK(std::all_of(mirror.shadow, mirror.shadow + Width * Height, [](const uint16_t p) { return p == 0; }));
+    }
+}
+
+int main(const int argc, char** argv) {
+    Arenas::Init();
+    RoundTrip();
+    Stream(argc > 2 ? argv[1] : nullptr, argc > 2 ? argv[2] : nullptr);
+    Budget();
+    return check::Result();
+}
@@ -0,0 +1,211 @@
+// Host implementations of the ESP-IDF and FreeRTOS calls declared in stubs/
+#include <chrono>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <pthread.h>
+#include <sched.h>
+#include <thread>
+
+#include <esp_heap_caps.h>
+#include <esp_log.h>
+#include <esp_system.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/event_groups.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+void* heap_caps_malloc(const size_t size, uint32_t) { return malloc(size); }
+
+void* heap_caps_aligned_alloc(const size_t alignment, const size_t size, uint32_t) {
+    return aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+}
+
+void heap_caps_free(void* ptr) { free(ptr); }
+
+size_t heap_caps_get_free_size(uint32_t) { return 0; }
+
+void esp_log_host(const char level, const char* tag, const char* format, ...) {
+    printf("%c (%s) ", level, tag);
+    va_list args;
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+    printf("\n");
+}
+
+void esp_system_abort(const char* details) {
+    fprintf(stderr, "abort: %s\n", details);
+    abort();
+}
+
+uint32_t esp_get_free_heap_size() { return 0; }
+
+int64_t esp_timer_get_time() {
+    static const auto start = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Every task is a detached std::thread; the main thread is a task too, with a handle of its own. Handles are
+// never freed, a test creates a bounded number of tasks.
+//
+// A task pinned to a core the host has runs on that CPU only. Priorities above RealtimePriority are mapped to
+// SCHED_FIFO where the host permits it, so such a task preempts ordinary threads as it would preempt lower
+// priorities on FreeRTOS; everything else shares the CPU the way Linux does.
+struct HostTask {
+    char name[16];
+    bool realtime{false};
+    std::mutex lock{};
+    std::condition_variable notified{};
+    uint32_t notifications{0};
+};
+
+struct HostEventGroup {
+    std::mutex lock;
+    std::condition_variable changed;
+    EventBits_t bits{0};
+};
+
+// Mutexes and binary semaphores alike: a count of at most one
+struct HostSemaphore {
+    std::mutex lock;
+    std::condition_variable given;
+    bool available;
+};
+
+namespace {
+    constexpr UBaseType_t RealtimePriority = configMAX_PRIORITIES / 2;
+
+    thread_local HostTask mainTask{"main"};
+    thread_local HostTask* currentTask = &mainTask;
+
+    void Place(HostTask* task, const UBaseType_t priority, const BaseType_t core) {
+        if (core >= 0 && core != tskNO_AFFINITY && static_cast<unsigned>(core) < std::thread::hardware_concurrency()) {
+            cpu_set_t cpus;
+            CPU_ZERO(&cpus);
+            CPU_SET(core, &cpus);
+            pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+        }
+        if (priority > RealtimePriority) {
+            sched_param param{};
+            param.sched_priority = static_cast<int>(priority);
+            task->realtime = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0;
+        }
+    }
+}
+
+bool HostTaskIsRealtime(TaskHandle_t task) { return (task != nullptr ? task : currentTask)->realtime; }
+
+BaseType_t xTaskCreatePinnedToCore(const TaskFunction_t fn, const char* name, uint32_t, void* arg,
+                                   const UBaseType_t priority, TaskHandle_t* created, const BaseType_t core) {
+    auto* task = new HostTask{};
+    strncpy(task->name, name, sizeof(task->name) - 1);
+    if (created != nullptr) {
+        *created = task;
+    }
+    std::thread([fn, arg, task, priority, core] {
+        currentTask = task;
+        Place(task, priority, core);
+        fn(arg);
+    }).detach();
+    return pdPASS;
+}
+
+// Only a task deleting itself is supported, and it has to return from its function right after
+void vTaskDelete(TaskHandle_t) { }
+
+void vTaskDelay(const TickType_t ticks) { std::this_thread::sleep_for(std::chrono::milliseconds(ticks)); }
+
+TickType_t xTaskGetTickCount() { return static_cast<TickType_t>(esp_timer_get_time() / 1000); }
+
+TaskHandle_t xTaskGetCurrentTaskHandle() { return currentTask; }
+
+char* pcTaskGetName(TaskHandle_t task) { return (task != nullptr ? task : currentTask)->name; }
+
+BaseType_t xPortGetCoreID() { return sched_getcpu(); }
+
+uint32_t ulTaskNotifyTake(const BaseType_t clear, const TickType_t ticks) {
+    HostTask* task = currentTask;
+    std::unique_lock guard{task->lock};
+    const auto ready = [&] { return task->notifications > 0; };
+    if (ticks == portMAX_DELAY) {
+        task->notified.wait(guard, ready);
+    } else {
+        // a timeout ends on a tick, 1ms, boundary as on FreeRTOS
+        const auto deadline = std::chrono::steady_clock::now() +
+            std::chrono::microseconds((esp_timer_get_time() / 1000 + ticks) * 1000 - esp_timer_get_time());
+        task->notified.wait_until(guard, deadline, ready);
+    }
+    const uint32_t value = task->notifications;
+    if (value > 0) {
+        task->notifications = clear ? 0 : value - 1;
+    }
+    return value;
+}
+
+BaseType_t xTaskNotifyGive(const TaskHandle_t task) {
+    std::lock_guard guard{task->lock};
+    task->notifications++;
+    task->notified.notify_one();
+    return pdPASS;
+}
+
+EventGroupHandle_t xEventGroupCreate() { return new HostEventGroup{}; }
+
+EventBits_t xEventGroupSetBits(const EventGroupHandle_t group, const EventBits_t bits) {
+    std::lock_guard guard{group->lock};
+    group->bits |= bits;
+    group->changed.notify_all();
+    return group->bits;
+}
+
+EventBits_t xEventGroupWaitBits(const EventGroupHandle_t group, const EventBits_t bits, const BaseType_t clear,
+                                const BaseType_t all, const TickType_t ticks) {
+    std::unique_lock guard{group->lock};
+    const auto ready = [&] { return all ? (group->bits & bits) == bits : (group->bits & bits) != 0; };
+    if (ticks == portMAX_DELAY) {
+        group->changed.wait(guard, ready);
+    } else {
+        group->changed.wait_for(guard, std::chrono::milliseconds(ticks), ready);
+    }
+    const EventBits_t value = group->bits;
+    if (clear && ready()) {
+        group->bits &= ~bits;
+    }
+    return value;
+}
+
+EventBits_t xEventGroupGetBits(const EventGroupHandle_t group) {
+    std::lock_guard guard{group->lock};
+    return group->bits;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex() { return new HostSemaphore{.available = true}; }
+
+SemaphoreHandle_t xSemaphoreCreateBinary() { return new HostSemaphore{.available = false}; }
+
+BaseType_t xSemaphoreTake(const SemaphoreHandle_t semaphore, const TickType_t ticks) {
+    std::unique_lock guard{semaphore->lock};
+    const auto ready = [&] { return semaphore->available; };
+    if (ticks == portMAX_DELAY) {
+        semaphore->given.wait(guard, ready);
+    } else if (!semaphore->given.wait_for(guard, std::chrono::milliseconds(ticks), ready)) {
+        return pdFALSE;
+    }
+    semaphore->available = false;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(const SemaphoreHandle_t semaphore) {
+    std::lock_guard guard{semaphore->lock};
+    if (semaphore->available) {
+        return pdFALSE;
+    }
+    semaphore->available = true;
+    semaphore->given.notify_one();
+    return pdTRUE;
+}
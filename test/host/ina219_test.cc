@@ -0,0 +1,119 @@
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+#include "check.hh"
+#include "meter_bus.hh"
+#include "sim_board.hh"
+
+namespace {
+    int16_t Saturated(const int32_t current) {
+        return static_cast<int16_t>(std::clamp(current, static_cast<int32_t>(INT16_MIN),
+            static_cast<int32_t>(INT16_MAX)));
+    }
+
+    // Calibrations a board could be set up with: the 100mOhm/5A default, small and large shunts, the edges
+    constexpr uint16_t Calibrations[] = {0, 1, 2, 512, 2684, 2685, 4096, 8192, 13421, 26843, 40960, 0xFFFE, 0xFFFF};
+
+    void Current() {
+        uint32_t mismatches = 0;
+        for (const uint16_t calibration : Calibrations) {
+            for (int32_t shunt = -32000; shunt <= 32000; shunt++) {
+                const auto raw = static_cast<int16_t>(shunt);
+                mismatches += hal::Ina219::DeriveCurrent(raw, calibration) !=
+                    Saturated(sim::DatasheetCurrent(raw, calibration));
+            }
+        }
+        CHECK(mismatches == 0);
+    }
+
+    void Power() {
+        // every current register value against bus voltages from 0 to 32V, the flag bits set and clear
+        uint32_t mismatches = 0;
+        bool unsignedFits = true;
+        for (int32_t current = INT16_MIN; current <= INT16_MAX; current++) {
+            for (uint32_t volts = 0; volts <= 8191; volts += 7) {
+                const auto bus = static_cast<uint16_t>(volts << 3 | (volts & 0x3));
+                const uint32_t datasheet = sim::DatasheetPower(current, bus);
+                unsignedFits &= datasheet <= UINT16_MAX;
+                mismatches += hal::Ina219::DerivePower(static_cast<int16_t>(current), bus) != datasheet;
+            }
+        }
+        CHECK(unsignedFits);
+        CHECK(mismatches == 0);
+        // reverse current draws the same power as forward current
+        CHECK(hal::Ina219::DerivePower(-2096, 3000 << 3) == hal::Ina219::DerivePower(2096, 3000 << 3));
+    }
+
+    // A load swinging between forward and reverse current, a new level every 2ms so that Verify() finds the
+    // registers unchanged between its reads most of the time
+    sim::Load Swing(const void* arg, const int64_t timeUs) {
+        const auto amps = *static_cast<const float*>(arg);
+        const auto step = static_cast<float>(timeUs / 2000);
+        return {12.0f + std::fmod(step, 7.0f), amps * std::sin(step * 0.3f)};
+    }
+
+    void Chip() {
+        sim::Reset();
+        // on 100mOhm and 10mOhm shunts
+        const float amps[] = {-2.0f, 1.5f};
+        sim::GetBus(0).Attach(0x40, Swing, &amps[0], 0.1f);
+        sim::GetBus(0).Attach(0x41, Swing, &amps[1], 0.01f);
+        hal::I2CBus bus{I2C_NUM_0, 8, 9};
+        MeterBus meters[] = {{bus, 0x40, 10, "reverse", 100.0f}, {bus, 0x41, 11, "forward", 10.0f}};
+        bool powerMatches = true;
+        bool negative = false;
+        for (MeterBus& meter : meters) {
+            meter.Enable();
+            for (uint32_t i = 0; i < 4 * MeterBus::VerifyInterval; i++) {
+                meter.Update();
+                negative |= meter.current < 0;
+                // power is a magnitude within a current LSB times the bus voltage of |V * I|
+                const float expected = std::fabs(meter.voltage * meter.current);
+                powerMatches &= meter.power >= 0 &&
+                    std::fabs(meter.power - expected) <= meter.ina.currentLsb * (meter.voltage + 1) * 20;
+            }
+            printf("%s: %lu verified, %lu mismatches\n", meter.name, static_cast<unsigned long>(meter.verified),
+                static_cast<unsigned long>(meter.mismatches));
+            CHECK(meter.verified > 0);
+            CHECK(meter.mismatches == 0);
+        }
+        CHECK(negative);
+        CHECK(powerMatches);
+
+        // a steady reverse current: every check goes through and the chip's power register agrees
+        constexpr float Reverse = -3.0f;
+        sim::GetBus(0).Attach(0x42, [](const void*, int64_t) { return sim::Load{5.0f, Reverse}; }, nullptr, 0.1f);
+        MeterBus reverse{bus, 0x42, 12, "steady"};
+        for (int i = 0; i < 8; i++) {
+            reverse.Verify(reverse.ina.ReadRaw());
+        }
+        CHECK(reverse.verified == 8 && reverse.mismatches == 0);
+        reverse.Update();
+        CHECK(reverse.current < 0 && std::fabs(reverse.power - 15.0f) < 0.05f);
+    }
+
+    void Benchmark() {
+        std::mt19937 rng{5};
+        int16_t shunts[4096];
+        uint16_t buses[4096];
+        for (size_t i = 0; i < 4096; i++) {
+            shunts[i] = static_cast<int16_t>(static_cast<int32_t>(rng() % 64001) - 32000);
+            buses[i] = static_cast<uint16_t>(rng() % 8192 << 3 | 0x2);
+        }
+        volatile uint32_t sink = 0;
+        const double ns = check::NsPer(10000000, [&](const size_t i) {
+            const int16_t current = hal::Ina219::DeriveCurrent(shunts[i % 4096], 2684);
+            sink = sink + hal::Ina219::DerivePower(current, buses[i % 4096]);
+        });
+        printf("deriving current and power: %.1f ns per reading, one transaction saved\n", ns);
+    }
+}
+
+int main() {
+    Current();
+    Power();
+    Chip();
+    Benchmark();
+    return check::Result();
+}
@@ -0,0 +1,78 @@
+#include <esp_timer.h>
+#include <freertos/task.h>
+
+#include "check.hh"
+#include "init_graph.hh"
+
+namespace {
+    // Stand-in for a stage's work: how long it takes, in milliseconds
+    struct Work {
+        TickType_t ms;
+    };
+
+    void Simulate(void* arg) {
+        vTaskDelay(pdMS_TO_TICKS(static_cast<Work*>(arg)->ms));
+    }
+
+    Work sensors{40};
+    Work serial{10};
+    Work display{60};
+    Work ui{5};
+    Work remote{5};
+    Work streamer{5};
+    Work keypad{20};
+    Work report{1};
+    int64_t firstFrame{0};
+
+    // The shape of app_main's graph with made-up durations. The first frame is up after display and ui, 65ms,
+    // everything after the deferred keypad and the report, 86ms, against 146ms of stage time in total.
+    void CriticalPath() {
+        static InitGraph init{};
+        const uint32_t s = init.Add("sensors", Simulate, &sensors);
+        const uint32_t l = init.Add("serial", Simulate, &serial);
+        const uint32_t d = init.Add("display", Simulate, &display, 0, 1);
+        const uint32_t u = init.Add("ui", [](void* arg) {
+            Simulate(arg);
+            firstFrame = esp_timer_get_time();
+            init.MarkFirstFrame();
+        }, &ui, s | d);
+        const uint32_t r = init.Add("remote", Simulate, &remote, s | l, 0);
+        const uint32_t t = init.Add("streamer", Simulate, &streamer, s | l, 0);
+        const uint32_t k = init.Add("keypad", Simulate, &keypad, InitGraph::FirstFrame);
+        const uint32_t all = init.Add("report", Simulate, &report, u | k | r | t);
+
+        const int64_t begin = esp_timer_get_time();
+        init.Run();
+        init.Wait(s | l | r | t);
+        const int64_t ready = esp_timer_get_time();
+        init.Wait(all);
+        const int64_t end = esp_timer_get_time();
+        init.Report();
+
+        // no stage starts before everything it depends on has finished
+        for (size_t i = 0; i < init.count; i++) {
+            const InitGraph::Stage& stage = init.stages[i];
+            CHECK(stage.end >= stage.start + static_cast<int64_t>(static_cast<Work*>(stage.arg)->ms) * 1000);
+            for (size_t dep = 0; dep < init.count; dep++) {
+                if (stage.deps & 1u << dep && !CHECK(stage.start >= init.stages[dep].end)) {
+                    printf("%s started before %s finished\n", stage.name, init.stages[dep].name);
+                }
+            }
+        }
+        // deferred work waits for the first frame, which ui marks at its end
+        CHECK(firstFrame > 0 && init.stages[6].start >= firstFrame);
+        // independent stages overlap: the sensors are done long before the display is
+        CHECK(init.stages[0].start - begin < 5000 && init.stages[2].start - begin < 5000);
+        // the sampling tasks could start once sensors, serial, remote and streamer are up, ~45ms, and not wait
+        // for the display
+        CHECK(ready - begin < 60000);
+        const int64_t elapsed = end - begin;
+        printf("boot %.1fms for 146ms of stage time, critical path 86ms\n", static_cast<double>(elapsed) / 1000.);
+        CHECK(elapsed >= 86000 && elapsed < 120000);
+    }
+}
+
+int main() {
+    CriticalPath();
+    return check::Result();
+}
@@ -0,0 +1,118 @@
+#include <atomic>
+#include <cmath>
+#include <thread>
+#include <esp_timer.h>
+#include <freertos/task.h>
+
+#include "check.hh"
+#include "cores.hh"
+#include "jitter.hh"
+
+// Built once per task placement: with CONFIG_TINYMETER_CORE_PARTITION set and without. The sampler's wake-up
+// lateness is measured alone and then next to a synthetic render load on the I/O side.
+namespace {
+    constexpr int64_t PeriodUs = 2000;
+    constexpr int64_t RenderBurstUs = 15000; // one LVGL frame of a busy screen
+    constexpr int64_t RunUs = 1500000;
+
+    std::atomic<bool> rendering{false};
+
+    void Stats() {
+        JitterStats stats;
+        CHECK(stats.Mean() == 0.0f && stats.StdDev() == 0.0f);
+        for (const int32_t lateness : {10, 20, 30, 40}) {
+            stats.Add(lateness);
+        }
+        CHECK(stats.count == 4 && stats.min == 10 && stats.max == 40);
+        CHECK(stats.Mean() == 25.0f);
+        CHECK(std::fabs(stats.StdDev() - std::sqrt(125.0f)) < 1e-3f);
+        stats.Reset();
+        CHECK(stats.count == 0 && stats.max == INT32_MIN);
+    }
+
+    // Busy for a frame, then idle until the next LVGL timer tick, for as long as `rendering` is set
+    void Render(void*) {
+        while (rendering) {
+            const int64_t until = esp_timer_get_time() + RenderBurstUs;
+            while (esp_timer_get_time() < until) { }
+            vTaskDelay(pdMS_TO_TICKS(5));
+        }
+        vTaskDelete(nullptr);
+    }
+
+    struct Sampler {
+        JitterStats jitter{};
+        bool realtime{false};
+        std::atomic<bool> done{false};
+    };
+
+    // The waiting part of App::Sample: sleep on the task notification until the next channel is due
+    void Sample(void* arg) {
+        auto& sampler = *static_cast<Sampler*>(arg);
+        sampler.realtime = HostTaskIsRealtime(nullptr);
+        const int64_t end = esp_timer_get_time() + RunUs;
+        int64_t cycleStart = esp_timer_get_time();
+        while (cycleStart < end) {
+            sampler.jitter.Add(static_cast<int32_t>(esp_timer_get_time() - cycleStart));
+            cycleStart += PeriodUs;
+            while (true) {
+                const int64_t remaining = cycleStart - esp_timer_get_time();
+                if (remaining <= 0) {
+                    break;
+                }
+                ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(remaining / 1000) + 1);
+            }
+        }
+        sampler.done = true;
+        vTaskDelete(nullptr);
+    }
+
+    JitterStats Measure(const int renderTasks, bool& realtime) {
+        rendering = true;
+        for (int i = 0; i < renderTasks; i++) {
+            xTaskCreatePinnedToCore(Render, "Render", 4096, nullptr, cores::IoPriority, nullptr, cores::Io);
+        }
+        Sampler sampler;
+        xTaskCreatePinnedToCore(Sample, "Sampler", 4096, &sampler, cores::SamplerPriority, nullptr, cores::Sampler);
+        while (!sampler.done) {
+            vTaskDelay(10);
+        }
+        rendering = false;
+        vTaskDelay(pdMS_TO_TICKS(RenderBurstUs / 1000 + 10));
+        realtime = sampler.realtime;
+        return sampler.jitter;
+    }
+
+    void Print(const char* label, const JitterStats& stats) {
+        printf("%s %-11s lateness min:%ldus mean:%.1fus sd:%.1fus max:%ldus over %lu wake-ups\n", cores::Name(), label,
+            static_cast<long>(stats.min), stats.Mean(), stats.StdDev(), static_cast<long>(stats.max),
+            static_cast<unsigned long>(stats.count));
+    }
+
+    // 77: the host can neither give the sampler a CPU of its own nor realtime priority
+    int UnderRenderLoad() {
+        bool realtime = false;
+        const JitterStats idle = Measure(0, realtime);
+        const JitterStats loaded = Measure(2, realtime);
+        Print("idle", idle);
+        Print("render load", loaded);
+        CHECK(idle.count > 0 && loaded.count > 0);
+        if (!cores::Partitioned) {
+            return 0;
+        }
+        if (!realtime && std::thread::hardware_concurrency() < 2) {
+            printf("no realtime scheduling and a single CPU, the partitioned placement cannot be reproduced\n");
+            return 77;
+        }
+        // the sampler preempts rendering or runs beside it, it never waits for a frame to finish
+        CHECK(loaded.max < RenderBurstUs / 2);
+        return 0;
+    }
+}
+
+int main() {
+    Stats();
+    const int skipped = UnderRenderLoad();
+    const int result = check::Result();
+    return result != 0 ? result : skipped;
+}
@@ -0,0 +1,159 @@
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <type_traits>
+#include <vector>
+
+#include "check.hh"
+#include "kernels.hh"
+
+// Every kernel against its reference, bit for bit: all lengths up to 300 so that every tail after the
+// `Lanes`-wide part is covered, strides 1 and 3 (Point's, as the plot decimates it) and block sizes
+// around and across `Lanes`.
+namespace {
+    constexpr size_t MaxCount = 300;
+    constexpr size_t Strides[] = {1, 3};
+    constexpr size_t Factors[] = {1, 2, 3, 4, 5, 7, 8, 9, 16, 17, 64, 300, 301};
+
+    std::mt19937 rng{17};
+
+    template<typename T>
+    T Random() {
+        if constexpr (std::is_floating_point_v<T>) {
+            // signed values across many magnitudes, the sums round differently depending on their order
+            const auto mantissa = static_cast<T>(static_cast<int32_t>(rng() % 2000001) - 1000000);
+            return std::ldexp(mantissa, static_cast<int>(rng() % 40) - 30);
+        } else {
+            return static_cast<T>(rng());
+        }
+    }
+
+    bool Same(const float a, const float b) { return memcmp(&a, &b, sizeof(float)) == 0; }
+
+    void Scale() {
+        std::vector<int16_t> in(MaxCount + 1);
+        bool same = true;
+        for (const float scale : {0.0f, 1.0f, 1.52587890625e-4f, 0.0915527f, -3.3f, 1e30f}) {
+            for (const float offset : {0.0f, -0.5f, 1.5f, 1e-7f}) {
+                for (size_t count = 0; count <= MaxCount; count++) {
+                    for (int16_t& value : in) {
+                        value = Random<int16_t>();
+                    }
+                    in[0] = INT16_MIN;
+                    in[count / 2] = INT16_MAX;
+                    // one past the end is a canary
+                    std::vector<float> out(count + 1, 42.0f);
+                    std::vector<float> expected(count + 1, 42.0f);
+                    kernels::Scale(in.data(), out.data(), count, scale, offset);
+                    kernels::reference::Scale(in.data(), expected.data(), count, scale, offset);
+                    same &= memcmp(out.data(), expected.data(), (count + 1) * sizeof(float)) == 0;
+                }
+            }
+        }
+        CHECK(same);
+    }
+
+    void MinMaxSum() {
+        std::vector<float> in(MaxCount);
+        bool same = true;
+        bool close = true;
+        for (int round = 0; round < 20; round++) {
+            for (size_t count = 0; count <= MaxCount; count++) {
+                for (float& value : in) {
+                    value = Random<float>();
+                }
+                if (round % 2 == 1 && count > 0) {
+                    // extremes in the tail and in the first element
+                    in[count - 1] = std::numeric_limits<float>::max();
+                    in[0] = -std::numeric_limits<float>::max();
+                }
+                const kernels::Summary summary = kernels::MinMaxSum(in.data(), count);
+                const kernels::Summary expected = kernels::reference::MinMaxSum(in.data(), count);
+                same &= Same(summary.min, expected.min) && Same(summary.max, expected.max) &&
+                    Same(summary.sum, expected.sum);
+                // the reference's order of additions is still a sum: within the float error bound of the exact one
+                double exact = 0;
+                double magnitude = 0;
+                for (size_t i = 0; i < count; i++) {
+                    exact += in[i];
+                    magnitude += std::fabs(in[i]);
+                }
+                const double bound = static_cast<double>(count) * std::numeric_limits<float>::epsilon() * magnitude;
+                close &= std::isinf(expected.sum) || std::fabs(expected.sum - exact) <= bound;
+            }
+        }
+        CHECK(same);
+        CHECK(close);
+    }
+
+    template<typename T>
+    bool Decimate() {
+        std::vector<T> in(MaxCount * 3 + 1);
+        bool same = true;
+        for (const size_t stride : Strides) {
+            for (const size_t factor : Factors) {
+                for (size_t count = 0; count <= MaxCount; count++) {
+                    for (T& value : in) {
+                        value = Random<T>();
+                    }
+                    const size_t blocks = (count + factor - 1) / factor;
+                    std::vector<kernels::Range<T>> out(blocks + 1, {T{42}, T{42}});
+                    std::vector<kernels::Range<T>> expected(blocks + 1, {T{42}, T{42}});
+                    // starting one element in, the way the plot reads a field of Point
+                    kernels::DecimateMinMax(in.data() + 1, stride, count, factor, out.data());
+                    kernels::reference::DecimateMinMax(in.data() + 1, stride, count, factor, expected.data());
+                    same &= memcmp(out.data(), expected.data(), (blocks + 1) * sizeof(kernels::Range<T>)) == 0;
+                }
+            }
+        }
+        return same;
+    }
+
+    template<typename F>
+    void Benchmark(const char* name, const size_t count, F&& fn) {
+        const double ns = check::NsPer(20000, [&](size_t) {
+            fn();
+            asm volatile("" ::: "memory");
+        });
+        printf("%-32s %7.1f ns per block of %zu, %.2f ns per element\n", name, ns, count, ns / count);
+    }
+
+    void Benchmarks() {
+        constexpr size_t Count = 1024;
+        std::vector<int16_t> raw(Count * 3);
+        for (int16_t& value : raw) {
+            value = Random<int16_t>();
+        }
+        std::vector<float> samples(Count);
+        std::vector<kernels::Range<int16_t>> ranges(Count);
+        volatile float sink = 0;
+        Benchmark("Scale", Count, [&] { kernels::Scale(raw.data(), samples.data(), Count, 0.0915527f); });
+        Benchmark("Scale (reference)", Count, [&] {
+            kernels::reference::Scale(raw.data(), samples.data(), Count, 0.0915527f);
+        });
+        Benchmark("MinMaxSum", Count, [&] { sink = kernels::MinMaxSum(samples.data(), Count).sum; });
+        Benchmark("MinMaxSum (reference)", Count, [&] {
+            sink = kernels::reference::MinMaxSum(samples.data(), Count).sum;
+        });
+        Benchmark("DecimateMinMax x4 stride 3", Count, [&] {
+            kernels::DecimateMinMax(raw.data(), 3, Count, 4, ranges.data());
+        });
+        Benchmark("DecimateMinMax (reference)", Count, [&] {
+            kernels::reference::DecimateMinMax(raw.data(), 3, Count, 4, ranges.data());
+        });
+    }
+}
+
+int main() {
+#if __has_include(<dsps_mulc.h>)
+    printf("Scale through ESP-DSP\n");
+#endif
+    Scale();
+    MinMaxSum();
+    CHECK(Decimate<int16_t>());
+    CHECK(Decimate<uint16_t>());
+    CHECK(Decimate<float>());
+    Benchmarks();
+    return check::Result();
+}
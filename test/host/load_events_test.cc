@@ -0,0 +1,179 @@
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "check.hh"
+#include "load_events.hh"
+
+namespace {
+    constexpr float Volts = 5.0f;
+
+    // Feeds `wave` (A at a time in us) plus gaussian noise every `periodUs` for `seconds`, returns the events
+    template<typename F>
+    std::vector<LoadEvent> Replay(F&& wave, const double seconds, const int64_t periodUs, const float sigma,
+                                  const unsigned seed = 1) {
+        LoadEventDetector detector{};
+        std::mt19937 rng{seed};
+        std::normal_distribution<float> noise{0.0f, sigma};
+        std::vector<LoadEvent> events;
+        for (int64_t t = 0; t < static_cast<int64_t>(seconds * 1e6); t += periodUs) {
+            const float current = std::max(0.0f, wave(t) + noise(rng));
+            LoadEvent event{};
+            if (detector.Push(t, current, current * Volts, event)) {
+                events.push_back(event);
+            }
+        }
+        return events;
+    }
+
+    // No events from noise on a steady load or from a slow charge taper, at the 20Hz base rate for an hour
+    void Quiet() {
+        for (const float sigma : {0.001f, 0.003f, 0.005f}) {
+            CHECK(Replay([](int64_t) { return 0.5f; }, 3600, 50000, sigma).empty());
+        }
+        const auto taper = [](const int64_t t) {
+            return static_cast<float>(1.0 - 0.9 * std::min(1.0, static_cast<double>(t) / 1.8e9));
+        };
+        CHECK(Replay(taper, 3600, 50000, 0.002f).empty());
+    }
+
+    // Steps from MinShift up are all found, larger ones sooner, the change point within a few readings
+    void Steps() {
+        constexpr int64_t StepUs = 10000000;
+        constexpr int64_t PeriodUs = 50000;
+        for (const float step : {LoadEventDetector::MinShift, 0.05f, 0.1f, 0.5f, -0.1f}) {
+            int found = 0;
+            int64_t delays = 0;
+            bool placed = true;
+            bool kind = true;
+            for (unsigned seed = 1; seed <= 50; seed++) {
+                const auto events = Replay([&](const int64_t t) { return t >= StepUs ? 0.3f + step : 0.3f; }, 20,
+                    PeriodUs, 0.002f, seed);
+                const auto event = std::find_if(events.begin(), events.end(),
+                    [](const LoadEvent& e) { return e.detectedUs >= StepUs; });
+                if (event == events.end()) {
+                    continue;
+                }
+                found++;
+                delays += (event->detectedUs - StepUs) / PeriodUs;
+                placed &= std::llabs(event->timeUs - StepUs) <= 3 * PeriodUs;
+                kind &= event->kind == (step > 0 ? LoadEvent::Kind::kRise : LoadEvent::Kind::kFall);
+                kind &= std::fabs(event->before - 0.3f) < 0.005f && std::fabs(event->after - (0.3f + step)) < 0.02f;
+            }
+            const double delay = found > 0 ? static_cast<double>(delays) / found : 0;
+            printf("step %+4.0fmA: detected %d/50, mean delay %.1f readings\n", step * 1e3, found, delay);
+            CHECK(found == 50);
+            CHECK(placed);
+            CHECK(kind);
+            CHECK(delay <= (std::fabs(step) >= 0.1f ? 1.0 : 15.0));
+        }
+    }
+
+    // A device plugged in: inrush, a charge phase that tapers off, a trickle, unplugged
+    void Session() {
+        const auto wave = [](const int64_t t) {
+            if (t < 2000000) {
+                return 0.0f;
+            }
+            if (t < 2060000) {
+                return 2.0f;
+            }
+            if (t < 60000000) {
+                return 1.5f;
+            }
+            if (t < 120000000) {
+                return 1.5f - 1.2f * static_cast<float>(t - 60000000) / 60e6f;
+            }
+            return t < 150000000 ? 0.3f : 0.0f;
+        };
+        const auto events = Replay(wave, 180, 5000, 0.002f);
+        for (const LoadEvent& event : events) {
+            printf("  %-6s at %.3fs (+%.0fms) %.3fA -> %.3fA, segment %.2fs %.3fJ\n",
+                LoadEventDetector::Name(event.kind), static_cast<double>(event.timeUs) / 1e6,
+                static_cast<double>(event.detectedUs - event.timeUs) / 1e3, event.before, event.after,
+                static_cast<double>(event.durationUs) / 1e6, event.energy);
+        }
+        CHECK(events.size() == 3);
+        if (events.size() != 3) {
+            return;
+        }
+        CHECK(events[0].kind == LoadEvent::Kind::kPlugIn && std::llabs(events[0].timeUs - 2000000) <= 5000);
+        CHECK(events[1].kind == LoadEvent::Kind::kInrush && std::llabs(events[1].timeUs - 2060000) <= 5000);
+        // the inrush segment: 2A at 5V for 60ms
+        CHECK(std::llabs(events[1].durationUs - 60000) <= 10000 && std::fabs(events[1].energy - 0.6f) < 0.1f);
+        CHECK(events[2].kind == LoadEvent::Kind::kIdle && std::llabs(events[2].timeUs - 150000000) <= 5000);
+        // charge and taper: 1.5A for 58s, the ramp down to 0.3A over 60s and 0.3A for 30s, all at 5V
+        const float charged = Volts * (1.5f * 57.94f + 0.9f * 60.0f + 0.3f * 30.0f);
+        CHECK(std::fabs(events[2].energy - charged) < charged * 0.01f);
+    }
+
+    // A reading after a gap longer than any sampling period adds no energy
+    void Gap() {
+        LoadEventDetector detector{};
+        LoadEvent event{};
+        int64_t t = 0;
+        for (; t < 1000000; t += 50000) {
+            detector.Push(t, 1.0f, Volts, event);
+        }
+        t += LoadEventDetector::MaxGapUs + 1;
+        for (int i = 0; i < 20; i++, t += 50000) {
+            detector.Push(t, 1.0f, Volts, event);
+        }
+        CHECK(detector.Push(t, 0.0f, 0.0f, event) && event.kind == LoadEvent::Kind::kIdle);
+        // 19 periods before the gap and 19 after it
+        CHECK(std::fabs(event.energy - Volts * 0.05f * 38) < 0.01f);
+    }
+
+    // Hours of steady load read at 1kHz, then a step: the ended segment's mean and energy still come out exact to
+    // far below the resolution of a reading
+    void LongSegment() {
+        constexpr float Amps = 1.234567f;
+        constexpr int64_t PeriodUs = 1000;
+        constexpr int64_t DurationUs = 2LL * 3600 * 1000000;
+        LoadEventDetector detector{};
+        LoadEvent event{};
+        bool quiet = true;
+        int64_t t = 0;
+        for (; t < DurationUs; t += PeriodUs) {
+            quiet &= !detector.Push(t, Amps, Amps * Volts, event);
+        }
+        while (!detector.Push(t, 0.5f, 0.5f * Volts, event)) {
+            t += PeriodUs;
+        }
+        const double joules = static_cast<double>(Amps) * Volts * static_cast<double>(DurationUs) * 1e-6;
+        printf("2h at 1kHz: mean %.7fA (drawn %.7fA), %.3fJ (drawn %.3fJ)\n", event.before, Amps, event.energy,
+            joules);
+        CHECK(quiet);
+        CHECK(std::fabs(event.before - Amps) < 1e-6f);
+        CHECK(std::fabs(event.energy - joules) < joules * 1e-5);
+    }
+
+    void Benchmark() {
+        std::mt19937 rng{1};
+        std::normal_distribution<float> noise{0.5f, 0.002f};
+        std::vector<float> readings(4096);
+        for (float& reading : readings) {
+            reading = noise(rng);
+        }
+        LoadEventDetector detector{};
+        LoadEvent event{};
+        size_t events = 0;
+        const double ns = check::NsPer(10000000, [&](const size_t i) {
+            const float current = readings[i % readings.size()];
+            events += detector.Push(static_cast<int64_t>(i) * 1000, current, current * Volts, event);
+        });
+        printf("LoadEventDetector::Push %.1f ns per reading (%zu events), %zu bytes per channel\n", ns, events,
+            sizeof(LoadEventDetector));
+    }
+}
+
+int main() {
+    Quiet();
+    Steps();
+    Session();
+    Gap();
+    LongSegment();
+    Benchmark();
+    return check::Result();
+}
@@ -0,0 +1,132 @@
+#!/usr/bin/env python3
+
+# MeterClient against a fake device on a pty: the device answers commands the way main.cc does, with log
+# lines and telemetry frames in between, so the client has to pick its responses out of a busy link.
+
+import os
+import pty
+import select
+import sys
+import time
+import tty
+import threading
+import unittest
+
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), '..', '..'))
+
+import telemetry
+from telemetry import FrameType, Opcode, Status
+from meter_client import MeterClient, CommandError
+
+
+class FakeDevice(threading.Thread):
+    def __init__(self, chatter=3):
+        super().__init__(daemon=True)
+        self.master, slave = pty.openpty()
+        tty.setraw(self.master)
+        self.port = os.ttyname(slave)
+        self.slave = slave
+        self.chatter = chatter
+        self.seq = 0
+        self.commands = []
+        self.running = True
+
+    def send(self, frame_type, payload):
+        os.write(self.master, telemetry.encode(frame_type, self.seq, payload))
+        self.seq += 1
+
+    def answer(self, command_id, opcode, channel, value):
+        for i in range(self.chatter):
+            os.write(self.master, b'I (%d) Meter: line before the response\n' % i)
+            self.send(FrameType.SAMPLES, telemetry.SAMPLES_HEADER.pack(0, 0, 1, i, 0) +
+                      telemetry.SAMPLE.pack(5000000, 100000, 500000))
+        status = Status.OK
+        if opcode == Opcode.ENABLE and channel >= 8:
+            status = Status.BAD_CHANNEL
+        elif opcode == Opcode.SET_SAMPLE_PERIOD and not 1000 <= value <= 10000000:
+            status = Status.BAD_VALUE
+        if opcode == Opcode.QUERY_STATS:
+            self.send(FrameType.STATS, telemetry.STATS.pack(1234, 10, 0, 0, len(self.commands), 5, 90, 20, 100000,
+                                                            1, 8, 0xff))
+        if opcode == Opcode.CAPTURE_RIPPLE:
+            return  # never answered, the client times out
+        self.send(FrameType.RESPONSE, telemetry.RESPONSE.pack(command_id, opcode, status, 42 + command_id, value))
+
+    def run(self):
+        decoder = telemetry.Decoder()
+        while self.running:
+            if not select.select([self.master], [], [], 0.05)[0]:
+                continue
+            data = os.read(self.master, 4096)
+            for item in decoder.feed(data):
+                if item[0] == 'frame' and item[1] == FrameType.COMMAND:
+                    command = telemetry.COMMAND.unpack(item[3])
+                    self.commands.append(command)
+                    self.answer(*command)
+
+    def close(self):
+        self.running = False
+        self.join()
+        os.close(self.slave)
+        os.close(self.master)
+
+
+class MeterClientTest(unittest.TestCase):
+    def setUp(self):
+        self.device = FakeDevice()
+        self.device.start()
+        self.frames = []
+        self.lines = []
+        self.client = MeterClient(self.device.port, on_frame=lambda *frame: self.frames.append(frame),
+                                  on_text=self.lines.append)
+
+    def tearDown(self):
+        self.client.close()
+        self.device.close()
+
+    def test_request_matches_response(self):
+        latency, _ = self.client.ping()
+        self.assertEqual(latency, 43)
+        self.assertEqual(self.client.enable(3)[0], 44)
+        self.assertEqual(self.device.commands[1], (2, Opcode.ENABLE, 3, 0))
+        self.assertEqual(self.client.latencies, [43, 44])
+
+    def test_chatter_is_handed_on(self):
+        self.client.ping()
+        self.assertEqual(len(self.lines), 3)
+        self.assertTrue(all(line.startswith(b'I (') for line in self.lines))
+        self.assertEqual([frame[0] for frame in self.frames], [FrameType.SAMPLES] * 3)
+        self.assertEqual(self.client.decoder.crc_errors, 0)
+
+    def test_errors(self):
+        with self.assertRaises(CommandError) as error:
+            self.client.enable(9)
+        self.assertEqual(error.exception.status, Status.BAD_CHANNEL)
+        with self.assertRaises(CommandError) as error:
+            self.client.set_sample_period(10)
+        self.assertEqual(error.exception.status, Status.BAD_VALUE)
+        # a failed request does not leave a stale response behind for the next one
+        self.assertEqual(self.client.ping()[0], 45)
+
+    def test_timeout(self):
+        with self.assertRaises(TimeoutError):
+            self.client.request(Opcode.CAPTURE_RIPPLE, 0, timeout=0.2)
+
+    def test_stats(self):
+        stats = self.client.query_stats()
+        self.assertEqual(stats['uptime_ms'], 1234)
+        self.assertEqual(stats['enabled'], 0xff)
+        self.assertEqual(stats['commands'], 1)
+
+    def test_round_trip(self):
+        count = 200
+        started = time.monotonic()
+        for _ in range(count):
+            self.client.ping()
+        elapsed = time.monotonic() - started
+        print('\n%d requests over a pty: %.0f us round trip' % (count, elapsed / count * 1e6))
+        self.assertEqual(len(self.device.commands), count)
+
+
+if __name__ == '__main__':
+    unittest.main()
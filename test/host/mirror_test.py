@@ -0,0 +1,55 @@
+#!/usr/bin/env python3
+
+# mirror.py against the firmware's encoder: display_mirror_test, given as the argument, streams a synthetic
+# meter screen through DisplayMirror and writes the link bytes and the screen it drew. The viewer has to end
+# up with the same pixels.
+
+import os
+import sys
+import struct
+import tempfile
+import subprocess
+import unittest
+
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), '..', '..'))
+
+import telemetry
+from telemetry import FrameType
+from mirror import Screen
+
+ENCODER = sys.argv.pop(1) if len(sys.argv) > 1 else None
+
+
+@unittest.skipIf(ENCODER is None, 'needs the path of display_mirror_test')
+class EncoderTest(unittest.TestCase):
+    def setUp(self):
+        with tempfile.TemporaryDirectory() as directory:
+            stream, screen = os.path.join(directory, 'stream.bin'), os.path.join(directory, 'screen.bin')
+            subprocess.run([ENCODER, stream, screen], check=True, stdout=subprocess.DEVNULL)
+            with open(stream, 'rb') as file:
+                self.stream = file.read()
+            with open(screen, 'rb') as file:
+                pixels = file.read()
+            self.screen = list(struct.unpack('<%dH' % (len(pixels) // 2), pixels))
+
+    def test_rebuilds_screen(self):
+        decoder = telemetry.Decoder()
+        screen = Screen()
+        frames = [item for item in decoder.feed(self.stream) if item[0] == 'frame']
+        self.assertEqual((decoder.lost, decoder.crc_errors), (0, 0))
+        for _, frame_type, _, payload in frames:
+            self.assertEqual(frame_type, FrameType.MIRROR)
+            self.assertTrue(screen.apply(payload))
+        self.assertEqual((screen.width, screen.height, screen.errors), (240, 280, 0))
+        self.assertEqual(screen.frames, len(frames))
+        self.assertEqual(screen.pixels, self.screen)
+
+    def test_rejects_truncated(self):
+        payload = next(item[3] for item in telemetry.Decoder().feed(self.stream) if item[0] == 'frame')
+        screen = Screen()
+        self.assertFalse(screen.apply(payload[:-1]))
+        self.assertEqual(screen.errors, 1)
+
+
+if __name__ == '__main__':
+    unittest.main()
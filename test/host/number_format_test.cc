@@ -0,0 +1,133 @@
+#include <cstring>
+#include <random>
+
+#include "check.hh"
+#include "number_format.hh"
+
+using number_format::Prefix;
+
+namespace {
+    // snprintf renders the exact binary value, so a micro value whose scaled fraction is exactly .5 may round
+    // either way there; FormatFixed always rounds half away from zero
+    bool IsTie(const int64_t micro, const Prefix prefix, const int decimals) {
+        const int64_t divisor = number_format::PrefixDivisor(prefix) / number_format::Pow10(decimals);
+        return divisor > 1 && (micro < 0 ? -micro : micro) % divisor == divisor / 2;
+    }
+
+    void AgainstSnprintf() {
+        std::mt19937_64 rng{1};
+        int mismatches = 0;
+        for (int i = 0; i < 1000000; i++) {
+            const int64_t micro = static_cast<int64_t>(rng() % 60000000) - 30000000;
+            const auto prefix = static_cast<Prefix>(rng() % 3);
+            const int decimals = static_cast<int>(rng() % (3 * static_cast<int>(prefix) + 1));
+            if (IsTie(micro, prefix, decimals)) {
+                continue;
+            }
+            char actual[32];
+            char expected[32];
+            number_format::FormatFixed(actual, sizeof(actual), micro, prefix, decimals, "A", 12);
+            const char* symbol = number_format::PrefixSymbol(prefix);
+            snprintf(expected, sizeof(expected), "%*.*Lf%sA", static_cast<int>(12 - 1 - strlen(symbol)), decimals,
+                static_cast<long double>(micro) / number_format::PrefixDivisor(prefix), symbol);
+            if (strcmp(actual, expected) != 0 && mismatches++ < 10) {
+                printf("%lld: '%s' != '%s'\n", static_cast<long long>(micro), actual, expected);
+            }
+        }
+        CHECK(mismatches == 0);
+    }
+
+    bool Renders(const int64_t micro, const Prefix prefix, const int digits, const char* expected) {
+        char out[16];
+        number_format::FormatSignificant(out, sizeof(out), micro, prefix, digits, "V");
+        if (strcmp(out, expected) != 0) {
+            printf("%lld: '%s' != '%s'\n", static_cast<long long>(micro), out, expected);
+            return false;
+        }
+        return true;
+    }
+
+    void Significant() {
+        CHECK(Renders(5123456, Prefix::kUnit, 4, "5.123V"));
+        CHECK(Renders(12345678, Prefix::kUnit, 4, "12.35V"));
+        CHECK(Renders(999960, Prefix::kUnit, 4, "1.000V"));
+        CHECK(Renders(9999960, Prefix::kUnit, 4, "10.00V"));
+        CHECK(Renders(99999600, Prefix::kUnit, 4, "100.0V"));
+        CHECK(Renders(1, Prefix::kMilli, 4, "0.001mV")); // never finer than a micro-unit
+        CHECK(Renders(-20400, Prefix::kMilli, 3, "-20.4mV"));
+    }
+
+    void Truncation() {
+        char out[6];
+        memset(out, 'x', sizeof(out));
+        const size_t len = number_format::FormatFixed(out, sizeof(out), 123456789, Prefix::kUnit, 3, "V");
+        CHECK(len == 5);
+        CHECK(strcmp(out, "123.4") == 0);
+        CHECK(number_format::FormatFixed(out, 0, 1, Prefix::kUnit, 0, "V") == 0);
+    }
+
+    // Decimals a prefix cannot resolve come out as the finest it can, the widest value still fits
+    void Decimals() {
+        char out[48];
+        char clamped[48];
+        for (int p = 0; p < 3; p++) {
+            const auto prefix = static_cast<Prefix>(p);
+            number_format::FormatFixed(clamped, sizeof(clamped), -1234567, prefix, 3 * p, "V");
+            for (const int decimals : {3 * p + 1, 7, 19, 64, 1000}) {
+                number_format::FormatFixed(out, sizeof(out), -1234567, prefix, decimals, "V");
+                CHECK(strcmp(out, clamped) == 0);
+            }
+        }
+        number_format::FormatFixed(out, sizeof(out), 1234567, Prefix::kUnit, -2, "V");
+        CHECK(strcmp(out, "1V") == 0);
+        CHECK(number_format::RoundScaled(1234567, Prefix::kMilli, 9) == 1234567);
+        const size_t len = number_format::FormatFixed(out, sizeof(out), INT64_MIN, Prefix::kUnit, 1000, "V");
+        CHECK(len == 22 && strcmp(out, "-9223372036854.775808V") == 0);
+    }
+
+    void Hysteresis() {
+        number_format::UnitFormatter format{"A", 4, 7};
+        char out[16];
+        const struct {
+            int64_t micro;
+            const char* expected;
+        } steps[] = {
+            {500000, "500.0mA"},
+            {999000, "999.0mA"},
+            {1000000, " 1.000A"}, // up as soon as it reaches 1000mA
+            {950000, " 0.950A"}, // stays in A within the hysteresis
+            {905000, " 0.905A"},
+            {899000, "899.0mA"}, // and only then goes back down
+            {1200000, " 1.200A"},
+        };
+        for (const auto& step : steps) {
+            format.Format(out, sizeof(out), step.micro);
+            if (!CHECK(strcmp(out, step.expected) == 0)) {
+                printf("%lld: '%s' != '%s'\n", static_cast<long long>(step.micro), out, step.expected);
+            }
+        }
+    }
+
+    void Benchmark() {
+        number_format::UnitFormatter format{"A", 4, 7};
+        char out[16];
+        volatile size_t sink = 0;
+        const double formatter = check::NsPer(5000000, [&](const size_t i) {
+            sink = sink + format.Format(out, sizeof(out), static_cast<int64_t>(i * 7));
+        });
+        const double reference = check::NsPer(5000000, [&](const size_t i) {
+            sink = sink + snprintf(out, sizeof(out), "%.3fA", static_cast<double>(i) * 7e-6);
+        });
+        printf("UnitFormatter %.1f ns per value, snprintf %.1f ns\n", formatter, reference);
+    }
+}
+
+int main() {
+    AgainstSnprintf();
+    Significant();
+    Truncation();
+    Decimals();
+    Hysteresis();
+    Benchmark();
+    return check::Result();
+}
@@ -0,0 +1,153 @@
+#include <algorithm>
+#include <deque>
+#include <random>
+#include <vector>
+
+#include "check.hh"
+#include "plot.hh"
+
+namespace {
+    // Same geometry as a MeterUi canvas
+    constexpr size_t Columns = 225;
+    constexpr size_t SamplesPerColumn = 4;
+    constexpr int Height = 50;
+
+    void TrackerAgainstScan() {
+        std::mt19937 rng{3};
+        int mismatches = 0;
+        for (const size_t window : {1, 2, 5, 225, 900}) {
+            RangeTracker tracker{window};
+            std::vector<int32_t> values;
+            for (int i = 0; i < 20000; i++) {
+                // runs of rising and falling values exercise both queues, not just random order
+                const auto value = i % 1000 < 500 ? static_cast<int32_t>(rng() % 2000) - 1000 : (i % 997) - 500;
+                tracker.Push(value);
+                values.push_back(value);
+                const auto begin = values.end() - static_cast<ptrdiff_t>(std::min(values.size(), window));
+                if (tracker.Min() != *std::min_element(begin, values.end()) ||
+                    tracker.Max() != *std::max_element(begin, values.end())) {
+                    mismatches++;
+                }
+            }
+            tracker.Reset();
+            CHECK(tracker.Empty());
+        }
+        CHECK(mismatches == 0);
+    }
+
+    // Column envelope by brute force. Current is drawn as its magnitude; a column whose samples change sign
+    // reaches down to zero rather than to the smallest magnitude.
+    Plot::Extent Envelope(const std::deque<Point>& window, const size_t begin, const size_t end,
+                          const Plot::Trace trace) {
+        int32_t lo = INT32_MAX;
+        int32_t hi = INT32_MIN;
+        for (size_t k = begin; k < end; k++) {
+            const int32_t value = trace == Plot::kCurrent ? window[k].current : Plot::TraceValue(window[k], trace);
+            lo = std::min(lo, value);
+            hi = std::max(hi, value);
+        }
+        if (trace != Plot::kCurrent || lo >= 0) {
+            return {lo, hi};
+        }
+        return hi <= 0 ? Plot::Extent{-hi, -lo} : Plot::Extent{0, std::max(-lo, hi)};
+    }
+
+    void ExtentsAgainstScan() {
+        std::mt19937 rng{5};
+        Plot plot{Columns, SamplesPerColumn};
+        std::deque<Point> window;
+        int mismatches = 0;
+        for (int i = 0; i < 3000; i++) {
+            // negative currents for the abs envelope, and power past 65W that once wrapped a 16 bit mW field
+            const Point point{
+                static_cast<float>(rng() % 26000) / 1000.0f,
+                static_cast<float>(static_cast<int>(rng() % 6000) - 3000) / 1000.0f,
+                static_cast<float>(rng() % 78000) / 1000.0f,
+            };
+            plot.Push(point);
+            window.push_back(point);
+            if (window.size() > Columns * SamplesPerColumn) {
+                window.pop_front();
+            }
+            if (i % 37 != 0 && i < 2990) {
+                continue;
+            }
+            for (const auto trace : {Plot::kVoltage, Plot::kCurrent, Plot::kPower}) {
+                const size_t used = plot.ColumnExtents(trace);
+                CHECK(used == (window.size() + SamplesPerColumn - 1) / SamplesPerColumn);
+                for (size_t column = 0; column < used; column++) {
+                    const size_t end = std::min(window.size(), (column + 1) * SamplesPerColumn);
+                    const Plot::Extent expected = Envelope(window, column * SamplesPerColumn, end, trace);
+                    if (plot.extents[column].lo != expected.lo || plot.extents[column].hi != expected.hi) {
+                        mismatches++;
+                    }
+                }
+                int32_t lo = INT32_MAX;
+                int32_t hi = INT32_MIN;
+                for (const Point& p : window) {
+                    lo = std::min(lo, Plot::TraceValue(p, trace));
+                    hi = std::max(hi, Plot::TraceValue(p, trace));
+                }
+                const Plot::Scale scale = plot.GetScale(trace);
+                if (window.size() > 1) {
+                    CHECK(scale.lo == lo && scale.hi == hi);
+                }
+            }
+        }
+        CHECK(mismatches == 0);
+    }
+
+    void PowerRange() {
+        // 26V at 3A is full scale and must land on the top row, not wrap around to the bottom
+        const Point full{26.0f, 3.0f, 78.0f};
+        const Point high{20.0f, 3.5f, 70.0f};
+        CHECK(Plot::TraceValue(full, Plot::kPower) > Plot::TraceValue(high, Plot::kPower));
+        CHECK(full.PowerY(Height) == Height);
+        Plot plot{Columns, SamplesPerColumn};
+        plot.mode = Plot::Mode::kFixed;
+        CHECK(Plot::MapY(Plot::TraceValue(full, Plot::kPower), plot.GetScale(Plot::kPower), Height) == 0);
+        CHECK(Plot::MapY(0, plot.GetScale(Plot::kPower), Height) == Height - 1);
+    }
+
+    void MinimumSpan() {
+        Plot plot{Columns, SamplesPerColumn};
+        for (int i = 0; i < 100; i++) {
+            plot.Push({5.0f, 0.001f, 0.0f});
+        }
+        const Plot::Scale voltage = plot.GetScale(Plot::kVoltage);
+        CHECK(voltage.hi - voltage.lo == Plot::MinVoltageSpan && voltage.lo <= 5000 && voltage.hi >= 5000);
+        const Plot::Scale power = plot.GetScale(Plot::kPower);
+        CHECK(power.lo == 0 && power.hi == Plot::MinPowerSpan); // never zooms below zero for positive traces
+    }
+
+    // What the UI timer does per meter and frame: one push, then scale and envelope of every trace
+    void Benchmark() {
+        Plot plot{Columns, SamplesPerColumn};
+        for (size_t i = 0; i < Columns * SamplesPerColumn; i++) {
+            plot.Push({5.0f, 0.02f * static_cast<float>(i % 9), 0.1f});
+        }
+        volatile int sink = 0;
+        const double ns = check::NsPer(20000, [&](const size_t frame) {
+            plot.Push({5.0f, 0.02f * static_cast<float>(frame % 9), 0.1f});
+            for (const auto trace : {Plot::kVoltage, Plot::kCurrent, Plot::kPower}) {
+                const Plot::Scale scale = plot.GetScale(trace);
+                const size_t used = plot.ColumnExtents(trace);
+                for (size_t column = 0; column < used; column++) {
+                    sink = sink + Plot::MapY(plot.extents[column].lo, scale, Height) +
+                        Plot::MapY(plot.extents[column].hi, scale, Height);
+                }
+            }
+        });
+        printf("plot frame, three traces over %zu columns: %.2f us\n", Columns, ns / 1000.0);
+    }
+}
+
+int main() {
+    Arenas::Init();
+    TrackerAgainstScan();
+    ExtentsAgainstScan();
+    PowerRange();
+    MinimumSpan();
+    Benchmark();
+    return check::Result();
+}
@@ -0,0 +1,295 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <string>
+#include <termios.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include <esp_timer.h>
+#include <freertos/task.h>
+
+#include "check.hh"
+#include "meter_client.hh"
+#include "spsc_ring.hh"
+
+// The board's end of a pseudo-terminal: what Telemetry writes goes to the client on the other end
+namespace {
+    int board = -1;
+}
+
+hal::Serial::Serial(size_t, size_t) { }
+
+hal::Serial::~Serial() = default;
+
+size_t hal::Serial::Write(const uint8_t* data, const size_t size, TickType_t) const {
+    size_t written = 0;
+    while (written < size) {
+        const ssize_t n = write(board, data + written, size - written);
+        if (n <= 0) {
+            break;
+        }
+        written += static_cast<size_t>(n);
+    }
+    return written;
+}
+
+size_t hal::Serial::Read(uint8_t* data, const size_t size, const TickType_t timeout) const {
+    pollfd ready{board, POLLIN, 0};
+    if (poll(&ready, 1, static_cast<int>(timeout)) <= 0) {
+        return 0;
+    }
+    const ssize_t n = read(board, data, size);
+    return n > 0 ? static_cast<size_t>(n) : 0;
+}
+
+namespace {
+    // The command path of the firmware on one task: the link read in chunks into FrameParser, commands through
+    // an SpscRing as Remote hands them to a sampler, answered through Telemetry with log lines and sample frames
+    // in between, so the client has to pick its responses out of a busy link. Commands are checked as
+    // App::Execute does; kCaptureRipple is never answered.
+    struct Device {
+        static constexpr uint8_t Channels = 8;
+
+        hal::Serial serial{0, 0};
+        Telemetry telemetry{serial};
+        FrameParser parser{[](void* arg, const FrameType type, uint8_t, const uint8_t* payload, const size_t length) {
+            static_cast<Device*>(arg)->OnFrame(type, payload, length);
+        }, this};
+        SpscRing<Command> commands{8};
+        int chatter;
+        uint16_t enabled{0};
+        uint32_t samplePeriodUs{50000};
+        LatencyStats latency{};
+        std::atomic<uint32_t> executed{0};
+        std::atomic<bool> done{false};
+        std::atomic<bool> finished{false};
+
+        explicit Device(const int chatter) : chatter{chatter} {
+            xTaskCreatePinnedToCore([](void* arg) {
+                auto& device = *static_cast<Device*>(arg);
+                while (!device.done) {
+                    uint8_t chunk[256];
+                    device.parser.Feed(chunk, device.serial.Read(chunk, sizeof(chunk), pdMS_TO_TICKS(10)));
+                    Command command{};
+                    while (device.commands.Pop(command)) {
+                        device.Execute(command);
+                    }
+                }
+                device.finished = true;
+                vTaskDelete(nullptr);
+            }, "Device", 4096, this, 3, nullptr, 0);
+        }
+
+        ~Device() {
+            done = true;
+            while (!finished) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+
+        void OnFrame(const FrameType type, const uint8_t* payload, const size_t length) {
+            if (type != FrameType::kCommand || length != sizeof(CommandPacket)) {
+                return;
+            }
+            Command command{{}, esp_timer_get_time()};
+            memcpy(&command.packet, payload, sizeof(command.packet));
+            if (!commands.Push(command)) {
+                const ResponsePacket response{command.packet.id, command.packet.opcode,
+                    static_cast<uint8_t>(Status::kBusy), 0, 0};
+                telemetry.Send(FrameType::kResponse, &response, sizeof(response));
+            }
+        }
+
+        void Execute(const Command& command) {
+            const CommandPacket& packet = command.packet;
+            for (int i = 0; i < chatter; i++) {
+                // a stray sync byte in a log line must not cost the client its response
+                const std::string line = "I (" + std::to_string(i) + ") Meter: \xA5 line before the response\n";
+                static_cast<void>(serial.Write(reinterpret_cast<const uint8_t*>(line.data()), line.size(), 0));
+                struct __attribute__((packed)) {
+                    SamplesHeader header;
+                    int32_t reading[3]; // a Packet
+                } samples{{0, 0, 1, static_cast<uint32_t>(i), 0}, {5000000, 100000, 500000}};
+                telemetry.Send(FrameType::kSamples, &samples, sizeof(samples));
+            }
+            auto status = Status::kOk;
+            switch (static_cast<Opcode>(packet.opcode)) {
+                case Opcode::kPing:
+                    break;
+                case Opcode::kEnable:
+                case Opcode::kDisable:
+                    if (packet.channel >= Channels) {
+                        status = Status::kBadChannel;
+                    } else if (static_cast<Opcode>(packet.opcode) == Opcode::kEnable) {
+                        enabled |= 1 << packet.channel;
+                    } else {
+                        enabled &= ~(1 << packet.channel);
+                    }
+                    break;
+                case Opcode::kSetSamplePeriod:
+                    if (packet.value < 1000 || packet.value > 10000000) {
+                        status = Status::kBadValue;
+                    } else {
+                        samplePeriodUs = packet.value;
+                    }
+                    break;
+                case Opcode::kCaptureRipple:
+                    executed++;
+                    return;
+                case Opcode::kQueryStats: {
+                    const StatsPacket stats{
+                        .uptimeMs = static_cast<uint32_t>(esp_timer_get_time() / 1000),
+                        .sentFrames = telemetry.sentFrames,
+                        .droppedFrames = telemetry.droppedFrames,
+                        .crcErrors = parser.crcErrors,
+                        .commands = latency.count,
+                        .latencyMinUs = latency.count > 0 ? latency.min : 0,
+                        .latencyMaxUs = latency.max,
+                        .latencyAvgUs = latency.Average(),
+                        .samplePeriodUs = samplePeriodUs,
+                        .streaming = 1,
+                        .channels = Channels,
+                        .enabled = enabled,
+                    };
+                    telemetry.Send(FrameType::kStats, &stats, sizeof(stats));
+                    break;
+                }
+                default:
+                    status = Status::kUnknownOpcode;
+                    break;
+            }
+            const auto latencyUs = static_cast<uint32_t>(esp_timer_get_time() - command.receivedUs);
+            latency.Add(latencyUs);
+            const ResponsePacket response{packet.id, packet.opcode, static_cast<uint8_t>(status), latencyUs,
+                packet.value};
+            telemetry.Send(FrameType::kResponse, &response, sizeof(response));
+            executed++;
+        }
+    };
+
+    struct Seen {
+        std::vector<std::string> lines;
+        std::vector<FrameType> frames;
+
+        static void Frame(void* arg, const FrameType type, uint8_t, const uint8_t*, size_t) {
+            static_cast<Seen*>(arg)->frames.push_back(type);
+        }
+
+        static void Text(void* arg, const char* line, const size_t length) {
+            static_cast<Seen*>(arg)->lines.emplace_back(line, length);
+        }
+    };
+
+    // A fresh pty with the device on one end, returns the client's end
+    const char* Connect() {
+        if (board >= 0) {
+            close(board);
+        }
+        board = posix_openpt(O_RDWR | O_NOCTTY);
+        grantpt(board);
+        unlockpt(board);
+        termios attrs{};
+        tcgetattr(board, &attrs);
+        cfmakeraw(&attrs);
+        tcsetattr(board, TCSANOW, &attrs);
+        return ptsname(board);
+    }
+
+    void Requests() {
+        const char* port = Connect();
+        Device device{3};
+        Seen seen{};
+        MeterClient client{MeterClient::Open(port), Seen::Frame, Seen::Text, &seen};
+        CHECK(client.fd >= 0);
+
+        const auto ping = client.Ping();
+        CHECK(ping.Ok() && ping.response.id == 1 && ping.response.opcode == static_cast<uint8_t>(Opcode::kPing));
+        CHECK(client.Enable(3).Ok() && client.Enable(5).Ok() && client.Disable(3).Ok());
+        CHECK(device.enabled == 1 << 5);
+        const auto period = client.SetSamplePeriod(20000);
+        CHECK(period.Ok() && period.response.value == 20000 && device.samplePeriodUs == 20000);
+        CHECK(client.deviceLatency.count == 5 && client.roundTrip.count == 5);
+
+        // everything around the responses is handed on, the stray sync bytes as part of their lines
+        CHECK(seen.lines.size() == 15 && seen.frames.size() == 15);
+        bool lines = true;
+        for (const std::string& line : seen.lines) {
+            lines &= line.starts_with("I (") && line.ends_with("\xA5 line before the response\n");
+        }
+        CHECK(lines);
+        CHECK(std::count(seen.frames.begin(), seen.frames.end(), FrameType::kSamples) == 15);
+        CHECK(client.link.CrcErrors() == 0 && device.parser.crcErrors == 0);
+    }
+
+    void Errors() {
+        const char* port = Connect();
+        Device device{1};
+        MeterClient client{MeterClient::Open(port)};
+        const auto channel = client.Enable(9);
+        CHECK(channel.answered && channel.response.status == static_cast<uint8_t>(Status::kBadChannel));
+        const auto value = client.SetSamplePeriod(10);
+        CHECK(value.answered && value.response.status == static_cast<uint8_t>(Status::kBadValue));
+        const auto opcode = client.Request(static_cast<Opcode>(0x7F));
+        CHECK(opcode.answered && opcode.response.status == static_cast<uint8_t>(Status::kUnknownOpcode));
+        // a request left unanswered times out, and its late response could not be taken for the next one's
+        const auto ripple = client.Request(Opcode::kCaptureRipple, 0, 0, 200);
+        CHECK(!ripple.answered && ripple.roundTripUs >= 200000);
+        const auto ping = client.Ping();
+        CHECK(ping.Ok() && ping.response.id == 5);
+        CHECK(device.samplePeriodUs == 50000 && device.executed == 5);
+    }
+
+    void Stats() {
+        const char* port = Connect();
+        Device device{2};
+        MeterClient client{MeterClient::Open(port)};
+        client.Enable(0);
+        client.Enable(7);
+        StatsPacket stats{};
+        CHECK(client.QueryStats(stats));
+        CHECK(stats.commands == 2 && stats.enabled == 0x81 && stats.channels == Device::Channels);
+        CHECK(stats.samplePeriodUs == 50000 && stats.crcErrors == 0 && stats.latencyMaxUs >= stats.latencyMinUs);
+        // two kSamples and a response for each of the two requests before, two kSamples ahead of the stats
+        CHECK(stats.sentFrames == 3 + 3 + 2);
+    }
+
+    // Round trips over the pty with the device chattering in between, and the command-to-effect latency the
+    // device reports for them
+    void Benchmark() {
+        const char* port = Connect();
+        Device device{3};
+        MeterClient client{MeterClient::Open(port)};
+        constexpr uint32_t Count = 2000;
+        uint32_t answered = 0;
+        for (uint32_t i = 0; i < Count; i++) {
+            answered += client.Ping().Ok();
+        }
+        CHECK(answered == Count);
+        printf("%lu requests over a pty: round trip min:%luus avg:%luus max:%luus, on the device min:%luus "
+            "avg:%luus max:%luus\n", static_cast<unsigned long>(Count),
+            static_cast<unsigned long>(client.roundTrip.min), static_cast<unsigned long>(client.roundTrip.Average()),
+            static_cast<unsigned long>(client.roundTrip.max), static_cast<unsigned long>(client.deviceLatency.min),
+            static_cast<unsigned long>(client.deviceLatency.Average()),
+            static_cast<unsigned long>(client.deviceLatency.max));
+        const double ns = check::NsPer(1000000, [&](const size_t i) {
+            uint8_t frame[Telemetry::MaxFrame];
+            const CommandPacket command{static_cast<uint16_t>(i), 0, 0, static_cast<uint32_t>(i)};
+            client.link.Feed(frame, MeterClient::Encode(FrameType::kCommand, 0, &command, sizeof(command), frame));
+        });
+        printf("Encode and parse one command frame %.1f ns\n", ns);
+    }
+}
+
+int main() {
+    Arenas::Init();
+    Requests();
+    Errors();
+    Stats();
+    Benchmark();
+    close(board);
+    return check::Result();
+}
@@ -0,0 +1,138 @@
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+
+#include "check.hh"
+#include "resampler.hh"
+
+namespace {
+    constexpr double Amplitude = 1e6; // 1A in uA
+    constexpr double Hz = 50.0;
+
+    // A 50Hz waveform, each channel shifted by a radian
+    double Wave(const int64_t timeUs, const size_t channel) {
+        return Amplitude * std::sin(2 * std::numbers::pi * Hz * static_cast<double>(timeUs) * 1e-6 +
+            static_cast<double>(channel));
+    }
+
+    // How a bus reads three channels one after the other: each register read ~100us after the previous one
+    ReadTimes Reads(const int64_t cycleUs, const size_t channel) {
+        const int64_t start = cycleUs + static_cast<int64_t>(channel) * 300;
+        return {start + 100, start, start + 200};
+    }
+
+    void PhaseShifted() {
+        constexpr uint32_t PeriodUs = 1000;
+        Resampler resampler{0b111};
+        resampler.SetPeriod(PeriodUs);
+        Packet out[3];
+        double aligned = 0;
+        double unaligned = 0;
+        size_t outputs = 0;
+        int64_t last = INT64_MIN;
+        bool onGrid = true;
+        for (int cycle = 0; cycle < 20000; cycle++) {
+            const int64_t cycleUs = cycle * 1000LL + 37;
+            for (size_t channel = 0; channel < 3; channel++) {
+                const ReadTimes times = Reads(cycleUs, channel);
+                resampler.Push(channel, {
+                    static_cast<int32_t>(Wave(times.voltage, channel)),
+                    static_cast<int32_t>(Wave(times.current, channel)),
+                    static_cast<uint32_t>(Wave(times.power, channel) + 2 * Amplitude),
+                }, times);
+                // what taking every reading of a cycle as simultaneous costs
+                unaligned = std::max(unaligned, std::fabs(Wave(times.current, channel) - Wave(cycleUs, channel)));
+            }
+            int64_t timeUs;
+            while (resampler.Next(timeUs, out)) {
+                outputs++;
+                onGrid &= timeUs % PeriodUs == 0 && timeUs > last;
+                last = timeUs;
+                for (size_t channel = 0; channel < 3; channel++) {
+                    aligned = std::max({aligned, std::fabs(out[channel].voltage - Wave(timeUs, channel)),
+                        std::fabs(out[channel].current - Wave(timeUs, channel)),
+                        std::fabs(out[channel].power - 2 * Amplitude - Wave(timeUs, channel))});
+                }
+            }
+        }
+        printf("%zu aligned instants, error max %.0f ppm of amplitude, %.0f ppm unaligned\n", outputs, aligned,
+            unaligned);
+        CHECK(onGrid);
+        CHECK(outputs >= 19990);
+        // linear interpolation over 1ms of a 50Hz sine is off by at most (2 pi 50Hz 1ms)^2 / 8 of the amplitude
+        const double bound = std::pow(2 * std::numbers::pi * Hz * 1e-3, 2) / 8 * Amplitude + 2;
+        CHECK(aligned <= bound);
+        CHECK(aligned * 10 < unaligned);
+    }
+
+    void Linear() {
+        // straight lines come out exact whatever the phase of the readings
+        Resampler resampler{0b101};
+        resampler.SetPeriod(250);
+        Packet out[2];
+        int64_t worst = 0;
+        for (int64_t t = 0; t < 200000; t += 1000) {
+            resampler.Push(0, {static_cast<int32_t>(t * 3), static_cast<int32_t>(-t), static_cast<uint32_t>(t)},
+                {t + 13, t + 13, t + 13});
+            resampler.Push(2, {static_cast<int32_t>(t), 0, 0}, {t + 611, t + 611, t + 611});
+            int64_t timeUs;
+            while (resampler.Next(timeUs, out)) {
+                worst = std::max({worst, std::abs(out[0].voltage - (timeUs - 13) * 3),
+                    std::abs(out[0].current + (timeUs - 13)), std::abs(out[1].voltage - (timeUs - 611))});
+            }
+        }
+        CHECK(worst <= 1);
+        resampler.SetPeriod(0);
+        int64_t timeUs;
+        CHECK(!resampler.Next(timeUs, out));
+    }
+
+    void Rates() {
+        // a channel at the fast period next to one at the base period, 10:1 as the adaptive rate defaults to
+        Resampler resampler{0b11};
+        resampler.SetPeriod(5000);
+        Packet out[2];
+        size_t outputs = 0;
+        for (int64_t t = 0; t < 1000000; t += 1000) {
+            resampler.Push(0, {static_cast<int32_t>(t), 0, 0}, {t, t, t});
+            if (t % 10000 == 0) {
+                const int64_t slow = t + 500;
+                resampler.Push(1, {static_cast<int32_t>(slow), 0, 0}, {slow, slow, slow});
+            }
+            int64_t timeUs;
+            while (resampler.Next(timeUs, out)) {
+                outputs++;
+                CHECK(out[0].voltage == timeUs && out[1].voltage == timeUs);
+            }
+        }
+        CHECK(outputs >= 195);
+    }
+
+    void Benchmark() {
+        Resampler resampler{0b111};
+        resampler.SetPeriod(1000);
+        Packet out[3];
+        size_t outputs = 0;
+        constexpr size_t Cycles = 1000000;
+        const double ns = check::NsPer(Cycles, [&](const size_t cycle) {
+            const auto cycleUs = static_cast<int64_t>(cycle) * 1000;
+            for (size_t channel = 0; channel < 3; channel++) {
+                const auto value = static_cast<int32_t>(cycle);
+                resampler.Push(channel, {value, value, static_cast<uint32_t>(value)}, Reads(cycleUs, channel));
+            }
+            int64_t timeUs;
+            while (resampler.Next(timeUs, out)) {
+                outputs++;
+            }
+        });
+        printf("resampling: %.1f ns per channel sample (%zu instants)\n", ns / 3, outputs);
+    }
+}
+
+int main() {
+    PhaseShifted();
+    Linear();
+    Rates();
+    Benchmark();
+    return check::Result();
+}
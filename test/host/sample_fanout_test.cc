@@ -0,0 +1,210 @@
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <freertos/task.h>
+
+#include "check.hh"
+#include "sample_fanout.hh"
+
+namespace {
+    // About the size of a SampleFrame, every word derived from the sequence number so a torn or reused block shows
+    struct Item {
+        uint64_t seq;
+        uint64_t data[96];
+    };
+
+    void Fill(Item& item, const uint64_t seq) {
+        item.seq = seq;
+        for (size_t i = 0; i < std::size(item.data); i++) {
+            item.data[i] = seq * 31 + i;
+        }
+    }
+
+    bool Intact(const Item& item) {
+        for (size_t i = 0; i < std::size(item.data); i++) {
+            if (item.data[i] != item.seq * 31 + i) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::vector<uint64_t> Drain(Fanout<Item>::Subscriber& subscriber) {
+        std::vector<uint64_t> seqs;
+        while (const Item* item = subscriber.Pop()) {
+            seqs.push_back(item->seq);
+            subscriber.Release(item);
+        }
+        return seqs;
+    }
+
+    // What each policy keeps of a burst nobody drains
+    void Policies() {
+        constexpr Subscription subscriptions[] = {
+            {"lossless", FanoutPolicy::kLossless, 4},
+            {"oldest", FanoutPolicy::kDropOldest, 3}, // rounded up to 4
+            {"latest", FanoutPolicy::kLatest, 0},
+        };
+        Fanout<Item> fanout{subscriptions, 3};
+        CHECK(fanout.pool.capacity == 13);
+        for (uint64_t seq = 0; seq < 10; seq++) {
+            Fill(*fanout.Next(), seq);
+            fanout.Publish();
+        }
+        CHECK(fanout[0].Lag() == 4 && fanout[1].Lag() == 4 && fanout[2].Lag() == 1);
+        CHECK(Drain(fanout[0]) == (std::vector<uint64_t>{0, 1, 2, 3}) && fanout[0].dropped == 6);
+        CHECK(Drain(fanout[1]) == (std::vector<uint64_t>{6, 7, 8, 9}) && fanout[1].dropped == 6);
+        CHECK(Drain(fanout[2]) == (std::vector<uint64_t>{9}) && fanout[2].dropped == 9 && fanout[2].Lag() == 0);
+        CHECK(fanout[0].delivered == 4 && fanout[1].delivered == 10 && fanout[1].maxLag == 4);
+        // the latest block replaces the one still waiting, never one the consumer holds
+        Fill(*fanout.Next(), 10);
+        fanout.Publish();
+        const Item* held = fanout[2].Pop();
+        for (uint64_t seq = 11; seq < 14; seq++) {
+            Fill(*fanout.Next(), seq);
+            fanout.Publish();
+        }
+        CHECK(held->seq == 10 && Intact(*held));
+        fanout[2].Release(held);
+        CHECK(Drain(fanout[2]) == (std::vector<uint64_t>{13}));
+        Drain(fanout[0]);
+        Drain(fanout[1]);
+        CHECK(fanout.pool.inUse == 0 && fanout.pool.exhausted == 0);
+        // a block that was filled but not published is offered again by the next Next()
+        Item* unpublished = fanout.Next();
+        CHECK(fanout.Next() == unpublished && fanout.pool.inUse == 1);
+    }
+
+    // Every queue full and every consumer holding a block still leaves one for the producer to fill
+    void Sizing() {
+        constexpr Subscription subscriptions[] = {
+            {"stream", FanoutPolicy::kLossless, 16},
+            {"display", FanoutPolicy::kDropOldest, 8},
+            {"status", FanoutPolicy::kLatest, 0},
+        };
+        Fanout<Item> fanout{subscriptions, 3};
+        CHECK(fanout.pool.capacity == Fanout<Item>::Blocks(subscriptions, 3) && fanout.pool.capacity == 29);
+        for (uint64_t seq = 0; seq < 100; seq++) {
+            Fill(*fanout.Next(), seq);
+            fanout.Publish();
+        }
+        const Item* held[] = {fanout[0].Pop(), fanout[1].Pop(), fanout[2].Pop()};
+        for (uint64_t seq = 100; seq < 200; seq++) {
+            Item* item = fanout.Next();
+            CHECK(item != nullptr);
+            if (item == nullptr) {
+                break;
+            }
+            Fill(*item, seq);
+            fanout.Publish();
+        }
+        CHECK(fanout.pool.exhausted == 0);
+        CHECK(held[0]->seq == 0 && Intact(*held[0]) && held[1]->seq == 92 && Intact(*held[1]));
+        CHECK(held[2]->seq == 99 && Intact(*held[2]));
+        for (size_t i = 0; i < 3; i++) {
+            fanout[i].Release(held[i]);
+            Drain(fanout[i]);
+        }
+        CHECK(fanout.pool.inUse == 0);
+    }
+
+    struct Consumer {
+        Fanout<Item>::Subscriber* subscriber;
+        const std::atomic<bool>* done;
+        uint32_t holdUs; // keeps each block this long, a consumer slower than the producer
+        uint64_t popped{0};
+        uint64_t last{0};
+        bool intact{true};
+        bool ordered{true};
+        std::atomic<bool> finished{false};
+    };
+
+    // One producer that never waits, consumers on tasks of their own at different speeds: whatever reaches a
+    // consumer is intact and in order, the rest is counted as dropped, and every block comes back
+    void Threads() {
+        constexpr Subscription subscriptions[] = {
+            {"stream", FanoutPolicy::kLossless, 256},
+            {"display", FanoutPolicy::kDropOldest, 8},
+            {"stats", FanoutPolicy::kLossless, 256},
+            {"status", FanoutPolicy::kLatest, 0},
+        };
+        Fanout<Item> fanout{subscriptions, 4, Region::kPsramBulk}; // 526 blocks
+        std::atomic<bool> done{false};
+        Consumer consumers[] = {
+            {&fanout[0], &done, 0}, {&fanout[1], &done, 200}, {&fanout[2], &done, 0}, {&fanout[3], &done, 300},
+        };
+        for (Consumer& consumer : consumers) {
+            xTaskCreatePinnedToCore([](void* arg) {
+                auto& consumer = *static_cast<Consumer*>(arg);
+                while (true) {
+                    const Item* item = consumer.subscriber->Pop();
+                    if (item == nullptr) {
+                        if (*consumer.done && consumer.subscriber->Lag() == 0) {
+                            break;
+                        }
+                        std::this_thread::yield();
+                        continue;
+                    }
+                    consumer.ordered &= consumer.popped == 0 || item->seq > consumer.last;
+                    consumer.last = item->seq;
+                    consumer.popped++;
+                    if (consumer.holdUs > 0) {
+                        std::this_thread::sleep_for(std::chrono::microseconds(consumer.holdUs));
+                    }
+                    // still untouched by the producer while held
+                    consumer.intact &= Intact(*item);
+                    consumer.subscriber->Release(item);
+                }
+                consumer.finished = true;
+                vTaskDelete(nullptr);
+            }, "Consumer", 4096, &consumer, 3, nullptr, 0);
+        }
+        constexpr uint64_t Count = 500000;
+        uint64_t missing = 0;
+        const auto start = std::chrono::steady_clock::now();
+        for (uint64_t seq = 0; seq < Count; seq++) {
+            Item* item = fanout.Next();
+            if (item == nullptr) {
+                missing++;
+                continue;
+            }
+            Fill(*item, seq);
+            fanout.Publish();
+            // let the consumers in, on one CPU the producer would otherwise fill every queue alone
+            if (seq % 16 == 0) {
+                std::this_thread::yield();
+            }
+        }
+        const double publishNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start)
+            .count() / Count;
+        done = true;
+        for (const Consumer& consumer : consumers) {
+            while (!consumer.finished) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+        printf("%llu blocks to 4 subscribers, %.0f ns per fill and publish, pool of %zu\n",
+            static_cast<unsigned long long>(Count), publishNs, fanout.pool.capacity);
+        for (const Consumer& consumer : consumers) {
+            const auto& subscriber = *consumer.subscriber;
+            printf("  %-8s %7llu popped, %7lu dropped, lag max %lu\n", subscriber.name,
+                static_cast<unsigned long long>(consumer.popped), static_cast<unsigned long>(subscriber.dropped),
+                static_cast<unsigned long>(subscriber.maxLag));
+            CHECK(consumer.intact && consumer.ordered);
+            CHECK(consumer.popped + subscriber.dropped == Count);
+        }
+        CHECK(consumers[1].popped < Count / 10 && consumers[3].popped < Count / 10);
+        // however slow, the latest-only subscriber ends on the last block published
+        CHECK(consumers[3].last == Count - 1);
+        CHECK(missing == 0 && fanout.pool.exhausted == 0);
+        CHECK(fanout.pool.inUse == 0);
+    }
+}
+
+int main() {
+    Arenas::Init();
+    Policies();
+    Sizing();
+    Threads();
+    return check::Result();
+}
@@ -0,0 +1,113 @@
+#include <chrono>
+#include <thread>
+#include <freertos/task.h>
+
+#include "check.hh"
+#include "seqlock.hh"
+
+namespace {
+    // About the size of a RippleReport, every word derived from the sequence number so a torn read shows
+    struct Item {
+        uint32_t seq;
+        uint32_t data[11];
+    };
+
+    Item Make(const uint32_t seq) {
+        Item item{seq, {}};
+        for (size_t i = 0; i < std::size(item.data); i++) {
+            item.data[i] = seq * 31 + static_cast<uint32_t>(i);
+        }
+        return item;
+    }
+
+    bool Intact(const Item& item) {
+        for (size_t i = 0; i < std::size(item.data); i++) {
+            if (item.data[i] != item.seq * 31 + i) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void Single() {
+        Seqlock<Item> lock{};
+        CHECK(lock.Read().seq == 0);
+        lock.Write(Make(7));
+        const Item item = lock.Read();
+        CHECK(item.seq == 7 && Intact(item) && lock.sequence == 2);
+    }
+
+    struct Reader {
+        const Seqlock<Item>* lock;
+        const std::atomic<bool>* done;
+        uint64_t reads{0};
+        uint32_t last{0};
+        bool intact{true};
+        bool ordered{true};
+        std::atomic<bool> finished{false};
+    };
+
+    // A writer that never waits and readers on tasks of their own: every read is one whole value, never older
+    // than the one before
+    void Threads() {
+        Seqlock<Item> lock{};
+        lock.Write(Make(0));
+        std::atomic<bool> done{false};
+        Reader readers[] = {{&lock, &done}, {&lock, &done}};
+        for (Reader& reader : readers) {
+            xTaskCreatePinnedToCore([](void* arg) {
+                auto& reader = *static_cast<Reader*>(arg);
+                while (!*reader.done) {
+                    const Item item = reader.lock->Read();
+                    reader.intact &= Intact(item);
+                    reader.ordered &= item.seq >= reader.last;
+                    reader.last = item.seq;
+                    if (++reader.reads % 64 == 0) {
+                        std::this_thread::yield();
+                    }
+                }
+                reader.finished = true;
+                vTaskDelete(nullptr);
+            }, "Reader", 4096, &reader, 3, nullptr, 0);
+        }
+        constexpr uint32_t Count = 2000000;
+        for (uint32_t seq = 1; seq <= Count; seq++) {
+            lock.Write(Make(seq));
+            // let the readers in, on one CPU the writer would otherwise finish alone
+            if (seq % 16 == 0) {
+                std::this_thread::yield();
+            }
+        }
+        done = true;
+        for (const Reader& reader : readers) {
+            while (!reader.finished) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+        for (const Reader& reader : readers) {
+            printf("reader: %llu reads, last %lu\n", static_cast<unsigned long long>(reader.reads),
+                static_cast<unsigned long>(reader.last));
+            CHECK(reader.intact && reader.ordered && reader.reads > 0);
+        }
+        CHECK(lock.Read().seq == Count);
+    }
+
+    void Benchmark() {
+        Seqlock<Item> lock{};
+        volatile uint32_t sink = 0;
+        const double write = check::NsPer(5000000, [&](const size_t i) {
+            lock.Write(Make(static_cast<uint32_t>(i)));
+        });
+        const double read = check::NsPer(5000000, [&](size_t) {
+            sink = sink + lock.Read().seq;
+        });
+        printf("Seqlock<%zu bytes> write %.1f ns, read %.1f ns uncontended\n", sizeof(Item), write, read);
+    }
+}
+
+int main() {
+    Single();
+    Threads();
+    Benchmark();
+    return check::Result();
+}
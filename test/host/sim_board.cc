@@ -0,0 +1,195 @@
+#include "sim_board.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+
+#include <driver/gpio.h>
+#include <driver/i2c_master.h>
+#include <esp_timer.h>
+
+using Clock = std::chrono::steady_clock;
+
+struct HostI2CBus {
+    sim::Bus* bus;
+    std::mutex lock;
+    Clock::time_point free;
+};
+
+struct HostI2CDevice {
+    HostI2CBus* bus;
+    sim::Ina219* chip;
+    uint32_t sclHz;
+};
+
+namespace {
+    constexpr int Ports = 2;
+    constexpr int Gpios = 64;
+
+    sim::Bus buses[Ports];
+    HostI2CBus hostBuses[Ports];
+    std::atomic<int> levels[Gpios]{};
+
+    int32_t Clamp(const double value, const int32_t lo, const int32_t hi) {
+        return static_cast<int32_t>(std::clamp(std::lround(value), static_cast<long>(lo), static_cast<long>(hi)));
+    }
+
+    // Occupies the bus for the transaction's bits and returns the time at its middle
+    int64_t Occupy(HostI2CDevice* device, const size_t bytes) {
+        const auto bits = static_cast<int64_t>(2 + 9 * bytes);
+        const auto duration = std::chrono::microseconds(sim::Bus::OverheadUs + bits * 1000000 / device->sclHz);
+        const Clock::time_point now = Clock::now();
+        const Clock::time_point start = std::max(now, device->bus->free);
+        device->bus->free = start + duration;
+        device->bus->bus->transactions++;
+        return esp_timer_get_time() + std::chrono::duration_cast<std::chrono::microseconds>(
+            start - now + duration / 2).count();
+    }
+}
+
+int32_t sim::DatasheetCurrent(const int16_t shunt, const uint16_t calibration) {
+    return static_cast<int32_t>(static_cast<int64_t>(shunt) * (calibration & 0xFFFE) / 4096);
+}
+
+uint32_t sim::DatasheetPower(const int32_t current, const uint16_t bus) {
+    return static_cast<uint32_t>(static_cast<int64_t>(std::abs(current)) * (bus >> 3) / 5000);
+}
+
+uint16_t sim::Ina219::Register(const uint8_t reg, const int64_t timeUs) const {
+    const Load load = signal(arg, timeUs);
+    // /8 gain: +-320mV across the shunt in 10uV steps, 32V on the bus in 4mV steps with the conversion ready flag
+    const auto shunt = static_cast<int16_t>(Clamp(load.amps * shuntOhm / 10e-6, -32000, 32000));
+    const auto bus = static_cast<uint16_t>(Clamp(load.busVolts / 0.004, 0, 8000) << 3 | 0x2);
+    const auto current = static_cast<int16_t>(std::clamp(DatasheetCurrent(shunt, calibration), -32768, 32767));
+    switch (reg) {
+        case 0x00: return config;
+        case 0x01: return static_cast<uint16_t>(shunt);
+        case 0x02: return bus;
+        case 0x03: return static_cast<uint16_t>(std::min<uint32_t>(DatasheetPower(current, bus), 0xFFFF));
+        case 0x04: return static_cast<uint16_t>(current);
+        case 0x05: return calibration & 0xFFFE;
+        default: return 0;
+    }
+}
+
+sim::Ina219& sim::Bus::Attach(const uint16_t address, const Signal signal, const void* arg, const float shuntOhm) {
+    Ina219& chip = chips[count++];
+    chip.address = address;
+    chip.shuntOhm = shuntOhm;
+    chip.signal = signal;
+    chip.arg = arg;
+    return chip;
+}
+
+sim::Ina219* sim::Bus::Find(const uint16_t address) {
+    for (size_t i = 0; i < count; i++) {
+        if (chips[i].address == address) {
+            return &chips[i];
+        }
+    }
+    return nullptr;
+}
+
+sim::Bus& sim::GetBus(const int port) {
+    buses[port].port = port;
+    return buses[port];
+}
+
+void sim::Reset() {
+    for (int port = 0; port < Ports; port++) {
+        for (Ina219& chip : buses[port].chips) {
+            chip.address = 0;
+            chip.signal = nullptr;
+            chip.config = 0x399F;
+            chip.calibration = 0;
+            chip.reads = 0;
+        }
+        buses[port].count = 0;
+        buses[port].transactions = 0;
+    }
+}
+
+int sim::Level(const int gpio) { return levels[gpio]; }
+
+esp_err_t i2c_new_master_bus(const i2c_master_bus_config_t* config, i2c_master_bus_handle_t* bus) {
+    if (config->i2c_port < 0 || config->i2c_port >= Ports) {
+        return ESP_FAIL;
+    }
+    HostI2CBus& host = hostBuses[config->i2c_port];
+    host.bus = &sim::GetBus(config->i2c_port);
+    host.free = Clock::now();
+    *bus = &host;
+    return ESP_OK;
+}
+
+esp_err_t i2c_del_master_bus(i2c_master_bus_handle_t) { return ESP_OK; }
+
+esp_err_t i2c_master_bus_add_device(const i2c_master_bus_handle_t bus, const i2c_device_config_t* config,
+                                    i2c_master_dev_handle_t* device) {
+    sim::Ina219* chip = bus->bus->Find(config->device_address);
+    if (chip == nullptr) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    *device = new HostI2CDevice{bus, chip, config->scl_speed_hz};
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_bus_rm_device(const i2c_master_dev_handle_t device) {
+    delete device;
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_transmit_receive(const i2c_master_dev_handle_t device, const uint8_t* tx, const size_t txSize,
+                                      uint8_t* rx, const size_t rxSize, int) {
+    std::lock_guard guard{device->bus->lock};
+    const int64_t timeUs = Occupy(device, 2 + txSize + rxSize);
+    const uint16_t value = device->chip->Register(tx[0], timeUs);
+    device->chip->reads++;
+    if (rxSize >= 2) {
+        rx[0] = value >> 8;
+        rx[1] = value & 0xFF;
+    }
+    std::this_thread::sleep_until(device->bus->free);
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_transmit(const i2c_master_dev_handle_t device, const uint8_t* tx, const size_t txSize, int) {
+    std::lock_guard guard{device->bus->lock};
+    Occupy(device, 1 + txSize);
+    if (txSize == 3) {
+        const auto value = static_cast<uint16_t>(tx[1] << 8 | tx[2]);
+        if (tx[0] == 0x00) {
+            device->chip->config = value;
+        } else if (tx[0] == 0x05) {
+            device->chip->calibration = value;
+        }
+    }
+    std::this_thread::sleep_until(device->bus->free);
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_direction(gpio_num_t, int) { return ESP_OK; }
+
+esp_err_t gpio_pullup_en(gpio_num_t) { return ESP_OK; }
+
+esp_err_t gpio_pullup_dis(gpio_num_t) { return ESP_OK; }
+
+esp_err_t gpio_pulldown_en(gpio_num_t) { return ESP_OK; }
+
+esp_err_t gpio_pulldown_dis(gpio_num_t) { return ESP_OK; }
+
+int gpio_get_level(const gpio_num_t gpio) { return levels[gpio]; }
+
+esp_err_t gpio_set_level(const gpio_num_t gpio, const uint32_t level) {
+    levels[gpio] = static_cast<int>(level);
+    return ESP_OK;
+}
+
+esp_err_t gpio_install_isr_service(int) { return ESP_OK; }
+
+esp_err_t gpio_set_intr_type(gpio_num_t, int) { return ESP_OK; }
+
+esp_err_t gpio_isr_handler_add(gpio_num_t, void (*)(void*), void*) { return ESP_OK; }
@@ -0,0 +1,64 @@
+#ifndef SIM_BOARD_HH
+#define SIM_BOARD_HH
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Simulated INA219s on simulated I2C buses behind the driver stubs. A chip converts its load as the datasheet
+// describes whenever a register is read; a bus carries one transaction at a time and each takes as long as its
+// bits do at the device's clock, plus a fixed driver overhead, during which the calling task sleeps as it would
+// on the interrupt-driven driver.
+namespace sim {
+    // Electrical state at the chip's inputs at `timeUs`
+    struct Load {
+        float busVolts;
+        float amps;
+    };
+
+    using Signal = Load (*)(const void* arg, int64_t timeUs);
+
+    struct Ina219 {
+        uint16_t address{0};
+        float shuntOhm{0.1f};
+        Signal signal{};
+        const void* arg{};
+        uint16_t config{0x399F};
+        uint16_t calibration{0};
+        std::atomic<uint32_t> reads{0};
+
+        // Register contents as of `timeUs`, current and power as the chip computes them
+        [[nodiscard]] uint16_t Register(uint8_t reg, int64_t timeUs) const;
+    };
+
+    struct Bus {
+        static constexpr size_t MaxChips = 16;
+        static constexpr int64_t OverheadUs = 20;
+
+        int port{0};
+        Ina219 chips[MaxChips]{};
+        size_t count{0};
+        std::atomic<uint32_t> transactions{0};
+
+        Ina219& Attach(uint16_t address, Signal signal, const void* arg, float shuntOhm = 0.1f);
+
+        [[nodiscard]] Ina219* Find(uint16_t address);
+    };
+
+    // The simulated bus behind I2C port `port`, chips are attached before the firmware opens the bus
+    Bus& GetBus(int port);
+
+    // Drops every chip and transaction count
+    void Reset();
+
+    // Level last set on an output GPIO
+    [[nodiscard]] int Level(int gpio);
+
+    // Datasheet register formulas in wide arithmetic, truncated towards zero, before they are fit into the 16 bit
+    // registers. Bit 0 of the calibration register is not implemented and the power register holds a magnitude.
+    [[nodiscard]] int32_t DatasheetCurrent(int16_t shunt, uint16_t calibration);
+
+    [[nodiscard]] uint32_t DatasheetPower(int32_t current, uint16_t bus);
+}
+
+#endif //SIM_BOARD_HH
@@ -0,0 +1,77 @@
+#include <cmath>
+#include <numbers>
+#include <random>
+#include <vector>
+
+#include "check.hh"
+#include "spectrum.hh"
+
+namespace {
+    constexpr float SampleRate = 5000.0f;
+
+    // 0.5A DC with two ripple tones and white noise, as a switching regulator's output current might look
+    std::vector<float> Synthetic(const size_t size, const float noise, const unsigned seed) {
+        std::mt19937 rng{seed};
+        std::normal_distribution<float> gaussian{0.0f, noise};
+        std::vector<float> samples(size);
+        for (size_t i = 0; i < size; i++) {
+            const float t = static_cast<float>(i) / SampleRate;
+            samples[i] = 0.5f + 0.02f * std::sin(2 * std::numbers::pi_v<float> * 437.3f * t) +
+                0.008f * std::sin(2 * std::numbers::pi_v<float> * 1210.0f * t + 1.0f) + gaussian(rng);
+        }
+        return samples;
+    }
+
+    void Peaks() {
+        for (const size_t size : {256, 1024, 4096}) {
+            Spectrum spectrum{size};
+            const std::vector<float> samples = Synthetic(size, 0.002f, 5);
+            const RippleReport report = RippleReport::Analyze(spectrum, samples.data(), SampleRate);
+            const float resolution = SampleRate / static_cast<float>(size);
+            printf("%4zu points: %zu peaks, %.1fHz %.4fA, %.1fHz %.4fA, floor %.5fA\n", size, report.peakCount,
+                report.peaks[0].frequency, report.peaks[0].amplitude, report.peaks[1].frequency,
+                report.peaks[1].amplitude, report.noiseFloor);
+            CHECK(report.peakCount >= 2);
+            // interpolation between bins gets well within one bin of the true frequency
+            CHECK(std::fabs(report.peaks[0].frequency - 437.3f) < resolution / 2);
+            CHECK(std::fabs(report.peaks[0].amplitude - 0.02f) < 0.002f);
+            CHECK(std::fabs(report.peaks[1].frequency - 1210.0f) < resolution / 2);
+            CHECK(std::fabs(report.peaks[1].amplitude - 0.008f) < 0.0015f);
+            CHECK(std::fabs(report.mean - 0.5f) < 0.001f);
+            CHECK(report.peakToPeak > 0.045f && report.peakToPeak < 0.07f);
+            CHECK(report.noiseFloor < 0.002f);
+        }
+    }
+
+    void NoiseOnly() {
+        // nothing stands out of pure noise, and a flat line has no ripple at all
+        Spectrum spectrum{1024};
+        std::mt19937 rng{9};
+        std::normal_distribution<float> gaussian{0.1f, 0.003f};
+        std::vector<float> samples(1024);
+        for (float& sample : samples) {
+            sample = gaussian(rng);
+        }
+        CHECK(RippleReport::Analyze(spectrum, samples.data(), SampleRate, 8.0f).peakCount == 0);
+        std::fill(samples.begin(), samples.end(), 0.25f);
+        const RippleReport flat = RippleReport::Analyze(spectrum, samples.data(), SampleRate);
+        CHECK(flat.peakCount == 0 && flat.peakToPeak == 0.0f);
+    }
+
+    void Benchmark() {
+        for (const size_t size : {64, 256, 1024, 4096}) {
+            Spectrum spectrum{size};
+            const std::vector<float> samples = Synthetic(size, 0.002f, 7);
+            const double ns = check::NsPer(2000, [&](size_t) { spectrum.Compute(samples.data()); });
+            printf("FFT %4zu points: %7.1f us\n", size, ns / 1000.0);
+        }
+    }
+}
+
+int main() {
+    Arenas::Init();
+    Peaks();
+    NoiseOnly();
+    Benchmark();
+    return check::Result();
+}
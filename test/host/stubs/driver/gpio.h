@@ -0,0 +1,22 @@
+#pragma once
+// Host stand-in for the GPIO driver, levels are kept by sim_board.cc
+
+#include <cstdint>
+
+#include "../esp_err.h"
+
+typedef int gpio_num_t;
+
+enum { GPIO_MODE_INPUT, GPIO_MODE_OUTPUT };
+enum { GPIO_INTR_NEGEDGE, GPIO_INTR_POSEDGE, GPIO_INTR_ANYEDGE };
+
+esp_err_t gpio_set_direction(gpio_num_t gpio, int mode);
+esp_err_t gpio_pullup_en(gpio_num_t gpio);
+esp_err_t gpio_pullup_dis(gpio_num_t gpio);
+esp_err_t gpio_pulldown_en(gpio_num_t gpio);
+esp_err_t gpio_pulldown_dis(gpio_num_t gpio);
+int gpio_get_level(gpio_num_t gpio);
+esp_err_t gpio_set_level(gpio_num_t gpio, uint32_t level);
+esp_err_t gpio_install_isr_service(int flags);
+esp_err_t gpio_set_intr_type(gpio_num_t gpio, int type);
+esp_err_t gpio_isr_handler_add(gpio_num_t gpio, void (*handler)(void*), void* arg);
@@ -0,0 +1,3 @@
+#pragma once
+
+#include "i2c_master.h"
@@ -0,0 +1,38 @@
+#pragma once
+// Host stand-in for the I2C master driver, transactions go to the simulated chips of sim_board.hh
+
+#include <cstddef>
+#include <cstdint>
+
+#include "../esp_err.h"
+#include "gpio.h"
+
+typedef struct HostI2CBus* i2c_master_bus_handle_t;
+typedef struct HostI2CDevice* i2c_master_dev_handle_t;
+typedef int i2c_port_num_t;
+
+enum { I2C_NUM_0 = 0, I2C_NUM_1 = 1 };
+enum { I2C_CLK_SRC_DEFAULT = 0 };
+enum { I2C_ADDR_BIT_LEN_7 = 0 };
+
+typedef struct {
+    int clk_source;
+    i2c_port_num_t i2c_port;
+    gpio_num_t sda_io_num;
+    gpio_num_t scl_io_num;
+} i2c_master_bus_config_t;
+
+typedef struct {
+    int dev_addr_length;
+    uint16_t device_address;
+    uint32_t scl_speed_hz;
+} i2c_device_config_t;
+
+esp_err_t i2c_new_master_bus(const i2c_master_bus_config_t* config, i2c_master_bus_handle_t* bus);
+esp_err_t i2c_del_master_bus(i2c_master_bus_handle_t bus);
+esp_err_t i2c_master_bus_add_device(i2c_master_bus_handle_t bus, const i2c_device_config_t* config,
+                                    i2c_master_dev_handle_t* device);
+esp_err_t i2c_master_bus_rm_device(i2c_master_dev_handle_t device);
+esp_err_t i2c_master_transmit_receive(i2c_master_dev_handle_t device, const uint8_t* tx, size_t txSize, uint8_t* rx,
+                                      size_t rxSize, int timeoutMs);
+esp_err_t i2c_master_transmit(i2c_master_dev_handle_t device, const uint8_t* tx, size_t txSize, int timeoutMs);
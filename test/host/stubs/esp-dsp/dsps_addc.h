@@ -0,0 +1,12 @@
+#pragma once
+// Host stand-in for ESP-DSP: the library's portable (ANSI C) version, one rounded addition per element
+
+#include <esp_err.h>
+
+inline esp_err_t dsps_addc_f32(const float* input, float* output, const int len, const float C, const int step_in,
+                               const int step_out) {
+    for (int i = 0; i < len; i++) {
+        output[i * step_out] = input[i * step_in] + C;
+    }
+    return ESP_OK;
+}
@@ -0,0 +1,13 @@
+#pragma once
+// Host stand-in for ESP-DSP: the library's portable (ANSI C) version, one rounded multiplication per element.
+// Only the targets testing the ESP-DSP path of the kernels put this directory on their include path.
+
+#include <esp_err.h>
+
+inline esp_err_t dsps_mulc_f32(const float* input, float* output, const int len, const float C, const int step_in,
+                               const int step_out) {
+    for (int i = 0; i < len; i++) {
+        output[i * step_out] = input[i * step_in] * C;
+    }
+    return ESP_OK;
+}
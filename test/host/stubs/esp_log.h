@@ -0,0 +1,10 @@
+#pragma once
+// Host stand-in: log lines go to stdout. Not format-checked, the firmware's %u for size_t is right on the
+// 32-bit target only.
+
+void esp_log_host(char level, const char* tag, const char* format, ...);
+
+#define ESP_LOGE(tag, format, ...) esp_log_host('E', tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) esp_log_host('W', tag, format, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) esp_log_host('I', tag, format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) do { } while (0)
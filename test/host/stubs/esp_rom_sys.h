@@ -0,0 +1,5 @@
+#pragma once
+
+#include <cstdio>
+
+#define esp_rom_printf printf
@@ -0,0 +1,6 @@
+#pragma once
+
+#include <cstdint>
+
+[[noreturn]] void esp_system_abort(const char* details);
+uint32_t esp_get_free_heap_size();
@@ -0,0 +1,6 @@
+#pragma once
+// Host stand-in: microseconds since the test started
+
+#include <cstdint>
+
+int64_t esp_timer_get_time();
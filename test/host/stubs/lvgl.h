@@ -0,0 +1,22 @@
+#pragma once
+// Host stand-in: the LVGL types and calls the display mirror uses, the test that links it defines the calls
+
+#include <cstdint>
+
+typedef int16_t lv_coord_t;
+
+typedef struct {
+    lv_coord_t x1;
+    lv_coord_t y1;
+    lv_coord_t x2;
+    lv_coord_t y2;
+} lv_area_t;
+
+typedef union {
+    uint16_t full;
+} lv_color_t;
+
+typedef struct HostLvObj lv_obj_t;
+
+lv_obj_t* lv_scr_act();
+void lv_obj_invalidate(const lv_obj_t* obj);